@@ -0,0 +1,157 @@
+//****************************************************************************
+// FILE: bench-codegen.cxx
+// Scaling benchmark for the threads of the CU code generator
+// Version date: Oct 18, 2026
+// This program generates a CU program with many functions, parses and
+// traverses it once, and then runs the code generator on the decorated
+// tree with 1, 2, 3, ... threads (see --threads in cu.cxx).  For each
+// number of threads, it prints the wall-clock time of the code generator
+// and its speedup over one thread.  The assembly code is not kept, but
+// its length and a checksum of its bytes are compared with those of the
+// run with one thread, since the output should not depend on the number
+// of threads.
+// The necessary commands are the same as for cu (see cu.cxx), with
+// bench-codegen.o in place of cu.o:
+// 1. g++ -Wall -O2 -c bench-codegen.cxx
+// 2. g++ bench-codegen.o cu.tab.o cu.lex.o cu.timing.o cu.traverser.o cu.fold.o cu.types.o cu.codegen.o cu.cache.o cu.emitter.o cu.ir.o cu.peephole.o cu.object.o tree.o intern.o -o bench-codegen -lpthread
+// You can then run the benchmark with the number of functions and the
+// largest number of threads:
+// bench-codegen 20000 8
+//*****************************************************************************
+#include <cstdio>           // Provides FILE, tmpfile, fprintf
+#include <cstdlib>          // Provides atoi
+#include <iomanip>          // Provides setw
+#include <iostream>         // Provides cout
+#include <streambuf>        // Provides streambuf
+#include <sys/time.h>       // Provides gettimeofday
+#include <unistd.h>         // Provides sysconf
+#include "tree.h"           // Provides the colorado::tree class
+#include "cu.compilation.h" // Provides the compilation struct and phases
+using namespace std;        // cout and endl are in std::
+using namespace colorado;   // tree class
+
+// Wall-clock time in seconds, since the code generator runs in several
+// threads at once:
+double now( )
+{
+    timeval t;
+
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec / 1e6;
+}
+
+// A stream buffer that throws away the generated assembly code, but keeps
+// its length and a checksum (FNV-1a) of its bytes:
+class checksum_buffer : public streambuf
+{
+public:
+    checksum_buffer( ) : bytes(0), sum(2166136261u) { }
+    long bytes;
+    unsigned int sum;
+protected:
+    int overflow(int c)
+    {
+	if (c != EOF)
+	{
+	    ++bytes;
+	    sum = (sum ^ (unsigned char)(c)) * 16777619u;
+	}
+	return c;
+    }
+    streamsize xsputn(const char* s, streamsize n)
+    {
+	streamsize i;
+
+	for (i = 0; i < n; ++i)
+	    sum = (sum ^ (unsigned char)(s[i])) * 16777619u;
+	bytes += n;
+	return n;
+    }
+};
+
+// Writes a CU program with the given number of functions to a temporary
+// file, and returns that file (positioned at its start).  Each function
+// has a loop, a decision, a string constant and a call of the function
+// before it, and every tenth one has a function of its own inside it.
+FILE* generate(int many)
+{
+    FILE* file = tmpfile( );
+    int i;
+
+    fprintf(file, "|int| total is initially 0;\n");
+    for (i = 0; i < many; ++i)
+    {
+	fprintf(file, "function f%d(|int| a) returns |int|\n{\n", i);
+	fprintf(file, "    |int| i is initially 0;\n");
+	if (i % 10 == 0)
+	    fprintf(file, "    function g%d( ) returns |int|\n    {\n"
+		    "        return total + %d;\n    }\n", i, i);
+	fprintf(file, "    while (i < a) do\n    {\n");
+	fprintf(file, "        total = total + i * %d;\n", i % 7 + 1);
+	fprintf(file, "        i = i + 1;\n    }\n    od\n");
+	fprintf(file, "    if (total > %d) then write \"f%d\"; fi\n", i, i);
+	if (i % 10 == 0)
+	    fprintf(file, "    total = total + g%d( );\n", i);
+	if (i > 0)
+	    fprintf(file, "    return f%d(a - 1) + i;\n}\n", i - 1);
+	else
+	    fprintf(file, "    return i;\n}\n");
+    }
+    fprintf(file, "function main ( ) returns |int|\n{\n");
+    fprintf(file, "    write f%d(3);\n}\n", many - 1);
+    rewind(file);
+    return file;
+}
+
+int main(int argc, char* argv[ ])
+{
+    int many = (argc > 1) ? atoi(argv[1]) : 20000;
+    int largest = (argc > 2) ? atoi(argv[2]) : int(sysconf(_SC_NPROCESSORS_ONLN));
+    compilation c;
+    FILE* input;
+    double start, seconds, serial_seconds = 0;
+    long serial_bytes = 0;
+    unsigned int serial_sum = 0;
+    int threads;
+
+    if (largest < 1)
+	largest = 1;
+    input = generate(many);
+    scan_stream(c, input);
+    if (!parse(c))
+	return 1;
+    end_scan(c);
+    fclose(input);
+    traverse(c);
+    if (c.root->attribute<int>("Errors") != 0)
+	return 1;
+
+    cout << "Functions: " << many << " (and " << (many+9)/10
+	 << " nested ones)" << endl;
+    cout << setw(8) << "threads" << setw(10) << "codegen"
+	 << setw(10) << "speedup" << setw(12) << "bytes" << endl;
+    for (threads = 1; threads <= largest; ++threads)
+    {
+	checksum_buffer assembly;
+	ostream out(&assembly);
+	compilation g(out);
+
+	g.threads = threads;
+	start = now( );
+	codegen(g, c.root);
+	seconds = now( ) - start;
+	if (threads == 1)
+	{
+	    serial_seconds = seconds;
+	    serial_bytes = assembly.bytes;
+	    serial_sum = assembly.sum;
+	}
+	cout << setw(8) << threads << setw(10) << seconds
+	     << setw(10) << serial_seconds / seconds
+	     << setw(12) << assembly.bytes
+	     << ((assembly.bytes == serial_bytes && assembly.sum == serial_sum)
+		 ? "" : "   (output differs from one thread)")
+	     << endl;
+    }
+    return 0;
+}
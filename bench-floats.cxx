@@ -0,0 +1,353 @@
+//****************************************************************************
+// FILE: bench-floats.cxx
+// Benchmark of the float code of the CU compiler: the x87 against SSE2
+// Version date: Oct 18, 2026
+// This program writes a few CU programs that spend their time on float
+// arithmetic, compiles each one twice with cu (once as it is, with the x87
+// code, and once with --sse, with the scalar SSE2 code of SSE_FLOATS in
+// cu.compilation.h), links both with libcu.a, and runs them.  For each
+// kernel it prints the fastest run of each program in milliseconds, the
+// speedup of the SSE2 code over the x87 code, and whether the two programs
+// wrote the same output (they should, since the two round alike).
+//
+// The kernels, each a loop that runs --iterations times:
+//   arith    a polynomial and a quotient of floats (float + - * / float);
+//   mixed    sums and products of floats with the int loop counter (the
+//            float-int operations, and the coercion of an int to a float);
+//   compare  a bisection for square roots, with float comparisons in its
+//            decisions;
+//   negate   a recurrence with unary minus and division.
+// The output of each kernel is written with write, so that it goes through
+// the conversion of a float to a double for printf.
+//
+// Options:
+//   --cu PATH       the compiler to run (./cu unless given)
+//   --lib PATH      the library of cu.lib.s (libcu.a unless given)
+//   --cc COMMAND    the command that assembles and links a program, to which
+//                   "program.s LIB -o program" is added ("gcc -m32" unless
+//                   given; its words are separated by spaces)
+//   --iterations N  how many times the loop of each kernel runs (1000000
+//                   unless given)
+//   --repeat N      how many times each program is run (3 unless given),
+//                   of which the fastest run is kept
+//   --print KERNEL  writes that kernel to cout instead, and runs nothing
+//   -- ARGS         the rest of the arguments are given to cu for both of
+//                   the programs (such as -O0)
+// The programs are made in a new directory in /tmp, which is removed at
+// the end.  The exit status is 0 if every program was made and ran and
+// each kernel wrote the same output both ways, and 1 otherwise.
+// This program uses fork, execvp and wait4, so it needs a POSIX system.
+// The necessary commands are:
+// 1. g++ -Wall -O2 -c bench-floats.cxx
+// 2. g++ bench-floats.o -o bench-floats
+// 3. Build cu and libcu.a (see cu.cxx).
+// You can then run the benchmark (or use make bench-sse):
+// bench-floats --iterations 2000000 -- -O0
+//*****************************************************************************
+#include <cstdio>           // Provides FILE, fopen, fprintf, remove
+#include <cstdlib>          // Provides atoi, atol, mkdtemp
+#include <fcntl.h>          // Provides open
+#include <fstream>          // Provides ifstream
+#include <iomanip>          // Provides setw, setprecision
+#include <iostream>         // Provides cout, cerr
+#include <sstream>          // Provides istringstream, ostringstream
+#include <string>           // Provides string class
+#include <sys/resource.h>   // Provides rusage
+#include <sys/time.h>       // Provides gettimeofday
+#include <sys/wait.h>       // Provides wait4
+#include <unistd.h>         // Provides fork, execvp, dup2, rmdir
+#include <vector>           // Provides vector class
+using namespace std;        // cout and endl are in std::
+
+// The two ways of compiling each kernel, in the order of the columns:
+enum { X87, SSE, MANY_WAYS };
+static const char* way_names[MANY_WAYS] = { "x87", "sse" };
+
+// Wall-clock time in seconds:
+double now( )
+{
+    timeval t;
+
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec / 1e6;
+}
+
+//-----------------------------------------------------------------------------
+// The kernels.  Each one keeps its variables in globals, and the loop that
+// generate puts around its body counts with the int i.
+struct kernel
+{
+    const char* name;
+    const char* globals;
+    const char* body;        // The statements of the loop
+    const char* result;      // The statements after the loop
+};
+
+static const kernel kernels[ ] =
+{
+    {
+	"arith",
+	"|float| x is initially 0.25;\n"
+	"|float| s is initially 0.0;\n",
+	"        x = x * 0.999 + 0.001;\n"
+	"        s = s + ((2.5 * x - 1.25) * x + 0.5) * x - x / (x + 3.0);\n",
+	"    write s; write \"\\n\";\n"
+    },
+    {
+	"mixed",
+	"|float| x is initially 0.0;\n"
+	"|float| s is initially 0.0;\n"
+	"|float| t is initially 1.0;\n",
+	"        x = i;\n"
+	"        s = s + 1.0 / (i + 1) - x * 0.0000001;\n"
+	"        t = t * 0.5 + i / 3.0 - (i - 7) * 0.25;\n",
+	"    write s; write \" \"; write t; write \"\\n\";\n"
+    },
+    {
+	"compare",
+	"|float| lo is initially 0.0;\n"
+	"|float| hi is initially 2.0;\n"
+	"|float| mid is initially 0.0;\n"
+	"|float| target is initially 2.0;\n"
+	"|int| found is initially 0;\n",
+	"        mid = (lo + hi) / 2.0;\n"
+	"        if (mid * mid < target) then lo = mid; else hi = mid; fi\n"
+	"        if (hi - lo <= 0.0001) then\n"
+	"        {\n"
+	"            found = found + 1;\n"
+	"            target = target + 0.5;\n"
+	"            lo = 0.0;\n"
+	"            hi = target;\n"
+	"        }\n"
+	"        fi\n",
+	"    write found; write \" \"; write mid; write \"\\n\";\n"
+    },
+    {
+	"negate",
+	"|float| x is initially 1.0;\n"
+	"|float| y is initially -2.0;\n",
+	"        x = -x / 1.5 + y;\n"
+	"        y = -(y - x) / 3.0 + 0.125;\n",
+	"    write x; write \" \"; write y; write \"\\n\";\n"
+    }
+};
+static const int many_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+// Writes the program of a kernel with the given number of iterations:
+void generate(FILE* file, const kernel& k, long iterations)
+{
+    fprintf(file, "|int| i is initially 0;\n%s", k.globals);
+    fprintf(file, "function main( ) returns |int|\n{\n");
+    fprintf(file, "    while (i < %ld) do\n    {\n%s", iterations, k.body);
+    fprintf(file, "        i = i + 1;\n    }\n    od\n");
+    fprintf(file, "%s    return 0;\n}\n", k.result);
+}
+//-----------------------------------------------------------------------------
+
+
+//-----------------------------------------------------------------------------
+// Runs a program (found on the PATH if its name has no '/'), with its
+// standard input from the file in and its standard output to the file out
+// (or /dev/null, if either one is ""), and its messages thrown away.  The
+// return value is its exit status (or 128 plus the signal that killed it,
+// or 127 if it could not be run), and seconds is its wall-clock time.
+int run(const vector<string>& args, const string& in, const string& out, double& seconds)
+{
+    vector<char*> argv;
+    rusage usage;
+    double start;
+    int status, null;
+    pid_t child;
+    size_t k;
+
+    for (k = 0; k < args.size( ); ++k)
+	argv.push_back(const_cast<char*>(args[k].c_str( )));
+    argv.push_back(NULL);
+    fflush(NULL);
+    start = now( );
+    child = fork( );
+    if (child == 0)
+    {
+	null = open("/dev/null", O_RDWR);
+	dup2(in.empty( ) ? null : open(in.c_str( ), O_RDONLY), 0);
+	dup2(out.empty( ) ? null : open(out.c_str( ), O_WRONLY | O_CREAT | O_TRUNC, 0644), 1);
+	dup2(null, 2);
+	execvp(argv[0], &argv[0]);
+	_exit(127);
+    }
+    if (child < 0 || wait4(child, &status, 0, &usage) != child)
+	return 127;
+    seconds = now( ) - start;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+// The words of a command, which are separated by spaces:
+vector<string> words(const string& command)
+{
+    istringstream in(command);
+    vector<string> answer;
+    string word;
+
+    while (in >> word)
+	answer.push_back(word);
+    return answer;
+}
+
+// The whole contents of a file:
+string contents(const string& name)
+{
+    ifstream in(name.c_str( ));
+    ostringstream answer;
+
+    answer << in.rdbuf( );
+    return answer.str( );
+}
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char* argv[ ])
+{
+    string cu = "./cu";
+    string lib = "libcu.a";
+    string cc = "gcc -m32";
+    vector<string> cu_args;
+    long iterations = 1000000;
+    int repeat = 3;
+    const char* print = NULL;
+    bool usage_error = false, ok = true;
+    char dir_name[ ] = "/tmp/bench-floats.XXXXXX";
+    string dir, source, assembly[MANY_WAYS], program[MANY_WAYS], output[MANY_WAYS];
+    double best[MANY_WAYS], seconds;
+    vector<string> args;
+    const char* status;
+    FILE* file;
+    int i, k, w, r;
+
+    for (i = 1; i < argc; ++i)
+    {
+	if (string(argv[i]) == "--cu" && i + 1 < argc)
+	    cu = argv[++i];
+	else if (string(argv[i]) == "--lib" && i + 1 < argc)
+	    lib = argv[++i];
+	else if (string(argv[i]) == "--cc" && i + 1 < argc)
+	    cc = argv[++i];
+	else if (string(argv[i]) == "--iterations" && i + 1 < argc)
+	    iterations = atol(argv[++i]);
+	else if (string(argv[i]) == "--repeat" && i + 1 < argc)
+	    repeat = atoi(argv[++i]);
+	else if (string(argv[i]) == "--print" && i + 1 < argc)
+	    print = argv[++i];
+	else if (string(argv[i]) == "--")
+	{
+	    for (++i; i < argc; ++i)
+		cu_args.push_back(argv[i]);
+	}
+	else
+	    usage_error = true;
+    }
+    if (usage_error || iterations < 1 || repeat < 1 || words(cc).empty( ))
+    {
+	cerr << "Usage: " << argv[0]
+	     << " [--cu PATH] [--lib PATH] [--cc COMMAND] [--iterations N]" << endl
+	     << "         [--repeat N] [-- ARGS]" << endl
+	     << "       " << argv[0] << " [--iterations N] --print KERNEL" << endl;
+	return 2;
+    }
+    if (print != NULL)
+    {
+	for (k = 0; k < many_kernels && string(kernels[k].name) != print; ++k)
+	    ;
+	if (k == many_kernels)
+	{
+	    cerr << "There is no kernel named " << print << endl;
+	    return 2;
+	}
+	generate(stdout, kernels[k], iterations);
+	return 0;
+    }
+    if (mkdtemp(dir_name) == NULL)
+    {
+	cerr << "Cannot make a directory in /tmp" << endl;
+	return 1;
+    }
+    dir = dir_name;
+    source = dir + "/kernel.cu";
+    for (w = 0; w < MANY_WAYS; ++w)
+    {
+	program[w] = dir + "/" + way_names[w];
+	assembly[w] = program[w] + ".s";
+	output[w] = program[w] + ".out";
+    }
+
+    cout << setw(10) << "kernel" << setw(12) << "x87 ms" << setw(12) << "sse ms"
+	 << setw(10) << "speedup" << "  output" << endl;
+    cout << fixed << setprecision(2);
+    for (k = 0; k < many_kernels; ++k)
+    {
+	file = fopen(source.c_str( ), "w");
+	if (file == NULL)
+	{
+	    cerr << "Cannot write " << source << endl;
+	    ok = false;
+	    break;
+	}
+	generate(file, kernels[k], iterations);
+	fclose(file);
+
+	status = "same";
+	for (w = 0; w < MANY_WAYS && status == string("same"); ++w)
+	{   // Compile, link and run the program, and keep its fastest run:
+	    args.assign(1, cu);
+	    args.insert(args.end( ), cu_args.begin( ), cu_args.end( ));
+	    if (w == SSE)
+		args.push_back("--sse");
+	    if (run(args, source, assembly[w], seconds) != 0)
+	    {
+		status = "cu failed";
+		break;
+	    }
+	    args = words(cc);
+	    args.push_back(assembly[w]);
+	    args.push_back(lib);
+	    args.push_back("-o");
+	    args.push_back(program[w]);
+	    if (run(args, "", "", seconds) != 0)
+	    {
+		status = "link failed";
+		break;
+	    }
+	    args.assign(1, program[w]);
+	    for (r = 0; r < repeat; ++r)
+	    {
+		if (run(args, "", output[w], seconds) != 0)
+		{
+		    status = "run failed";
+		    break;
+		}
+		if (r == 0 || seconds < best[w])
+		    best[w] = seconds;
+	    }
+	}
+	if (status == string("same") && contents(output[X87]) != contents(output[SSE]))
+	    status = "DIFFERENT";
+
+	cout << setw(10) << kernels[k].name;
+	if (status == string("same") || status == string("DIFFERENT"))
+	    cout << setw(12) << best[X87] * 1000 << setw(12) << best[SSE] * 1000
+		 << setw(9) << best[X87] / best[SSE] << "x";
+	else
+	    cout << setw(12) << "-" << setw(12) << "-" << setw(10) << "-";
+	cout << "  " << status << endl;
+	ok = ok && status == string("same");
+    }
+
+    remove(source.c_str( ));
+    for (w = 0; w < MANY_WAYS; ++w)
+    {
+	remove(assembly[w].c_str( ));
+	remove(program[w].c_str( ));
+	remove(output[w].c_str( ));
+    }
+    rmdir(dir.c_str( ));
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+//****************************************************************************
+// FILE: bench-lexer.cxx
+// Benchmark of the two ways that the lexer can read a CU program
+// Version date: Oct 18, 2026
+// This program generates CU programs of several megabytes and scans each
+// of them to the end with yylex in two ways:
+//   stream:  through scan_stream, as cu does with a program on cin, so that
+//            flex reads the file and copies it into its own buffer in pieces;
+//   mapped:  through a colorado::mapped_file and scan_in_place, as cu does
+//            with the name of a program, so that flex scans the mapped
+//            pages where they are.
+// Each token is still made into a one-node tree (in a tree_arena that is
+// released after each scan), so the times are for the whole lexer.  The
+// last column shows how many lexemes the first scan of each program copied
+// into the intern pool: only the distinct strings that were new, out of
+// all of the tokens.
+// The necessary commands are the same as for test-lexer (see
+// test-lexer.cxx), with bench-lexer.o in place of test-lexer.o:
+// 1. g++ -Wall -O2 -c bench-lexer.cxx
+// 2. g++ -Wall -c mapped.cxx
+// 3. g++ -Wall -c cu.emitter.cxx
+// 4. g++ -Wall -c cu.ir.cxx
+// 5. g++ -Wall -c cu.timing.cxx
+// 6. g++ bench-lexer.o cu.tab.o cu.lex.o cu.timing.o cu.emitter.o cu.ir.o tree.o intern.o mapped.o -o bench-lexer -lpthread
+// You can then run the benchmark with the largest size in megabytes:
+// bench-lexer 64
+//*****************************************************************************
+#include <cstdio>           // Provides FILE, fopen, fprintf, remove
+#include <cstdlib>          // Provides atoi
+#include <iomanip>          // Provides setw
+#include <iostream>         // Provides cout
+#include <string>           // Provides string class
+#include <sys/time.h>       // Provides gettimeofday
+#include "intern.h"         // Provides many_interned
+#include "mapped.h"         // Provides the colorado::mapped_file class
+#include "tree.h"           // Provides the colorado::tree class
+#include "cu.compilation.h" // Provides the compilation struct
+using namespace std;        // cout and endl are in std::
+using namespace colorado;   // tree class
+int yylex(tree** lvalp, void* scanner); // Provided by the lexer
+
+// The generated program is written to this file:
+const char FILENAME[ ] = "bench-lexer.cu";
+
+// Wall-clock time in seconds, since the mapped scan also spends time in
+// the kernel on page faults:
+double now( )
+{
+    timeval t;
+
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec / 1e6;
+}
+
+// Writes a CU program of at least the given number of bytes to FILENAME.
+void generate(long bytes)
+{
+    FILE* file = fopen(FILENAME, "w");
+    long i;
+
+    for (i = 0; ftell(file) < bytes; ++i)
+    {
+	fprintf(file, "function f%ld (|int| x, |float| y) returns |int|\n{\n", i);
+	fprintf(file, "    |int| a is initially x + %ld;\n", i % 1000);
+	fprintf(file, "    |float| b is initially y * 2.0; // Scaled\n");
+	fprintf(file, "    while (a < 100) do a = a + 1; od\n");
+	fprintf(file, "    if (a > 3) then write a; else write b; fi\n");
+	fprintf(file, "    write \"Done with f%ld\\n\";\n    return a;\n}\n", i);
+    }
+    fprintf(file, "function main( ) returns |int|\n{\n    return 0;\n}\n");
+    fclose(file);
+}
+
+// Scans the whole program and returns the number of tokens.  If mapped is
+// true, then the program is scanned in place, and otherwise as a stream.
+long scan(bool mapped)
+{
+    compilation c;
+    tree_arena arena;
+    mapped_file* source = NULL;
+    FILE* file = NULL;
+    tree* token;
+    long answer = 0;
+
+    tree_arena::set_current(&arena);
+    if (mapped)
+    {
+	source = new mapped_file(FILENAME, 2);
+	scan_in_place(c, source->data( ), source->size( ));
+    }
+    else
+    {
+	file = fopen(FILENAME, "r");
+	scan_stream(c, file);
+    }
+    while (yylex(&token, c.scanner) != 0)
+	++answer;
+    end_scan(c);
+    if (mapped)
+	delete source;
+    else
+	fclose(file);
+    tree_arena::set_current(NULL);
+    arena.release( );
+    return answer;
+}
+
+int main(int argc, char* argv[ ])
+{
+    int largest = (argc > 1) ? atoi(argv[1]) : 64;
+    double start, streamed, mapped;
+    size_t copied;
+    long tokens;
+    int megabytes;
+
+    cout << "Seconds to scan each program:" << endl;
+    cout << setw(10) << "MB" << setw(12) << "tokens"
+	 << setw(10) << "stream" << setw(10) << "mapped"
+	 << setw(10) << "speedup" << setw(12) << "copied" << endl;
+    for (megabytes = 1; megabytes <= largest; megabytes *= 4)
+    {
+	generate(megabytes * 1024L * 1024L);
+	copied = many_interned( );
+	scan(true);         // Also warms up the page cache
+	copied = many_interned( ) - copied;
+
+	start = now( );
+	tokens = scan(false);
+	streamed = now( ) - start;
+
+	start = now( );
+	if (scan(true) != tokens)
+	    cout << "The two scans found different tokens." << endl;
+	mapped = now( ) - start;
+
+	cout << setw(10) << megabytes << setw(12) << tokens
+	     << setw(10) << streamed << setw(10) << mapped
+	     << setw(10) << streamed / mapped
+	     << setw(12) << copied << endl;
+    }
+    remove(FILENAME);
+    return 0;
+}
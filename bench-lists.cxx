@@ -0,0 +1,153 @@
+//****************************************************************************
+// FILE: bench-lists.cxx
+// Scaling benchmark for long lists in CU programs
+// Version date: Oct 18, 2026
+// This program generates CU programs with a very long list and runs the
+// parser, the traverser and the code generator on each of them:
+//   body:    a main function whose body has many statements;
+//   literal: a global array that is initialized by an array literal with
+//            many elements.
+// Each compilation runs in a thread with a small fixed stack, so a run
+// that finishes shows that the stack use does not grow with the length of
+// the list.  The time per item should stay about the same as the lists
+// get longer.  The trees of each compilation are built in a tree_arena.
+// The necessary commands are the same as for cu (see cu.cxx), with
+// bench-lists.o in place of cu.o:
+// 1. g++ -Wall -O2 -c bench-lists.cxx
+// 2. g++ bench-lists.o cu.tab.o cu.lex.o cu.timing.o cu.traverser.o cu.fold.o cu.types.o cu.codegen.o cu.cache.o cu.emitter.o cu.ir.o cu.peephole.o cu.object.o tree.o intern.o -o bench-lists -lpthread
+// You can then run the benchmark with the largest list length:
+// bench-lists 1000000
+//*****************************************************************************
+#include <cstdio>           // Provides FILE, tmpfile, fprintf
+#include <cstdlib>          // Provides atoi
+#include <ctime>            // Provides clock
+#include <iomanip>          // Provides setw
+#include <iostream>         // Provides cout
+#include <streambuf>        // Provides streambuf
+#include <string>           // Provides string class
+#include <pthread.h>        // Provides pthread_create, pthread_join
+#include "tree.h"           // Provides the colorado::tree class
+#include "cu.compilation.h" // Provides the compilation struct and phases
+using namespace std;        // cout and endl are in std::
+using namespace colorado;   // tree class
+
+// Each compilation thread gets a stack of this many bytes:
+const size_t STACK_BYTES = 256*1024;
+
+// A stream buffer that throws away the generated assembly code:
+class null_buffer : public streambuf
+{
+protected:
+    int overflow(int c) { return c; }
+};
+
+// Writes a CU program with a list of the given shape and length to a
+// temporary file, and returns that file (positioned at its start).
+FILE* generate(const string& shape, int many)
+{
+    FILE* file = tmpfile( );
+    int i;
+
+    if (shape == "body")
+    {
+	fprintf(file, "|int| x is initially 0;\n");
+	fprintf(file, "function main ( ) returns |int|\n{\n");
+	for (i = 0; i < many; ++i)
+	    fprintf(file, "    x = x + %d;\n", i % 10);
+	fprintf(file, "}\n");
+    }
+    else
+    {
+	fprintf(file, "array of |int| a is initially (array of |int| is 0");
+	for (i = 1; i < many; ++i)
+	    fprintf(file, i % 16 ? ", %d" : ",\n    %d", i);
+	fprintf(file, ");\n");
+	fprintf(file, "function main ( ) returns |int|\n{\n}\n");
+    }
+    rewind(file);
+    return file;
+}
+
+// The work of one compilation thread:
+struct job
+{
+    FILE* input;
+    double seconds[3];  // Parse, traverse, and codegen
+    bool ok;
+};
+
+void* compile(void* p)
+{
+    job* j = static_cast<job*>(p);
+    null_buffer nowhere;
+    ostream assembly(&nowhere);
+    compilation c(assembly);
+    tree_arena arena;
+    clock_t start;
+
+    tree_arena::set_current(&arena);
+    scan_stream(c, j->input);
+    start = clock( );
+    j->ok = parse(c);
+    j->seconds[0] = double(clock( ) - start) / CLOCKS_PER_SEC;
+    end_scan(c);
+    if (j->ok)
+    {
+	start = clock( );
+	traverse(c);
+	j->seconds[1] = double(clock( ) - start) / CLOCKS_PER_SEC;
+	j->ok = (c.root->attribute<int>("Errors") == 0);
+    }
+    if (j->ok)
+    {
+	start = clock( );
+	codegen(c, c.root);
+	j->seconds[2] = double(clock( ) - start) / CLOCKS_PER_SEC;
+    }
+    tree_arena::set_current(NULL);
+    arena.release( );
+    return NULL;
+}
+
+// Compiles one generated program and prints one line to out:
+void run(ostream& out, const string& shape, int many)
+{
+    job j;
+    pthread_attr_t attributes;
+    pthread_t thread;
+    double total;
+
+    j.input = generate(shape, many);
+    j.seconds[0] = j.seconds[1] = j.seconds[2] = 0;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, STACK_BYTES);
+    pthread_create(&thread, &attributes, compile, &j);
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attributes);
+    fclose(j.input);
+
+    total = j.seconds[0] + j.seconds[1] + j.seconds[2];
+    out << setw(8) << shape << setw(10) << many
+	<< setw(10) << j.seconds[0] << setw(10) << j.seconds[1]
+	<< setw(10) << j.seconds[2]
+	<< setw(12) << 1e6 * total / many
+	<< (j.ok ? "" : "   (compilation failed)") << endl;
+}
+
+int main(int argc, char* argv[ ])
+{
+    int largest = (argc > 1) ? atoi(argv[1]) : 100000;
+    int many;
+
+    // The assembly code of each compilation is thrown away (see compile):
+    cout << "Stack of each compilation: " << STACK_BYTES/1024 << "K" << endl;
+    cout << setw(8) << "shape" << setw(10) << "items"
+	 << setw(10) << "parse" << setw(10) << "traverse"
+	 << setw(10) << "codegen" << setw(12) << "usec/item" << endl;
+    for (many = 1000; many <= largest; many *= 10)
+    {
+	run(cout, "body", many);
+	run(cout, "literal", many);
+    }
+    return 0;
+}
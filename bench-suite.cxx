@@ -0,0 +1,427 @@
+//****************************************************************************
+// FILE: bench-suite.cxx
+// Throughput benchmark of the whole CU compiler on synthetic programs
+// Version date: Oct 18, 2026
+// This program generates CU programs of growing sizes, runs cu on each of
+// them in a process of its own (as a user would), and records the speed of
+// the compiler in milliseconds per thousand lines of CU code, its peak
+// resident memory (from wait4) and the size of the assembly code.
+//
+// A program is given by six numbers, and each of them is scaled in turn
+// (by 1, 2, 4 and 8) while the others keep their base values:
+//   functions  the number of functions (base 200);
+//   length     the number of statements in each function (base 20);
+//   depth      how deep the functions are nested in each function (base 1);
+//   expr       the number of operators in each expression (base 4);
+//   array      the number of items in each array literal (base 8);
+//   globals    the number of global variables (base 10).
+// So a slowdown that grows with one of them (a long function in the code
+// generator, a deep nesting in the symbol table, a long expression in the
+// parser) shows as a ms/KLOC that grows along that row of the table.  (The
+// expr and array rows make the lines longer rather than more, so their
+// ms/KLOC grows even when the compiler scales well; compare them with the
+// rows of an earlier run.)
+//
+// Each program is compiled --repeat times (3 unless given), and the fastest
+// run is kept.  A line for each program is printed to cout, and added to
+// the end of the results file (bench.results unless --results is given), so
+// that the file keeps the history of the runs.  Its lines have fields that
+// are separated by tabs, in the order that is given by the first line of
+// the file (which starts with '#'):
+//   date (seconds since 1970, the same for all the lines of one run),
+//   dimension, value, functions, length, depth, expr, array, globals,
+//   lines, ms, ms_per_kloc, peak_rss_kb, output_bytes, status
+// where status is the exit status of cu (0 unless the program failed).
+//
+// Options:
+//   --cu PATH       the compiler to run (./cu unless given)
+//   --results FILE  the results file
+//   --repeat N      how many times each program is compiled
+//   --scale N       multiplies the base number of functions by N
+//   --print F L D E A G
+//                   writes the program with those six numbers to cout
+//                   instead, and runs nothing
+//   -- ARGS         the rest of the arguments are given to cu (such as
+//                   --threads 4)
+// This program uses fork and wait4, so it needs a POSIX system.
+// The necessary commands are:
+// 1. g++ -Wall -O2 -c bench-suite.cxx
+// 2. g++ bench-suite.o -o bench-suite
+// 3. Build cu (see cu.cxx).
+// You can then run the benchmark (or use make bench):
+// bench-suite --results bench.results
+//*****************************************************************************
+#include <cstdio>           // Provides FILE, tmpfile, fprintf, fileno
+#include <cstdlib>          // Provides atoi, exit
+#include <ctime>            // Provides time
+#include <fcntl.h>          // Provides open
+#include <fstream>          // Provides ofstream
+#include <iomanip>          // Provides setw, setprecision
+#include <iostream>         // Provides cout, cerr
+#include <string>           // Provides string class
+#include <sys/resource.h>   // Provides rusage
+#include <sys/stat.h>       // Provides fstat
+#include <sys/time.h>       // Provides gettimeofday
+#include <sys/wait.h>       // Provides wait4
+#include <unistd.h>         // Provides fork, execv, dup2
+#include <vector>           // Provides vector class
+using namespace std;        // cout and endl are in std::
+
+// The six numbers of a program, in the order of --print:
+enum { FUNCTIONS, LENGTH, DEPTH, EXPR, ARRAY, GLOBALS, MANY_SIZES };
+static const char* size_names[MANY_SIZES] =
+    { "functions", "length", "depth", "expr", "array", "globals" };
+static const int base_sizes[MANY_SIZES] = { 200, 20, 1, 4, 8, 10 };
+static const int many_factors = 4;
+static const int factors[many_factors] = { 1, 2, 4, 8 };
+
+// What one compilation measured:
+struct measure
+{
+    long lines;          // Lines of CU code
+    double ms;           // Wall-clock milliseconds
+    long peak_rss_kb;    // Peak resident memory of cu
+    long output_bytes;   // Bytes of assembly code
+    int status;          // Exit status of cu
+};
+
+// Wall-clock time in seconds:
+double now( )
+{
+    timeval t;
+
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec / 1e6;
+}
+
+//-----------------------------------------------------------------------------
+// The generator.  Every global gK is an |int| when K is even and a |float|
+// when K is odd.  Each function fI has a parameter a, a local i, an array
+// v of array literals, and a chain of nested functions fI_1, fI_1_2, ...
+// that each call the next one in and use the symbols of all of the
+// functions around them.  Its statements cycle through an assignment, a
+// decision, a loop, an array literal and a write.
+
+// Writes an expression with the given number of operators, whose operands
+// are the int variables in scope, int globals, literals, array items and
+// (once in a while) a call of the function before this one:
+void write_expr(FILE* file, int operators, int function, const string& local, const int sizes[ ])
+{
+    int k;
+
+    fprintf(file, "%s", local.c_str( ));
+    for (k = 0; k < operators; ++k)
+    {
+	fprintf(file, " %s ", (k % 3 == 0) ? "+" : (k % 3 == 1) ? "*" : "-");
+	if (k % 4 == 3)
+	    fprintf(file, "(");
+	switch (k % 5)
+	{
+	case 0:
+	    fprintf(file, "a");
+	    break;
+	case 1:
+	    if (sizes[GLOBALS] > 0)
+		fprintf(file, "g%d", 2 * ((function + k) % ((sizes[GLOBALS] + 1) / 2)));
+	    else
+		fprintf(file, "%d", k);
+	    break;
+	case 2:
+	    fprintf(file, "%d", (function * 7 + k) % 100);
+	    break;
+	case 3:
+	    fprintf(file, "v[%d]", k % (sizes[ARRAY] > 0 ? sizes[ARRAY] : 1));
+	    break;
+	default:
+	    if (function > 0 && k % 10 == 4)
+		fprintf(file, "f%d(%d)", function - 1, k);
+	    else
+		fprintf(file, "i");
+	    break;
+	}
+	if (k % 4 == 3)
+	    fprintf(file, " + 1)");
+    }
+}
+
+// Writes an array literal with the given number of items:
+void write_array(FILE* file, int items, int function)
+{
+    int k;
+
+    fprintf(file, "(array of |int| is ");
+    for (k = 0; k < items || k == 0; ++k)
+	fprintf(file, "%s%d", (k == 0) ? "" : ", ", (function + k) % 1000);
+    fprintf(file, ")");
+}
+
+// Writes the statements of a function, whose int local is named local:
+void write_statements(FILE* file, int function, const string& local, const int sizes[ ], const char* indent)
+{
+    int s;
+
+    for (s = 0; s < sizes[LENGTH]; ++s)
+    {
+	fprintf(file, "%s", indent);
+	switch (s % 5)
+	{
+	case 0:
+	    fprintf(file, "%s = ", local.c_str( ));
+	    write_expr(file, sizes[EXPR], function, local, sizes);
+	    fprintf(file, ";\n");
+	    break;
+	case 1:
+	    fprintf(file, "if (%s > %d) then %s = %s - a; else %s = %s + 1; fi\n",
+		    local.c_str( ), s, local.c_str( ), local.c_str( ),
+		    local.c_str( ), local.c_str( ));
+	    break;
+	case 2:
+	    fprintf(file, "while (%s < a) do { %s = %s + %d; } od\n",
+		    local.c_str( ), local.c_str( ), local.c_str( ), s + 1);
+	    break;
+	case 3:
+	    fprintf(file, "v = ");
+	    write_array(file, sizes[ARRAY], function + s);
+	    fprintf(file, ";\n");
+	    break;
+	default:
+	    if (sizes[GLOBALS] > 1)
+		fprintf(file, "write g%d; write \"\\n\";\n", 2 * (s % (sizes[GLOBALS] / 2)) + 1);
+	    else
+		fprintf(file, "write %s; write \"\\n\";\n", local.c_str( ));
+	    break;
+	}
+    }
+}
+
+// Writes the nested function at the given level of function number
+// function (level 1 is just inside of the function itself):
+void write_nested(FILE* file, int function, int level, const string& name, const int sizes[ ])
+{
+    string indent(4 * level, ' ');
+    string inner = name + "_" + char('0' + (level + 1) % 10);
+    char local[32];
+
+    sprintf(local, "j%d", level);
+    fprintf(file, "%sfunction %s(|int| b) returns |int|\n%s{\n", indent.c_str( ),
+	    name.c_str( ), indent.c_str( ));
+    fprintf(file, "%s    |int| %s is initially b + i;\n", indent.c_str( ), local);
+    if (level < sizes[DEPTH])
+	write_nested(file, function, level + 1, inner, sizes);
+    write_statements(file, function, local, sizes, (indent + "    ").c_str( ));
+    if (level < sizes[DEPTH])
+	fprintf(file, "%s    return %s(%s) + %s;\n", indent.c_str( ), inner.c_str( ),
+		local, local);
+    else
+	fprintf(file, "%s    return %s;\n", indent.c_str( ), local);
+    fprintf(file, "%s}\n", indent.c_str( ));
+}
+
+// Writes the program with the given sizes to the file:
+void generate(FILE* file, const int sizes[ ])
+{
+    char name[32];
+    int f, g;
+
+    for (g = 0; g < sizes[GLOBALS]; ++g)
+    {
+	if (g % 2 == 0)
+	    fprintf(file, "|int| g%d is initially %d;\n", g, g);
+	else
+	    fprintf(file, "|float| g%d is initially %d.5;\n", g, g);
+    }
+    for (f = 0; f < sizes[FUNCTIONS]; ++f)
+    {
+	sprintf(name, "f%d", f);
+	fprintf(file, "function %s(|int| a) returns |int|\n{\n", name);
+	fprintf(file, "    |int| i is initially a;\n");
+	fprintf(file, "    array of |int| v is initially ");
+	write_array(file, sizes[ARRAY], f);
+	fprintf(file, ";\n");
+	if (sizes[DEPTH] > 0)
+	    write_nested(file, f, 1, string(name) + "_1", sizes);
+	write_statements(file, f, "i", sizes, "    ");
+	if (sizes[DEPTH] > 0)
+	    fprintf(file, "    return %s_1(i);\n}\n", name);
+	else
+	    fprintf(file, "    return i;\n}\n");
+    }
+    fprintf(file, "function main( ) returns |int|\n{\n");
+    if (sizes[FUNCTIONS] > 0)
+	fprintf(file, "    write f%d(3);\n", sizes[FUNCTIONS] - 1);
+    fprintf(file, "    return 0;\n}\n");
+}
+//-----------------------------------------------------------------------------
+
+
+//-----------------------------------------------------------------------------
+// Counts the lines of a file, which is then at its start:
+long count_lines(FILE* file)
+{
+    long lines = 0;
+    int c;
+
+    rewind(file);
+    while ((c = getc(file)) != EOF)
+	if (c == '\n')
+	    ++lines;
+    rewind(file);
+    return lines;
+}
+
+// Runs cu once with the program as its standard input, and measures it:
+measure run_cu(const string& cu, const vector<string>& args, FILE* program)
+{
+    measure m;
+    FILE* output = tmpfile( );
+    vector<char*> argv;
+    rusage usage;
+    struct stat info;
+    double start;
+    int status, null;
+    pid_t child;
+    size_t k;
+
+    m.lines = count_lines(program);
+    argv.push_back(const_cast<char*>(cu.c_str( )));
+    for (k = 0; k < args.size( ); ++k)
+	argv.push_back(const_cast<char*>(args[k].c_str( )));
+    argv.push_back(NULL);
+    fflush(NULL);
+    start = now( );
+    child = fork( );
+    if (child == 0)
+    {   // The child becomes cu, with the messages thrown away:
+	null = open("/dev/null", O_WRONLY);
+	dup2(fileno(program), 0);
+	dup2(fileno(output), 1);
+	dup2(null, 2);
+	execv(cu.c_str( ), &argv[0]);
+	_exit(127);
+    }
+    if (child < 0 || wait4(child, &status, 0, &usage) != child)
+    {
+	cerr << "Cannot run " << cu << endl;
+	exit(1);
+    }
+    m.ms = (now( ) - start) * 1000;
+    m.peak_rss_kb = usage.ru_maxrss;
+    m.status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    fstat(fileno(output), &info);
+    m.output_bytes = info.st_size;
+    fclose(output);
+    return m;
+}
+//-----------------------------------------------------------------------------
+
+
+int main(int argc, char* argv[ ])
+{
+    string cu = "./cu";
+    string results = "bench.results";
+    vector<string> args;
+    int repeat = 3, scale = 1;
+    int sizes[MANY_SIZES];
+    bool print = false, usage_error = false, header;
+    long date = long(time(NULL));
+    FILE* program;
+    measure m, best;
+    int i, d, f, r;
+
+    for (d = 0; d < MANY_SIZES; ++d)
+	sizes[d] = base_sizes[d];
+    for (i = 1; i < argc; ++i)
+    {
+	if (string(argv[i]) == "--cu" && i + 1 < argc)
+	    cu = argv[++i];
+	else if (string(argv[i]) == "--results" && i + 1 < argc)
+	    results = argv[++i];
+	else if (string(argv[i]) == "--repeat" && i + 1 < argc)
+	    repeat = atoi(argv[++i]);
+	else if (string(argv[i]) == "--scale" && i + 1 < argc)
+	    scale = atoi(argv[++i]);
+	else if (string(argv[i]) == "--print" && i + MANY_SIZES < argc)
+	{
+	    print = true;
+	    for (d = 0; d < MANY_SIZES; ++d)
+		sizes[d] = atoi(argv[++i]);
+	}
+	else if (string(argv[i]) == "--")
+	{
+	    for (++i; i < argc; ++i)
+		args.push_back(argv[i]);
+	}
+	else
+	    usage_error = true;
+    }
+    if (usage_error || repeat < 1 || scale < 1)
+    {
+	cerr << "Usage: " << argv[0]
+	     << " [--cu PATH] [--results FILE] [--repeat N] [--scale N] [-- ARGS]" << endl
+	     << "       " << argv[0]
+	     << " --print functions length depth expr array globals" << endl;
+	return 2;
+    }
+    if (print)
+    {
+	fflush(stdout);
+	generate(stdout, sizes);
+	return 0;
+    }
+
+    // The first line of a new results file names the fields:
+    ifstream existing(results.c_str( ));
+    header = !existing || existing.peek( ) == EOF;
+    existing.close( );
+    ofstream out(results.c_str( ), ios::app);
+    if (!out)
+    {
+	cerr << "Cannot write " << results << endl;
+	return 1;
+    }
+    if (header)
+	out << "# date\tdimension\tvalue\tfunctions\tlength\tdepth\texpr\tarray"
+	    << "\tglobals\tlines\tms\tms_per_kloc\tpeak_rss_kb\toutput_bytes\tstatus"
+	    << endl;
+
+    cout << setw(10) << "dimension" << setw(7) << "value" << setw(9) << "lines"
+	 << setw(10) << "ms" << setw(10) << "ms/KLOC" << setw(12) << "peak KB"
+	 << setw(12) << "bytes" << endl;
+    cout << fixed << setprecision(2);
+    out << fixed << setprecision(3);
+    for (d = 0; d < MANY_SIZES; ++d)
+    {
+	for (f = 0; f < many_factors; ++f)
+	{
+	    for (i = 0; i < MANY_SIZES; ++i)
+		sizes[i] = base_sizes[i] * ((i == FUNCTIONS) ? scale : 1);
+	    sizes[d] *= factors[f];
+	    program = tmpfile( );
+	    generate(program, sizes);
+	    fflush(program);
+	    for (r = 0; r < repeat; ++r)
+	    {
+		rewind(program);
+		m = run_cu(cu, args, program);
+		if (r == 0 || m.ms < best.ms)
+		    best = m;
+		if (m.peak_rss_kb > best.peak_rss_kb)
+		    best.peak_rss_kb = m.peak_rss_kb;
+	    }
+	    fclose(program);
+
+	    cout << setw(10) << size_names[d] << setw(7) << sizes[d]
+		 << setw(9) << best.lines << setw(10) << best.ms
+		 << setw(10) << best.ms * 1000 / best.lines
+		 << setw(12) << best.peak_rss_kb << setw(12) << best.output_bytes
+		 << ((best.status != 0) ? "   (cu failed)" : "") << endl;
+	    out << date << '\t' << size_names[d] << '\t' << sizes[d];
+	    for (i = 0; i < MANY_SIZES; ++i)
+		out << '\t' << sizes[i];
+	    out << '\t' << best.lines << '\t' << best.ms << '\t'
+		<< best.ms * 1000 / best.lines << '\t' << best.peak_rss_kb << '\t'
+		<< best.output_bytes << '\t' << best.status << endl;
+	}
+    }
+    return 0;
+}
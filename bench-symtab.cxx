@@ -0,0 +1,173 @@
+//****************************************************************************
+// FILE: bench-symtab.cxx
+// Benchmark of the colorado::symbol_table class
+// Version date: Oct 18, 2026
+// This program compares the hashed symbol_table of symtab.h with the
+// earlier version of the same class, which searched its list of symbols
+// from the back to the front (it is copied below as linear_symbol_table).
+// For each size n, both tables run the same work:
+//   global:  insert n names in the global scope, and then seek each name;
+//   nested:  n/10 times, enter a scope, insert 10 names that hide global
+//            names, seek each of them, and exit the scope.
+// The linear table is run only up to a limit, since its time grows with
+// the square of n.
+// The necessary commands are:
+// 1. g++ -Wall -O2 -c intern.cxx
+// 2. g++ -Wall -O2 -c bench-symtab.cxx
+// 3. g++ bench-symtab.o intern.o -o bench-symtab -lpthread
+// You can then run the benchmark with the largest n and the largest n for
+// the linear table:
+// bench-symtab 1000000 100000
+//*****************************************************************************
+#include <cassert>          // Provides assert
+#include <cstdio>           // Provides sprintf
+#include <cstdlib>          // Provides atoi
+#include <ctime>            // Provides clock
+#include <iomanip>          // Provides setw
+#include <iostream>         // Provides cout
+#include <string>           // Provides string class
+#include <vector>           // Provides vector class
+#include "intern.h"         // Provides intern
+#include "symtab.h"         // Provides the colorado::symbol_table class
+using namespace std;        // cout and endl are in std::
+using namespace colorado;   // symbol_table class
+
+// The part of the earlier symbol_table that the benchmark uses.  Its
+// offsets of kinds are left out, since they are the same in both tables.
+template <class value_type>
+class linear_symbol_table
+{
+public:
+    struct symbol_info
+    {
+	const string* name;
+	int depth;
+	value_type value;
+    };
+
+    linear_symbol_table( ) : cd(-1), sought(NULL) { }
+
+    void enter_scope( ) { ++cd; sought = NULL; }
+    void exit_scope( )
+    {
+	--cd;
+	sought = NULL;
+	while (!symbols.empty( ) && symbols.back( ).depth > cd)
+	    symbols.pop_back( );
+    }
+    bool insert(const string& name, int, value_type value)
+    {
+	symbol_info info;
+
+	seek(name);
+	if (sought != NULL && sought->depth == cd)
+	    return false;
+	info.name = &(intern(name));
+	info.depth = cd;
+	info.value = value;
+	symbols.push_back(info);
+	return true;
+    }
+    symbol_info* seek(const string& name)
+    {
+	const string* interned = &(intern(name));
+	unsigned int i;
+
+	sought = NULL;
+	i = symbols.size( );
+	while (i > 0)
+	{
+	    if (symbols[--i].name == interned)
+	    {
+		sought = &(symbols[i]);
+		break;
+	    }
+	}
+	return sought;
+    }
+    value_type value( ) const { assert(sought != NULL); return sought->value; }
+
+private:
+    int cd;
+    symbol_info* sought;
+    vector<symbol_info> symbols;
+};
+
+// Makes the symbols' names.  They are interned before any timing starts.
+vector<string> make_names(int many)
+{
+    vector<string> answer(many);
+    char buffer[32];
+    int i;
+
+    for (i = 0; i < many; ++i)
+    {
+	sprintf(buffer, "symbol%d", i);
+	answer[i] = buffer;
+	intern(answer[i]);
+    }
+    return answer;
+}
+
+// Runs the work on a table of type T and prints its two times.  The sum
+// of the values that were found is returned, so that the compiler cannot
+// skip the searches.
+template <class T>
+long run(T& st, const vector<string>& names, int many)
+{
+    long sum = 0;
+    clock_t start;
+    int i, j;
+
+    start = clock( );
+    st.enter_scope( );
+    for (i = 0; i < many; ++i)
+	st.insert(names[i], 0, i);
+    for (i = 0; i < many; ++i)
+	if (st.seek(names[i]))
+	    sum += st.value( );
+    cout << setw(12) << double(clock( ) - start) / CLOCKS_PER_SEC;
+
+    start = clock( );
+    for (i = 0; i < many/10; ++i)
+    {
+	st.enter_scope( );
+	for (j = 0; j < 10; ++j)
+	    st.insert(names[(7*i + j) % many], 0, j);
+	for (j = 0; j < 10; ++j)
+	    if (st.seek(names[(7*i + j) % many]))
+		sum += st.value( );
+	st.exit_scope( );
+    }
+    st.exit_scope( );
+    cout << setw(12) << double(clock( ) - start) / CLOCKS_PER_SEC;
+    return sum;
+}
+
+int main(int argc, char* argv[ ])
+{
+    int largest = (argc > 1) ? atoi(argv[1]) : 1000000;
+    int largest_linear = (argc > 2) ? atoi(argv[2]) : 100000;
+    vector<string> names = make_names(largest);
+    int many;
+
+    cout << "Seconds for each table:" << endl;
+    cout << setw(10) << "symbols"
+	 << setw(12) << "hash-global" << setw(12) << "hash-nested"
+	 << setw(12) << "lin-global" << setw(12) << "lin-nested" << endl;
+    for (many = 10000; many <= largest; many *= 10)
+    {
+	symbol_table<int> hashed;
+	linear_symbol_table<int> linear;
+
+	hashed.register_kind(0, 0, 1, true);
+	cout << setw(10) << many;
+	run(hashed, names, many);
+	if (many <= largest_linear)
+	    run(linear, names, many);
+	else
+	    cout << setw(24) << "(skipped)";
+	cout << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,205 @@
+//****************************************************************************
+// FILE: bench-tree.cxx
+// Benchmark of the attribute storage in the colorado::tree class
+// Version date: Oct 18, 2026
+// This program builds a large tree that has the same shape and the same
+// attributes as the parse tree of a long generated CU program, and then it
+// runs a decoration pass and a code-generation-style pass over the tree.
+// Each pass is run three times: once with the real attribute keys (which
+// are kept in the fixed slots of each node), once with the same keys spelled
+// with a leading underscore (which forces every attribute into the map), and
+// once with the real keys in a tree_arena.  The last column is the time to
+// delete the tree (or to release the arena).
+// The necessary commands are:
+// 1. g++ -Wall -O2 -c tree.cxx
+// 2. g++ -Wall -O2 -c intern.cxx
+// 3. g++ -Wall -O2 -c bench-tree.cxx
+// 4. g++ bench-tree.o tree.o intern.o -o bench-tree -lpthread
+// You can then run the benchmark with the number of statements:
+// bench-tree 200000
+//*****************************************************************************
+#include <cstdlib>          // Provides atoi, malloc, free
+#include <ctime>            // Provides clock
+#include <iomanip>          // Provides setw
+#include <iostream>         // Provides cout
+#include <new>              // Provides bad_alloc
+#include <string>           // Provides string class
+#include "tree.h"           // Provides the colorado::tree class
+using namespace std;        // cout and endl are in std::
+using namespace colorado;   // tree class
+
+// Every call of the global new operator is counted:
+static long many_allocations = 0;
+void* operator new(size_t bytes)
+{
+    ++many_allocations;
+    void* p = malloc(bytes == 0 ? 1 : bytes);
+    if (p == NULL) throw std::bad_alloc( );
+    return p;
+}
+void operator delete(void* p) throw( )
+{
+    free(p);
+}
+void operator delete(void* p, size_t) throw( )
+{
+    free(p);
+}
+
+// The keys that the benchmark uses.  With a prefix of "_", none of them
+// is a well-known key.
+struct keys
+{
+    string lhs, rhs, line, errors, token, type, addressable;
+    keys(const string& prefix) :
+	lhs(prefix + "LHS"), rhs(prefix + "RHS"), line(prefix + "Line"),
+	errors(prefix + "Errors"), token(prefix + "Token"),
+	type(prefix + "Type"), addressable(prefix + "Addressable") { }
+};
+
+// A leaf, decorated the way the lexer decorates a token:
+tree* leaf(const keys& k, int token, int line)
+{
+    tree* p = new tree("x");
+    p->set_attribute<int>(k.token, token);
+    p->set_attribute<int>(k.line, line);
+    p->set_attribute<int>(k.errors, 0);
+    return p;
+}
+
+// A nonterminal, decorated the way the parser decorates a node:
+tree* node(const keys& k, int lhs, int rhs, tree* a, tree* b = NULL, tree* c = NULL)
+{
+    tree* p = new tree("<expr>");
+    p->append_child(a);
+    if (b != NULL) p->append_child(b);
+    if (c != NULL) p->append_child(c);
+    p->set_attribute<int>(k.lhs, lhs);
+    p->set_attribute<int>(k.rhs, rhs);
+    p->set_attribute<int>(k.errors, 0);
+    p->set_attribute<int>(k.line, a->attribute<int>(k.line));
+    return p;
+}
+
+// Builds a list of many statements of the form "x = x * x + x;"
+tree* build(const keys& k, int many)
+{
+    tree* list = node(k, 11, 1, leaf(k, 0, 0));
+    int i;
+
+    for (i = 0; i < many; ++i)
+    {
+	tree* sum = node(
+	    k, 5, 20,
+	    node(k, 5, 22, node(k, 5, 13, leaf(k, 1, i)), leaf(k, 2, i), node(k, 5, 13, leaf(k, 1, i))),
+	    leaf(k, 3, i),
+	    node(k, 5, 13, leaf(k, 1, i))
+	    );
+	list->append_child(node(k, 10, 50, node(k, 5, 13, leaf(k, 1, i)), leaf(k, 4, i), sum));
+    }
+    return list;
+}
+
+// Decorates the tree in the same way as traverse_subtree:
+void decorate(const keys& k, tree* p, const tree* type)
+{
+    size_t i;
+
+    for (i = 0; i < p->many_children( ); ++i)
+	decorate(k, p->child(i), type);
+    if (!p->is_attribute<int>(k.lhs))
+	return;
+    for (i = 0; i < p->many_children( ); ++i)
+	p->attribute<int>(k.errors) += p->child(i)->attribute<int>(k.errors);
+    if (p->attribute<int>(k.lhs) == 5)
+    {
+	p->set_attribute<bool>(k.addressable, p->attribute<int>(k.rhs) == 13);
+	p->set_attribute<const tree*>(k.type, type);
+    }
+}
+
+// Reads the attributes in the same way as the code generator:
+long generate(const keys& k, const tree* p)
+{
+    long answer = 0;
+    size_t i;
+
+    if (p->is_attribute<int>(k.lhs))
+    {
+	answer += p->attribute<int>(k.rhs) + p->attribute<int>(k.line);
+	if (p->attribute<int>(k.lhs) == 5 && p->attribute<const tree*>(k.type) != NULL)
+	    answer += p->attribute<bool>(k.addressable);
+    }
+    else
+	answer += p->attribute<int>(k.token);
+    for (i = 0; i < p->many_children( ); ++i)
+	answer += generate(k, p->child(i));
+    return answer;
+}
+
+// Runs the four phases with one set of keys and prints one line.  If arena
+// is not NULL, then the trees are built in that arena.
+void run(const string& name, const keys& k, int many, tree_arena* arena = NULL)
+{
+    long before;
+    long allocations[3];
+    double seconds[4];
+    clock_t start;
+    long checksum;
+    tree* type;
+    tree* root;
+
+    tree_arena::set_current(arena);
+    type = new tree("<typeexpr>");
+    before = many_allocations; start = clock( );
+    root = build(k, many);
+    allocations[0] = many_allocations - before;
+    seconds[0] = double(clock( ) - start) / CLOCKS_PER_SEC;
+
+    before = many_allocations; start = clock( );
+    decorate(k, root, type);
+    allocations[1] = many_allocations - before;
+    seconds[1] = double(clock( ) - start) / CLOCKS_PER_SEC;
+
+    before = many_allocations; start = clock( );
+    checksum = generate(k, root);
+    allocations[2] = many_allocations - before;
+    seconds[2] = double(clock( ) - start) / CLOCKS_PER_SEC;
+
+    start = clock( );
+    if (arena == NULL)
+    {
+	delete root;
+	delete type;
+    }
+    else
+    {
+	tree_arena::set_current(NULL);
+	arena->release( );
+    }
+    seconds[3] = double(clock( ) - start) / CLOCKS_PER_SEC;
+
+    cout << setw(8) << name
+	 << setw(14) << allocations[0] << setw(10) << seconds[0]
+	 << setw(14) << allocations[1] << setw(10) << seconds[1]
+	 << setw(14) << allocations[2] << setw(10) << seconds[2]
+	 << setw(10) << seconds[3]
+	 << "   (checksum " << checksum << ")" << endl;
+}
+
+int main(int argc, char* argv[ ])
+{
+    int many = (argc > 1) ? atoi(argv[1]) : 100000;
+    tree_arena arena;
+
+    cout << "Statements: " << many << endl;
+    cout << setw(8) << "keys"
+	 << setw(24) << "build (allocs, sec)"
+	 << setw(24) << "decorate (allocs, sec)"
+	 << setw(24) << "generate (allocs, sec)"
+	 << setw(10) << "free" << endl;
+    run("slots", keys(""), many);
+    run("map", keys("_"), many);
+    run("arena", keys(""), many, &arena);
+    return 0;
+}
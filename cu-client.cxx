@@ -0,0 +1,192 @@
+//****************************************************************************
+// FILE: cu-client.cxx
+// Client of the CU compile server (cu --server, see cu.server.h)
+// Version date: Oct 18, 2026
+// This program is used in place of cu when a server is running.  It sends
+// a program to the server over the server's Unix domain socket and writes
+// the reply: the assembly code to standard output (or to the file named by
+// -o) and the error messages to standard error.  The exit status is 0 if
+// the program compiled with no errors, 1 if it did not, and 2 if the
+// server could not be reached.  The client does not need any other part
+// of the compiler, and it uses only the C library and the system calls
+// (no iostreams or strings), so that it starts in about half of the time
+// of a program that loads the C++ library:
+// 1. g++ -Wall -c cu-client.cxx
+// 2. g++ cu-client.o -o cu-client
+// Start the server and then compile with the client:
+// cu --server /tmp/cu.sock &
+// cu-client /tmp/cu.sock [--compact] [--threads N] [--registers] [--sse]
+//           [-O0 | -O1] [-o FILE] [program.cu | < program.cu]
+//*****************************************************************************
+#include <cerrno>           // Provides errno, EINTR
+#include <cstdio>           // Provides fprintf, sscanf, snprintf
+#include <cstdlib>          // Provides atoi, realloc
+#include <cstring>          // Provides memcpy, memchr, memset, strcmp, strlen
+#include <fcntl.h>          // Provides open
+#include <sys/socket.h>     // Provides socket, connect, shutdown
+#include <sys/un.h>         // Provides sockaddr_un
+#include <unistd.h>         // Provides read, write, close
+
+// A growing buffer of bytes, for the program and for the reply:
+struct buffer
+{
+    char* data;
+    size_t size;
+    size_t room;
+};
+
+// Writes the n bytes at s to fd, and returns false if that failed:
+bool write_all(int fd, const char* s, size_t n)
+{
+    ssize_t written;
+
+    while (n > 0)
+    {
+	written = write(fd, s, n);
+	if (written < 0 && errno == EINTR)
+	    continue;
+	if (written <= 0)
+	    return false;
+	s += written;
+	n -= written;
+    }
+    return true;
+}
+
+// Reads from fd until the other side is done, puts what was read at the
+// end of b, and returns false if that failed:
+bool read_all(int fd, buffer& b)
+{
+    ssize_t n;
+
+    for (;;)
+    {
+	if (b.room - b.size < 64*1024)
+	{
+	    b.room = 2*b.room + 64*1024;
+	    b.data = static_cast<char*>(realloc(b.data, b.room));
+	    if (b.data == NULL)
+		return false;
+	}
+	n = read(fd, b.data + b.size, b.room - b.size);
+	if (n == 0)
+	    return true;
+	if (n < 0 && errno != EINTR)
+	    return false;
+	if (n > 0)
+	    b.size += n;
+    }
+}
+
+int main(int argc, char* argv[ ])
+{
+    const char* socket_name = NULL; // The first argument
+    const char* source_file = NULL; // The program, if it is not read from stdin
+    const char* output_file = NULL; // Given by -o
+    bool compact = false;           // Given by --compact
+    bool registers = false;         // Given by --registers
+    bool sse = false;               // Given by --sse
+    int threads = 0;                // Given by --threads (0 if it is not)
+    const char* level = NULL;       // Given by -O0 or -O1
+    char threads_option[24] = "";   // " --threads N", if it was given
+    char options[64];               // The line of options of the request
+    buffer program = { NULL, 0, 0 };
+    buffer reply = { NULL, 0, 0 };
+    sockaddr_un address;
+    const char* newline;
+    bool usage_error = false;
+    int status;
+    unsigned long assembly_bytes, error_bytes;
+    size_t start;
+    int fd, i;
+
+    for (i = 1; i < argc; ++i)
+    {
+	if (socket_name == NULL && argv[i][0] != '-')
+	    socket_name = argv[i];
+	else if (strcmp(argv[i], "--compact") == 0)
+	    compact = true;
+	else if (strcmp(argv[i], "--threads") == 0 && i+1 < argc && atoi(argv[i+1]) > 0)
+	    threads = atoi(argv[++i]);
+	else if (strcmp(argv[i], "--registers") == 0)
+	    registers = true;
+	else if (strcmp(argv[i], "--sse") == 0)
+	    sse = true;
+	else if (strcmp(argv[i], "-O0") == 0 || strcmp(argv[i], "-O1") == 0)
+	    level = argv[i];
+	else if (strcmp(argv[i], "-o") == 0 && i+1 < argc)
+	    output_file = argv[++i];
+	else if (argv[i][0] != '-' && source_file == NULL)
+	    source_file = argv[i];
+	else
+	    usage_error = true;
+    }
+    if (usage_error || socket_name == NULL
+	|| strlen(socket_name) >= sizeof(address.sun_path))
+    {
+	fprintf(stderr, "Usage: %s SOCKET [--compact] [--threads N] [--registers]"
+		" [--sse] [-O0 | -O1] [-o FILE] [program.cu | < program.cu]\n", argv[0]);
+	return 2;
+    }
+
+    fd = (source_file == NULL) ? 0 : open(source_file, O_RDONLY);
+    if (fd < 0 || !read_all(fd, program))
+    {
+	fprintf(stderr, "Cannot read %s.\n", source_file ? source_file : "the program");
+	return 1;
+    }
+    if (fd != 0)
+	close(fd);
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socket_name, strlen(socket_name) + 1);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*) &address, sizeof(address)) != 0)
+    {
+	fprintf(stderr, "Cannot reach the server at %s: %s\n", socket_name, strerror(errno));
+	return 2;
+    }
+    // Each option is in the line once, however often it was given (the
+    // last --threads or -O wins), so the line always fits in options:
+    if (threads > 0)
+	snprintf(threads_option, sizeof(threads_option), " --threads %d", threads);
+    snprintf(options, sizeof(options), "%s%s%s%s%s%s\n",
+	     compact ? " --compact" : "", threads_option,
+	     registers ? " --registers" : "", sse ? " --sse" : "",
+	     level ? " " : "", level ? level : "");
+    if (!write_all(fd, options, strlen(options))
+	|| !write_all(fd, program.data, program.size)
+	|| shutdown(fd, SHUT_WR) != 0
+	|| !read_all(fd, reply))
+    {
+	fprintf(stderr, "The connection to the server failed.\n");
+	close(fd);
+	return 2;
+    }
+    close(fd);
+
+    // The reply is "status assembly_bytes error_bytes\n", the assembly
+    // code and the error messages:
+    newline = static_cast<const char*>(memchr(reply.data, '\n', reply.size));
+    if (newline == NULL
+	|| sscanf(reply.data, "%d %lu %lu", &status, &assembly_bytes, &error_bytes) != 3
+	|| reply.size != size_t(newline - reply.data) + 1 + assembly_bytes + error_bytes)
+    {
+	fprintf(stderr, "The reply of the server is garbled.\n");
+	return 2;
+    }
+    start = newline - reply.data + 1;
+    write_all(2, reply.data + start + assembly_bytes, error_bytes);
+    if (status != 0)
+	return 1;
+    fd = (output_file == NULL) ? 1 : open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0 || !write_all(fd, reply.data + start, assembly_bytes))
+    {
+	fprintf(stderr, "Cannot write %s.\n", output_file ? output_file : "the assembly code");
+	return 1;
+    }
+    if (fd != 1)
+	close(fd);
+    return 0;
+}
@@ -0,0 +1,209 @@
+// File: cu.batch.cxx
+// Version: Oct 18, 2026
+// This is the implementation file for the batch mode of the CU compiler
+// (see cu.batch.h).
+
+#include <cstddef>       // Provides size_t, NULL
+#include <fstream>       // Provides ofstream
+#include <iomanip>       // Provides setw, setprecision
+#include <iostream>      // Provides ostream
+#include <map>           // Provides map class
+#include <sstream>       // Provides ostringstream
+#include <string>        // Provides string class
+#include <vector>        // Provides vector class
+#include <pthread.h>     // Provides pthread_create, pthread_join
+#include <sys/time.h>    // Provides gettimeofday
+#include "tree.h"        // Provides the tree_arena class
+#include "mapped.h"      // Provides the mapped_file class
+#include "cu.compilation.h" // Provides the compilation struct and phases
+#include "cu.batch.h"
+using namespace std;
+using namespace colorado;
+
+//----------------------------------------------------------------------------
+// What became of one program of the batch:
+struct batch_unit
+{
+    string program;          // Name of the program
+    string assembly;         // Name of its assembly file
+    string errors;           // Everything written to its error stream
+    double seconds;          // Wall-clock time of its compilation
+    bool ok;                 // Whether it compiled with no errors
+};
+
+// The units that the workers of compile_batch share.  Each worker takes
+// the next unit that no worker has taken yet.
+struct batch_team
+{
+    vector<batch_unit>* units;
+    const batch_options* options;
+    size_t next;             // Index of the next unit to take
+};
+
+// Wall-clock time in seconds, since the units are compiled by several
+// threads at once:
+static double now( )
+{
+    timeval t;
+
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec / 1e6;
+}
+
+// The name of the assembly file for the named program.
+static string assembly_name(const string& program, const string& outdir)
+{
+    string name = program;
+    size_t slash;
+
+    if (name.size( ) > 3 && name.compare(name.size( )-3, 3, ".cu") == 0)
+	name.erase(name.size( )-3);
+    if (!outdir.empty( ))
+    {
+	slash = name.find_last_of("/\\");
+	if (slash != string::npos)
+	    name.erase(0, slash+1);
+	name = outdir + "/" + name;
+    }
+    return name + ".s";
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// Compiles one unit as cu compiles a named file.
+static void compile_unit(batch_unit& unit, const batch_options& options)
+{
+    ostringstream err;
+    ofstream output;
+    compilation c(output, err);
+    tree_arena arena;
+    mapped_file source(unit.program, 2);
+    double start = now( );
+
+    c.out.set_compact(options.compact);
+    c.threads = options.threads;
+    c.options = options.options;
+    if (options.arena)
+	tree_arena::set_current(&arena);
+    unit.ok = false;
+    if (!source.is_open( ))
+	err << "Cannot read " << unit.program << "." << endl;
+    else
+    {
+	scan_in_place(c, source.data( ), source.size( ));
+	if (!parse(c))
+	    err << "Parsing failed." << endl;
+	else
+	{
+	    traverse(c);
+	    if (c.root->attribute<int>("Errors") != 0)
+		err << "Errors in the traversal." << endl;
+	    else
+	    {   // The file is made only for a program with no errors:
+		output.open(unit.assembly.c_str( ), ios::out | ios::binary);
+		if (!output)
+		    err << "Cannot write " << unit.assembly << "." << endl;
+		else
+		{
+		    codegen(c, c.root);
+		    unit.ok = true;
+		}
+	    }
+	}
+	end_scan(c);
+    }
+    // Without an arena, the trees are freed one by one, so that a long
+    // batch does not keep the tree of every program until it ends:
+    if (!options.arena)
+	delete c.root;
+    tree_arena::set_current(NULL);
+    arena.release( );
+    unit.errors = err.str( );
+    unit.seconds = now( ) - start;
+}
+
+static void* compile_units(void* team_pointer)
+{
+    batch_team* team = static_cast<batch_team*>(team_pointer);
+    size_t i;
+
+    while ((i = __sync_fetch_and_add(&team->next, 1)) < team->units->size( ))
+	compile_unit((*team->units)[i], *team->options);
+    return NULL;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+bool compile_batch(
+    const vector<string>& programs,
+    const batch_options& options,
+    ostream& report
+    )
+{
+    vector<batch_unit> units(programs.size( ));
+    vector<pthread_t> threads;
+    map<string, size_t> first_with;  // The first unit of each assembly file
+    batch_team team;
+    double start = now( );
+    size_t i, many_threads;
+    int many_ok = 0;
+    bool clash = false;
+
+    // Two programs with one assembly file (such as a/x.cu and b/x.cu with
+    // an output directory) would overwrite each other's code, or write the
+    // file at once from two workers, so no program is compiled then:
+    for (i = 0; i < programs.size( ); ++i)
+    {
+	units[i].program = programs[i];
+	units[i].assembly = assembly_name(programs[i], options.outdir);
+	if (first_with.count(units[i].assembly) == 0)
+	    first_with[units[i].assembly] = i;
+	else
+	{
+	    report << "Both " << units[first_with[units[i].assembly]].program
+		   << " and " << programs[i] << " would be compiled into "
+		   << units[i].assembly << "." << endl;
+	    clash = true;
+	}
+    }
+    if (clash)
+	return false;
+    team.units = &units;
+    team.options = &options;
+    team.next = 0;
+
+    many_threads = (options.jobs < 1) ? 1 : options.jobs;
+    if (many_threads > units.size( ))
+	many_threads = units.size( );
+    if (many_threads <= 1)
+	compile_units(&team);
+    else
+    {
+	threads.resize(many_threads);
+	for (i = 0; i < many_threads; ++i)
+	    pthread_create(&threads[i], NULL, compile_units, &team);
+	for (i = 0; i < many_threads; ++i)
+	    pthread_join(threads[i], NULL);
+    }
+
+    report << fixed << setprecision(3);
+    for (i = 0; i < units.size( ); ++i)
+    {
+	report << units[i].errors;
+	report << setw(8) << units[i].seconds << " s  " << units[i].program;
+	if (units[i].ok)
+	{
+	    report << " -> " << units[i].assembly << endl;
+	    ++many_ok;
+	}
+	else
+	    report << " (failed)" << endl;
+    }
+    report << setw(8) << now( ) - start << " s  total: " << many_ok
+	   << " of " << units.size( ) << " programs compiled by "
+	   << many_threads << (many_threads == 1 ? " job" : " jobs") << endl;
+    return many_ok == int(units.size( ));
+}
+//----------------------------------------------------------------------------
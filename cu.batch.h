@@ -0,0 +1,65 @@
+// File: cu.batch.h
+// Version: Oct 18, 2026
+// This file provides the batch mode of the CU compiler (cu --batch), which
+// compiles many programs in one process, each into its own assembly file.
+// This saves the start-up of a process for each program, which is most of
+// the time for small programs.  Each program gets a compilation of its own
+// (see cu.compilation.h), so nothing of one program (its symbol table, its
+// queue of functions or its labels) is left over for the next one, and
+// several programs may be compiled at once by a pool of worker threads.
+//
+// A program named dir/name.cu is compiled into name.s in the output
+// directory, or into dir/name.s if there is no output directory.  The
+// program is scanned in place through mmap, as cu does with a named file.
+// If the program has errors, no assembly file is written.  If two of the
+// programs would be compiled into the same assembly file (such as a/x.cu
+// and b/x.cu with an output directory), then none of them is compiled.
+//
+// THE batch_options STRUCT has these members:
+//   std::string outdir   The output directory, or "" for none.
+//   int jobs             How many programs are compiled at once.
+//   int threads          The threads of the code generator for each
+//                        program (see compilation::threads).
+//   bool compact         Whether the assembly code is compact (see
+//                        cu.emitter.h).
+//   int options          The options of the code generator (see
+//                        compilation::options).
+//   bool arena           Whether the trees of each program are built in a
+//                        tree_arena of their own.
+// The constructor sets them to "", 1, 1, false, 0 and false.
+//
+// FUNCTION:
+//   bool compile_batch(const vector<string>& programs,
+//                      const batch_options& options, ostream& report)
+//     Postcondition: If two of the programs have the same assembly file,
+//     then each such pair was written to report, nothing was compiled and
+//     the return value is false.  Otherwise, each of the named programs
+//     has been compiled.  For each program (in the order of the names),
+//     its error messages (if any) and a line with its name, its assembly
+//     file and its wall-clock time were written to report, and then a line
+//     with the total time.  The return value is true if all of the
+//     programs compiled with no errors.
+
+#ifndef CU_BATCH_H
+#define CU_BATCH_H
+#include <iostream>      // Provides ostream
+#include <string>        // Provides string class
+#include <vector>        // Provides vector class
+
+struct batch_options
+{
+    batch_options( ) : jobs(1), threads(1), compact(false), options(0), arena(false) { }
+    std::string outdir;
+    int jobs;
+    int threads;
+    bool compact;
+    int options;
+    bool arena;
+};
+
+bool compile_batch(
+    const std::vector<std::string>& programs,
+    const batch_options& options,
+    std::ostream& report
+    );
+#endif
@@ -0,0 +1,391 @@
+// File: cu.cache.cxx
+// Version: Oct 18, 2026
+// This is the implementation file for the function cache of the CU
+// compiler (see cu.cache.h).
+
+#include <algorithm>     // Provides sort
+#include <cstddef>       // Provides size_t, NULL
+#include <cstdio>        // Provides rename, remove
+#include <cstring>       // Provides memcmp, memcpy
+#include <fstream>       // Provides ifstream, ofstream
+#include <iostream>      // Provides ostream
+#include <map>           // Provides map
+#include <sstream>       // Provides istringstream, ostringstream
+#include <string>        // Provides string class
+#include <utility>       // Provides pair
+#include <vector>        // Provides vector class
+#ifndef _WIN32
+#include <dirent.h>      // Provides opendir, readdir, closedir
+#include <sys/stat.h>    // Provides mkdir, stat
+#include <unistd.h>      // Provides getpid
+#include <utime.h>       // Provides utime
+#endif
+#include "tree.h"        // Provides the tree class
+#include "cu.tab.h"      // Provides the token numbers
+#include "cu.enum.h"     // Provides lhs, rhs
+#include "cu.types.h"    // Provides cu_type
+#include "cu.ir.h"       // Provides the asm_list class
+#include "cu.cache.h"
+using namespace std;
+using namespace colorado;
+
+//----------------------------------------------------------------------------
+// The attributes of a node (those of cu.serial.h), the most common first.
+// Line and Errors are looked up only to be counted: the code generator
+// never reads them, so they are not part of a key.
+enum value_kind { INT_VALUE, BOOL_VALUE, LHS_VALUE, RHS_VALUE, TREE_VALUE, TYPE_VALUE };
+struct field_info
+{
+    const char* key;
+    value_kind kind;
+    bool in_key;
+};
+static const field_info fields[ ] =
+{
+    { "Token", INT_VALUE, true }, { "Line", INT_VALUE, false },
+    { "LHS", LHS_VALUE, true }, { "RHS", RHS_VALUE, true },
+    { "Type", TYPE_VALUE, true }, { "Definition", TREE_VALUE, true },
+    { "Depth", INT_VALUE, true }, { "Kind", LHS_VALUE, true },
+    { "Offset", INT_VALUE, true }, { "Reference", BOOL_VALUE, true },
+    { "Addressable", BOOL_VALUE, true }, { "Bytes", INT_VALUE, true },
+    { "Constant", INT_VALUE, true }, { "Errors", INT_VALUE, false }
+};
+static const int MANY_FIELDS = sizeof(fields) / sizeof(fields[0]);
+
+// The keys of the fields as strings, made once (the tree looks up an
+// attribute by a string):
+static const string field_keys[MANY_FIELDS] =
+{
+    fields[0].key, fields[1].key, fields[2].key, fields[3].key,
+    fields[4].key, fields[5].key, fields[6].key, fields[7].key,
+    fields[8].key, fields[9].key, fields[10].key, fields[11].key,
+    fields[12].key, fields[13].key
+};
+
+static const string lhs_key("LHS");
+
+// A 128-bit hash, made of four 32-bit hashes of the same words, each with
+// its own seed and multiplier:
+struct key_hash
+{
+    unsigned int h[4];
+
+    key_hash( )
+	{ h[0] = 2166136261u; h[1] = 0x9e3779b9u; h[2] = 0x85ebca6bu; h[3] = 0xc2b2ae35u; }
+    void add_word(unsigned int w)
+	{
+	    h[0] = (h[0] ^ w) * 16777619u;  h[0] ^= h[0] >> 15;
+	    h[1] = (h[1] ^ w) * 0x2127599bu; h[1] ^= h[1] >> 13;
+	    h[2] = (h[2] ^ w) * 0x165667b1u; h[2] ^= h[2] >> 16;
+	    h[3] = (h[3] ^ w) * 0x27d4eb2fu; h[3] ^= h[3] >> 14;
+	}
+    void add(const void* data, size_t n)
+	{
+	    const char* s = static_cast<const char*>(data);
+	    unsigned int w;
+
+	    add_word(n);
+	    for ( ; n >= sizeof(w); s += sizeof(w), n -= sizeof(w))
+	    {
+		memcpy(&w, s, sizeof(w));
+		add_word(w);
+	    }
+	    if (n > 0)
+	    {
+		w = 0;
+		memcpy(&w, s, n);
+		add_word(w);
+	    }
+	}
+    void add_int(int i) { add_word(i); }
+    void add_string(const string& s) { add(s.data( ), s.size( )); }
+};
+
+static void hash_type(key_hash& k, const cu_type* t)
+{
+    for ( ; t != NULL; t = t->element)
+    {
+	k.add_int(t->format);
+	if (t->name != NULL)
+	    k.add_string(*t->name);
+    }
+    k.add_int(-1);
+}
+
+// Adds the node p (and its subtree) to the hash.  If signatures is not
+// NULL, then the signature of each definition that a node refers to is
+// added as well; the map holds the hash of each signature that was already
+// made.  In that case, only the attributes of the leaves are added: the
+// traverser works out those of the other nodes from the leaves below them
+// and from the definitions that the leaves refer to, so they add nothing
+// to the key (and looking them up is most of the cost of a key).
+// Otherwise (when p is itself such a signature) every attribute is added,
+// the bodies of functions and the initial values of variables are left out
+// (they are generated with their own code, not with the code that uses
+// them), and the references are not followed any further.
+typedef map<const tree*, key_hash> signature_map;
+static void hash_node(key_hash& k, const tree* p, signature_map* signatures)
+{
+    const tree* defn;
+    signature_map::iterator where;
+    size_t i, left;
+    int f;
+
+    k.add_string(p->label( ));
+    k.add_int(p->many_children( ));
+    left = (signatures != NULL && p->many_children( ) > 0) ? 0 : p->many_attributes( );
+    for (f = 0; f < MANY_FIELDS && left > 0; ++f)
+    {
+	const string& key = field_keys[f];
+	bool found = false;
+	int value = 0;
+
+	switch (fields[f].kind)
+	{
+	case INT_VALUE:
+	    if ((found = p->is_attribute<int>(key)))
+		value = p->attribute<int>(key);
+	    break;
+	case BOOL_VALUE:
+	    if ((found = p->is_attribute<bool>(key)))
+		value = p->attribute<bool>(key);
+	    break;
+	case LHS_VALUE:
+	    if ((found = p->is_attribute<lhs>(key)))
+		value = p->attribute<lhs>(key);
+	    break;
+	case RHS_VALUE:
+	    if ((found = p->is_attribute<rhs>(key)))
+		value = p->attribute<rhs>(key);
+	    break;
+	case TREE_VALUE:
+	    if ((found = p->is_attribute<const tree*>(key)))
+	    {
+		defn = p->attribute<const tree*>(key);
+		if (signatures != NULL && defn != NULL)
+		{
+		    where = signatures->find(defn);
+		    if (where == signatures->end( ))
+		    {
+			where = signatures->insert(make_pair(defn, key_hash( ))).first;
+			hash_node(where->second, defn, NULL);
+		    }
+		    for (i = 0; i < 4; ++i)
+			k.add_word(where->second.h[i]);
+		}
+	    }
+	    break;
+	case TYPE_VALUE:
+	    if ((found = p->is_attribute<const cu_type*>(key)))
+		hash_type(k, p->attribute<const cu_type*>(key));
+	    break;
+	}
+	if (found)
+	{
+	    --left;
+	    if (fields[f].in_key)
+	    {
+		k.add_int(f);
+		k.add_int(value);
+	    }
+	}
+    }
+    for (i = 0; i < p->many_children( ); ++i)
+    {
+	if (signatures != NULL || !p->child(i)->is_attribute<lhs>(lhs_key))
+	    hash_node(k, p->child(i), signatures);
+	else if (p->child(i)->attribute<lhs>(lhs_key) != body__
+	    && p->child(i)->attribute<lhs>(lhs_key) != expr__)
+	    hash_node(k, p->child(i), signatures);
+    }
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// The header of an entry file, which is followed by the list (see
+// asm_list::write):
+const char MAGIC[8] = { 'C', 'U', 'f', 'u', 'n', 'c', '\r', '\n' };
+struct entry_header
+{
+    char magic[8];
+    int version;
+    char key[32];
+    int many_labels;
+    unsigned int body_bytes;
+    unsigned int checksum;   // Of the body
+};
+
+static unsigned int checksum(const char* data, size_t n)
+{
+    key_hash k;
+
+    k.add(data, n);
+    return k.h[0];
+}
+
+function_cache::function_cache(const string& directory, size_t max_bytes)
+    : directory(directory), max_bytes(max_bytes), hits(0), misses(0), reused_bytes(0)
+{
+#ifndef _WIN32
+    mkdir(directory.c_str( ), 0777);
+#endif
+}
+
+string function_cache::key_of(const tree* funcdefn, bool comments, int options)
+{
+    static const char digits[ ] = "0123456789abcdef";
+    key_hash k;
+    signature_map signatures;
+    string answer;
+    int i, b;
+
+    k.add_int(CACHE_VERSION);
+    k.add_int(comments);
+    k.add_int(options);
+    hash_node(k, funcdefn, &signatures);
+    for (i = 0; i < 4; ++i)
+    {
+	for (b = 28; b >= 0; b -= 4)
+	    answer += digits[(k.h[i] >> b) & 15];
+    }
+    return answer;
+}
+
+string function_cache::path_of(const string& key) const
+{
+    return directory + "/" + key + ".cuf";
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+bool function_cache::load(const string& key, asm_list& code, int& many_labels)
+{
+    string path = path_of(key);
+    ifstream file(path.c_str( ), ios::in | ios::binary);
+    ostringstream contents;
+    string bytes;
+    entry_header header;
+    bool ok = false;
+
+    if (file)
+    {
+	contents << file.rdbuf( );
+	bytes = contents.str( );
+    }
+    if (bytes.size( ) >= sizeof(header))
+    {
+	memcpy(&header, bytes.data( ), sizeof(header));
+	ok = memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+	    && header.version == CACHE_VERSION
+	    && key.size( ) == sizeof(header.key)
+	    && memcmp(header.key, key.data( ), sizeof(header.key)) == 0
+	    && header.body_bytes == bytes.size( ) - sizeof(header)
+	    && header.checksum == checksum(bytes.data( ) + sizeof(header), header.body_bytes);
+    }
+    if (ok)
+    {
+	istringstream body(bytes.substr(sizeof(header)));
+	ok = code.read(body);
+	many_labels = header.many_labels;
+    }
+    if (!ok)
+    {
+	__sync_fetch_and_add(&misses, 1);
+	return false;
+    }
+    __sync_fetch_and_add(&hits, 1);
+#ifndef _WIN32
+    // The entry is now the most recently used one (see trim):
+    utime(path.c_str( ), NULL);
+#endif
+    return true;
+}
+
+void function_cache::store(const string& key, const asm_list& code, int many_labels)
+{
+    static long many_stores = 0;
+    ostringstream body;
+    ostringstream temporary;
+    string bytes;
+    entry_header header;
+    ofstream file;
+
+    if (key.size( ) != sizeof(header.key))
+	return;
+    code.write(body);
+    bytes = body.str( );
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = CACHE_VERSION;
+    memcpy(header.key, key.data( ), sizeof(header.key));
+    header.many_labels = many_labels;
+    header.body_bytes = bytes.size( );
+    header.checksum = checksum(bytes.data( ), bytes.size( ));
+
+    // Another thread or process may be writing the same entry, so each
+    // write goes to a file of its own, which is then renamed:
+    temporary << path_of(key) << '.' << __sync_fetch_and_add(&many_stores, 1);
+#ifndef _WIN32
+    temporary << '.' << getpid( );
+#endif
+    file.open(temporary.str( ).c_str( ), ios::out | ios::binary);
+    file.write((const char*) &header, sizeof(header));
+    file.write(bytes.data( ), bytes.size( ));
+    file.close( );
+    if (!file || rename(temporary.str( ).c_str( ), path_of(key).c_str( )) != 0)
+	remove(temporary.str( ).c_str( ));
+}
+
+void function_cache::add_reused(size_t bytes)
+{
+    __sync_fetch_and_add(&reused_bytes, long(bytes));
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+void function_cache::trim( )
+{
+#ifndef _WIN32
+    vector< pair<long, string> > entries; // Time of last use, and name
+    DIR* d = opendir(directory.c_str( ));
+    dirent* e;
+    struct stat status;
+    string name, path;
+    size_t total = 0;
+    size_t i;
+
+    if (d == NULL)
+	return;
+    while ((e = readdir(d)) != NULL)
+    {
+	name = e->d_name;
+	path = directory + "/" + name;
+	if (name.size( ) > 4 && name.compare(name.size( )-4, 4, ".cuf") == 0
+	    && stat(path.c_str( ), &status) == 0)
+	{
+	    entries.push_back(make_pair(long(status.st_mtime), path));
+	    total += status.st_size;
+	}
+    }
+    closedir(d);
+
+    // The oldest entries go first:
+    sort(entries.begin( ), entries.end( ));
+    for (i = 0; i < entries.size( ) && total > max_bytes; ++i)
+    {
+	if (stat(entries[i].second.c_str( ), &status) == 0
+	    && remove(entries[i].second.c_str( )) == 0)
+	    total -= status.st_size;
+    }
+#endif
+}
+
+void function_cache::write_stats(ostream& out) const
+{
+    out << "Function cache: " << hits << (hits == 1 ? " hit, " : " hits, ")
+	<< misses << (misses == 1 ? " miss, " : " misses, ")
+	<< reused_bytes << " bytes of assembly code reused." << endl;
+}
+//----------------------------------------------------------------------------
@@ -0,0 +1,100 @@
+// File: cu.cache.h
+// Version: Oct 18, 2026
+// This file provides the function cache of the CU compiler (cu --cache
+// DIR), which keeps the generated code of each function in a directory on
+// disk, so that when one function of a big program changes, only that
+// function is generated again.
+//
+// Each entry is the instruction list of one function (see cu.ir.h), with
+// the label numbers that start at 1 for the function (see
+// cgx_delayed_functions in cu.codegen.cxx), so it can be spliced into any
+// program.  Its key is a 128-bit hash of:
+//   the <funcdefn> subtree, including its nested functions: the labels of
+//   its nodes, their shapes and the attributes that the traverser set on
+//   its leaves (the ones that cu.serial.h saves, except Line and Errors,
+//   which the code generator never reads), such as the depth, offset and
+//   type of each identifier;
+//   for every identifier in it, the signature of the definition that it
+//   refers to (the nodes of the definition with their attributes, but not
+//   the body of a function or the initial value of a variable), whether
+//   it is a global, an enclosing or a local symbol;
+//   whether comments are kept (see cu.emitter.h), the options of the code
+//   generator (see cu.compilation.h), and CACHE_VERSION.
+// So a change anywhere in a function, or in the type, depth or offset of a
+// symbol that it uses, gives the function a new key.  CACHE_VERSION must be
+// changed whenever the code generator changes what it writes.
+//
+// An entry is a file named by the key in the directory.  It is written to
+// a temporary file and renamed, so that several compilations (in threads
+// or in processes) may share a directory.  Each file has a checksum, and a
+// file that is damaged is treated as a miss.  The directory is kept under
+// a bound by trim, which deletes the entries that were used least
+// recently (a hit touches the file).
+//
+// CONSTRUCTOR for the function_cache class:
+//   function_cache(const string& directory, size_t max_bytes)
+//     Postcondition: The cache keeps its entries in the directory (which
+//     has been made if it did not exist), and trim keeps them to max_bytes
+//     in all.  The counts are zero.
+//
+// MEMBER FUNCTIONS for the function_cache class (any of which may be
+// called by several threads at once, except trim):
+//   static std::string key_of
+//   (const colorado::tree* funcdefn, bool comments, int options)
+//     Precondition: funcdefn is a <funcdefn> of a decorated tree.
+//     Postcondition: The return value is the key of the function (32 hex
+//     digits), for code that keeps comments if comments is true, and that
+//     is generated with the given options (see compilation::options).
+//
+//   bool load(const std::string& key, asm_list& code, int& many_labels)
+//     Postcondition: If there is a good entry for the key, then code holds
+//     its instructions, many_labels is its number of labels, the entry is
+//     the most recently used, and the return value is true (a hit).
+//     Otherwise the return value is false (a miss).
+//
+//   void store(const std::string& key, const asm_list& code, int many_labels)
+//     Postcondition: The code has been written as the entry for the key
+//     (unless the file could not be written).
+//
+//   void add_reused(size_t bytes)
+//     Postcondition: bytes has been added to the count of assembly bytes
+//     that came from the cache.
+//
+//   void trim( )
+//     Postcondition: The least recently used entries have been deleted
+//     until the entries take no more than max_bytes.
+//
+//   void write_stats(std::ostream& out) const
+//     Postcondition: One line with the hits, the misses and the bytes of
+//     assembly code that came from the cache has been written to out.
+
+#ifndef CU_CACHE_H
+#define CU_CACHE_H
+#include <cstddef>       // Provides size_t
+#include <iostream>      // Provides ostream
+#include <string>        // Provides string class
+#include "tree.h"        // Provides the colorado::tree class
+#include "cu.ir.h"       // Provides the asm_list class
+
+class function_cache
+{
+public:
+    // Changed whenever the code generator changes what it writes:
+    static const int CACHE_VERSION = 2;
+
+    function_cache(const std::string& directory, size_t max_bytes);
+    static std::string key_of(const colorado::tree* funcdefn, bool comments, int options);
+    bool load(const std::string& key, asm_list& code, int& many_labels);
+    void store(const std::string& key, const asm_list& code, int many_labels);
+    void add_reused(size_t bytes);
+    void trim( );
+    void write_stats(std::ostream& out) const;
+private:
+    std::string directory;
+    size_t max_bytes;
+    long hits;
+    long misses;
+    long reused_bytes;       // Bytes of assembly code from hits
+    std::string path_of(const std::string& key) const;
+};
+#endif
@@ -6,29 +6,36 @@
 // additional discussion and documentation.
 //
 // This file provides the codegen( ) function that traverses the parse
-// tree (*parse_tree_root_ptr) produced by the lexer/parser/decorator for the
+// tree (c.root) produced by the lexer/parser/decorator for the
 // CU language. The traversal outputs assembly code for the input CU
-// program. The input comes from standard input (cin).  The assembly output
-// goes to standard output (cout).  Error output goes to error output (cerr).
+// program.  The instructions of each function are first added to the
+// instruction list of the compilation (see cu.ir.h), and then the list is
+// printed through the emitter of the compilation (see cu.compilation.h and
+// cu.emitter.h).  Error output goes to the compilation's error stream.
 
 // Windows or Linix directions:
 // To make the entire compiler with debugging checks: make hw7
 // After compilation, a CU program xxx.cu can be compiled to create
 // xxx.exe (in Windows) or an executable xxx file (in Linux) with:
 //   cu <xxx.cu >xxx.s
-//   g++ -m32 xxx.s -o xxx
+//   gcc -m32 xxx.s libcu.a -o xxx
+// The generated code calls the run-time library (cu.lib.s), which is
+// linked from libcu.a (make libcu.a; see cu.cxx).
 //-----------------------------------------------------------------------------
 
 
 //-----------------------------------------------------------------------------
 // Includes and directives
+#include <algorithm>      // Provides swap
 #include <cassert>        // Provides assert macro
 #include <cstdio>         // Provides sprintf
 #include <fstream>        // Provides ifstream
-#include <iomanip>        // Provides setw
-#include <iostream>       // Provides cerr and cout
+#include <iostream>       // Provides ostream
+#include <pthread.h>      // Provides pthread_create, pthread_join
 #include <queue>          // Provides queue
+#include <sstream>        // Provides ostringstream
 #include <string>         // Provides the string class
+#include <vector>         // Provides the vector class
 
 // if error "atof not declared":
 // include other header files for this function
@@ -36,63 +43,80 @@
 #include "tree.h"         // Provides the tree class
 #include "cu.tab.h"       // Provides the token numbers
 #include "cu.enum.h"      // Provides lhs, rhs
+#include "cu.types.h"     // Provides cu_type, is_compat and the basic types
+#include "cu.compilation.h" // Provides the compilation struct
+#include "cu.ir.h"        // Provides asm_list, asm_arg, print_asm and the opcodes
+#include "cu.object.h"    // Provides the elf_object class
+#include "cu.peephole.h"  // Provides peephole, peephole_name
+#include "cu.cache.h"     // Provides the function_cache class
+#include "cu.timing.h"    // Provides the time_report class, COUNT, COUNT_NAMED
 using namespace std;
 using namespace colorado;
 
-// Some type functions from cu.traverser.cxx
-extern int format_of_tt(const tree* tt);
-extern bool is_compat(const tree* var_type, const tree* expr_type, bool allow_coercion = true);
+// A function from cu.traverser.cxx
 extern int seq_length(const tree* p);
-extern const tree* const tt_primitive(string primitive); 
-extern const tree* tt_minus(const tree* tt, int qualifier);
 //-----------------------------------------------------------------------------
 
 
 //-----------------------------------------------------------------------------
 // Functions and MACROS for assembly instructions that we will use.
 // Note that we are using 32-bit machine instructions only (the -m32 option).
-#define ASM_COMMAND "\n#  gcc -m32 xxx.s -o xxx\n"
+#define ASM_COMMAND "\n#  gcc -m32 xxx.s libcu.a -o xxx\n"
+// Each macro adds one record to current->code (see cu.ir.h), and the
+// records of each function are printed when the function is done (by
+// cgx_print_code or cgx_delayed_functions).
 const int MAX_OPERAND = 34;        // Maximum length of an assembly operand
-const int TAB = 35;                // Position of tab in assembly commands
-#define ADD(op1, op2, comment) print_instruction(comment, "addl", op1, op2)
-#define ALLOCATE_STACK(amount, comment) print_instruction(comment, "subl", amount, "%esp")
-#define CALL(function, comment) print_instruction(comment, "call", function)
-#define CMP(op1, op2, comment) print_instruction(comment, "cmpl", op1, op2)
-#define CDQ(comment) print_instruction(comment, "cdq")
-#define DEC(op, comment) print_instruction(comment, "decl", op)
-#define IDIV(op, comment) print_instruction(comment, "idivl", op)
-#define IMUL(op, comment) print_instruction(comment, "imull", op)
-#define INC(op, comment) print_instruction(comment, "incl", op)
-#define JUMP(jxx, j, comment) print_instruction(comment, jxx, jump_label(j))
-#define LABEL(j) cout << "  " << jump_label(j) << ":" << endl
-#define LONG(op, comment) cout << "  .long " << setw(TAB-8) << (op) << " # " << (comment) << endl
-#define MOV(op1, op2, comment) print_instruction(comment, "movl", op1, op2)
-#define NEG_TOP print_instruction("(%esp) = -1*(%esp)", "negl", "(%esp)")
-#define NOT_TOP print_instruction("Flips between 0 and 1", "xorl", 1, "(%esp)")
-#define POP(op, comment) print_instruction(comment, "popl", op)
-#define PUSH(op, comment) print_instruction(comment, "pushl", op)
-#define RELEASE_STACK(amount, comment) print_instruction(comment, "addl", amount, "%esp")
-#define RET(comment) print_instruction(comment, "ret")
-#define SHL(amount, op, comment) print_instruction(comment, "shll", amount, op)
-#define SHR(amount, op, comment) print_instruction(comment, "shrl", amount, op)
-#define SUB(amount, op, comment) print_instruction(comment, "subl", amount, op)
-
-#define FADD(op, comment) print_instruction(comment, "fadd", op)
-#define FCHS(comment) print_instruction(comment, "fchs")
-#define FILD(op, comment) print_instruction(comment, "fild", op)
-#define FISTPL(op, comment) print_instruction(comment, "fistpl", op)
-#define FLD(op, comment) print_instruction(comment, "fld", op)
-#define FLDZ(comment) print_instruction(comment, "fldz")
-#define FSTP(op, comment) print_instruction(comment, "fstp", op)
-#define FSTP8(op, comment) print_instruction(comment, "fstpl", op)
-#define FSUB(op, comment) print_instruction(comment, "fsub", op)
+#define ADD(op1, op2, comment) current->code.add(OP_ADDL, op1, op2, comment)
+#define ALLOCATE_STACK(amount, comment) current->code.add(OP_SUBL, amount, "%esp", comment)
+#define CALL(function, comment) current->code.add(OP_CALL, function, asm_arg( ), comment)
+#define CMP(op1, op2, comment) current->code.add(OP_CMPL, op1, op2, comment)
+#define CDQ(comment) current->code.add(OP_CDQ, asm_arg( ), asm_arg( ), comment)
+#define DEC(op, comment) current->code.add(OP_DECL, op, asm_arg( ), comment)
+#define IDIV(op, comment) current->code.add(OP_IDIVL, op, asm_arg( ), comment)
+#define IMUL(op, comment) current->code.add(OP_IMULL, op, asm_arg( ), comment)
+#define INC(op, comment) current->code.add(OP_INCL, op, asm_arg( ), comment)
+#define JUMP(jxx, j, comment) current->code.add(jxx, jump_label(j), asm_arg( ), comment)
+#define LABEL(j) current->code.add(OP_LABEL, jump_label(j))
+#define LONG(op, comment) current->code.add(OP_LONG, asm_number_arg(op), asm_arg( ), comment)
+#define MOV(op1, op2, comment) current->code.add(OP_MOVL, op1, op2, comment)
+#define NEG_TOP current->code.add(OP_NEGL, "(%esp)", asm_arg( ), "(%esp) = -1*(%esp)")
+#define NOT_TOP current->code.add(OP_XORL, 1, "(%esp)", "Flips between 0 and 1")
+#define POP(op, comment) current->code.add(OP_POPL, op, asm_arg( ), comment)
+#define PUSH(op, comment) current->code.add(OP_PUSHL, op, asm_arg( ), comment)
+#define RELEASE_STACK(amount, comment) current->code.add(OP_ADDL, amount, "%esp", comment)
+#define RET(comment) current->code.add(OP_RET, asm_arg( ), asm_arg( ), comment)
+#define SHL(amount, op, comment) current->code.add(OP_SHLL, amount, op, comment)
+#define SHR(amount, op, comment) current->code.add(OP_SHRL, amount, op, comment)
+#define SUB(amount, op, comment) current->code.add(OP_SUBL, amount, op, comment)
+
+#define FADD(op, comment) current->code.add(OP_FADD, op, asm_arg( ), comment)
+#define FCHS(comment) current->code.add(OP_FCHS, asm_arg( ), asm_arg( ), comment)
+#define FILD(op, comment) current->code.add(OP_FILD, op, asm_arg( ), comment)
+#define FISTPL(op, comment) current->code.add(OP_FISTPL, op, asm_arg( ), comment)
+#define FLD(op, comment) current->code.add(OP_FLD, op, asm_arg( ), comment)
+#define FLDZ(comment) current->code.add(OP_FLDZ, asm_arg( ), asm_arg( ), comment)
+#define FSTP(op, comment) current->code.add(OP_FSTP, op, asm_arg( ), comment)
+#define FSTP8(op, comment) current->code.add(OP_FSTPL, op, asm_arg( ), comment)
+#define FSUB(op, comment) current->code.add(OP_FSUB, op, asm_arg( ), comment)
+
+// The scalar SSE2 instructions of the SSE_FLOATS option:
+#define CVTSD2SS(op1, op2, comment) current->code.add(OP_CVTSD2SS, op1, op2, comment)
+#define CVTSI2SD(op1, op2, comment) current->code.add(OP_CVTSI2SD, op1, op2, comment)
+#define CVTSI2SS(op1, op2, comment) current->code.add(OP_CVTSI2SS, op1, op2, comment)
+#define CVTSS2SD(op1, op2, comment) current->code.add(OP_CVTSS2SD, op1, op2, comment)
+#define CVTSS2SI(op1, op2, comment) current->code.add(OP_CVTSS2SI, op1, op2, comment)
+#define MOVSD(op1, op2, comment) current->code.add(OP_MOVSD, op1, op2, comment)
+#define MOVSS(op1, op2, comment) current->code.add(OP_MOVSS, op1, op2, comment)
+#define UCOMISS(op1, op2, comment) current->code.add(OP_UCOMISS, op1, op2, comment)
+#define XORPS(op1, op2, comment) current->code.add(OP_XORPS, op1, op2, comment)
+const int SIGN_BIT = -2147483647 - 1; // The sign bit of a 4-byte float
 //----------------------------------------------------------------------------
 
 
 //----------------------------------------------------------------------------
 #define check(b,fn)     \
   if (!(b))             \
-    {cerr << "ERROR -- Internal compiler error in " << (fn) << endl; return; }
+    {*current->err << "ERROR -- Internal compiler error in " << (fn) << endl; return; }
 //----------------------------------------------------------------------------
 
 
@@ -113,7 +137,7 @@ const int TAB = 35;                // Position of tab in assembly commands
 //
 // For debugging purposes, each of the cg functions begins with a check to
 // ensure that the parameter is a pointer to the right kind of tree.
-void codegen(const tree* p); // The main code generator.
+void codegen(compilation& c, const tree* p); // The main code generator.
 
 void cd_funcdefn(const tree* p);
 void cg_program(const tree* p);
@@ -131,32 +155,36 @@ void cg_stmt__RETURN_expr_SEMICOLON(const tree* p);
 void cg_stmtlist(const tree* p);
 void cgx_call(const tree* p);
 void cgx_coerce_stack_top_to_float( );
-void cgx_coerce_stack_top_to_float_if_needed(const tree* need_type, const tree* have_type);
+void cgx_coerce_stack_top_to_float_if_needed(const cu_type* need_type, const cu_type* have_type);
 void cgx_coerce_stack_top_to_int( );
 void cgx_common_externs( );
 void cgx_construct_defn(const tree* p);
 void cgx_construct_defnlist(const tree* p);
 void cgx_construct_variable(const tree* p);
-string cgx_define_array_constant(const tree* p);
-string cgx_define_string_constant(const tree* leaf);
+int cgx_define_array_constant(const tree* p);
+int cgx_define_string_constant(const tree* leaf);
 void cgx_delayed_functions( );
 void cgx_destruct_defn(const tree* p);
 void cgx_destruct_defnlist(const tree* p);
 void cgx_destruct_variable(const tree* p);
-void cgx_flop(const tree* p, string ffop, string fiop, string ifop);
+void cgx_flop(const tree* p, int ffop, int fiop, int ifop, bool comparison);
+void cgx_sse_flop(const tree* p, int ffop);
 void cgx_jump_for_false_boolexpr(const tree* p, int j);
 void cgx_jump_for_false_compare(const tree* p, int label_number);
 void cgx_jump_for_true_boolexpr(const tree* p, int j);
 void cgx_jump_for_true_compare(const tree* p, int label_number);
-void cgx_make_deep_copy(const tree* p);
+bool cgx_is_register_expr(const tree* p);
+void cgx_make_deep_copy(const cu_type* type);
+int cgx_many_instructions(const asm_list& code);
 void cgx_pop_to_variable(const tree* leaf);
-void cgx_push_default(const tree* type);
+void cgx_push_default(const cu_type* type);
 void cgx_push_lval_expr(const tree* p);
 void cgx_push_lval_expr__IDENTIFIER(const tree* p);
 void cgx_push_lval_expr__STAR_expr(const tree* p);
 void cgx_push_lval_expr__expr_LSQUARE_expr_RSQUARE(const tree* p);
 void cgx_push_lval_expr__MINUSMINUS_expr(const tree* p);
 void cgx_push_lval_expr__PLUSPLUS_expr(const tree* p);
+void cgx_push_register_expr(const tree* p);
 void cgx_push_rval_expr(const tree* leaf);
 void cgx_push_rval_expr__INTEGERVALUE(const tree* p);
 void cgx_push_rval_expr__FLOATVALUE(const tree* p);
@@ -190,64 +218,70 @@ void cgx_push_shallow_rval_expr__LPAREN_ARRAY_OF_typeexpr_IS_exprseq_RPAREN(cons
 void cgx_push_shallow_rval_expr__STAR_expr(const tree* p);
 void cgx_push_shallow_rval_expr__expr_LSQUARE_expr_RSQUARE(const tree* p);
 void cgx_push_static_link(int depth);
-void cgx_read(const tree* type);
+void cgx_read(const cu_type* type);
 void cgx_set_carry_flag_from_floats(const tree* p1, const tree* p2);
 void cgx_set_compare_flags(const tree* p);
-bool is_array(const tree* type);
-bool is_complex_array(const tree* type);
+void cgx_widen_stack_top_to_double(const cu_type* type);
 bool is_defn_reference(const tree* defn);
-bool is_simple_array(const tree* type);
-bool is_string(const tree* type);
-bool is_using_implicit_memory(const tree* type);
-string jump_label(int j);
+asm_arg jump_label(int j);
 string jump_label(string j);
-void print_instruction(string comment, string inst, string op1 = "", string op2 = "");
-void print_instruction(string comment, string inst, int op1, string op2 = "");
+void cgx_print_code( );
+void cgx_optimize(asm_list& code);
+void cgx_print_list(const asm_list& code, int label_base);
+size_t cgx_bytes_printed( );
 int unique_number( );
 //-----------------------------------------------------------------------------
 
 
 //-----------------------------------------------------------------------------
-// Global constants:
-const tree* const FLOAT_TYPE = tt_primitive("|float|");
-const tree* const INTEGER_TYPE = tt_primitive("|int|");
-const tree* const STRING_TYPE = tt_primitive("|string|");
-
-// The queue of delayed function definitions:
-queue<const tree*> delayed_queue;
-
-// The depth of any variable definitions that we process:
-int current_depth = 0;
+// The compilation that the calling thread is generating code for.  It
+// holds the queue of delayed function definitions (current->delayed_queue),
+// the depth of any variable definitions that we process
+// (current->current_depth) and the last number from unique_number.  Each
+// thread has its own copy of this pointer, so that several threads can
+// generate code for their own trees at once.  The threads that generate
+// the functions of one program (see cgx_delayed_functions) each point to
+// a compilation of their own, too.
+static __thread compilation* current = NULL;
 //-----------------------------------------------------------------------------
 
 
 //-----------------------------------------------------------------------------
-void codegen(const tree* p)
+void codegen(compilation& c, const tree* p)
 // Written by Michael Main (Feb 2, 2011)
 // This is the full code generator function.  Call it with the root of the
-// entire parse tree to write the assembly program to cout.
+// entire parse tree to write the assembly program to c's output stream.
+// The code of the program's start-up is built in c.code, and printed
+// before the functions, which are generated by c.threads threads.
 // Precondition: p, a complete parse tree for a cu program, has been
 // created by the lexer/parser/decorator with no errors.
-// Postcondition: A nasm assembly program for p has been written to cout.
+// Postcondition: A nasm assembly program for p has been written to c's
+// output stream (or added to c.object, if it is set).
 {
-    cout.setf(ios_base::left);
+    current = &c;
+    current->code.clear( );
+    current->code.keep_comments(!current->out.is_compact( ));
     check(p->attribute<lhs>("LHS") == program__, "compile");
     
-    cout << "# ..........................................................\n";
-    cout << "# This is assembly code generated by the CU compiler.\n";
-    cout << "# To assemble xxx.s into an executable: "
+    current->code << "# ..........................................................\n";
+    current->code << "# This is assembly code generated by the CU compiler.\n";
+    current->code << "# To assemble xxx.s into an executable: "
          << ASM_COMMAND;
-    cout << "# ..........................................................\n";
-    cout << '\n' << endl;
+    current->code << "# ..........................................................\n";
+    current->code << '\n' << '\n';
 
     cgx_common_externs( );
     cg_program(p);
+    cgx_print_code( );
     cgx_delayed_functions( );
     
-    cout << "# ..........................................................\n";
-    cout << "# End of assembly code generated by the 3155 compiler.\n";
-    cout << "# ..........................................................";
-    cout << endl;
+    current->code << "# ..........................................................\n";
+    current->code << "# End of assembly code generated by the 3155 compiler.\n";
+    current->code << "# ..........................................................";
+    current->code << '\n';
+    cgx_print_code( );
+    current->out.flush( );
+    COUNT(c, labels, c.last_label);
 }
 //-----------------------------------------------------------------------------
 
@@ -288,11 +322,12 @@ void cd_funcdefn(const tree* p)
     int offset;     // A unique number that's the Offset attribute 
     int depth;      // The depth of the function definition
     int body_index; // Index of body in the definition (6 or 8)
+    char digits[12]; // The offset as text
     const tree* stmtlist;
     const tree* defnlist;
     
-    // 0. Set information about the function, including the global
-    // current_depth to indicate the current depth of any definitions
+    // 0. Set information about the function, including
+    // current->current_depth to indicate the current depth of any definitions
     // that we will run into:
     name = p->child(1)->label( );
     offset = p->child(1)->attribute<int>("Offset");
@@ -300,13 +335,14 @@ void cd_funcdefn(const tree* p)
     body_index = p->many_children( ) - 1;
     defnlist = p->child(body_index)->child(1);
     stmtlist = p->child(body_index)->child(2);
-    current_depth = depth+1;
+    current->current_depth = depth+1;
     
     // 1. The entry-point label:
-    cout << "entry." << name << "." << offset << ":\n";
+    format_int(offset, digits);
+    current->code.add(OP_LABEL, "entry." + name + "." + digits, asm_arg( ), asm_text( ), ASM_BARE);
     if (depth == 0)
     {   // Additional label for external linking of global functions/procedures
-	cout << "__" << name << ":\n";
+	current->code.add(OP_LABEL, "__" + name, asm_arg( ), asm_text( ), ASM_BARE);
     }
 
     // 2. Create the function's frame
@@ -323,7 +359,7 @@ void cd_funcdefn(const tree* p)
     cg_stmtlist(stmtlist);
 
     // 5. The exit-point label:
-    cout << "jump.exit." << name << "." << offset << ":\n";
+    current->code.add(OP_LABEL, "jump.exit." + name + "." + digits, asm_arg( ), asm_text( ), ASM_BARE);
 
     // 6. Destroy any local variables that use implicit heap-dynamic memory:
     cgx_destruct_defnlist(defnlist);
@@ -349,40 +385,39 @@ void cg_program(const tree* p)
     check(p->attribute<lhs>("LHS") == program__, "cg_program");
 
     // Reserve the memory for global variables.
-    cout << "# ...........................................................\n";
-    cout << "# Include some useful assembly functions.\n";
-    cout << "  .include \"cu.lib.s\"" << endl;
-    cout << "# ...........................................................\n";
-    cout << endl;
-    cout << "# ...........................................................\n";
-    cout << "# Data section for globals and compiler requirements.\n";
-    cout << "  .section .data\n";
-    cout << "  compiler.globals: .rept "
+    current->code << "# ...........................................................\n";
+    current->code << "# The lib. functions are in libcu.a (made from cu.lib.s).\n";
+    current->code << "# ...........................................................\n";
+    current->code << '\n';
+    current->code << "# ...........................................................\n";
+    current->code << "# Data section for globals and compiler requirements.\n";
+    current->code << "  .section .data\n";
+    current->code << "  compiler.globals: .rept "
 	 << p->attribute<int>("Bytes")
 	 << "\n  .byte 0\n  .endr\n";
-    cout << "  compiler.globals.base: .long 0\n";           // globals -4 from here
-    cout << "  compiler.false: .asciz \"false\"\n";         // "false" null-termin
-    cout << "  compiler.true: .asciz \"true\"\n";           // "true" null-termin
-    cout << "  compiler.booleaninput: .long 0\n";           // |string| for bool in
-    cout << "  compiler.integerformat: .asciz \"%d\"\n";    // for scanf or printf
-    cout << "  compiler.floatformat: .asciz \"%f\"\n";      // for scanf or printf
-    cout << "  compiler.stringformat: .asciz \"%s\"\n";     // for printf only
-    cout << "  compiler.toos: .long 0\n";                   // return value to OS
-    cout << "  .section .text\n";
-    cout << "# ...........................................................\n";
-    cout << '\n' << endl;
-
-    cout << "# ..........................................................\n";
-    cout << "# Generate code for globals, and call main function." << endl;
-    cout << ".globl main\n";
-    cout << "main:\n";
-    cout << ".globl _main\n";
-    cout << "_main:\n";
+    current->code << "  compiler.globals.base: .long 0\n";           // globals -4 from here
+    current->code << "  compiler.false: .asciz \"false\"\n";         // "false" null-termin
+    current->code << "  compiler.true: .asciz \"true\"\n";           // "true" null-termin
+    current->code << "  compiler.booleaninput: .long 0\n";           // |string| for bool in
+    current->code << "  compiler.integerformat: .asciz \"%d\"\n";    // for scanf or printf
+    current->code << "  compiler.floatformat: .asciz \"%f\"\n";      // for scanf or printf
+    current->code << "  compiler.stringformat: .asciz \"%s\"\n";     // for printf only
+    current->code << "  compiler.toos: .long 0\n";                   // return value to OS
+    current->code << "  .section .text\n";
+    current->code << "# ...........................................................\n";
+    current->code << '\n' << '\n';
+
+    current->code << "# ..........................................................\n";
+    current->code << "# Generate code for globals, and call main function." << '\n';
+    current->code << ".globl main\n";
+    current->code << "main:\n";
+    current->code << ".globl _main\n";
+    current->code << "_main:\n";
     
     // Set up a fake function's frame for pre-main function.  Notice that we
     // save all general purpose registers for whoever called this program.
-    cout << "  fninit\n";  // Initialize the FPU
-    cout << "  pusha\n";  // Save registers for whoever called this program
+    current->code.add(OP_FNINIT, asm_arg( ), asm_arg( ), "", ASM_PLAIN);  // Initialize the FPU
+    current->code.add(OP_PUSHA, asm_arg( ), asm_arg( ), "", ASM_PLAIN);   // Save registers for whoever called this program
     PUSH(0, "Static depth of pre-main program");
     PUSH(0, "NULL static link for pre-main program");
     PUSH("%ebp", "Save ebp of pre-main's caller");
@@ -412,11 +447,11 @@ void cg_program(const tree* p)
     MOV("%ebp", "%esp", "Move stack pointer back down");
     POP("%ebp", "Restore caller's ebp");
     ADD(8, "%esp", "Release static link and static depth");
-    cout << "  popa\n";  // Restore registers for whoever called this program
+    current->code.add(OP_POPA, asm_arg( ), asm_arg( ), "", ASM_PLAIN);  // Restore registers for whoever called this program
     MOV("(compiler.toos)", "%eax", "%eax = main's return value");
     RET("Return to operating sys");
-    cout << "# ..........................................................\n";
-    cout << '\n' << endl;
+    current->code << "# ..........................................................\n";
+    current->code << '\n' << '\n';
 }
 //-----------------------------------------------------------------------------
 
@@ -528,14 +563,14 @@ void cg_stmt__READ_expr_SEMICOLON(const tree* p)
     check(p->attribute<rhs>("RHS") == __READ_expr_SEMICOLON, "cg_stmt__READ_expr_SEMICOLON");
 
     cgx_push_lval_expr(p->child(1));
-    cgx_read(p->child(1)->attribute<const tree*>("Type"));
+    cgx_read(p->child(1)->attribute<const cu_type*>("Type"));
 }
 
 void cg_stmt__WRITE_expr_SEMICOLON(const tree* p)
 // Written by Michael Main (Feb 3, 2011)
 {
     check(p->attribute<rhs>("RHS") == __WRITE_expr_SEMICOLON, "cg_stmt__WRITE_expr_SEMICOLON");
-    const tree* type = p->child(1)->attribute<const tree*>("Type");
+    const cu_type* type = p->child(1)->attribute<const cu_type*>("Type");
     int label1, label2;           // Two labels for jumps in boolean case
     bool is_address_available;    // Does the expr have an address?
 
@@ -570,9 +605,19 @@ void cg_stmt__WRITE_expr_SEMICOLON(const tree* p)
 	cgx_push_rval_expr(p->child(1));
 	
 	// Convert that 4-byte float to an 8-byte float for printf
-	FLD("(%esp)", "Load a 4-byte float from top of stack");
-	ALLOCATE_STACK(4, "4 more bytes, so an 8-byte float");
-	FSTP8("(%esp)", "Store the 8-byte float on top of the stack");
+	if (current->options & SSE_FLOATS)
+	{
+	    XORPS("%xmm0", "%xmm0", "Zero xmm0, so the cvt waits for nothing");
+	    CVTSS2SD("(%esp)", "%xmm0", "Convert the 4-byte float to 8 bytes");
+	    ALLOCATE_STACK(4, "4 more bytes, so an 8-byte float");
+	    MOVSD("%xmm0", "(%esp)", "Store the 8-byte float on top of the stack");
+	}
+	else
+	{
+	    FLD("(%esp)", "Load a 4-byte float from top of stack");
+	    ALLOCATE_STACK(4, "4 more bytes, so an 8-byte float");
+	    FSTP8("(%esp)", "Store the 8-byte float on top of the stack");
+	}
 
 	// Push the format argument, call printf, and clean up:
 	PUSH("$compiler.floatformat", "Push printf's format argument");
@@ -586,7 +631,7 @@ void cg_stmt__WRITE_expr_SEMICOLON(const tree* p)
         label2 = unique_number( );
         cgx_jump_for_true_boolexpr(p->child(1), label1);
         PUSH("$compiler.false", "Push format parameter for false");
-        JUMP("jmp", label2, "Do not print the true case");
+        JUMP(OP_JMP, label2, "Do not print the true case");
         LABEL(label1);
         PUSH("$compiler.true", "Push format parameter for true");
         LABEL(label2);
@@ -601,13 +646,13 @@ void cg_stmt__expr_EQ_expr_SEMICOLON(const tree* p)
     check(p->attribute<rhs>("RHS") == __expr_EQ_expr_SEMICOLON, "cg_stmt_expr_EQ_expr_SEMICOLON");
 
     const tree* target = p->child(0);
-    const tree* need_type = target->attribute<const tree*>("Type");
-    const tree* have_type = p->child(2)->attribute<const tree*>("Type");
+    const cu_type* need_type = target->attribute<const cu_type*>("Type");
+    const cu_type* have_type = p->child(2)->attribute<const cu_type*>("Type");
 
     cgx_push_rval_expr(p->child(2));
     cgx_coerce_stack_top_to_float_if_needed(need_type, have_type);
 	
-    if (is_using_implicit_memory(target->attribute<const tree*>("Type")))
+    if (need_type->is_using_implicit_memory)
     {
 	cgx_push_lval_expr(target);
 	MOV("(%esp)", "%eax", "%eax = ptr to array or string to free");
@@ -645,7 +690,7 @@ void cg_stmt__RETURN_SEMICOLON(const tree* p)
     
     // Jump to the exit code for this function
     sprintf(op, "exit.%s.%d", defn->child(1)->label().c_str(), defn->child(1)->attribute<int>("Offset")); 
-    JUMP("jmp", op, "To function exit");
+    JUMP(OP_JMP, op, "To function exit");
 }
 
 void cg_stmt__RETURN_expr_SEMICOLON(const tree* p)
@@ -656,8 +701,8 @@ void cg_stmt__RETURN_expr_SEMICOLON(const tree* p)
 	"cg_stmt__RETURN_expr_SEMICOLON"
 	);
     const tree* defn = p;
-    const tree* need_type;
-    const tree* have_type;
+    const cu_type* need_type;
+    const cu_type* have_type;
     char op[MAX_OPERAND];
     
     do
@@ -666,22 +711,20 @@ void cg_stmt__RETURN_expr_SEMICOLON(const tree* p)
     }   while (defn->attribute<lhs>("LHS") != funcdefn__);
     
     // Compute the return value:
-    need_type = defn->child(6);
-    have_type = p->child(1)->attribute<const tree*>("Type");
+    need_type = defn->child(6)->attribute<const cu_type*>("Type");
+    have_type = p->child(1)->attribute<const cu_type*>("Type");
     cgx_push_rval_expr(p->child(1));
     cgx_coerce_stack_top_to_float_if_needed(need_type, have_type);
 
     // Pop the return value in the return location.
-    sprintf(
-	op,
-	"%d(%%ebp)",
-	16 + defn->child(3)->attribute<int>("Bytes")
+    POP(
+	asm_memory_arg(EBP, 16 + defn->child(3)->attribute<int>("Bytes")),
+	"Pop the return value"
 	);
-    POP(op, "Pop the return value");
     
     // Jump to the exit code for this function
     sprintf(op, "exit.%s.%d", defn->child(1)->label().c_str(), defn->child(1)->attribute<int>("Offset")); 
-    JUMP("jmp", op, "To function exit");
+    JUMP(OP_JMP, op, "To function exit");
 }
 
 void cg_stmt__FREE_expr_SEMICOLON(const tree* p)
@@ -692,18 +735,18 @@ void cg_stmt__FREE_expr_SEMICOLON(const tree* p)
 {
     check(p->attribute<rhs>("RHS") == __FREE_expr_SEMICOLON, "cg_stmt__FREE_expr_SEMICOLON");
     const tree* child1 = p->child(1);
-    const tree* type;
+    const cu_type* type;
 
     // Compute the type of the data that we are releasing:
-    type = child1->attribute<const tree*>("Type");
-    type = tt_minus(type, POINTER);
+    type = child1->attribute<const cu_type*>("Type");
+    type = type_minus(type, POINTER);
 
     // Push a pointer to the dynamic memory that we're releasing
     cgx_push_rval_expr(child1);
 
     // If this pointer points to a string or array, then release the
     // implicit dynamic memory that it is using, too.
-    if (is_using_implicit_memory(type))
+    if (type->is_using_implicit_memory)
     {   // Release the implicit memory of the string or array
 	MOV("(%esp)", "%eax", "%eax = pointer to string or array");
 	MOV("(%eax)", "%eax", "%eax = string or array");
@@ -724,11 +767,10 @@ void cg_stmtlist(const tree* p)
 // The function generates code for each statement in the list.
 {
     check(p->attribute<lhs>("LHS") == stmtlist__, "cg_stmtlist");
+    size_t i;
     
-    if (p->attribute<rhs>("RHS") == __EMPTY)
-	return;
-    cg_stmtlist(p->child(0));
-    cg_stmt(p->child(1));
+    for (i = 0; i < p->many_children( ); ++i)
+	cg_stmt(p->child(i));
 }   
 //-----------------------------------------------------------------------------
 
@@ -759,15 +801,25 @@ void cgx_coerce_stack_top_to_float( )
 // Written by Michael Main (Feb 3, 2011)
 // This function generates code so that
 // the 4-byte int on top of the stack is coerced to a 4-byte float.
+// With SSE_FLOATS, the cvtsi2ss rounds the int just as the fstp does.
 {
-    FILD("(%esp)", "Load an int to float stack");
-    FSTP("(%esp)", "Store back to run-time stack");
+    if (current->options & SSE_FLOATS)
+    {
+	XORPS("%xmm0", "%xmm0", "Zero xmm0, so the cvt waits for nothing");
+	CVTSI2SS("(%esp)", "%xmm0", "Convert an int to a float");
+	MOVSS("%xmm0", "(%esp)", "Store back to run-time stack");
+    }
+    else
+    {
+	FILD("(%esp)", "Load an int to float stack");
+	FSTP("(%esp)", "Store back to run-time stack");
+    }
 }
 //-----------------------------------------------------------------------------
 
 
 //-----------------------------------------------------------------------------
-void cgx_coerce_stack_top_to_float_if_needed(const tree* need_type, const tree* have_type)
+void cgx_coerce_stack_top_to_float_if_needed(const cu_type* need_type, const cu_type* have_type)
 // Precondition: Both arguments are type trees.
 // Postcondition: If the need_type tree is float and the have_type tree is an
 // int, then cgx_coerce_stack_top_to_float is called to generate code to coerce
@@ -784,13 +836,13 @@ void cgx_coerce_stack_top_to_float_if_needed(const tree* need_type, const tree*
 	if( is_compat(need_type, FLOAT_TYPE, false) && is_compat(have_type, INTEGER_TYPE, false) ) { 
 		cgx_coerce_stack_top_to_float();
 	}
-	else if ( format_of_tt(need_type) == ARRAY) {
-		const tree * ltype = need_type;
-		const tree * rtype = have_type;
+	else if ( format_of_type(need_type) == ARRAY) {
+		const cu_type * ltype = need_type;
+		const cu_type * rtype = have_type;
 
-		while ( format_of_tt(ltype) == ARRAY) {
-			ltype = tt_minus(ltype, format_of_tt(ltype));
-			rtype = tt_minus(rtype, format_of_tt(rtype));
+		while ( format_of_type(ltype) == ARRAY) {
+			ltype = type_minus(ltype, format_of_type(ltype));
+			rtype = type_minus(rtype, format_of_type(rtype));
 
 			if ( is_compat(ltype, FLOAT_TYPE, false) && is_compat(rtype, INTEGER_TYPE, false) ){
 				mov((%esp), %eax, "move eax onto stack");
@@ -818,9 +870,19 @@ void cgx_coerce_stack_top_to_int( )
 // Written by Michael Main (Feb 3, 2011)
 // This function generates code so that
 // the 4-byte float on top of the stack is coerced to a 4-byte int.
+// With SSE_FLOATS, the cvtss2si rounds to the nearest int (with halves to
+// even), as the fistpl does; a cvttss2si would cut off the fraction.
 {
-    FLD("(%esp)", "Load the float to the float stack");
-    FISTPL("(%esp)", "Store back to run-time stack as int");
+    if (current->options & SSE_FLOATS)
+    {
+	CVTSS2SI("(%esp)", "%eax", "Round the float to an int");
+	MOV("%eax", "(%esp)", "Store back to run-time stack as int");
+    }
+    else
+    {
+	FLD("(%esp)", "Load the float to the float stack");
+	FISTPL("(%esp)", "Store back to run-time stack as int");
+    }
 }
 //-----------------------------------------------------------------------------
 
@@ -840,7 +902,7 @@ void cgx_construct_defn(const tree* p)
 	cgx_construct_variable(p->child(0));
 	break;
     case __funcdefn:
-	delayed_queue.push(p->child(0));
+	current->delayed_queue.push(p->child(0));
 	break;
     default:
 	break;
@@ -858,11 +920,10 @@ void cgx_construct_defnlist(const tree* p)
 // later.
 {
     check(p->attribute<lhs>("LHS") == defnlist__, "cg_construct_defnlist");
+    size_t i;
 
-    if (p->attribute<rhs>("RHS") == __EMPTY)
-        return;
-    cgx_construct_defnlist(p->child(0));
-    cgx_construct_defn(p->child(1));
+    for (i = 0; i < p->many_children( ); ++i)
+	cgx_construct_defn(p->child(i));
 }
 //-----------------------------------------------------------------------------
 
@@ -879,8 +940,8 @@ void cgx_construct_variable(const tree* p)
 	p->attribute<lhs>("LHS") == vardefn__,
 	"cg_construct_variabledefn"
 	);
-    const tree* type = p->child(0);
-    const tree* have_type;
+    const cu_type* type = p->child(0)->attribute<const cu_type*>("Type");
+    const cu_type* have_type;
     
     // Push the default value onto the stack.
     if (p->many_children( ) == 3)
@@ -890,7 +951,7 @@ void cgx_construct_variable(const tree* p)
     else
     {   // Push the r-value of the initialization expression
 	cgx_push_rval_expr(p->child(4));
-	have_type = p->child(4)->attribute<const tree*>("Type");
+	have_type = p->child(4)->attribute<const cu_type*>("Type");
 	cgx_coerce_stack_top_to_float_if_needed(type, have_type);
     }
 
@@ -909,100 +970,95 @@ void cgx_construct_variable(const tree* p)
 void cgx_common_externs( )
 {
 #ifdef __MINGW_H // Windows
-    cout << "# ..........................................................\n";
-    cout << "# Allow each external to be accessed via its Windows name\n";
-    cout << "  .set main,_main" << endl;
-    cout << "  .set calloc,_calloc" << endl;
-    cout << "  .set free,_free" << endl;
-    cout << "  .set getchar,_getchar" << endl;
-    cout << "  .set malloc,_malloc" << endl;
-    cout << "  .set memcpy,_memcpy" << endl;
-    cout << "  .set pow,_pow" << endl;
-    cout << "  .set printf,_printf" << endl;
-    cout << "  .set realloc,_realloc" << endl;
-    cout << "  .set scanf,_scanf"<< endl;
-    cout << "  .set stdin,__imp___iob" << endl;
-    cout << "  .set strcat,_strcat" << endl;
-    cout << "  .set strcmp,_strcmp" << endl;
-    cout << "  .set strcpy,_strcpy" << endl;
-    cout << "  .set strlen,_strlen" << endl;
-    cout << "  .set ungetc,_ungetc" << endl;
-    cout << "# ..........................................................\n";
-    cout << '\n' << endl;
+    current->code << "# ..........................................................\n";
+    current->code << "# Allow each external to be accessed via its Windows name\n";
+    current->code << "  .set main,_main" << '\n';
+    current->code << "  .set calloc,_calloc" << '\n';
+    current->code << "  .set free,_free" << '\n';
+    current->code << "  .set getchar,_getchar" << '\n';
+    current->code << "  .set malloc,_malloc" << '\n';
+    current->code << "  .set memcpy,_memcpy" << '\n';
+    current->code << "  .set pow,_pow" << '\n';
+    current->code << "  .set printf,_printf" << '\n';
+    current->code << "  .set realloc,_realloc" << '\n';
+    current->code << "  .set scanf,_scanf"<< '\n';
+    current->code << "  .set stdin,__imp___iob" << '\n';
+    current->code << "  .set strcat,_strcat" << '\n';
+    current->code << "  .set strcmp,_strcmp" << '\n';
+    current->code << "  .set strcpy,_strcpy" << '\n';
+    current->code << "  .set strlen,_strlen" << '\n';
+    current->code << "  .set ungetc,_ungetc" << '\n';
+    current->code << "# ..........................................................\n";
+    current->code << '\n' << '\n';
 #endif
 }
 //-----------------------------------------------------------------------------
 
 
 //-----------------------------------------------------------------------------
-string cgx_define_array_constant(const tree* p)
+int cgx_define_array_constant(const tree* p)
 // Written by Michael Main (Feb 3, 2011)
 // Generates code to create a readonly array of readonly elements in
-// static memory.  The return value is a string that can be used
-// in an assembly instruction as the r-value of the static array
-// (a pointer to byte 16 of the actual array).
+// static memory.  The return value is the number of the record, so that
+// "arrayrecord." and the number is the label of the static array (byte 16
+// of the actual array), whose address is the r-value of the array.
 {
-    char record_name[MAX_OPERAND];
-    char destination[MAX_OPERAND];
+    int record;
     size_t i, many, index;
     const tree* pal;
     const tree* pex;
-    const tree* ptmp;
-    const tree* need_type = p->child(3);
-    const tree* have_type;
+    const cu_type* need_type = p->child(3)->attribute<const cu_type*>("Type");
+    const cu_type* have_type;
     
     // Create an array record in the data section.  The format of the record
     // is described in the data type comments at the top of this file.
-    sprintf(record_name, "arrayrecord.%d", unique_number( ));
-    pal = ptmp = p->child(5);
+    record = unique_number( );
+    pal = p->child(5);
 
-    // Count how many elements in the array:
-    many = 0;
-    while (ptmp->many_children( ) == 3)
-    {
-	++many;
-	ptmp = ptmp->child(0);
-    }
-    if (ptmp->many_children( ) != 0)
-	++many;
+    // Each element of the array is one child of the exprseq:
+    many = pal->many_children( );
     
-    cout << "\n  .section .data\n";
+    current->code << "\n  .section .data\n";
     LONG(16+many*4, "Start of an array record (total bytes)");
-    LONG((is_using_implicit_memory(p->child(3))?1:0), "What kind of array");
+    LONG((need_type->is_using_implicit_memory?1:0), "What kind of array");
     LONG(0, "Reserved for future use");
     LONG(many, "Current size of the array record");
-    cout << "  " << record_name << ":\n  .rept " << many*4 << "\n  .byte 0\n  .endr\n";
-    cout << "\n  .section .text\n" << endl;
+    current->code.add(OP_LABEL, asm_symbol_arg(SYMBOL_OPERAND, "arrayrecord.", 0, record));
+    current->code << "  .rept " << int(many*4) << "\n  .byte 0\n  .endr\n";
+    current->code << "\n  .section .text\n" << '\n';
     for (i = 0; i < many; ++i)
     {
-	// Set pex to pal's <expr> child.  The index for this child is many - i - 1;
-	pex = pal->child(pal->many_children( )-1);
+	// The elements are evaluated from the last one to the first one.
 	index = many - i - 1;
+	pex = pal->child(index);
 	cgx_push_rval_expr(pex);
-	have_type = pex->attribute<const tree*>("Type");
+	have_type = pex->attribute<const cu_type*>("Type");
 	cgx_coerce_stack_top_to_float_if_needed(need_type, have_type);
-	sprintf(destination, "(%s+%lu)", record_name, index*4);
-	POP(destination, "Pop an array component");
-	pal = pal->child(0); // Down to the next exprseq
+	POP(
+	    asm_symbol_arg(SYMBOL_PLUS_OPERAND, "arrayrecord.", int(index*4), record),
+	    "Pop an array component"
+	    );
     }
 
-    return record_name;
+    return record;
 }
 //-----------------------------------------------------------------------------
 
 
 //-----------------------------------------------------------------------------
-string cgx_define_string_constant(const tree* leaf)
+int cgx_define_string_constant(const tree* leaf)
 // Written by Michael Main (Feb 3, 2011
+// The return value is the number of the string record, whose label is
+// "stringrecord." and the number.
 {
     const string value = leaf->label( );
-    char record_name[MAX_OPERAND];
+    int record;
     size_t i, length;
 
     // Create a string-record in the data section.  The format of the record
     // is described in the data type comments at the top of this file.
-    sprintf(record_name, "stringrecord.%d", unique_number( ));
-    cout << "\n  .section .data\n";
+    record = unique_number( );
+    current->code << "\n  .section .data\n";
     length = 0;
     for (i = 1; i < value.size( )-1; ++i)
     {
@@ -1014,7 +1070,11 @@ string cgx_define_string_constant(const tree* leaf)
     LONG(-1, "What kind of record? (-1 is string)");
     LONG(length, "Maximum chars in the string record");
     LONG(length, "Current chars in the string record");
-    cout << "  " << record_name << ": .byte ";
+    current->code.add(
+	OP_LABEL, asm_symbol_arg(SYMBOL_OPERAND, "stringrecord.", 0, record),
+	asm_arg( ), asm_text( ), ASM_PLAIN
+	);
+    current->code << ".byte ";
     for (i = 1; i < value.size( )-1; ++i)
     {
         if (value[i] == '\\')
@@ -1022,56 +1082,192 @@ string cgx_define_string_constant(const tree* leaf)
             ++i;
             if (isdigit(value[i]))
             {
-                cout << value[i++];
+                current->code << value[i++];
                 if (isdigit(value[i]))
-                    cout << value[i++];
+                    current->code << value[i++];
                 if (isdigit(value[i]))
-                    cout << value[i++];
+                    current->code << value[i++];
             }
             else switch(value[i])
             {
-            case 'n': cout << int('\n'); break;
-            case 't': cout << int('\t'); break;
-            case 'v': cout << int('\v'); break;
-            case 'b': cout << int('\b'); break;
-            case 'r': cout << int('\r'); break;
-            case 'f': cout << int('\f'); break;
-            case 'a': cout << int('\a'); break;
-            case '\\': cout << int('\\'); break;
-            case '?': cout << int('\?'); break;
-            case '\'': cout << int('\''); break;
-            case '"': cout << int('\"'); break;
-            default: cout << int(value[i]); break;
+            case 'n': current->code << int('\n'); break;
+            case 't': current->code << int('\t'); break;
+            case 'v': current->code << int('\v'); break;
+            case 'b': current->code << int('\b'); break;
+            case 'r': current->code << int('\r'); break;
+            case 'f': current->code << int('\f'); break;
+            case 'a': current->code << int('\a'); break;
+            case '\\': current->code << int('\\'); break;
+            case '?': current->code << int('\?'); break;
+            case '\'': current->code << int('\''); break;
+            case '"': current->code << int('\"'); break;
+            default: current->code << int(value[i]); break;
             }
         }
         else
-            cout << int(value[i]);
-        cout << ',';
+            current->code << int(value[i]);
+        current->code << ',';
     }
-    cout << "0\n";
-    cout << "  .section .text\n" << endl;
+    current->code << "0\n";
+    current->code << "  .section .text\n" << '\n';
 
-    return record_name;
+    return record;
 }
 //-----------------------------------------------------------------------------
 
 
 //-----------------------------------------------------------------------------
+// One function of cgx_delayed_functions.  Its code is generated with label
+// numbers that start at 1, and the numbers are moved past those of all the
+// functions before it when the code is printed.
+struct function_job
+{
+    const tree* p;                    // The <funcdefn>
+    asm_list code;                    // The code of the function
+    int many_labels;                  // How many numbers it got from unique_number
+    vector<const tree*> nested;       // Functions that it queued, in order
+    bool cached;                      // Whether the code came from the cache
+    string errors;                    // The error messages of the function
+};
+
+// The functions that the threads of cgx_delayed_functions share.  Each
+// thread takes the next job that no thread has taken yet.
+struct function_team
+{
+    vector<function_job>* jobs;
+    size_t next;                      // Index of the next job to take
+    compilation* owner;               // The compilation of the whole program
+};
+
+static void cgx_nested_functions(const tree* p, vector<const tree*>& nested)
+// The pointer p must be a pointer to a <funcdefn> node.  The functions
+// defined in its body are added to nested, in the order in which
+// cgx_construct_defnlist queues them when the function is generated.
+{
+    const tree* defnlist = p->child(p->many_children( ) - 1)->child(1);
+    size_t i;
+
+    for (i = 0; i < defnlist->many_children( ); ++i)
+    {
+	if (defnlist->child(i)->attribute<rhs>("RHS") == __funcdefn)
+	    nested.push_back(defnlist->child(i)->child(0));
+    }
+}
+
+static void* cgx_generate_functions(void* team_pointer)
+// Generates the code for the jobs of a function_team, until none are left.
+// The calling thread uses a compilation of its own for the state of the
+// code generator, so the team's compilation is only read.  The errors of
+// each function are kept in its job, for the owner to write in order.  A
+// function that is in the team's function cache (if any) is loaded
+// instead, and one that is not is stored there after it is generated.
+{
+    function_team* team = static_cast<function_team*>(team_pointer);
+    ostringstream errors;
+    compilation worker(cout, errors);
+    function_cache* cache = team->owner->cache;
+    string key;
+    size_t i;
+
+    current = &worker;
+    worker.code.keep_comments(!team->owner->out.is_compact( ));
+    worker.options = team->owner->options;
+    while ((i = __sync_fetch_and_add(&team->next, 1)) < team->jobs->size( ))
+    {
+	function_job& job = (*team->jobs)[i];
+	if (cache != NULL)
+	{
+	    key = function_cache::key_of(job.p, !team->owner->out.is_compact( ),
+					 team->owner->options);
+	    job.cached = cache->load(key, job.code, job.many_labels);
+	    if (job.cached)
+	    {
+		cgx_nested_functions(job.p, job.nested);
+		continue;
+	    }
+	}
+	worker.last_label = 0;
+	errors.str("");
+	worker.code << "# ..........................................................\n";
+	cd_funcdefn(job.p);
+	worker.code << "# ..........................................................\n";
+	worker.code << '\n' << '\n';
+	job.code.swap(worker.code);
+	job.many_labels = worker.last_label;
+	job.errors = errors.str( );
+	for ( ; !worker.delayed_queue.empty( ); worker.delayed_queue.pop( ))
+	    job.nested.push_back(worker.delayed_queue.front( ));
+	if (cache != NULL)
+	    cache->store(key, job.code, job.many_labels);
+    }
+    current = NULL;
+    return NULL;
+}
+
 void cgx_delayed_functions( )
 // Written by Michael Main (Feb 3, 2011)
-// This function causes all the definitions in delayed_queue
-// to have their code generated.
-{
-    while (!delayed_queue.empty( ))
-    {   // Generate the code for the function definition at the front of
-	// the queue.  Notice that cd_funcdefn could add more
-	// function definitions to the queue.
-	cout << "# ..........................................................\n";
-	cd_funcdefn(delayed_queue.front( ));
-	delayed_queue.pop( );
-	cout << "# ..........................................................\n";
-	cout << '\n' << endl;
+// This function causes all the definitions in current->delayed_queue
+// to have their code generated, by current->threads threads.  The
+// functions are generated in rounds: first those in the queue, and then
+// the ones that were defined inside of them, and so on.  Within a round,
+// the code of each function is printed in the order of the queue, so the
+// output is the same as if each function had been generated after the one
+// before it, no matter how many threads there are.
+{
+    compilation* owner = current;
+    vector<function_job> jobs;
+    vector<const tree*> round;
+    vector<pthread_t> threads;
+    function_team team;
+    int label_base = owner->last_label;
+    size_t i, many_threads, bytes;
+
+    for ( ; !owner->delayed_queue.empty( ); owner->delayed_queue.pop( ))
+	round.push_back(owner->delayed_queue.front( ));
+    while (!round.empty( ))
+    {
+	jobs.clear( );
+	jobs.resize(round.size( ));
+	for (i = 0; i < round.size( ); ++i)
+	{
+	    jobs[i].p = round[i];
+	    jobs[i].cached = false;
+	}
+	team.jobs = &jobs;
+	team.next = 0;
+	team.owner = owner;
+
+	many_threads = (owner->threads < 1) ? 1 : owner->threads;
+	if (many_threads > jobs.size( ))
+	    many_threads = jobs.size( );
+	if (many_threads == 1)
+	    cgx_generate_functions(&team);
+	else
+	{
+	    threads.resize(many_threads);
+	    for (i = 0; i < many_threads; ++i)
+		pthread_create(&threads[i], NULL, cgx_generate_functions, &team);
+	    for (i = 0; i < many_threads; ++i)
+		pthread_join(threads[i], NULL);
+	}
+	current = owner;
+
+	// Print the round, and collect the functions of the next round:
+	round.clear( );
+	for (i = 0; i < jobs.size( ); ++i)
+	{
+	    *owner->err << jobs[i].errors;
+	    cgx_optimize(jobs[i].code);
+	    COUNT(*owner, instructions, cgx_many_instructions(jobs[i].code));
+	    bytes = cgx_bytes_printed( );
+	    cgx_print_list(jobs[i].code, label_base);
+	    if (jobs[i].cached)
+		owner->cache->add_reused(cgx_bytes_printed( ) - bytes);
+	    label_base += jobs[i].many_labels;
+	    round.insert(round.end( ), jobs[i].nested.begin( ), jobs[i].nested.end( ));
+	}
     }
+    owner->last_label = label_base;
 }
 //-----------------------------------------------------------------------------
 
@@ -1107,11 +1303,11 @@ void cgx_destruct_defnlist(const tree* p)
 // later.
 {
     check(p->attribute<lhs>("LHS") == defnlist__, "cg_destruct_defnlist");
+    size_t i;
 
-    if (p->attribute<rhs>("RHS") == __EMPTY)
-        return;
-    cgx_destruct_defn(p->child(1));
-    cgx_destruct_defnlist(p->child(0));
+    // The variables are destroyed in the reverse order of their construction.
+    for (i = p->many_children( ); i > 0; --i)
+	cgx_destruct_defn(p->child(i-1));
 }
 //-----------------------------------------------------------------------------
 
@@ -1124,17 +1320,17 @@ void cgx_destruct_variable(const tree* p)
 // any implicit heap-dynamic memory used by the variable.
 {
     check(p->attribute<lhs>("LHS") == vardefn__, "cg_destruct_variabledefn");
-    const tree* type = p->child(0);
-    char op[MAX_OPERAND];
+    const cu_type* type = p->child(0)->attribute<const cu_type*>("Type");
+    asm_arg op;
     int offset = p->child(1)->attribute<int>("Offset");
     int identifier_depth = p->child(1)->attribute<int>("Depth");
     
-    if (is_using_implicit_memory(type))
+    if (type->is_using_implicit_memory)
     {   // Free the implicit heap dynamic memory used by this variable
 	if (identifier_depth == 0)
-	    sprintf(op, "(compiler.globals.base+%d)", offset);
+	    op = asm_symbol_arg(SYMBOL_PLUS_OPERAND, "compiler.globals.base", offset);
 	else
-	    sprintf(op, "%d(%%ebp)", offset);
+	    op = asm_memory_arg(EBP, offset);
 	MOV(op, "%eax", "%eax = rvalue of array or string");
 	CALL("lib.freerec", "Free implicit dynamic memory");
     }
@@ -1145,7 +1341,7 @@ void cgx_destruct_variable(const tree* p)
 //-----------------------------------------------------------------------------
 void cgx_flop(
     const tree* p,
-    string ffop, string fiop, string ifop,
+    int ffop, int fiop, int ifop,
     bool comparison
     )
 // Written by Michael Main (Feb 3, 2011)
@@ -1159,20 +1355,24 @@ void cgx_flop(
 // The (%esp) op is then removed from the run-time stack.
 // The result of the arithmetic operation is popped from the float stack
 // and pushed onto the run-time stack as a 4-byte float.
+// With SSE_FLOATS, cgx_sse_flop generates the code instead.
 {
     check(p->attribute<lhs>("LHS") == expr__, "cgx_flop");
-    const tree* type1 = p->child(0)->attribute<const tree*>("Type");
-    const tree* type2 = p->child(2)->attribute<const tree*>("Type");
+    const cu_type* type1 = p->child(0)->attribute<const cu_type*>("Type");
+    const cu_type* type2 = p->child(2)->attribute<const cu_type*>("Type");
 
+    if (current->options & SSE_FLOATS)
+    {
+	cgx_sse_flop(p, ffop);
+	return;
+    }
     if (is_compat(INTEGER_TYPE, type1))
     {   // Use ifop
 	cgx_push_rval_expr(p->child(0));
 	cgx_push_rval_expr(p->child(2));
 	FLD("(%esp)", "st0 = op2 for flop");
 	RELEASE_STACK(4, "Release memory used by op2");
-	cout << "  " << ifop 
-	     << setw(TAB-10-ifop.length( )) << " (%esp)" << " # "
-	     << "float-integer op" << endl;
+	current->code.add(ifop, "(%esp)", asm_arg( ), "float-integer op", ASM_FLOP);
     }
     else if (is_compat(INTEGER_TYPE, type2))
     {   // Use fiop 
@@ -1180,9 +1380,7 @@ void cgx_flop(
 	cgx_push_rval_expr(p->child(0));
 	FLD("(%esp)", "st0 = op1 for flop");
 	RELEASE_STACK(4, "Release memory used by op1");
-	cout << "  " << fiop 
-	     << setw(TAB-10-fiop.length( )) << " (%esp)" << " # "
-	     << "float-intger op" << endl;
+	current->code.add(fiop, "(%esp)", asm_arg( ), "float-intger op", ASM_FLOP);
     }
     else
     {   // Use ffop
@@ -1190,15 +1388,90 @@ void cgx_flop(
 	cgx_push_rval_expr(p->child(0));
 	FLD("(%esp)", "st0 = op1 for flop");
 	RELEASE_STACK(4, "Release memory used by op1");
-	cout << "  " << ffop 
-	     << setw(TAB-10-ffop.length( )) << " (%esp)" << " # "
-	     << "float-float op" << endl;
+	current->code.add(ffop, "(%esp)", asm_arg( ), "float-float op", ASM_FLOP);
     }
     FSTP("(%esp)", "Put result back on stack");
 }
 //-----------------------------------------------------------------------------
 
 
+//-----------------------------------------------------------------------------
+void cgx_sse_flop(const tree* p, int ffop)
+// Precondition: p is an expr node for a binary expression with at least
+// one of the two operands being a float, and ffop is the operation that
+// cgx_flop was given for two floats (OP_FADD, OP_FSUB, OP_FMUL or OP_FDIV).
+// Postcondition: The code to evaluate the expression with the scalar SSE2
+// instructions (the SSE_FLOATS option) has been generated, with the
+// operands evaluated in the same order as cgx_flop evaluates them, and the
+// result is on top of the run-time stack as a 4-byte float.
+// Two floats are combined by an addss, subss, mulss or divss, which rounds
+// the exact answer to a float, as the x87 does when it stores its answer.
+// If one operand is an int, both are converted to doubles (which hold any
+// int exactly), combined by addsd, subsd, mulsd or divsd, and rounded to a
+// float.  The x87 also rounds twice, to its 64-bit mantissa and then to a
+// float, so the two answers differ only when the exact answer needs more
+// than 53 bits and is that close to halfway between two floats.
+// A cvt sets only the low part of its xmm register, so it would wait for
+// the last instruction that set the register (often a slow divsd) if the
+// register were not zeroed by an xorps first.
+{
+    check(p->attribute<lhs>("LHS") == expr__, "cgx_sse_flop");
+    bool is_int1 = is_compat(INTEGER_TYPE, p->child(0)->attribute<const cu_type*>("Type"));
+    bool is_int2 = is_compat(INTEGER_TYPE, p->child(2)->attribute<const cu_type*>("Type"));
+    const char* op1;    // Where the operands are on the run-time stack
+    const char* op2;
+    int ssop, sdop;
+
+    switch (ffop)
+    {
+    case OP_FADD: ssop = OP_ADDSS; sdop = OP_ADDSD; break;
+    case OP_FSUB: ssop = OP_SUBSS; sdop = OP_SUBSD; break;
+    case OP_FMUL: ssop = OP_MULSS; sdop = OP_MULSD; break;
+    case OP_FDIV: ssop = OP_DIVSS; sdop = OP_DIVSD; break;
+    default: check(false, "cgx_sse_flop");
+    }
+
+    if (is_int1)
+    {
+	cgx_push_rval_expr(p->child(0));
+	cgx_push_rval_expr(p->child(2));
+	op1 = "4(%esp)";
+	op2 = "(%esp)";
+    }
+    else
+    {
+	cgx_push_rval_expr(p->child(2));
+	cgx_push_rval_expr(p->child(0));
+	op1 = "(%esp)";
+	op2 = "4(%esp)";
+    }
+    if (!is_int1 && !is_int2)
+    {
+	MOVSS(op1, "%xmm0", "xmm0 = op1 for flop");
+	current->code.add(ssop, op2, "%xmm0", "float-float op");
+	RELEASE_STACK(4, "Release memory used by one op");
+    }
+    else
+    {
+	XORPS("%xmm0", "%xmm0", "Zero xmm0, so the cvt waits for nothing");
+	XORPS("%xmm1", "%xmm1", "Zero xmm1, so the cvt waits for nothing");
+	if (is_int1)
+	    CVTSI2SD(op1, "%xmm0", "xmm0 = op1 as a double");
+	else
+	    CVTSS2SD(op1, "%xmm0", "xmm0 = op1 as a double");
+	if (is_int2)
+	    CVTSI2SD(op2, "%xmm1", "xmm1 = op2 as a double");
+	else
+	    CVTSS2SD(op2, "%xmm1", "xmm1 = op2 as a double");
+	current->code.add(sdop, "%xmm1", "%xmm0", "float-integer op");
+	RELEASE_STACK(4, "Release memory used by one op");
+	CVTSD2SS("%xmm0", "%xmm0", "Round the result to a float");
+    }
+    MOVSS("%xmm0", "(%esp)", "Put result back on stack");
+}
+//-----------------------------------------------------------------------------
+
+
 //-----------------------------------------------------------------------------
 void cgx_jump_for_false_boolexpr(const tree* p, int label_number)
 // Written by Michael Main (Feb 3, 2011)
@@ -1212,13 +1485,19 @@ void cgx_jump_for_false_boolexpr(const tree* p, int label_number)
 {
     check(p->attribute<lhs>("LHS") == expr__, "cgx_jump_for_false_boolexpr");
     int other_number;
-    
+
+    if (p->is_attribute<int>("Constant"))
+    {   // A condition that the traverser worked out (see cu.fold.cxx):
+	if (p->attribute<int>("Constant") == 0)
+	    JUMP(OP_JMP, label_number, "Jump for false folded constant");
+	return;
+    }
     switch(p->attribute<rhs>("RHS"))
     {
     case __TRUE:
 	break;
     case __FALSE:
-            JUMP("jmp", label_number, "Jump for false constant");
+            JUMP(OP_JMP, label_number, "Jump for false constant");
         break;
     case __expr_AND_expr:
         cgx_jump_for_false_boolexpr(p->child(0), label_number);
@@ -1251,7 +1530,7 @@ void cgx_jump_for_false_boolexpr(const tree* p, int label_number)
         cgx_push_rval_expr(p);
         POP("%eax", "Pop value of boolean variable");
         CMP(0, "%eax", "Check value of boolean variable");
-        JUMP("je", label_number, "Jump if false");
+        JUMP(OP_JE, label_number, "Jump if false");
         break;
     default:
         check(false, "cgx_jump_for_false_boolexpr");
@@ -1273,8 +1552,8 @@ void cgx_jump_for_false_compare(const tree* p, int label_number)
 // of the stack.
 {   
     check(p->attribute<lhs>("LHS") == expr__, "cgx_jump_for_false_compare");
-    const tree* type1 = p->child(0)->attribute<const tree*>("Type");
-    const tree* type2 = p->child(2)->attribute<const tree*>("Type");
+    const cu_type* type1 = p->child(0)->attribute<const cu_type*>("Type");
+    const cu_type* type2 = p->child(2)->attribute<const cu_type*>("Type");
     bool is_float = !is_compat(INTEGER_TYPE, type1) || !is_compat(INTEGER_TYPE, type2);
 
     if (is_float)
@@ -1283,27 +1562,27 @@ void cgx_jump_for_false_compare(const tree* p, int label_number)
 	{
         case __expr_LT_expr:
 	    cgx_set_carry_flag_from_floats(p->child(0), p->child(2));
-	    JUMP("jae", label_number, "Jump if !(a < b)");
+	    JUMP(OP_JAE, label_number, "Jump if !(a < b)");
 	    break;
 	case __expr_GT_expr:
 	    cgx_set_carry_flag_from_floats(p->child(2), p->child(0));
-	    JUMP("jae", label_number, "Jump if !(a > b)");
+	    JUMP(OP_JAE, label_number, "Jump if !(a > b)");
 	    break;
 	case __expr_LE_expr:
 	    cgx_set_carry_flag_from_floats(p->child(0), p->child(2));
-	    JUMP("ja", label_number, "Jump if !(a <= b)");
+	    JUMP(OP_JA, label_number, "Jump if !(a <= b)");
 	    break;
 	case __expr_GE_expr:
 	    cgx_set_carry_flag_from_floats(p->child(2), p->child(0));
-	    JUMP("ja", label_number, "Jump if !(a >= b)");
+	    JUMP(OP_JA, label_number, "Jump if !(a >= b)");
 	    break;
 	case __expr_EQEQ_expr:
 	    cgx_set_carry_flag_from_floats(p->child(0), p->child(2));
-	    JUMP("jne", label_number, "Jump if !(a == b)");
+	    JUMP(OP_JNE, label_number, "Jump if !(a == b)");
 	    break;
 	case __expr_NE_expr:
 	    cgx_set_carry_flag_from_floats(p->child(0), p->child(2));
-	    JUMP("je", label_number, "Jump if !(a != b)");
+	    JUMP(OP_JE, label_number, "Jump if !(a != b)");
 	    break;
 	default:
 	    check(false, "cgx_jump_for_false_compare");
@@ -1316,22 +1595,22 @@ void cgx_jump_for_false_compare(const tree* p, int label_number)
 	switch(p->attribute<rhs>("RHS"))
 	{
 	case __expr_LT_expr:
-	    JUMP("jge", label_number, "Jump for !(expr1 < expr2)");
+	    JUMP(OP_JGE, label_number, "Jump for !(expr1 < expr2)");
 	    break;
 	case __expr_GT_expr:
-	    JUMP("jle", label_number, "Jump for !(expr1 > expr2)");
+	    JUMP(OP_JLE, label_number, "Jump for !(expr1 > expr2)");
 	    break;
 	case __expr_LE_expr:
-	    JUMP("jg", label_number, "Jump for !(expr1 <= expr2)");
+	    JUMP(OP_JG, label_number, "Jump for !(expr1 <= expr2)");
 	    break;
 	case __expr_GE_expr:
-	    JUMP("jl", label_number, "Jump for !(expr1 >= expr2)");
+	    JUMP(OP_JL, label_number, "Jump for !(expr1 >= expr2)");
 	    break;
 	case __expr_EQEQ_expr:
-	    JUMP("jne", label_number, "Jump for !(expr1 == expr2)");
+	    JUMP(OP_JNE, label_number, "Jump for !(expr1 == expr2)");
 	    break;
 	case __expr_NE_expr:
-	    JUMP("je", label_number, "Jump for !(expr1 != expr2)");
+	    JUMP(OP_JE, label_number, "Jump for !(expr1 != expr2)");
 	    break;
 	default:
 	    check(false, "cgx_jump_for_false_compare");
@@ -1356,10 +1635,16 @@ void cgx_jump_for_true_boolexpr(const tree* p, int label_number)
     check(p->attribute<lhs>("LHS") == expr__, "cgx_jump_for_true_boolexpr");
     int other_number;
 
+    if (p->is_attribute<int>("Constant"))
+    {   // A condition that the traverser worked out (see cu.fold.cxx):
+	if (p->attribute<int>("Constant") != 0)
+	    JUMP(OP_JMP, label_number, "Jump for true folded constant");
+	return;
+    }
     switch(p->attribute<rhs>("RHS"))
     {
     case __TRUE:
-	JUMP("jmp", label_number, "Jump for true constant");
+	JUMP(OP_JMP, label_number, "Jump for true constant");
         break;
     case __FALSE:
 	break;
@@ -1394,7 +1679,7 @@ void cgx_jump_for_true_boolexpr(const tree* p, int label_number)
 	cgx_push_rval_expr(p);
         POP("%eax", "Pop value of boolean variable");
         CMP(0, "%eax", "Check value of boolean variable");
-        JUMP("jne", label_number, "Jump if true");
+        JUMP(OP_JNE, label_number, "Jump if true");
         break;
     default:
         check(false, "cgx_jump_for_true_boolexpr");
@@ -1417,8 +1702,8 @@ void cgx_jump_for_true_compare(const tree* p, int label_number)
 // of the stack.
 {
     check(p->attribute<lhs>("LHS") == expr__, "cgx_jump_for_true_compare");
-    const tree* type1 = p->child(0)->attribute<const tree*>("Type");
-    const tree* type2 = p->child(2)->attribute<const tree*>("Type");
+    const cu_type* type1 = p->child(0)->attribute<const cu_type*>("Type");
+    const cu_type* type2 = p->child(2)->attribute<const cu_type*>("Type");
     bool is_float = !is_compat(INTEGER_TYPE, type1) || !is_compat(INTEGER_TYPE, type2);
 
     if (is_float)
@@ -1427,27 +1712,27 @@ void cgx_jump_for_true_compare(const tree* p, int label_number)
 	{
         case __expr_LT_expr:
 	    cgx_set_carry_flag_from_floats(p->child(2), p->child(0));
-	    JUMP("ja", label_number, "");
+	    JUMP(OP_JA, label_number, "");
 	    break;
 	case __expr_GT_expr:
 	    cgx_set_carry_flag_from_floats(p->child(0), p->child(2));
-	    JUMP("ja", label_number, "");
+	    JUMP(OP_JA, label_number, "");
 	    break;
 	case __expr_LE_expr:
 	    cgx_set_carry_flag_from_floats(p->child(2), p->child(0));
-	    JUMP("jae", label_number, "");
+	    JUMP(OP_JAE, label_number, "");
 	    break;
 	case __expr_GE_expr:
 	    cgx_set_carry_flag_from_floats(p->child(0), p->child(2));
-	    JUMP("jae", label_number, "");
+	    JUMP(OP_JAE, label_number, "");
 	    break;
 	case __expr_EQEQ_expr:
 	    cgx_set_carry_flag_from_floats(p->child(0), p->child(2));
-	    JUMP("je", label_number, "");
+	    JUMP(OP_JE, label_number, "");
 	    break;
 	case __expr_NE_expr:
 	    cgx_set_carry_flag_from_floats(p->child(0), p->child(2));
-	    JUMP("jne", label_number, "");
+	    JUMP(OP_JNE, label_number, "");
 	    break;
 	default:
 	    check(false, "cgx_jump_for_false_compare");
@@ -1461,22 +1746,22 @@ void cgx_jump_for_true_compare(const tree* p, int label_number)
 	switch(p->attribute<rhs>("RHS"))
 	{   
 	case __expr_LT_expr:
-	    JUMP("jl", label_number, "Jump for (expr1 < expr2)");
+	    JUMP(OP_JL, label_number, "Jump for (expr1 < expr2)");
 	    break;
 	case __expr_GT_expr:
-	    JUMP("jg", label_number, "Jump for (expr1 > expr2)");
+	    JUMP(OP_JG, label_number, "Jump for (expr1 > expr2)");
 	    break;
 	case __expr_LE_expr:
-	    JUMP("jle", label_number, "Jump for (expr1 <= expr2)");
+	    JUMP(OP_JLE, label_number, "Jump for (expr1 <= expr2)");
 	    break;
 	case __expr_GE_expr:
-	    JUMP("jge", label_number, "Jump for (expr1 >= expr2)");
+	    JUMP(OP_JGE, label_number, "Jump for (expr1 >= expr2)");
 	    break;
 	case __expr_EQEQ_expr:
-	    JUMP("je", label_number, "Jump for (expr1 == expr2)");
+	    JUMP(OP_JE, label_number, "Jump for (expr1 == expr2)");
 	    break;
 	case __expr_NE_expr:
-	    JUMP("jne", label_number, "Jump for (expr1 != expr2)");
+	    JUMP(OP_JNE, label_number, "Jump for (expr1 != expr2)");
 	    break;
 	default:
 	    check(false, "cgx_jump_for_true_compare");
@@ -1488,7 +1773,7 @@ void cgx_jump_for_true_compare(const tree* p, int label_number)
 
 
 //-----------------------------------------------------------------------------
-void cgx_make_deep_copy(const tree* p)
+void cgx_make_deep_copy(const cu_type* type)
 // Written by Michael Main (Feb 3, 2011)
 // When this function is called, (%esp) is a pointer to an array or string
 // record (as described in the documentation of cgx_push_rval_expr).
@@ -1513,16 +1798,16 @@ void cgx_pop_to_variable(const tree* leaf)
 {
     check(leaf->attribute<int>("Token") == IDENTIFIER, "cgx_pop_to_variable");
 
-    char op[MAX_OPERAND];
+    asm_arg op;
     int identifier_depth = leaf->attribute<int>("Depth");
     int offset = leaf->attribute<int>("Offset");
-    int distance = current_depth - identifier_depth;
+    int distance = current->current_depth - identifier_depth;
     
     // Always pop to the variable's l-value.
-    // We start by putting that address into a string, op.
+    // We start by putting that address into an operand, op.
     if (identifier_depth == 0)
     {   // Pop to global variable
-        sprintf(op, "(compiler.globals.base+%d)", offset);
+        op = asm_symbol_arg(SYMBOL_PLUS_OPERAND, "compiler.globals.base", offset);
     }
     else if (distance == 0)
     {   // Pop to a local variable or parameter of the current frame
@@ -1541,20 +1826,20 @@ void cgx_pop_to_variable(const tree* leaf)
 
 
 //-----------------------------------------------------------------------------
-void cgx_push_default(const tree* type)
+void cgx_push_default(const cu_type* type)
 // Written by Michael Main (Feb 3, 2011)
 {
-    check(type->attribute<lhs>("LHS") == typeexpr__, "cgx_push_default");
+    check(type != NULL, "cgx_push_default");
 
     if (is_compat(type, FLOAT_TYPE))
     {   // Initialize a float with 0 constant:
 	FLDZ("Default value for float");
     }
-    else if (!is_using_implicit_memory(type))
+    else if (!type->is_using_implicit_memory)
     {   // An |int|, |bool|, or pointer to something.
 	PUSH(0, "Default value");
     }
-    else if (is_string(type))
+    else if (type->is_string)
     {   // A string. Make space for 15 characters initially, and
 	// set the string equal to the empty string initially.
 	PUSH(1, "Push calloc's elemsize argument");
@@ -1577,7 +1862,7 @@ void cgx_push_default(const tree* type)
 	CALL("malloc", "%eax = memory for new array");
 	RELEASE_STACK(4, "Pop malloc's arguments");
 	MOV(16, "(%eax)", "Number of bytes in the record");
-	if (is_simple_array(type))
+	if (type->is_simple_array)
 	    MOV(0, "4(%eax)", "Array type");
 	else
 	    MOV(1, "4(%eax)", "Array type");
@@ -1637,16 +1922,17 @@ void cgx_push_lval_expr__IDENTIFIER(const tree* p)
 // Written by Michael Main (Feb 3, 2011)
 {
     check(p->attribute<rhs>("RHS") == __IDENTIFIER, "cgx_push_lval_expr__IDENTIFIER");
-    char op[MAX_OPERAND];
     const tree* leaf = p->child(0);
     int identifier_depth = leaf->attribute<int>("Depth");
     int offset = leaf->attribute<int>("Offset");
-    int distance = current_depth - identifier_depth;
+    int distance = current->current_depth - identifier_depth;
     
     if (identifier_depth == 0)
     {   // Global variable
-	sprintf(op, "$compiler.globals.base+(%d)", offset);
-	PUSH(op, "Address of global reference variable");
+	PUSH(
+	    asm_symbol_arg(ADDRESS_PLUS_OPERAND, "compiler.globals.base", offset),
+	    "Address of global reference variable"
+	    );
     }
     else if (distance == 0)
     {   // A local variable or parameter of the current function's frame
@@ -1690,7 +1976,7 @@ void cgx_push_lval_expr__expr_LSQUARE_expr_RSQUARE(const tree* p)
     POP("%ecx", "%ecx = l-value of the array variable");
     MOV("(%ecx)", "%eax", "pointer to byte 16 of the array record");
     CMP("-4(%eax)", "%ebx", "Is index < array size?");
-    JUMP("jl", label, "If so, then jump over realloc");
+    JUMP(OP_JL, label, "If so, then jump over realloc");
 
     // Resize the array so that it has the specified index.
     // NOTE: Later we should increase beyond this amount to prevent
@@ -1718,7 +2004,7 @@ void cgx_push_lval_expr__expr_LSQUARE_expr_RSQUARE(const tree* p)
     LABEL(label_loop_top);
     PUSH("%ecx", "Save reg for call to cgx_push_default");
     PUSH("%edx", "Save reg for call to cgx_push_default");
-    cgx_push_default(p->attribute<const tree*>("Type"));
+    cgx_push_default(p->attribute<const cu_type*>("Type"));
     MOV("4(%esp)", "%edx", "Restore reg after call to cgx_push_default");
     MOV("8(%esp)", "%ecx", "Restore reg after call to cgx_push_default");
     POP("(%edx)", "Initialize the next array element");
@@ -1726,7 +2012,7 @@ void cgx_push_lval_expr__expr_LSQUARE_expr_RSQUARE(const tree* p)
     ADD(4, "%edx", "%edx = address of next uninitialized byte");
     INC("%ecx", "%ecx = number of elements already with value");
     CMP("%ebx", "%ecx", "Have we initialized all?");
-    JUMP("jle", label_loop_top, "If not, jump back to loop top"); 
+    JUMP(OP_JLE, label_loop_top, "If not, jump back to loop top"); 
     POP("%ebx", "Restore reg after calls to cgx_push_default");
     POP("%eax", "Restore reg after calls to cgx_push_default");
 
@@ -1808,6 +2094,17 @@ void cgx_push_rval_expr(const tree* p)
 {
     check(p->attribute<lhs>("LHS") == expr__, "cgx_push_rval_expr");
 
+    if (p->is_attribute<int>("Constant"))
+    {   // The traverser worked out its value (see cu.fold.cxx):
+	PUSH(p->attribute<int>("Constant"), "Push r-value of folded constant");
+	return;
+    }
+    if ((current->options & REGISTER_EXPRESSIONS) && cgx_is_register_expr(p))
+    {   // Evaluate it in registers instead (see cgx_push_register_expr):
+	cgx_push_register_expr(p);
+	return;
+    }
+
     switch(p->attribute<rhs>("RHS"))
     {
     case __INTEGERVALUE:
@@ -1946,7 +2243,7 @@ void cgx_push_rval_expr__STRINGVALUE(const tree* p)
 // Written by Michael Main (Feb 3, 2011)
 {
     check(p->attribute<rhs>("RHS") == __STRINGVALUE, "cgx_push_rval_expr__STRINGVALUE");
-    const tree* type = p->attribute<const tree*>("Type");
+    const cu_type* type = p->attribute<const cu_type*>("Type");
     cgx_push_shallow_rval_expr__STRINGVALUE(p); // Shallow string
     cgx_make_deep_copy(type);
 }
@@ -1955,9 +2252,9 @@ void cgx_push_rval_expr__IDENTIFIER(const tree* p)
 // Written by Michael Main (Feb 3, 2011)
 {
     check(p->attribute<rhs>("RHS") == __IDENTIFIER, "cgx_push_rval_expr__IDENTIFIER");
-    const tree* type = p->attribute<const tree*>("Type");
+    const cu_type* type = p->attribute<const cu_type*>("Type");
     cgx_push_shallow_rval_expr__IDENTIFIER(p);
-    if (is_using_implicit_memory(type))
+    if (type->is_using_implicit_memory)
 	cgx_make_deep_copy(type);
 }
 
@@ -1981,7 +2278,7 @@ void cgx_push_rval_expr__LPAREN_ARRAY_OF_typeexpr_IS_exprseq_RPAREN(const tree*
 	p->attribute<rhs>("RHS") == __LPAREN_ARRAY_OF_typeexpr_IS_exprseq_RPAREN,
 	"cgx_push_rval_expr__LPAREN_ARRAY_OF_typeexpr_IS_exprseq_RPAREN"
 	);
-    const tree* type = p->attribute<const tree*>("Type");
+    const cu_type* type = p->attribute<const cu_type*>("Type");
     cgx_push_shallow_rval_expr__LPAREN_ARRAY_OF_typeexpr_IS_exprseq_RPAREN(p);
     cgx_make_deep_copy(type);
 }
@@ -1998,8 +2295,8 @@ void cgx_push_rval_expr__LPAREN_NEW_typeexpr_IS_expr_RPAREN(const tree* p)
 	p->attribute<rhs>("RHS") == __LPAREN_NEW_typeexpr_IS_expr_RPAREN,
 	"cgx_push_rval_expr__LPAREN_NEW_typeexpr_IS_expr_RPAREN"
 	);
-    const tree* need_type = p->child(2);
-    const tree* have_type = p->child(4)->attribute<const tree*>("Type");
+    const cu_type* need_type = p->child(2)->attribute<const cu_type*>("Type");
+    const cu_type* have_type = p->child(4)->attribute<const cu_type*>("Type");
     
     // Push a value to store in the newly allocated memory:
     cgx_push_rval_expr(p->child(4));
@@ -2024,7 +2321,7 @@ void cgx_push_rval_expr__expr_OR_expr(const tree* p)
     
     cgx_push_rval_expr(p->child(0));    // The left operand
     CMP(1, "(%esp)", "Check left side of or");
-    JUMP("je", label_number, "Skip evaluation of right side");
+    JUMP(OP_JE, label_number, "Skip evaluation of right side");
     RELEASE_STACK(4, "Discard left side of or");
     cgx_push_rval_expr(p->child(2));    // The right operand
     LABEL(label_number);
@@ -2070,8 +2367,8 @@ void cgx_push_rval_expr__expr_HAT_expr(const tree* p)
 // Written by Michael Main (Feb 3, 2011)
 {
     check(p->attribute<rhs>("RHS") == __expr_HAT_expr, "cgx_push_rval_expr__expr_HAT_expr");
-    const tree* type1 = p->child(0)->attribute<const tree*>("Type");
-    const tree* type2 = p->child(2)->attribute<const tree*>("Type");
+    const cu_type* type1 = p->child(0)->attribute<const cu_type*>("Type");
+    const cu_type* type2 = p->child(2)->attribute<const cu_type*>("Type");
 
     if (is_compat(INTEGER_TYPE, type1) && is_compat(INTEGER_TYPE, type2))
     {
@@ -2085,21 +2382,12 @@ void cgx_push_rval_expr__expr_HAT_expr(const tree* p)
     else
     {   // Float exponentiation:
 	cgx_push_rval_expr(p->child(2));    // The exponent
-	if (is_compat(INTEGER_TYPE, type2))
-	    FILD("(%esp)", "Load a 4-byte float from top of stack");
-	else
-	    FLD("(%esp)", "Load a 4-byte float from top of stack");
-	ALLOCATE_STACK(4, "4 more bytes, so room for 8-byte float");
-	FSTP8("(%esp)", "Store the 8-byte float on top of the stack");
+	cgx_widen_stack_top_to_double(type2);
 
 	cgx_push_rval_expr(p->child(0));    // The base
-	if (is_compat(INTEGER_TYPE, type1))
-	    FILD("(%esp)", "Load a 4-byte float from top of stack");
-	else
-	    FLD("(%esp)", "Load a 4-byte float from top of stack");
-	ALLOCATE_STACK(4, "4 more bytes, so room for 8-byte float");
-	FSTP8("(%esp)", "Store the 8-byte float on top of the stack");
+	cgx_widen_stack_top_to_double(type1);
 
+	// pow returns its answer on the float stack, even with SSE_FLOATS:
 	CALL("pow", "Call pow");
 	RELEASE_STACK(12, "Remove 12 of 16 bytes of pow's arguments");
 	FSTP("(%esp)", "And replace the other 4 with pow's answer");
@@ -2110,8 +2398,8 @@ void cgx_push_rval_expr__expr_MINUS_expr(const tree* p)
 // Written by Michael Main (Feb 3, 2011)
 {
     check(p->attribute<rhs>("RHS") == __expr_MINUS_expr, "cgx_push_rval_expr__expr_MINUS_expr");
-    const tree* type1 = p->child(0)->attribute<const tree*>("Type");
-    const tree* type2 = p->child(2)->attribute<const tree*>("Type");
+    const cu_type* type1 = p->child(0)->attribute<const cu_type*>("Type");
+    const cu_type* type2 = p->child(2)->attribute<const cu_type*>("Type");
 
     if (is_compat(INTEGER_TYPE, type1) && is_compat(INTEGER_TYPE, type2))
     {
@@ -2122,7 +2410,7 @@ void cgx_push_rval_expr__expr_MINUS_expr(const tree* p)
     }
     else
     {   // Float subtraction:
-	cgx_flop(p, "fsub", "fisub", "fisubr", false);
+	cgx_flop(p, OP_FSUB, OP_FISUB, OP_FISUBR, false);
     }
 }
 
@@ -2151,8 +2439,8 @@ void cgx_push_rval_expr__expr_SLASH_expr(const tree* p)
 // Written by Michael Main (Feb 3, 2011)
 {
     check(p->attribute<rhs>("RHS") == __expr_SLASH_expr, "cgx_push_rval_expr__expr_SLASH_expr");
-    const tree* type1 = p->child(0)->attribute<const tree*>("Type");
-    const tree* type2 = p->child(2)->attribute<const tree*>("Type");
+    const cu_type* type1 = p->child(0)->attribute<const cu_type*>("Type");
+    const cu_type* type2 = p->child(2)->attribute<const cu_type*>("Type");
 
     if (is_compat(INTEGER_TYPE, type1) && is_compat(INTEGER_TYPE, type2))
     {
@@ -2166,7 +2454,7 @@ void cgx_push_rval_expr__expr_SLASH_expr(const tree* p)
     }
     else
     {   // Float divide:
-	cgx_flop(p, "fdiv", "fidiv", "fidivr", false);
+	cgx_flop(p, OP_FDIV, OP_FIDIV, OP_FIDIVR, false);
     }
 }
 
@@ -2174,8 +2462,8 @@ void cgx_push_rval_expr__expr_STAR_expr(const tree* p)
 // Written by Michael Main (Feb 3, 2011)
 {
     check(p->attribute<rhs>("RHS") == __expr_STAR_expr, "cgx_push_rval_expr__expr_STAR_expr");
-    const tree* type1 = p->child(0)->attribute<const tree*>("Type");
-    const tree* type2 = p->child(2)->attribute<const tree*>("Type");
+    const cu_type* type1 = p->child(0)->attribute<const cu_type*>("Type");
+    const cu_type* type2 = p->child(2)->attribute<const cu_type*>("Type");
 
     if (is_compat(INTEGER_TYPE, type1) && is_compat(INTEGER_TYPE, type2))
     {
@@ -2188,7 +2476,7 @@ void cgx_push_rval_expr__expr_STAR_expr(const tree* p)
     }
     else
     {   // Float multiply:
-	cgx_flop(p, "fmul", "fimul", "fimul", false);
+	cgx_flop(p, OP_FMUL, OP_FIMUL, OP_FIMUL, false);
     }
 }
 
@@ -2211,8 +2499,10 @@ void cgx_push_rval_expr__MINUS_expr(const tree* p)
 	);
     
     cgx_push_rval_expr(p->child(1));
-    if (is_compat(INTEGER_TYPE, p->child(1)->attribute<const tree*>("Type")))
+    if (is_compat(INTEGER_TYPE, p->child(1)->attribute<const cu_type*>("Type")))
 	NEG_TOP;
+    else if (current->options & SSE_FLOATS)
+	current->code.add(OP_XORL, SIGN_BIT, "(%esp)", "Flip the sign bit of the float");
     else
     {
 	FLD("(%esp)", "Load float to float stack");
@@ -2263,9 +2553,9 @@ void cgx_push_rval_expr__STAR_expr(const tree* p)
 	"cgx_push_rval_expr__STAR_expr"
 	);
 
-    const tree* type = p->attribute<const tree*>("Type");
+    const cu_type* type = p->attribute<const cu_type*>("Type");
     cgx_push_shallow_rval_expr__STAR_expr(p);
-    if (is_using_implicit_memory(type))
+    if (type->is_using_implicit_memory)
 	cgx_make_deep_copy(type);
 }
 
@@ -2281,7 +2571,7 @@ void cgx_push_rval_expr__expr_LSQUARE_expr_RSQUARE(const tree* p)
     const tree* parr = p->child(0);
     const tree* pindex = p->child(2);
     bool is_element_using_implicit_memory =
-        is_using_implicit_memory(p->attribute<const tree*>("Type"));
+        p->attribute<const cu_type*>("Type")->is_using_implicit_memory;
     bool is_shallow_copy_of_array_possible =
         parr->attribute<bool>("Addressable");
     
@@ -2337,6 +2627,318 @@ void cgx_push_rval_expr__PLUSPLUS_expr(const tree* p)
 //-----------------------------------------------------------------------------
 
 
+//-----------------------------------------------------------------------------
+// Expressions in registers (the REGISTER_EXPRESSIONS option).  An expression
+// whose operators are the int -, *, / and % (and unary minus, not and
+// parentheses) is evaluated in the registers below, and only its value is
+// pushed at the end.  The registers are given out by Sethi-Ullman
+// numbering: of two operands with no side effects, the one that needs more
+// registers is evaluated first, and when there are too few registers left
+// for the second operand, the first one is spilled to the stack.  A global
+// variable is used in place as the right operand.  Any other part of the
+// expression (a call, an array element, a constant and so on) is evaluated
+// by its usual stack code, and the registers that are in use are saved on
+// the stack around it, since that code may change any register.  %eax and
+// %edx are never given out, because idivl needs them.  (The int + is not
+// among the operators, since its stack code is still left for HW 5.)
+static const char* const expr_registers[ ] = { "%ebx", "%ecx", "%esi", "%edi" };
+const int MANY_EXPR_REGISTERS = 4;
+
+// The registers of expr_registers that hold values of the expression:
+struct register_set
+{
+    register_set( ) { for (int i = 0; i < MANY_EXPR_REGISTERS; ++i) busy[i] = false; }
+    bool busy[MANY_EXPR_REGISTERS];
+};
+
+static const tree* cgx_strip_parens(const tree* p)
+// Returns the expression inside of any parentheses and unary pluses
+// around the <expr> p.
+{
+    while (p->attribute<rhs>("RHS") == __LPAREN_expr_RPAREN
+	   || p->attribute<rhs>("RHS") == __PLUS_expr)
+	p = p->child(1);
+    return p;
+}
+
+bool cgx_is_register_expr(const tree* p)
+// The pointer p must point to an <expr> node.  The return value is true if
+// its operator is one that cgx_register_expr evaluates in registers (and
+// its value was not folded, which is pushed as a constant instead).
+{
+    p = cgx_strip_parens(p);
+    if (p->is_attribute<int>("Constant"))
+	return false;
+    switch (p->attribute<rhs>("RHS"))
+    {
+    case __expr_MINUS_expr:
+    case __expr_STAR_expr:
+    case __expr_SLASH_expr:
+	return is_compat(INTEGER_TYPE, p->child(0)->attribute<const cu_type*>("Type"))
+	    && is_compat(INTEGER_TYPE, p->child(2)->attribute<const cu_type*>("Type"));
+    case __expr_PERCENT_expr:
+    case __NOT_expr:
+	return true;
+    case __MINUS_expr:
+	return is_compat(INTEGER_TYPE, p->child(1)->attribute<const cu_type*>("Type"));
+    default:
+	return false;
+    }
+}
+
+static bool cgx_register_operand(const tree* p, asm_arg& op)
+// The pointer p must point to an <expr> node.  If it is a global variable
+// whose type does not use implicit memory, then op is set to the variable
+// (an operand that an instruction can use in place), and the return value
+// is true.  Otherwise the return value is false.
+{
+    const tree* leaf;
+
+    p = cgx_strip_parens(p);
+    if (p->attribute<rhs>("RHS") != __IDENTIFIER
+	|| p->attribute<const cu_type*>("Type")->is_using_implicit_memory)
+	return false;
+    leaf = p->child(0);
+    if (leaf->attribute<int>("Depth") != 0)
+	return false;
+    op = asm_symbol_arg(SYMBOL_PLUS_OPERAND, "compiler.globals.base", leaf->attribute<int>("Offset"));
+    return true;
+}
+
+static bool cgx_is_constant_expr(const tree* p)
+// The pointer p must point to an <expr> node.  The return value is true if
+// it is a constant, whose stack code pushes it and changes no register.
+{
+    if (p->is_attribute<int>("Constant"))
+	return true;
+    switch (cgx_strip_parens(p)->attribute<rhs>("RHS"))
+    {
+    case __INTEGERVALUE:
+    case __FLOATVALUE:
+    case __TRUE:
+    case __FALSE:
+    case __NULLPTR:
+	return true;
+    default:
+	return false;
+    }
+}
+
+static bool cgx_is_pure_expr(const tree* p)
+// The pointer p must point to an <expr> node.  The return value is true if
+// evaluating it in registers has no side effects (so that it may be
+// evaluated before or after the other operand of its parent).
+{
+    asm_arg op;
+
+    p = cgx_strip_parens(p);
+    if (cgx_register_operand(p, op) || cgx_is_constant_expr(p))
+	return true;
+    if (!cgx_is_register_expr(p))
+	return false;
+    if (p->many_children( ) == 2)
+	return cgx_is_pure_expr(p->child(1));
+    return cgx_is_pure_expr(p->child(0)) && cgx_is_pure_expr(p->child(2));
+}
+
+static int cgx_register_need(const tree* p)
+// The pointer p must point to an <expr> node.  The return value is its
+// Sethi-Ullman number: how many registers cgx_register_expr needs to
+// evaluate it without spilling.
+{
+    asm_arg op;
+    int left, right;
+
+    p = cgx_strip_parens(p);
+    if (!cgx_is_register_expr(p))
+	return 1;
+    if (p->many_children( ) == 2)
+	return cgx_register_need(p->child(1));
+    left = cgx_register_need(p->child(0));
+    right = cgx_register_operand(p->child(2), op) ? 0 : cgx_register_need(p->child(2));
+    return (left == right) ? left + 1 : (left > right) ? left : right;
+}
+
+static int cgx_take_register(register_set& rs)
+// Marks a free register of rs busy, and returns its index.
+{
+    int i;
+
+    for (i = 0; i < MANY_EXPR_REGISTERS - 1 && rs.busy[i]; ++i)
+	;
+    rs.busy[i] = true;
+    return i;
+}
+
+static int cgx_free_registers(const register_set& rs)
+// Returns how many registers of rs are free.
+{
+    int i, answer = 0;
+
+    for (i = 0; i < MANY_EXPR_REGISTERS; ++i)
+	answer += !rs.busy[i];
+    return answer;
+}
+
+static void cgx_register_operation(const tree* p, int r, const asm_arg& right)
+// The pointer p must point to a binary operator of cgx_is_register_expr.
+// Generates code that applies it to the left operand in register r and
+// the right operand, leaving the answer in register r.
+{
+    switch (p->attribute<rhs>("RHS"))
+    {
+    case __expr_MINUS_expr:
+	SUB(right, expr_registers[r], "Do the subtraction");
+	break;
+    case __expr_STAR_expr:
+	current->code.add(OP_IMULL, right, expr_registers[r], "Do the multiplication");
+	break;
+    default:
+	MOV(expr_registers[r], "%eax", "%eax = numerator for division");
+	CDQ("sign extend eax into edx:eax");
+	IDIV(right, "%eax = eax/right with remainder to edx");
+	if (p->attribute<rhs>("RHS") == __expr_SLASH_expr)
+	    MOV("%eax", expr_registers[r], "The quotient");
+	else
+	    MOV("%edx", expr_registers[r], "The remainder");
+	break;
+    }
+}
+
+static int cgx_register_from_stack(const tree* p, register_set& rs)
+// The pointer p must point to an <expr> node.  Generates code that
+// evaluates it by the usual stack code and pops its value into a free
+// register of rs, which is marked busy; the return value is the index of
+// that register.  The busy registers are saved around the stack code,
+// unless it is a constant.
+{
+    bool saved[MANY_EXPR_REGISTERS];
+    int i, r;
+
+    for (i = 0; i < MANY_EXPR_REGISTERS; ++i)
+    {
+	saved[i] = rs.busy[i] && !cgx_is_constant_expr(p);
+	if (saved[i])
+	    PUSH(expr_registers[i], "Save a register of the expression");
+    }
+    cgx_push_rval_expr(p);
+    r = cgx_take_register(rs);
+    POP(expr_registers[r], "An operand of the expression");
+    for (i = MANY_EXPR_REGISTERS - 1; i >= 0; --i)
+    {
+	if (saved[i])
+	    POP(expr_registers[i], "Restore a register of the expression");
+    }
+    return r;
+}
+
+static int cgx_register_expr(const tree* p, register_set& rs)
+// The pointer p must point to an <expr> node of type int or bool, and rs
+// must have a free register.  Generates code that evaluates it into a free
+// register of rs, which is marked busy.  The return value is the index of
+// that register.
+{
+    const tree* first;
+    const tree* second;
+    asm_arg op;
+    bool reversed;
+    int r, s;
+
+    p = cgx_strip_parens(p);
+    if (cgx_register_operand(p, op))
+    {
+	r = cgx_take_register(rs);
+	MOV(op, expr_registers[r], "Load a static variable");
+	return r;
+    }
+    if (!cgx_is_register_expr(p))
+	return cgx_register_from_stack(p, rs);
+
+    // The unary operators:
+    if (p->attribute<rhs>("RHS") == __MINUS_expr)
+    {
+	r = cgx_register_expr(p->child(1), rs);
+	current->code.add(OP_NEGL, expr_registers[r], asm_arg( ), "Negate it");
+	return r;
+    }
+    if (p->attribute<rhs>("RHS") == __NOT_expr)
+    {
+	r = cgx_register_expr(p->child(1), rs);
+	current->code.add(OP_XORL, 1, expr_registers[r], "Flips between 0 and 1");
+	return r;
+    }
+
+    // A binary operator whose right operand is used in place:
+    if (cgx_register_operand(p->child(2), op))
+    {
+	r = cgx_register_expr(p->child(0), rs);
+	cgx_register_operation(p, r, op);
+	return r;
+    }
+
+    // Otherwise the operand that needs more registers goes first, unless
+    // that would change the order of side effects:
+    reversed = cgx_is_pure_expr(p->child(0)) && cgx_is_pure_expr(p->child(2))
+	&& cgx_register_need(p->child(2)) > cgx_register_need(p->child(0));
+    first = p->child(reversed ? 2 : 0);
+    second = p->child(reversed ? 0 : 2);
+    r = cgx_register_expr(first, rs);
+    if (cgx_free_registers(rs) >= cgx_register_need(second))
+    {
+	s = cgx_register_expr(second, rs);
+	if (reversed)
+	    swap(r, s);
+	cgx_register_operation(p, r, expr_registers[s]);
+	rs.busy[s] = false;
+	return r;
+    }
+
+    // Too few registers, so the first operand is spilled:
+    PUSH(expr_registers[r], "Spill an operand to the stack");
+    rs.busy[r] = false;
+    s = cgx_register_expr(second, rs);
+    if (reversed)
+    {   // The right operand is on the stack:
+	cgx_register_operation(p, s, "(%esp)");
+	RELEASE_STACK(4, "Pop the spilled operand");
+    }
+    else if (p->attribute<rhs>("RHS") == __expr_MINUS_expr)
+    {   // The left operand is on the stack:
+	SUB(expr_registers[s], "(%esp)", "Do the subtraction");
+	POP(expr_registers[s], "Pop the answer");
+    }
+    else if (p->attribute<rhs>("RHS") == __expr_STAR_expr)
+    {
+	current->code.add(OP_IMULL, "(%esp)", expr_registers[s], "Do the multiplication");
+	RELEASE_STACK(4, "Pop the spilled operand");
+    }
+    else
+    {
+	POP("%eax", "%eax = numerator for division");
+	CDQ("sign extend eax into edx:eax");
+	IDIV(expr_registers[s], "%eax = eax/right with remainder to edx");
+	if (p->attribute<rhs>("RHS") == __expr_SLASH_expr)
+	    MOV("%eax", expr_registers[s], "The quotient");
+	else
+	    MOV("%edx", expr_registers[s], "The remainder");
+    }
+    return s;
+}
+
+void cgx_push_register_expr(const tree* p)
+// The pointer p must point to an <expr> node for which
+// cgx_is_register_expr is true.  Generates code that evaluates it in
+// registers and pushes its value, just as cgx_push_rval_expr would.
+{
+    register_set rs;
+    int r;
+
+    r = cgx_register_expr(p, rs);
+    PUSH(expr_registers[r], "Push the value of the expression");
+}
+//-----------------------------------------------------------------------------
+
+
 //-----------------------------------------------------------------------------
 void cgx_push_shallow_rval_expr(const tree* p)
 // Written by Michael Main (Feb 3, 2011)
@@ -2394,24 +2996,25 @@ void cgx_push_shallow_rval_expr__STRINGVALUE(const tree* p)
 // Written by Michael Main (Feb 3, 2011)
 {
     check(p->attribute<rhs>("RHS") == __STRINGVALUE, "cgx_push_shallow_rval_expr__STRINGVALUE");
-    PUSH("$" + cgx_define_string_constant(p->child(0)), "Pointer to a constant string");
+    PUSH(
+	asm_symbol_arg(ADDRESS_OPERAND, "stringrecord.", 0, cgx_define_string_constant(p->child(0))),
+	"Pointer to a constant string"
+	);
 }
 
 void cgx_push_shallow_rval_expr__IDENTIFIER(const tree* p)
 // Written by Michael Main (Feb 3, 2011)
 {
     check(p->attribute<rhs>("RHS") == __IDENTIFIER, "cgx_push_shallow_rval_expr__IDENTIFIER");
-    char op[MAX_OPERAND];
     const tree* leaf = p->child(0);
     int identifier_depth = leaf->attribute<int>("Depth");
     int offset = leaf->attribute<int>("Offset");
-    int distance = current_depth - identifier_depth;
+    int distance = current->current_depth - identifier_depth;
     
     // Push the r-value of the variable
     if (identifier_depth == 0)
     {   // Global variable
-        sprintf(op, "(compiler.globals.base+%d)", offset);
-        PUSH(op, "Static variable");
+        PUSH(asm_symbol_arg(SYMBOL_PLUS_OPERAND, "compiler.globals.base", offset), "Static variable");
     }
     else if (distance == 0)
     {   // A local variable or parameter of the current frame
@@ -2435,7 +3038,10 @@ void cgx_push_shallow_rval_expr__LPAREN_ARRAY_OF_typeexpr_IS_exprseq_RPAREN(cons
     // Create a new array record in static memory, and push a pointer to this
     // array record onto the stack.  We do not make a new deep copy of the
     // array record.
-    PUSH("$" + cgx_define_array_constant(p), "Pointer to byte 16 of array record");
+    PUSH(
+	asm_symbol_arg(ADDRESS_OPERAND, "arrayrecord.", 0, cgx_define_array_constant(p)),
+	"Pointer to byte 16 of array record"
+	);
 }
 
 void cgx_push_shallow_rval_expr__STAR_expr(const tree* p)
@@ -2511,14 +3117,14 @@ void cgx_push_static_link(int depth)
 
 
 //-----------------------------------------------------------------------------
-void cgx_read(const tree* type)
+void cgx_read(const cu_type* type)
 // Written by Michael Main (Feb 3, 2011)
 // This function generates code to read a value of the specified type.
 // The value is read into an l-value that is already on the stack prior
 // to executing the code that this function generates.  After the code
 // finishes, that l-value address has been popped from the stack.
 {
-    check(type->attribute<lhs>("LHS") == typeexpr__, "cgx_read");
+    check(type != NULL, "cgx_read");
     
     if (is_compat(INTEGER_TYPE, type))
     {   // Read an integer:
@@ -2556,19 +3162,27 @@ void cgx_read(const tree* type)
 void cgx_set_carry_flag_from_floats(const tree* p1, const tree* p2)
 // Written by Michael Main (Feb 3, 2011)
 {
-    const tree* type1 = p1->attribute<const tree*>("Type");
-    const tree* type2 = p2->attribute<const tree*>("Type");
+    const cu_type* type1 = p1->attribute<const cu_type*>("Type");
+    const cu_type* type2 = p2->attribute<const cu_type*>("Type");
 
     cgx_push_rval_expr(p1);
     cgx_coerce_stack_top_to_float_if_needed(FLOAT_TYPE, type1);
     cgx_push_rval_expr(p2);
     cgx_coerce_stack_top_to_float_if_needed(FLOAT_TYPE, type2);
+    if (current->options & SSE_FLOATS)
+    {   // The ucomiss sets the flags just as the sahf below would:
+	MOVSS("4(%esp)", "%xmm0", "Load left op of comparison");
+	MOVSS("(%esp)", "%xmm1", "Load right op of comparison");
+	RELEASE_STACK(8, "Release the ops from the stack");
+	UCOMISS("%xmm1", "%xmm0", "Compare left op with right op");
+	return;
+    }
     FLD("(%esp)", "Load right op of comparison");
     FLD("4(%esp)", "Load left op of comparison");
     RELEASE_STACK(8, "Release the ops from the stack");
-    cout << "fcompp" << endl;    // Floating point compare
-    cout << "fnstsw %ax" << endl; // Move fp status word to ax register
-    cout << "sahf" << endl;      // Move ah part of ax into flags
+    current->code.add(OP_FCOMPP, asm_arg( ), asm_arg( ), "", ASM_BARE);  // Floating point compare
+    current->code.add(OP_FNSTSW, "%ax", asm_arg( ), "", ASM_BARE);     // Move fp status word to ax register
+    current->code.add(OP_SAHF, asm_arg( ), asm_arg( ), "", ASM_BARE);    // Move ah part of ax into flags
 }
 //-----------------------------------------------------------------------------
 
@@ -2608,132 +3222,118 @@ void cgx_set_compare_flags(const tree* p)
 //-----------------------------------------------------------------------------
 
 
-//-------------------------------------------------------------------------
-bool is_array(const tree* type)
-// Written by Michael Main (Feb 3, 2011)
-// Precondition: tt must be a type tree (i.e., a parse tree with lhs of
-// typeexpr__).
-// Return value is true if this data type is an array
-// (but not for a pointer to one of those).
+//-----------------------------------------------------------------------------
+void cgx_widen_stack_top_to_double(const cu_type* type)
+// Precondition: The 4-byte value on top of the run-time stack has the given
+// type, which is int or float.
+// Postcondition: Code has been generated to replace it with the same value
+// as an 8-byte double (for pow).  The conversion is exact, with
+// the x87 or (with SSE_FLOATS) with cvtsi2sd or cvtss2sd.
 {
-    return tt_minus(type, ARRAY) != NULL;
+    if (current->options & SSE_FLOATS)
+    {
+	XORPS("%xmm0", "%xmm0", "Zero xmm0, so the cvt waits for nothing");
+	if (is_compat(INTEGER_TYPE, type))
+	    CVTSI2SD("(%esp)", "%xmm0", "Convert the int on top of the stack");
+	else
+	    CVTSS2SD("(%esp)", "%xmm0", "Convert the float on top of the stack");
+	ALLOCATE_STACK(4, "4 more bytes, so room for 8-byte float");
+	MOVSD("%xmm0", "(%esp)", "Store the 8-byte float on top of the stack");
+	return;
+    }
+    if (is_compat(INTEGER_TYPE, type))
+	FILD("(%esp)", "Load a 4-byte float from top of stack");
+    else
+	FLD("(%esp)", "Load a 4-byte float from top of stack");
+    ALLOCATE_STACK(4, "4 more bytes, so room for 8-byte float");
+    FSTP8("(%esp)", "Store the 8-byte float on top of the stack");
 }
-//-------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
 
 
-//-------------------------------------------------------------------------
-bool is_complex_array(const tree* type)
-// Written by Michael Main (Feb 3, 2011)
-// Precondition: tt must be a type tree (i.e., a parse tree with lhs of
-// typeexpr__).
-// Return value is true if this data type is an array
-// with components that are strings or arrays of some sort
-// (but not for a pointer to one of those).
+//-----------------------------------------------------------------------------
+// These functions give the operand for a jump to a label.  They should not
+// be called directly, but only through the JUMP and LABEL macros at the top
+// of this file.
+asm_arg jump_label(int j)
 {
-    const tree* subtree = tt_minus(type, ARRAY);
-
-    return
-        subtree != NULL
-        &&
-        is_using_implicit_memory(subtree);
+    return asm_label_arg(j);
 }
-//-------------------------------------------------------------------------
 
-
-//-------------------------------------------------------------------------
-bool is_simple_array(const tree* type)
-// Written by Michael Main (Feb 3, 2011)
-// Precondition: tt must be a type tree (i.e., a parse tree with lhs of
-// typeexpr__).
-// Return value is true if this data type is an array
-// with components that are neither strings nor arrays of some sort
-// (but not for a or pointer to one of those).
+string jump_label(string j)
 {
-    const tree* subtree = tt_minus(type, ARRAY);
-
-    return
-        subtree != NULL
-        &&
-        !is_using_implicit_memory(subtree);
+    return "jump." + j;
 }
-//-------------------------------------------------------------------------
-
 
-//-------------------------------------------------------------------------
-bool is_string(const tree* type)
-// Written by Michael Main (Feb 3, 2011)
-// Precondition: tt must be a type tree (i.e., a parse tree with lhs of
-// typeexpr__).
-// Return value is true if this data type is a string.
-// (but not for an array of or pointer to one of those).
+void cgx_print_code( )
+// Writes the instructions in current->code to the output, and empties the
+// list for the next function.
 {
-    return
-	type->attribute<rhs>("RHS") == __TYPENAME
-        &&
-        type->child(0)->label( ) == "|string|";
+    cgx_optimize(current->code);
+    COUNT(*current, instructions, cgx_many_instructions(current->code));
+    cgx_print_list(current->code, 0);
+    current->code.clear( );
 }
-//-------------------------------------------------------------------------
-
 
-//-------------------------------------------------------------------------
-bool is_using_implicit_memory(const tree* type)
-// Written by Michael Main (Feb 3, 2011)
-// Precondition: tt must be a type tree (i.e., a parse tree with lhs of
-// typeexpr__).
-// Return value is true if this data type is an array or string.
-// (but not for a pointer to one of those).
+void cgx_optimize(asm_list& code)
+// Runs the peephole optimizer over code, if current->options has PEEPHOLE,
+// with the patterns that it applies counted for the time report.
 {
-    return is_string(type) || is_array(type);
-}
-//-------------------------------------------------------------------------
+    long hits[MANY_PEEPHOLE_PATTERNS];
+    int k;
 
+    if ((current->options & PEEPHOLE) == 0)
+	return;
+    for (k = 0; k < MANY_PEEPHOLE_PATTERNS; ++k)
+	hits[k] = 0;
+    peephole(code, hits);
+    for (k = 0; k < MANY_PEEPHOLE_PATTERNS; ++k)
+	COUNT_NAMED(*current, peephole, k, peephole_name(k), hits[k]);
+}
 
-//-----------------------------------------------------------------------------
-// These functions allow us to print assembly instructions in a standard
-// format. They should not be called directly, but only through the various
-// macros (such as ADD, SUB...) at the top of this file.
-string jump_label(int j)
+void cgx_print_list(const asm_list& code, int label_base)
+// Writes the instructions of code (with label_base added to each label
+// number) to the output: into current->object if there is one, and as
+// assembly code to current->out otherwise.
 {
-    char label[MAX_OPERAND];
-    sprintf(label, "jump.%d", j);
-    return label;
+    if (current->object != NULL)
+	current->object->add(code, label_base);
+    else
+	print_asm(code, current->out, label_base);
 }
 
-string jump_label(string j)
+size_t cgx_bytes_printed( )
+// Returns how many bytes of output cgx_print_list has made so far (for the
+// object file, the bytes of code and data), for the cache's statistics.
 {
-    return "jump." + j;
+    if (current->object != NULL)
+	return current->object->size( );
+    return current->out.bytes_written( );
 }
 
-void print_instruction(string comment, string inst, string op1, string op2)
+int cgx_many_instructions(const asm_list& code)
+// Returns the number of records of the list that are instructions (not
+// labels, data or raw text), for the time report.
 {
-    cout << "  " << inst << setw(6-inst.length()) << " " << op1;
-    if (op2.length( ) != 0)
-    {
-	cout << ", " << setw(TAB-10-op1.length()) << op2;
-    }
-    else
+    int answer = 0;
+    size_t i;
+
+    for (i = 0; i < code.size( ); ++i)
     {
-	cout << setw(TAB-8-op1.length()) << "";
+	if (code[i].opcode > OP_LONG)
+	    ++answer;
     }
-    cout << " # " << comment << endl;
-}
-
-void print_instruction(string comment, string inst, int op1, string op2)
-{
-    char sop1[MAX_OPERAND];
-    sprintf(sop1, "$%d", op1);
-    print_instruction(comment, inst, sop1, op2);
+    return answer;
 }
 //-----------------------------------------------------------------------------
 
 //-----------------------------------------------------------------------------
 int unique_number( )
 // Written by Michael Main (Feb 3, 2011)
-// The first time this function is called, it returns 1. The next time, it
-// returns 2. Then 3, then 4, and so on. These numbers are used as part
-// of a label in any jump statement.
+// The first time this function is called in a compilation, it returns 1.
+// The next time, it returns 2. Then 3, then 4, and so on. These numbers are
+// used as part of a label in any jump statement.
 {
-    static int answer = 0;
-    return ++answer;
+    return ++current->last_label;
 }
 //-----------------------------------------------------------------------------
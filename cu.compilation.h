@@ -0,0 +1,174 @@
+// File: cu.compilation.h
+// Version: Oct 18, 2026
+// This file provides the compilation struct, which holds all of the state
+// of compiling one CU program: the lexer's scanner, the root of the parse
+// tree, the traverser's symbol table and the code generator's queue and
+// counters and instruction list (see cu.ir.h), along with the emitter for
+// the assembly code (see cu.emitter.h) and the stream for the error
+// messages.  The lexer is a reentrant flex scanner and the parser is a
+// pure bison parser, and none of the phases keeps any state of its own
+// outside of a compilation.  So several programs may be compiled at the
+// same time in different threads, each with its own compilation.  (The
+// trees of each thread are built in that thread's current tree_arena, if
+// any; see tree.h.)  The code generator itself may also use several
+// threads for the functions of one program (c.threads, which is 1 unless
+// it is set before codegen is called); the output does not depend on it.
+// If c.cache is set before codegen is called, then the code of each
+// function is taken from that function cache when it is there, and put
+// there when it is not (see cu.cache.h); again the output is the same.
+// If c.report is set before the phases are run, then the phases count
+// their work and time their inner parts for that time report (see
+// cu.timing.h).  If c.object is set before codegen is called, then the
+// instructions are encoded into that object file instead of being written
+// to c.out as assembly code (see cu.object.h).  The bits of c.options
+// choose other ways of generating the code (such as REGISTER_EXPRESSIONS,
+// which evaluates the expressions of type int in registers instead of on
+// the stack, PEEPHOLE, which runs the peephole optimizer of cu.peephole.h
+// over the code of each function, FOLD_CONSTANTS, which has the
+// traverser work out the constant expressions of the tree for the code
+// generator, and SSE_FLOATS, which does the float arithmetic with the
+// scalar SSE2 instructions instead of the x87); a program means the same
+// with any of them (but for the last bit of a few rare operations of an
+// int with a float under SSE_FLOATS, as cgx_flop of cu.codegen.cxx tells).
+// A new compilation has the bits of OPTIMIZATIONS (PEEPHOLE and
+// FOLD_CONSTANTS, which are cu -O1).
+//
+// The usual steps of one compilation are:
+//   compilation c(out, err);
+//   scan_in_place(c, text, n);     // or scan_stream(c, file)
+//   parsed = parse(c);
+//   end_scan(c);
+//   if (parsed)
+//   {
+//       traverse(c);
+//       if (c.root->attribute<int>("Errors") == 0)
+//           codegen(c, c.root);
+//   }
+//
+// CONSTRUCTOR for the compilation struct:
+//   compilation(ostream& out = cout, ostream& err = cerr)
+//     Postcondition: The compilation has no scanner and no tree yet.  The
+//     code generator will write to out (through the emitter c.out, which
+//     may be given another stream or put in compact mode before codegen is
+//     called), and all phases will write their error messages to err.  A
+//     compilation cannot be copied or assigned.
+//
+// FUNCTIONS provided by the lexer (cu.lex):
+//   void scan_stream(compilation& c, FILE* in)
+//     Postcondition: c has a new scanner that reads the program from in.
+//
+//   void scan_in_place(compilation& c, char* text, size_t n)
+//     Precondition: text[n] and text[n+1] are both '\0', and the n
+//     characters stay valid and writable until end_scan(c) is called.
+//     Postcondition: c has a new scanner that scans the n characters at
+//     text where they are, without copying them.
+//
+//   void end_scan(compilation& c)
+//     Postcondition: The scanner of c (if any) has been destroyed.  The
+//     trees made by the scanner hold only interned copies of the lexemes,
+//     so they stay valid.
+//
+// FUNCTION provided by the parser (cu.y):
+//   bool parse(compilation& c)
+//     Precondition: c has a scanner.
+//     Postcondition: The whole program has been parsed.  If there were no
+//     syntax errors, then c.root points to the parse tree and the return
+//     value is true.  Otherwise the errors were written to c's error
+//     stream and the return value is false.
+//
+// FUNCTION provided by the traverser (cu.traverser.cxx):
+//   void traverse(compilation& c)
+//     Precondition: c.root points to a parse tree made by parse(c).
+//     Postcondition: The entire tree has been decorated.  The value of
+//     c.root->attribute<int>("Errors") tells how many total errors were
+//     found, and the errors were written to c's error stream.  If there
+//     were none and c.options has FOLD_CONSTANTS, then the constants of
+//     the tree have also been folded by fold_constants(c).
+//
+// FUNCTION provided by the constant folder (cu.fold.cxx):
+//   void fold_constants(compilation& c)
+//     Precondition: c.root points to a tree that traverse(c) decorated with
+//     no errors.
+//     Postcondition: Each <expr> of type int, float or bool whose value is
+//     known (and each local <vardefn> that holds such a value and is never
+//     changed) has the value in its Constant attribute, which the code
+//     generator uses in place of the code of the expression.
+//
+// FUNCTION provided by the code generator (cu.codegen.cxx):
+//   void codegen(compilation& c, const colorado::tree* p)
+//     Precondition: p is the root of a whole tree that was decorated with
+//     no errors (by traverse or by load_tree in cu.serial.h).
+//     Postcondition: The assembly program for p has been written to c.out,
+//     which has been flushed (or, if c.object is set, the program has been
+//     added to that object file).
+
+#ifndef CU_COMPILATION_H
+#define CU_COMPILATION_H
+#include <cstddef>       // Provides size_t, NULL
+#include <cstdio>        // Provides FILE
+#include <iostream>      // Provides ostream, cout, cerr
+#include <queue>         // Provides queue
+#include "tree.h"        // Provides the colorado::tree class
+#include "symtab.h"      // Provides the colorado::symbol_table class
+#include "cu.emitter.h"  // Provides the asm_emitter class
+#include "cu.ir.h"       // Provides the asm_list class
+
+class function_cache;        // See cu.cache.h
+class time_report;           // See cu.timing.h
+class elf_object;            // See cu.object.h
+
+// The bits of compilation::options:
+enum
+{
+    REGISTER_EXPRESSIONS = 1,   // Evaluate int expressions in registers
+    PEEPHOLE = 2,               // Run the peephole optimizer
+    FOLD_CONSTANTS = 4,         // Fold constant expressions (see cu.fold.cxx)
+    SSE_FLOATS = 8,             // Do float arithmetic with SSE2, not the x87
+    OPTIMIZATIONS = PEEPHOLE | FOLD_CONSTANTS   // The bits of cu -O1
+};
+
+struct compilation
+{
+    compilation(std::ostream& out = std::cout, std::ostream& err = std::cerr)
+	: out(out), err(&err), report(NULL), scanner(NULL), root(NULL),
+	  threads(1), options(OPTIMIZATIONS), cache(NULL), object(NULL),
+	  current_depth(0), last_label(0)
+	{ }
+
+    // Where the assembly code and the error messages are written:
+    asm_emitter out;
+    std::ostream* err;
+
+    // The counters and timers of all phases, or NULL:
+    time_report* report;
+
+    // The lexer and the parser:
+    void* scanner;              // The flex scanner (a yyscan_t), or NULL
+    colorado::tree* root;       // Root of the parse tree, or NULL
+
+    // The traverser:
+    colorado::symbol_table<const colorado::tree*> st;
+
+    // The code generator:
+    int threads;                // How many threads generate the functions
+    int options;                // Bits such as REGISTER_EXPRESSIONS
+    function_cache* cache;      // Cache of the code of functions, or NULL
+    elf_object* object;         // Object file being built, or NULL
+    std::queue<const colorado::tree*> delayed_queue; // Functions to generate
+    int current_depth;          // Depth of any definitions being generated
+    int last_label;             // Last number given out by unique_number
+    asm_list code;              // Instructions of the function being generated
+
+private:
+    compilation(const compilation&);
+    void operator =(const compilation&);
+};
+
+void scan_stream(compilation& c, FILE* in);
+void scan_in_place(compilation& c, char* text, size_t n);
+void end_scan(compilation& c);
+bool parse(compilation& c);
+void traverse(compilation& c);
+void fold_constants(compilation& c);
+void codegen(compilation& c, const colorado::tree* p);
+#endif
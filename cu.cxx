@@ -11,46 +11,372 @@
 // 3. bison -b cu -d -v cu.y
 // 4. g++ -Wall -c cu.y.c
 // 5. g++ -Wall -c cu.traverser.cxx
-// 6. g++ -Wall -c cu.codegen.cxx
-// 7. g++ -Wall -c cu.cxx
-// 8. g++ -Wall -c tree.cxx
-// 9. g++ cu.o cu.y.o cu.lex.o cu.traverser.o cu.codegen.o tree.o -o cu
+// 6. g++ -Wall -c cu.types.cxx
+// 7. g++ -Wall -c cu.codegen.cxx
+// 8. g++ -Wall -c cu.serial.cxx
+// 9. g++ -Wall -c cu.cxx
+// 10. g++ -Wall -c tree.cxx
+// 11. g++ -Wall -c intern.cxx
+// 12. g++ -Wall -c mapped.cxx
+// 13. g++ -Wall -c cu.memory.cxx
+// 14. g++ -Wall -c cu.emitter.cxx
+// 15. g++ -Wall -c cu.ir.cxx
+// 16. g++ -Wall -c cu.batch.cxx
+// 17. g++ -Wall -c cu.server.cxx
+// 18. g++ -Wall -c cu.cache.cxx
+// 19. g++ -Wall -c cu.timing.cxx
+// 20. g++ -Wall -c cu.object.cxx
+// 21. g++ -Wall -c cu.peephole.cxx
+// 22. g++ -Wall -c cu.fold.cxx
+// 23. g++ cu.o cu.y.o cu.lex.o cu.traverser.o cu.fold.o cu.types.o cu.codegen.o cu.emitter.o cu.ir.o cu.object.o cu.peephole.o cu.serial.o cu.memory.o cu.batch.o cu.server.o cu.cache.o cu.timing.o tree.o intern.o mapped.o -o cu -lpthread
 // After compilation, you can create a file called sample.cu that
 // contains a program written in the CU programming language.
 // You can then run cu on that file with the command:
 // cu < sample.cu
+// or (with the name of the file, which is then scanned in place through
+// mmap instead of being read and copied in pieces from cin):
+// cu sample.cu
+// With the option --arena (cu --arena < sample.cu), all of the trees are
+// built in one colorado::tree_arena, which is released in one step at the end.
+// With the option --save-tree FILE, the decorated tree is also saved in the
+// named file (see cu.serial.h).  With the option --load-tree FILE, the
+// program is not read at all: the saved tree is loaded and given
+// straight to the code generator, which writes the same output as before.
+// With the option --mem-report, a report of the memory used by each phase,
+// by each attribute key and by each kind of node is written to cerr at the
+// end (see cu.memory.h).
+// With the option --time-report, the wall-clock and CPU time of each phase
+// and the counts of tokens, nodes, attribute sets and lookups, symbol-table
+// seeks, instructions and labels are written to cerr at the end (see
+// cu.timing.h).
+// The assembly code goes to cout, or to the named file with the option
+// -o FILE.  The functions that it calls from cu.lib.s are not included in
+// it; they are linked from the library libcu.a (make libcu.a):
+//   cu -o sample.s sample.cu
+//   gcc -m32 sample.s libcu.a -o sample
+//  With the option --compact, the comment of each instruction and
+// the padding that lines it up are left out (see cu.emitter.h).
+// With the option --threads N, the code of the functions is generated by N
+// threads at once; the assembly code is the same for any N.
+// With the option --registers, the int expressions are evaluated in
+// registers instead of on the stack (see REGISTER_EXPRESSIONS in
+// cu.compilation.h).
+// With the option --sse, the float arithmetic is done with the scalar SSE2
+// instructions (movss, addss, cvtsi2ss, ucomiss and so on) instead of the
+// x87, with the same rounding for round and write (see SSE_FLOATS in
+// cu.compilation.h and cgx_sse_flop in cu.codegen.cxx).
+// With the option -O1, which is the default, the constant expressions are
+// folded after the traversal (see cu.fold.cxx) and the peephole optimizer
+// of cu.peephole.h runs over the code of each function before it is
+// written; with -O0, the code is generated from the tree as it was
+// decorated and written as it was generated.
+// With the option --batch (cu --batch [--outdir DIR] [--jobs N] a.cu b.cu ...),
+// each of the named programs is compiled into its own .s file in one
+// process, by N worker threads, and the time of each program and the total
+// time are written to cerr (see cu.batch.h).
+// With the option --server SOCKET (cu --server SOCKET [--jobs N]), cu stays
+// up and compiles the programs that cu-client sends to it over the Unix
+// domain socket SOCKET, with N worker threads (see cu.server.h).
+// With the option --cache DIR, the code of each function is kept in the
+// directory DIR, and the next compilation takes the functions that did not
+// change from there instead of generating them again; the directory is
+// kept under the size given by --cache-size MB (64 MB if it is not given),
+// and the hits and misses are written to cerr (see cu.cache.h).
+// With the option -c, an ELF32 object file is written instead of the
+// assembly code (to cout, or to the file given by -o), and it is linked
+// with the same library (see cu.object.h):
+//   cu -c -o sample.o sample.cu
+//   gcc -m32 sample.o libcu.a -o sample
 //*****************************************************************************
+#include <cstdio>           // Provides stdin
+#include <cstdlib>          // Provides atoi
+#include <fstream>          // Provides ofstream
 #include <iostream>         // Provides cin and cout
+#include <string>           // Provides the string class
+#include <vector>           // Provides the vector class
 #include "cu.tab.h"         // Provides definitions of the token numbers
 #include "tree.h"           // Provides the colorado::tree class
+#include "cu.compilation.h" // Provides the compilation struct and phases
+#include "cu.batch.h"       // Provides compile_batch, batch_options
+#include "cu.server.h"      // Provides run_server
+#include "cu.cache.h"       // Provides the function_cache class
+#include "cu.object.h"      // Provides the elf_object class
+#include "cu.memory.h"      // Provides the memory report
+#include "cu.timing.h"      // Provides the time_report class
+#include "cu.serial.h"      // Provides save_tree, load_tree
+#include "mapped.h"         // Provides the colorado::mapped_file class
 using namespace std;        // cout and endl are in std::
 using namespace colorado;   // tree class
-int yyparse( );             // Provided by the parser
-void traverse( );           // Provided by cu.traverser.cxx
-void codegen(const tree* p);// The code generator
-extern tree* parse_tree_root_ptr; // From the parser
 
-int main( )
+void finish_cache(compilation& c)
+// Trims the function cache of c (if any), writes its counts to cerr and
+// deletes it.
 {
+    if (c.cache != NULL)
+    {
+	c.cache->trim( );
+	c.cache->write_stats(cerr);
+	delete c.cache;
+	c.cache = NULL;
+    }
+}
+
+bool finish_object(compilation& c, ostream& out)
+// Writes the object file of c (if any) to out, or the reason that it
+// cannot be written to cerr.  The return value is false if it could not
+// be written.
+{
+    if (c.object == NULL)
+	return true;
+    if (!c.object->write(out))
+    {
+	cerr << c.object->error( ) << endl;
+	return false;
+    }
+    out.flush( );
+    return true;
+}
+
+void start_phase(compilation& c, int phase)
+// Starts the timer of a phase of the time report of c (if any).
+{
+    if (c.report != NULL)
+	c.report->start_phase(phase);
+}
+
+void stop_phase(compilation& c, int phase)
+// Stops the timer of a phase of the time report of c (if any).
+{
+    if (c.report != NULL)
+	c.report->stop_phase(phase);
+}
+
+void finish_time_report(compilation& c)
+// Writes the time report of c (if any) to cerr and deletes it.
+{
+    if (c.report != NULL)
+    {
+	c.report->write(cerr);
+	delete c.report;
+	c.report = NULL;
+    }
+}
+
+int main(int argc, char* argv[ ])
+{
+    compilation c;          // Writes to cout and cerr
+    tree_arena arena;       // Holds the trees if --arena is given
+    string save_file;       // Given by --save-tree
+    string load_file;       // Given by --load-tree
+    string source_file;     // The program, if it is not read from cin
+    string output_file;     // Given by -o
+    vector<string> programs; // The named programs
+    batch_options batch;    // The options of --batch
+    bool batch_mode = false; // Given by --batch
+    string server_socket;   // Given by --server
+    string cache_dir;       // Given by --cache
+    int cache_megabytes = 64; // Given by --cache-size
+    ofstream output;        // The assembly code, if -o is given
+    elf_object object;      // The object file, if -c is given
+    bool object_file = false; // Given by -c
+    bool written = true;    // False if the object file could not be written
+    mapped_file* source = NULL;
+    bool memory_report = false; // Given by --mem-report
+    bool timing = false;    // Given by --time-report
+    bool usage_error = false;
+    bool parsed;
+    tree* root;
+    int i;
+
+    batch.options = c.options;
+    for (i = 1; i < argc; ++i)
+    {
+	if (string(argv[i]) == "--arena")
+	{
+	    tree_arena::set_current(&arena);
+	    batch.arena = true;
+	}
+	else if (string(argv[i]) == "--batch")
+	    batch_mode = true;
+	else if (string(argv[i]) == "--server" && i+1 < argc)
+	    server_socket = argv[++i];
+	else if (string(argv[i]) == "--outdir" && i+1 < argc)
+	    batch.outdir = argv[++i];
+	else if (string(argv[i]) == "--jobs" && i+1 < argc && atoi(argv[i+1]) > 0)
+	    batch.jobs = atoi(argv[++i]);
+	else if (string(argv[i]) == "--cache" && i+1 < argc)
+	    cache_dir = argv[++i];
+	else if (string(argv[i]) == "--cache-size" && i+1 < argc && atoi(argv[i+1]) > 0)
+	    cache_megabytes = atoi(argv[++i]);
+	else if (string(argv[i]) == "--mem-report")
+	    memory_report = true;
+	else if (string(argv[i]) == "--time-report")
+	    timing = true;
+	else if (string(argv[i]) == "--compact")
+	{
+	    c.out.set_compact(true);
+	    batch.compact = true;
+	}
+	else if (string(argv[i]) == "--threads" && i+1 < argc && atoi(argv[i+1]) > 0)
+	    batch.threads = c.threads = atoi(argv[++i]);
+	else if (string(argv[i]) == "--registers")
+	    batch.options = c.options |= REGISTER_EXPRESSIONS;
+	else if (string(argv[i]) == "--sse")
+	    batch.options = c.options |= SSE_FLOATS;
+	else if (string(argv[i]) == "-O0")
+	    batch.options = c.options &= ~OPTIMIZATIONS;
+	else if (string(argv[i]) == "-O1")
+	    batch.options = c.options |= OPTIMIZATIONS;
+	else if (string(argv[i]) == "-c")
+	    object_file = true;
+	else if (string(argv[i]) == "-o" && i+1 < argc)
+	    output_file = argv[++i];
+	else if (string(argv[i]) == "--save-tree" && i+1 < argc)
+	    save_file = argv[++i];
+	else if (string(argv[i]) == "--load-tree" && i+1 < argc)
+	    load_file = argv[++i];
+	else if (argv[i][0] != '-')
+	    programs.push_back(argv[i]);
+	else
+	    usage_error = true;
+    }
+    if (!server_socket.empty( ))
+	usage_error = usage_error || batch_mode || !programs.empty( ) || memory_report
+	    || timing || !output_file.empty( ) || !save_file.empty( )
+	    || !load_file.empty( ) || !cache_dir.empty( ) || object_file;
+    else if (batch_mode)
+	usage_error = usage_error || programs.empty( ) || memory_report
+	    || timing || !output_file.empty( ) || !save_file.empty( )
+	    || !load_file.empty( ) || !cache_dir.empty( ) || object_file;
+    else if (programs.size( ) > 1)
+	usage_error = true;
+    else if (programs.size( ) == 1)
+	source_file = programs[0];
+    if (usage_error)
+    {
+	cerr << "Usage: " << argv[0]
+	     << " [--arena] [--mem-report] [--time-report] [--compact] [--threads N]" << endl
+	     << "         [--registers] [--sse] [-O0 | -O1] [-c] [-o FILE] [--cache DIR [--cache-size MB]]" << endl
+	     << "         [--save-tree FILE]" << endl
+	     << "         [program.cu | < program.cu]" << endl
+	     << "       " << argv[0]
+	     << " [--arena] [--mem-report] [--time-report] [--compact] [--threads N]" << endl
+	     << "         [--registers] [--sse] [-O0 | -O1] [-c] [-o FILE] [--cache DIR [--cache-size MB]]" << endl
+	     << "         --load-tree FILE" << endl
+	     << "       " << argv[0]
+	     << " --batch [--arena] [--compact] [--threads N] [--registers]" << endl
+	     << "         [--sse] [-O0 | -O1] [--jobs N] [--outdir DIR] program.cu..." << endl
+	     << "       " << argv[0] << " --server SOCKET [--jobs N]" << endl;
+	return 1;
+    }
+    if (!server_socket.empty( ))
+	return run_server(server_socket, batch.jobs, cerr) ? 0 : 1;
+    if (batch_mode)
+	return compile_batch(programs, batch, cerr) ? 0 : 1;
+    if (!output_file.empty( ))
+    {
+	output.open(output_file.c_str( ), ios::out | ios::binary);
+	if (!output)
+	{
+	    cerr << "Cannot write " << output_file << "." << endl;
+	    return 1;
+	}
+	c.out.set_stream(output);
+    }
+    if (object_file)
+	c.object = &object;
+    if (!cache_dir.empty( ))
+	c.cache = new function_cache(cache_dir, size_t(cache_megabytes) * 1024 * 1024);
+    if (memory_report)
+	start_memory_report( );
+    if (timing)
+	c.report = new time_report;   // After the memory report, whose hooks it keeps
+
+    if (!load_file.empty( ))
+    {
+	cerr << "Loading " << load_file << "..." << endl;
+	set_memory_phase(LOAD_PHASE);
+	root = load_tree(load_file);
+	if (root == NULL)
+	    cerr << "Loading failed." << endl;
+	else
+	{
+	    cerr << "Starting code generation..." << endl;
+	    set_memory_phase(CODEGEN_PHASE);
+	    start_phase(c, TIME_CODEGEN);
+	    codegen(c, root);
+	    stop_phase(c, TIME_CODEGEN);
+	    written = finish_object(c, output_file.empty( ) ? cout : output);
+	    cerr << "Done." << endl;
+	}
+	set_memory_phase(OTHER_PHASE);
+	finish_cache(c);
+	finish_time_report(c);
+	if (memory_report)
+	    write_memory_report(cerr, root);
+	tree_arena::set_current(NULL);
+	arena.release( );
+	return (root != NULL && written) ? 0 : 1;
+    }
+
+    if (!source_file.empty( ))
+    {   // The two bytes of padding end the text for the lexer:
+	source = new mapped_file(source_file, 2);
+	if (!source->is_open( ))
+	{
+	    cerr << "Cannot read " << source_file << "." << endl;
+	    delete source;
+	    return 1;
+	}
+	scan_in_place(c, source->data( ), source->size( ));
+    }
+    else
+	scan_stream(c, stdin);
+
     cerr << "Starting parsing..." << endl;
 
-    if (yyparse( ) != 0)
+    set_memory_phase(PARSE_PHASE);
+    start_phase(c, TIME_PARSE);
+    parsed = parse(c);
+    stop_phase(c, TIME_PARSE);
+    set_memory_phase(OTHER_PHASE);
+    // The trees hold only interned copies of the lexemes:
+    end_scan(c);
+    delete source;
+    if (!parsed)
 	cerr << "Parsing failed." << endl;
     else
     {
 	cerr << "Parsing OK." << endl;
 	cerr << "Starting traversal..." << endl;
-	traverse( );
-	if (parse_tree_root_ptr->attribute<int>("Errors") != 0)
+	set_memory_phase(TRAVERSE_PHASE);
+	start_phase(c, TIME_DECORATE);
+	traverse(c);
+	stop_phase(c, TIME_DECORATE);
+	set_memory_phase(OTHER_PHASE);
+	if (c.root->attribute<int>("Errors") != 0)
 	    cerr << "Errors in the traversal." << endl;
 	else
 	{
 	    cerr << "Traversal OK." << endl;
+	    if (!save_file.empty( ) && !save_tree(c.root, save_file))
+		cerr << "Could not save the tree in " << save_file << "." << endl;
 	    cerr << "Starting code generation..." << endl;
-	    codegen(parse_tree_root_ptr);
+	    set_memory_phase(CODEGEN_PHASE);
+	    start_phase(c, TIME_CODEGEN);
+	    codegen(c, c.root);
+	    stop_phase(c, TIME_CODEGEN);
+	    set_memory_phase(OTHER_PHASE);
+	    written = finish_object(c, output_file.empty( ) ? cout : output);
 	    cerr << "Done." << endl;
 	}
     }
 
-    return 0;
+    finish_cache(c);
+    finish_time_report(c);
+    if (memory_report)
+	write_memory_report(cerr, c.root);
+    tree_arena::set_current(NULL);
+    arena.release( );
+    return written ? 0 : 1;
 }
@@ -0,0 +1,124 @@
+// File: cu.emitter.cxx
+// Version: Oct 18, 2026
+// This is the implementation file for the asm_emitter class of the CU
+// compiler (see cu.emitter.h).
+
+#include <cstddef>       // Provides size_t, NULL
+#include <cstring>       // Provides memcpy
+#include <iostream>      // Provides ostream
+#include "cu.emitter.h"
+using namespace std;
+
+//----------------------------------------------------------------------------
+size_t format_int(int value, char* digits)
+{
+    char reversed[12];
+    unsigned int u = (value < 0) ? 0u - (unsigned int)(value) : value;
+    size_t many = 0;
+    size_t i = 0;
+
+    do
+    {
+	reversed[many++] = char('0' + u % 10);
+	u /= 10;
+    }   while (u != 0);
+    if (value < 0)
+	digits[i++] = '-';
+    while (many > 0)
+	digits[i++] = reversed[--many];
+    digits[i] = '\0';
+    return i;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+asm_emitter::~asm_emitter( )
+{
+    write_buffer( );
+    delete [ ] buffer;
+}
+
+void asm_emitter::set_stream(ostream& out)
+{
+    flush( );
+    this->out = &out;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+void asm_emitter::append(const char* s, size_t n)
+{
+    total += n;
+    if (buffer == NULL)
+	buffer = new char[CHUNK];
+    if (used + n > CHUNK)
+    {
+	write_buffer( );
+	if (n > CHUNK)
+	{   // Too big for the buffer, so it goes straight to the stream:
+	    out->write(s, n);
+	    return;
+	}
+    }
+    memcpy(buffer + used, s, n);
+    used += n;
+}
+
+asm_emitter& asm_emitter::operator <<(char c)
+{
+    append(&c, 1);
+    return *this;
+}
+
+asm_emitter& asm_emitter::operator <<(int i)
+{
+    char digits[12];
+
+    append(digits, format_int(i, digits));
+    return *this;
+}
+
+void asm_emitter::pad(int n)
+{
+    static const char spaces[ ] = "                                        ";
+    const int many_spaces = sizeof(spaces) - 1;
+
+    if (compact)
+	return;
+    while (n > many_spaces)
+    {
+	append(spaces, many_spaces);
+	n -= many_spaces;
+    }
+    if (n > 0)
+	append(spaces, n);
+}
+
+void asm_emitter::end_line(const asm_text& comment)
+{
+    if (!compact)
+    {
+	append(" # ", 3);
+	append(comment.data, comment.size);
+    }
+    append("\n", 1);
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+void asm_emitter::write_buffer( )
+{
+    if (used > 0)
+	out->write(buffer, used);
+    used = 0;
+}
+
+void asm_emitter::flush( )
+{
+    write_buffer( );
+    out->flush( );
+}
+//----------------------------------------------------------------------------
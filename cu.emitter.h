@@ -0,0 +1,134 @@
+// File: cu.emitter.h
+// Version: Oct 18, 2026
+// This file provides the asm_emitter class, which the code generator uses
+// to write its assembly code.  An emitter collects the text in one large
+// buffer of its own and writes it to its stream in large chunks (and once
+// more when flush is called), so that the stream is never flushed after
+// each line.  Integers are formatted by hand, and an instruction is given
+// as pieces of text (asm_text) that point into the caller's own strings,
+// so that no temporary strings are made for each line.
+//
+// In compact mode, the padding that lines up the operands and the comment
+// of each instruction is left out, along with the comment itself.  This
+// makes the assembly code about half as big.  Lines that are only comments
+// (the banners between the parts of the program) are still written.
+//
+// CONSTRUCTORS for the asm_text struct:
+//   asm_text( )
+//   asm_text(const char* s)
+//   asm_text(const std::string& s)
+//   asm_text(const char* s, size_t n)
+//     Postcondition: The asm_text refers to the empty string, to the
+//     characters of s up to its '\0', to the characters of s, or to the n
+//     characters at s.  The characters are not copied, so they must stay
+//     valid as long as the asm_text is used.
+//
+// FUNCTION for formatting integers:
+//   size_t format_int(int value, char* digits)
+//     Precondition: digits has room for at least 12 characters.
+//     Postcondition: The decimal digits of value (with a '-' in front if it
+//     is negative) are in digits, followed by a '\0'.  The return value is
+//     the number of characters before the '\0'.
+//
+// CONSTRUCTOR for the asm_emitter class:
+//   asm_emitter(std::ostream& out = std::cout)
+//     Postcondition: The emitter will write to out, not in compact mode.
+//     Its buffer is not allocated until something is written.
+//
+// MODIFICATION MEMBER FUNCTIONS for the asm_emitter class:
+//   void set_stream(std::ostream& out)
+//     Postcondition: The buffer has been flushed, and from now on the
+//     emitter writes to out.
+//
+//   void set_compact(bool compact)
+//     Postcondition: The emitter is in compact mode if compact is true.
+//
+//   asm_emitter& operator <<(const char* s)
+//   asm_emitter& operator <<(const std::string& s)
+//   asm_emitter& operator <<(const asm_text& s)
+//   asm_emitter& operator <<(char c)
+//   asm_emitter& operator <<(int i)
+//     Postcondition: The text (or the decimal digits of i) has been added
+//     to the buffer.  The return value is the emitter itself.
+//
+//   void pad(int n)
+//     Postcondition: Unless the emitter is in compact mode, n spaces (if n
+//     is positive) have been added to the buffer.
+//
+//   void end_line(const asm_text& comment)
+//     Postcondition: Unless the emitter is in compact mode, " # " and the
+//     comment have been added to the buffer.  Then a '\n' has been added.
+//
+//   void flush( )
+//     Postcondition: Everything in the buffer has been written to the
+//     stream, and the stream itself has been flushed.
+//
+// CONSTANT MEMBER FUNCTION for the asm_emitter class:
+//   bool is_compact( ) const
+//     Postcondition: The return value tells whether the emitter is in
+//     compact mode.
+//
+//   size_t bytes_written( ) const
+//     Postcondition: The return value is the number of bytes that have
+//     been added to the buffer since the emitter was made.
+//
+// The destructor of an emitter flushes its buffer.  An emitter cannot be
+// copied or assigned.
+
+#ifndef CU_EMITTER_H
+#define CU_EMITTER_H
+#include <cstddef>       // Provides size_t, NULL
+#include <cstring>       // Provides strlen
+#include <iostream>      // Provides ostream, cout
+#include <string>        // Provides string class
+
+struct asm_text
+{
+    asm_text( ) : data(""), size(0) { }
+    asm_text(const char* s) : data(s), size(std::strlen(s)) { }
+    asm_text(const std::string& s) : data(s.data( )), size(s.size( )) { }
+    asm_text(const char* s, size_t n) : data(s), size(n) { }
+    const char* data;
+    size_t size;
+};
+
+size_t format_int(int value, char* digits);
+
+class asm_emitter
+{
+public:
+    // The size of the buffer, which is also the size of each chunk that is
+    // written to the stream:
+    static const size_t CHUNK = 64*1024;
+
+    asm_emitter(std::ostream& out = std::cout)
+	: out(&out), buffer(NULL), used(0), total(0), compact(false)
+	{ }
+    ~asm_emitter( );
+    void set_stream(std::ostream& out);
+    void set_compact(bool compact) { this->compact = compact; }
+    bool is_compact( ) const { return compact; }
+    size_t bytes_written( ) const { return total; }
+    asm_emitter& operator <<(const char* s)
+	{ append(s, std::strlen(s)); return *this; }
+    asm_emitter& operator <<(const std::string& s)
+	{ append(s.data( ), s.size( )); return *this; }
+    asm_emitter& operator <<(const asm_text& s)
+	{ append(s.data, s.size); return *this; }
+    asm_emitter& operator <<(char c);
+    asm_emitter& operator <<(int i);
+    void pad(int n);
+    void end_line(const asm_text& comment);
+    void flush( );
+private:
+    std::ostream* out;
+    char* buffer;       // CHUNK bytes, or NULL until the first write
+    size_t used;        // How many bytes of the buffer are used
+    size_t total;       // How many bytes have been added in all
+    bool compact;
+    void append(const char* s, size_t n);
+    void write_buffer( );
+    asm_emitter(const asm_emitter&);
+    void operator =(const asm_emitter&);
+};
+#endif
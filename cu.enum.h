@@ -48,6 +48,7 @@ enum rhs {
 
     // defnlist -->
     // could be empty or...
+    // (A non-empty defnlist is one node with a child for each defn.)
     __defnlist_defn,
 
     // expr -->
@@ -91,6 +92,8 @@ enum rhs {
 
     // exprseq -->
     // could be empty or...
+    // (A non-empty exprseq is one node with a child for each expr.  Its RHS
+    // is __exprseq_COMMA_expr only if a comma came before the first expr.)
     __expr,
     __exprseq_COMMA_expr,
 	
@@ -104,6 +107,8 @@ enum rhs {
 	
     // parmseq -->
     // could be empty or...
+    // (A non-empty parmseq is one node with a child for each parmdefn.  Its
+    // RHS is __parmseq_COMMA_parmdefn only if a comma came before the first.)
     __parmdefn,
     __parmseq_COMMA_parmdefn,
 
@@ -125,6 +130,7 @@ enum rhs {
 
     // stmtlist -->
     // could be empty or...
+    // (A non-empty stmtlist is one node with a child for each stmt.)
     __stmtlist_stmt,
 
     // typeexpr -->
@@ -0,0 +1,461 @@
+// File: cu.fold.cxx
+// Version: Oct 18, 2026
+// This file provides the fold_constants(compilation&) function, the
+// constant folder of the CU compiler, which the traverser runs over a
+// decorated tree that has no errors when the FOLD_CONSTANTS bit of
+// c.options is set (see cu.compilation.h).  It works out the value of each
+// <expr> of type int, float or bool whose operands are all known, and
+// gives it to the node as an int attribute:
+//   Constant: the 4 bytes of the r-value, just as cgx_push_rval_expr in
+//   cu.codegen.cxx pushes them (an |int|, the bits of a 4-byte |float|, or
+//   0 and 1 for a |bool|).
+// The code generator pushes such a value instead of generating the code of
+// the expression, and a constant condition becomes a jump or nothing.
+//
+// A value is only folded when it is exactly the value that the code would
+// compute at run time:
+//   int + - * and ^ wrap around at 32 bits (as addl, imull and lib.intpow
+//   do), and / and % truncate (as idivl does), but a division by zero, the
+//   one division that overflows and a negative exponent (which lib.intpow
+//   leaves unspecified) are left for run time;
+//   float operations are done in long double and then rounded to float,
+//   which is what the x87 does with its extended precision and the fstp
+//   that stores the result; with SSE_FLOATS, + - * and / of an int with a
+//   float are done in double instead and then rounded to float, as the
+//   addsd, subsd, mulsd and divsd of cgx_sse_flop do (two floats give the
+//   same answer either way); a result that is infinite or not a number is
+//   left for run time, and so is a comparison with a NaN;
+//   float ^ calls pow, so it is folded only when the answer is exact (an
+//   exponent that is a whole number from 0 to 64 whose power fits in a
+//   double), and then rounded to float;
+//   round rounds to the nearest int, with halves to even (the fistp of the
+//   x87), and is folded only when the answer fits in an int; floatcast
+//   rounds an int to the nearest float (the fildl and fstp of the coercion);
+//   the comparisons of an int with a float first round the int to a float,
+//   as the code generator does;
+//   and and or are folded when both sides are known, or when the left side
+//   alone decides the answer (the right side is then never evaluated).
+//
+// A value is also only folded for an <expr> that the code generator has
+// stack code for (see has_stack_code), so that a program does the same at
+// -O0 and -O1.  The int literals, +, and, round and floatcast are still
+// left for HW 5 in cu.codegen.cxx, so none of them is folded, and neither
+// is an expression that needs one of them (such as 2*3).  The uses of a
+// local variable (HW 7) are not folded either, even when its initial value
+// is known and never changed.  When the stack code of an <expr> is
+// written, its case in has_stack_code can be taken out.
+
+#include <cfloat>             // Provides DBL_MIN
+#include <climits>            // Provides INT_MAX, INT_MIN
+#include <cmath>              // Provides fabs, floor, fmod, frexp, ldexp
+#include <cstdlib>            // Provides atof
+#include <cstring>            // Provides memcpy
+#include <string>             // Provides the string class
+#include "tree.h"             // Provides the tree class
+#include "cu.enum.h"          // Provides lhs, rhs
+#include "cu.types.h"         // Provides the cu_type struct and BOOL_TYPE...
+#include "cu.compilation.h"   // Provides the compilation struct
+#include "cu.timing.h"        // Provides the time_report class, COUNT
+using namespace colorado;     // For the tree
+using namespace std;
+
+static const string constant_key("Constant");
+static const string type_key("Type");
+
+//----------------------------------------------------------------------------
+// Facts about the nodes of an <expr>.
+static const cu_type* type_of(const tree* p)
+{
+    return p->attribute<const cu_type*>(type_key);
+}
+
+static bool is_integer(const tree* p)
+// Whether p has the type that the code generator treats as an int.
+{
+    return is_compat(INTEGER_TYPE, type_of(p));
+}
+
+static bool known(const tree* p, int& bits)
+// If the value of p has been folded, then bits is set to it and the
+// return value is true.
+{
+    if (!p->is_attribute<int>(constant_key))
+	return false;
+    bits = p->attribute<int>(constant_key);
+    return true;
+}
+
+static float float_of(int bits)
+{
+    float f;
+
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static int bits_of(float f)
+{
+    int bits;
+
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+static bool has_stack_code(const tree* p)
+// Whether cgx_push_rval_expr has the stack code of the <expr> p written.
+{
+    switch (p->attribute<rhs>("RHS"))
+    {
+    case __INTEGERVALUE:
+    case __expr_PLUS_expr:
+    case __expr_AND_expr:
+    case __ROUND_expr:
+    case __FLOATCAST_expr:
+    case __IDENTIFIER:
+	return false;
+    default:
+	return true;
+    }
+}
+
+static bool is_finite(long double x)
+{
+    return x == x && x - x == 0;
+}
+
+static long double value_of(const tree* p, int bits)
+// The value of the bits of p, as a number (an int or bool as it is, and a
+// float as the float that the bits hold).
+{
+    if (type_of(p) == FLOAT_TYPE)
+	return float_of(bits);
+    return bits;
+}
+
+static long double float_value_of(const tree* p, int bits)
+// The value of the bits of p once an int has been coerced to a float.
+{
+    if (is_integer(p))
+	return float(bits);
+    return value_of(p, bits);
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// The values of the operators.  Each returns true if it set answer to the
+// bits of the value.
+static bool integer_value(const string& digits, int& answer)
+{
+    int value = 0, digit;
+    size_t i;
+
+    for (i = 0; i < digits.size( ); ++i)
+    {
+	digit = digits[i] - '0';
+	if (value > (INT_MAX - digit) / 10)
+	    return false;
+	value = 10 * value + digit;
+    }
+    answer = value;
+    return true;
+}
+
+static bool float_answer(long double x, int& answer)
+// Rounds x to a float, as an fstp does.
+{
+    float f = float(x);
+
+    if (!is_finite(f))
+	return false;
+    answer = bits_of(f);
+    return true;
+}
+
+static bool integer_arithmetic(rhs what, int a, int b, int& answer)
+{
+    unsigned int x = a, y = b, power;
+
+    switch (what)
+    {
+    case __expr_PLUS_expr:
+	answer = int(x + y);
+	return true;
+    case __expr_MINUS_expr:
+	answer = int(x - y);
+	return true;
+    case __expr_STAR_expr:
+	answer = int(x * y);
+	return true;
+    case __expr_SLASH_expr:
+    case __expr_PERCENT_expr:
+	if (b == 0 || (a == INT_MIN && b == -1))
+	    return false;
+	answer = (what == __expr_SLASH_expr) ? a / b : a % b;
+	return true;
+    case __expr_HAT_expr:
+	if (b < 0)
+	    return false;
+	for (power = 1; y > 0; y >>= 1, x *= x)
+	{
+	    if (y & 1)
+		power *= x;
+	}
+	answer = int(power);
+	return true;
+    default:
+	return false;
+    }
+}
+
+static bool float_power(long double x, long double y, int& answer)
+// pow(x, y) rounded to a float, when pow's answer is sure to be exact.
+{
+    unsigned long long mantissa, power = 1;
+    double exact;
+    int exponent, n;
+
+    if (y != floor(y) || y < 0 || y > 64)
+	return false;
+    n = int(y);
+    if (n == 0)
+	return float_answer(1, answer);
+    if (x == 0)
+	return false;
+
+    // x is mantissa * 2^exponent, with an odd whole number as the mantissa
+    // (of at most 32 bits, for an int or a float):
+    mantissa = (unsigned long long) ldexp(frexp(fabs(double(x)), &exponent), 53);
+    exponent -= 53;
+    while ((mantissa & 1) == 0)
+    {
+	mantissa >>= 1;
+	++exponent;
+    }
+    for ( ; n > 0; --n)
+    {
+	if (mantissa > 0 && power > (1ULL << 53) / mantissa)
+	    return false;
+	power *= mantissa;
+    }
+    n = int(y);
+    exact = ldexp(double(power), exponent * n);
+    if (!is_finite(exact) || exact < DBL_MIN)
+	return false;
+    if (x < 0 && n % 2 == 1)
+	exact = -exact;
+    return float_answer(exact, answer);
+}
+
+static bool float_arithmetic(rhs what, long double x, long double y, int& answer)
+{
+    switch (what)
+    {
+    case __expr_PLUS_expr:
+	return float_answer(x + y, answer);
+    case __expr_MINUS_expr:
+	return float_answer(x - y, answer);
+    case __expr_STAR_expr:
+	return float_answer(x * y, answer);
+    case __expr_SLASH_expr:
+	return y != 0 && float_answer(x / y, answer);
+    case __expr_HAT_expr:
+	return float_power(x, y, answer);
+    default:
+	return false;
+    }
+}
+
+static bool double_arithmetic(rhs what, double x, double y, int& answer)
+// + - * or / of two doubles, rounded to a double and then to a float.
+{
+    volatile double exact;  // Rounded to a double even by the x87
+
+    switch (what)
+    {
+    case __expr_PLUS_expr:  exact = x + y; break;
+    case __expr_MINUS_expr: exact = x - y; break;
+    case __expr_STAR_expr:  exact = x * y; break;
+    case __expr_SLASH_expr:
+	if (y == 0)
+	    return false;
+	exact = x / y;
+	break;
+    default:
+	return false;
+    }
+    return float_answer(exact, answer);
+}
+
+static bool comparison(rhs what, long double x, long double y, int& answer)
+{
+    if (x != x || y != y)
+	return false;
+    switch (what)
+    {
+    case __expr_LT_expr:   answer = (x < y);  break;
+    case __expr_GT_expr:   answer = (x > y);  break;
+    case __expr_LE_expr:   answer = (x <= y); break;
+    case __expr_GE_expr:   answer = (x >= y); break;
+    case __expr_EQEQ_expr: answer = (x == y); break;
+    case __expr_NE_expr:   answer = (x != y); break;
+    default:
+	return false;
+    }
+    return true;
+}
+
+static bool round_value(float f, int& answer)
+// Rounds f to the nearest int, with halves to even.
+{
+    double whole = floor(f);
+    double part = f - whole;
+
+    if (!(f >= -2147483648.0 && f < 2147483648.0))
+	return false;
+    if (part > 0.5 || (part == 0.5 && fmod(whole, 2) != 0))
+	whole += 1;
+    answer = int(whole);
+    return true;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// The folding of each node.
+static bool fold_expr(const tree* p, bool sse, int& answer)
+// p is an <expr> whose children have been folded, and sse tells whether
+// the float arithmetic is done with SSE2 (SSE_FLOATS).  If its value is
+// known, then answer is set to it and the return value is true.
+{
+    rhs what = p->attribute<rhs>("RHS");
+    int a, b;
+
+    switch (what)
+    {
+    case __INTEGERVALUE:
+	return integer_value(p->child(0)->label( ), answer);
+    case __FLOATVALUE:
+	// Converted just as cgx_push_rval_expr__FLOATVALUE does:
+	answer = bits_of(atof(p->child(0)->label( ).c_str( )));
+	return true;
+    case __TRUE:
+	answer = 1;
+	return true;
+    case __FALSE:
+	answer = 0;
+	return true;
+    case __LPAREN_expr_RPAREN:
+    case __PLUS_expr:
+	return known(p->child(1), answer);
+    case __NOT_expr:
+	if (!known(p->child(1), a))
+	    return false;
+	answer = !a;
+	return true;
+    case __MINUS_expr:
+	if (!known(p->child(1), a))
+	    return false;
+	if (is_integer(p->child(1)))
+	    answer = int(0u - (unsigned int) a);
+	else
+	    answer = int((unsigned int) a ^ 0x80000000u);
+	return true;
+    case __expr_AND_expr:
+    case __expr_OR_expr:
+	if (!known(p->child(0), a))
+	    return false;
+	if ((a != 0) == (what == __expr_OR_expr))
+	    answer = a;
+	else if (!known(p->child(2), answer))
+	    return false;
+	return true;
+    case __expr_PLUS_expr:
+    case __expr_MINUS_expr:
+    case __expr_STAR_expr:
+    case __expr_SLASH_expr:
+    case __expr_PERCENT_expr:
+    case __expr_HAT_expr:
+	if (!known(p->child(0), a) || !known(p->child(2), b))
+	    return false;
+	if (is_integer(p->child(0)) && is_integer(p->child(2)))
+	    return integer_arithmetic(what, a, b, answer);
+	if (sse && what != __expr_HAT_expr
+	    && (is_integer(p->child(0)) || is_integer(p->child(2))))
+	    return double_arithmetic(
+		what, value_of(p->child(0), a), value_of(p->child(2), b), answer
+		);
+	return float_arithmetic(
+	    what, value_of(p->child(0), a), value_of(p->child(2), b), answer
+	    );
+    case __expr_LT_expr:
+    case __expr_GT_expr:
+    case __expr_LE_expr:
+    case __expr_GE_expr:
+    case __expr_EQEQ_expr:
+    case __expr_NE_expr:
+	if (!known(p->child(0), a) || !known(p->child(2), b))
+	    return false;
+	if (is_integer(p->child(0)) && is_integer(p->child(2)))
+	    return comparison(what, a, b, answer);
+	return comparison(
+	    what, float_value_of(p->child(0), a), float_value_of(p->child(2), b), answer
+	    );
+    case __ROUND_expr:
+	if (!known(p->child(1), a))
+	    return false;
+	if (is_integer(p->child(1)))
+	{
+	    answer = a;
+	    return true;
+	}
+	return round_value(float_of(a), answer);
+    case __FLOATCAST_expr:
+	if (!known(p->child(1), a))
+	    return false;
+	answer = is_integer(p->child(1)) ? bits_of(float(a)) : a;
+	return true;
+    default:
+	return false;
+    }
+}
+
+static void fold_subtree(compilation& c, tree* p)
+// Folds the nodes of p, children first.
+{
+    size_t i;
+    int answer;
+
+    for (i = 0; i < p->many_children( ); ++i)
+	fold_subtree(c, p->child(i));
+    if (!p->is_attribute<lhs>("LHS")
+	|| p->attribute<lhs>("LHS") != expr__
+	|| !has_stack_code(p)
+	|| !fold_expr(p, (c.options & SSE_FLOATS) != 0, answer))
+	return;
+    p->set_attribute<int>(constant_key, answer);
+    switch (p->attribute<rhs>("RHS"))
+    {
+    case __FLOATVALUE:
+    case __TRUE:
+    case __FALSE:
+    case __LPAREN_expr_RPAREN:
+    case __PLUS_expr:
+	break;
+    default:
+	COUNT(c, constants_folded, 1);
+	break;
+    }
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// void fold_constants(compilation& c)
+// Precondition: c.root is a tree that traverse(c) decorated with no errors.
+// Postcondition: The Constant attributes have been set (see above).
+void fold_constants(compilation& c)
+{
+    fold_subtree(c, c.root);
+}
+//----------------------------------------------------------------------------
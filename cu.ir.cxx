@@ -0,0 +1,527 @@
+// File: cu.ir.cxx
+// Version: Oct 18, 2026
+// This is the implementation file for the instruction lists of the CU code
+// generator (see cu.ir.h).
+
+#include <cstddef>       // Provides size_t, NULL
+#include <cstdlib>       // Provides atoi
+#include <cstring>       // Provides memcpy, strlen
+#include <iostream>      // Provides istream, ostream
+#include <string>        // Provides string class
+#include <vector>        // Provides vector class
+#include "cu.emitter.h"  // Provides asm_emitter, asm_text, format_int
+#include "cu.ir.h"
+using namespace std;
+
+//----------------------------------------------------------------------------
+// The mnemonics of the opcodes and the names of the registers:
+static const char* const mnemonics[MANY_OPCODES] =
+{
+    "", "", ".long",
+    "addl", "call", "cdq", "cmpl", "decl", "idivl", "imull", "incl",
+    "movl", "negl", "popl", "pushl", "ret", "shll", "shrl", "subl",
+    "xorl", "pusha", "popa",
+    "jmp", "je", "jne", "ja", "jae", "jb", "jbe", "jg", "jge",
+    "jl", "jle",
+    "fadd", "fiaddl", "fchs", "fcompp", "fdiv", "fidivl", "fidivrl",
+    "fildl", "fimull", "fninit", "fistpl", "fisubl", "fisubrl", "fld",
+    "fldz", "fmul", "fnstsw", "fstp", "fstpl", "fsub", "sahf",
+    "addsd", "addss", "cvtsd2ss", "cvtsi2sdl", "cvtsi2ssl", "cvtss2sd",
+    "cvtss2si", "divsd", "divss", "movsd", "movss", "mulsd", "mulss",
+    "subsd", "subss", "ucomiss", "xorps"
+};
+static const char* const registers[MANY_REGISTERS] =
+{
+    "", "%eax", "%ebx", "%ecx", "%edx", "%esi", "%edi", "%ebp", "%esp", "%ax",
+    "%xmm0", "%xmm1"
+};
+
+// Position of the tab in assembly commands:
+const int TAB = 35;
+
+const char* asm_mnemonic(int opcode)
+{
+    return mnemonics[opcode];
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+asm_arg asm_register_arg(int r)
+{
+    asm_arg answer;
+
+    answer.set(REGISTER_OPERAND, 0);
+    answer.operand.base = r;
+    return answer;
+}
+
+asm_arg asm_memory_arg(int base, int value)
+{
+    asm_arg answer;
+
+    answer.set(MEMORY_OPERAND, value);
+    answer.operand.base = base;
+    return answer;
+}
+
+asm_arg asm_label_arg(int j)
+{
+    asm_arg answer;
+
+    answer.set(LABEL_OPERAND, j);
+    return answer;
+}
+
+asm_arg asm_number_arg(int value)
+{
+    asm_arg answer;
+
+    answer.set(NUMBER_OPERAND, value);
+    return answer;
+}
+
+asm_arg asm_symbol_arg(int kind, const char* symbol, int value, int label)
+{
+    asm_arg answer(symbol);
+
+    answer.set(kind, value);
+    answer.operand.label = label;
+    return answer;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// Helpers for working out the kind of an operand from its text.  Each one
+// accepts only text that would be written back the same way, so that a
+// list prints exactly what the code generator gave it.
+
+// The register named by the n characters at s, or NO_REGISTER:
+static int register_of(const char* s, size_t n)
+{
+    int r;
+
+    for (r = EAX; r < MANY_REGISTERS; ++r)
+    {
+	if (strlen(registers[r]) == n && memcmp(registers[r], s, n) == 0)
+	    return r;
+    }
+    return NO_REGISTER;
+}
+
+// Whether the n characters at s are an integer as format_int writes it:
+static bool is_int(const char* s, size_t n, int& value)
+{
+    char digits[12];
+    size_t i;
+
+    if (n == 0 || n > 11)
+	return false;
+    for (i = (s[0] == '-') ? 1 : 0; i < n; ++i)
+    {
+	if (s[i] < '0' || s[i] > '9')
+	    return false;
+    }
+    value = atoi(string(s, n).c_str( ));
+    return format_int(value, digits) == n && memcmp(digits, s, n) == 0;
+}
+
+// Whether the n characters at s can be a symbol:
+static bool is_symbol(const char* s, size_t n)
+{
+    size_t i;
+
+    if (n == 0 || (s[0] >= '0' && s[0] <= '9'))
+	return false;
+    for (i = 0; i < n; ++i)
+    {
+	if (!((s[i] >= 'a' && s[i] <= 'z') || (s[i] >= 'A' && s[i] <= 'Z')
+	      || (s[i] >= '0' && s[i] <= '9') || s[i] == '.' || s[i] == '_'))
+	    return false;
+    }
+    return true;
+}
+
+// The position of the first c in the n characters at s, or n:
+static size_t find(const char* s, size_t n, char c)
+{
+    size_t i;
+
+    for (i = 0; i < n && s[i] != c; ++i)
+	;
+    return i;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+asm_list::asm_list( )
+{
+    comments = true;
+    pool.push_back('\0');
+}
+
+void asm_list::clear( )
+{
+    code.clear( );
+    pool.resize(1);
+}
+
+void asm_list::erase(size_t first, size_t last)
+{
+    code.erase(code.begin( ) + first, code.begin( ) + last);
+}
+
+void asm_list::swap(asm_list& other)
+{
+    bool other_comments = other.comments;
+
+    code.swap(other.code);
+    pool.swap(other.pool);
+    other.comments = comments;
+    comments = other_comments;
+}
+
+void asm_list::write(ostream& out) const
+{
+    int sizes[2];
+
+    sizes[0] = code.size( );
+    sizes[1] = pool.size( );
+    out.write((const char*) sizes, sizeof(sizes));
+    if (!code.empty( ))
+	out.write((const char*) &code[0], code.size( ) * sizeof(asm_instruction));
+    out.write(&pool[0], pool.size( ));
+}
+
+// Tells whether the operand refers only to registers that exist and to
+// text that is in a pool of the given size.
+static bool is_valid(const asm_operand& op, size_t pool_size)
+{
+    return op.base < MANY_REGISTERS && op.index < MANY_REGISTERS
+	&& op.symbol >= 0 && size_t(op.symbol) < pool_size;
+}
+
+bool asm_list::read(istream& in)
+{
+    int sizes[2];
+    size_t i;
+    bool ok;
+
+    clear( );
+    if (!in.read((char*) sizes, sizeof(sizes)) || sizes[0] < 0 || sizes[1] < 1)
+	return false;
+    code.resize(sizes[0]);
+    pool.resize(sizes[1]);
+    ok = (sizes[0] == 0 || in.read((char*) &code[0], sizes[0] * sizeof(asm_instruction)))
+	&& in.read(&pool[0], sizes[1]) && pool[0] == '\0';
+    for (i = 0; ok && i < code.size( ); ++i)
+    {   // Anything that print_asm could not write is a sign of a bad file:
+	ok = code[i].opcode < MANY_OPCODES
+	    && code[i].comment >= 0 && size_t(code[i].comment) < pool.size( )
+	    && is_valid(code[i].op1, pool.size( )) && is_valid(code[i].op2, pool.size( ))
+	    && (code[i].opcode != OP_TEXT
+		|| size_t(code[i].op1.symbol) + code[i].op1.value <= pool.size( ));
+    }
+    if (!ok)
+	clear( );
+    return ok;
+}
+
+int asm_list::add_pool(const char* s, size_t n)
+{
+    int position = pool.size( );
+
+    pool.insert(pool.end( ), s, s+n);
+    pool.push_back('\0');
+    return position;
+}
+
+void asm_list::add_text(const char* s, size_t n)
+{
+    asm_instruction i;
+
+    if (code.empty( ) || code.back( ).opcode != OP_TEXT)
+    {   // Start a new record at the end of the pool:
+	i.opcode = OP_TEXT;
+	i.layout = ASM_COLUMNS;
+	i.comment = 0;
+	i.op1.kind = TEXT_OPERAND;
+	i.op1.base = i.op1.index = i.op1.scale = 0;
+	i.op1.value = 0;
+	i.op1.symbol = pool.size( );
+	i.op1.label = 0;
+	i.op2 = asm_arg( ).operand;
+	code.push_back(i);
+    }
+    // The text of the last record is always at the end of the pool:
+    pool.insert(pool.end( ), s, s+n);
+    code.back( ).op1.value += n;
+}
+
+asm_list& asm_list::operator <<(int i)
+{
+    char digits[12];
+
+    add_text(digits, format_int(i, digits));
+    return *this;
+}
+
+void asm_list::add(
+    int opcode, const asm_arg& op1, const asm_arg& op2,
+    const asm_text& comment, int layout
+    )
+{
+    asm_instruction i;
+
+    i.opcode = opcode;
+    i.layout = layout;
+    i.comment = (comments && comment.size != 0) ? add_pool(comment.data, comment.size) : 0;
+    i.op1 = operand_of(op1);
+    i.op2 = operand_of(op2);
+    code.push_back(i);
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+asm_operand asm_list::operand_of(const asm_arg& a)
+{
+    asm_operand answer = a.operand;
+    const char* s = a.text;
+    size_t n = a.size;
+    size_t open, comma;
+    int value;
+
+    if (answer.kind != NO_OPERAND)
+    {   // A typed operand, with a symbol that is copied into the pool:
+	if (s != NULL)
+	    answer.symbol = add_pool(s, n);
+	return answer;
+    }
+    if (n == 0)
+	return answer;
+
+    if (s[0] == '%' && (answer.base = register_of(s, n)) != NO_REGISTER)
+    {   // %reg
+	answer.kind = REGISTER_OPERAND;
+	return answer;
+    }
+    if (s[0] == '$' && is_int(s+1, n-1, answer.value))
+    {   // $value
+	answer.kind = IMMEDIATE_OPERAND;
+	return answer;
+    }
+    if (s[0] == '$' && is_symbol(s+1, n-1))
+    {   // $symbol
+	answer.kind = ADDRESS_OPERAND;
+	answer.symbol = add_pool(s+1, n-1);
+	return answer;
+    }
+    open = find(s, n, '+');
+    if (s[0] == '$' && open+3 < n && s[open+1] == '(' && s[n-1] == ')'
+	&& is_symbol(s+1, open-1) && is_int(s+open+2, n-open-3, answer.value))
+    {   // $symbol+(value)
+	answer.kind = ADDRESS_PLUS_OPERAND;
+	answer.symbol = add_pool(s+1, open-1);
+	return answer;
+    }
+    if (n > 2 && s[0] == '(' && s[1] != '%' && s[n-1] == ')')
+    {
+	if (is_symbol(s+1, n-2))
+	{   // (symbol)
+	    answer.kind = SYMBOL_MEMORY_OPERAND;
+	    answer.symbol = add_pool(s+1, n-2);
+	    return answer;
+	}
+	if (open < n && is_symbol(s+1, open-1) && is_int(s+open+1, n-open-2, answer.value))
+	{   // (symbol+value)
+	    answer.kind = SYMBOL_PLUS_OPERAND;
+	    answer.symbol = add_pool(s+1, open-1);
+	    return answer;
+	}
+    }
+    open = find(s, n, '(');
+    if (open < n && s[n-1] == ')' && s[open+1] == '%'
+	&& (open == 0 || (is_int(s, open, value) && value != 0)))
+    {   // value(%base) or value(%base,%index,scale)
+	answer.value = (open == 0) ? 0 : value;
+	comma = open + 1 + find(s+open+1, n-open-2, ',');
+	answer.base = register_of(s+open+1, comma-open-1);
+	if (comma == n-1 && answer.base != NO_REGISTER)
+	{
+	    answer.kind = MEMORY_OPERAND;
+	    return answer;
+	}
+	if (n-comma > 5 && s[n-3] == ',' && s[n-2] >= '1' && s[n-2] <= '8'
+	    && (answer.index = register_of(s+comma+1, n-comma-4)) != NO_REGISTER
+	    && answer.base != NO_REGISTER)
+	{
+	    answer.kind = MEMORY_OPERAND;
+	    answer.scale = s[n-2] - '0';
+	    return answer;
+	}
+	answer.base = answer.index = 0;
+    }
+    if (n > 5 && memcmp(s, "jump.", 5) == 0 && is_int(s+5, n-5, answer.value))
+    {   // jump.value
+	answer.kind = LABEL_OPERAND;
+	return answer;
+    }
+    answer.kind = is_symbol(s, n) ? SYMBOL_OPERAND : TEXT_OPERAND;
+    answer.value = 0;
+    answer.symbol = add_pool(s, n);
+    return answer;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// Writes the symbol of op (with its label number, if it has one), and
+// returns how many characters it wrote.
+static size_t write_symbol(
+    const asm_list& code, const asm_operand& op, asm_emitter& out, int label_base
+    )
+{
+    char digits[12];
+    asm_text symbol(code.text(op.symbol));
+
+    out << symbol;
+    if (op.label == 0)
+	return symbol.size;
+    out << op.label + label_base;
+    return symbol.size + format_int(op.label + label_base, digits);
+}
+
+// Writes the operand op of the given list, and returns how many characters
+// it wrote.
+static size_t write_operand(
+    const asm_list& code, const asm_operand& op, asm_emitter& out, int label_base
+    )
+{
+    char digits[12];
+    size_t n = 0;
+
+    switch (op.kind)
+    {
+    case REGISTER_OPERAND:
+	out << registers[op.base];
+	return strlen(registers[op.base]);
+    case IMMEDIATE_OPERAND:
+	out << '$' << op.value;
+	return 1 + format_int(op.value, digits);
+    case NUMBER_OPERAND:
+	out << op.value;
+	return format_int(op.value, digits);
+    case MEMORY_OPERAND:
+	if (op.value != 0)
+	{
+	    out << op.value;
+	    n = format_int(op.value, digits);
+	}
+	out << '(' << registers[op.base];
+	n += 1 + strlen(registers[op.base]);
+	if (op.index != NO_REGISTER)
+	{
+	    out << ',' << registers[op.index] << ',' << char('0' + op.scale);
+	    n += 3 + strlen(registers[op.index]);
+	}
+	out << ')';
+	return n + 1;
+    case LABEL_OPERAND:
+	out << "jump." << op.value + label_base;
+	return 5 + format_int(op.value + label_base, digits);
+    case SYMBOL_OPERAND:
+    case TEXT_OPERAND:
+	return write_symbol(code, op, out, label_base);
+    case ADDRESS_OPERAND:
+	out << '$';
+	return 1 + write_symbol(code, op, out, label_base);
+    case ADDRESS_PLUS_OPERAND:
+	out << '$';
+	n = write_symbol(code, op, out, label_base);
+	out << "+(" << op.value << ')';
+	return 4 + n + format_int(op.value, digits);
+    case SYMBOL_MEMORY_OPERAND:
+	out << '(';
+	n = write_symbol(code, op, out, label_base);
+	out << ')';
+	return 2 + n;
+    case SYMBOL_PLUS_OPERAND:
+	out << '(';
+	n = write_symbol(code, op, out, label_base);
+	out << '+' << op.value << ')';
+	return 3 + n + format_int(op.value, digits);
+    }
+    return 0;
+}
+
+void print_asm(const asm_list& code, asm_emitter& out, int label_base)
+{
+    size_t i;
+
+    for (i = 0; i < code.size( ); ++i)
+	print_asm_record(code, i, out, label_base);
+}
+
+void print_asm_record(const asm_list& code, size_t i, asm_emitter& out, int label_base)
+{
+    const asm_instruction& p = code[i];
+    const char* mnemonic = mnemonics[p.opcode];
+    size_t n1, n2;
+    size_t n = strlen(mnemonic);
+
+    if (p.opcode == OP_TEXT)
+    {
+	out << asm_text(code.text(p.op1.symbol), p.op1.value);
+	return;
+    }
+    if (p.opcode == OP_LABEL)
+    {
+	if (p.layout != ASM_BARE)
+	    out << "  ";
+	write_operand(code, p.op1, out, label_base);
+	out << ((p.layout == ASM_PLAIN) ? ": " : ":\n");
+	return;
+    }
+    switch (p.layout)
+    {
+    case ASM_PLAIN:
+	out << "  " << mnemonic << '\n';
+	break;
+    case ASM_BARE:
+	out << mnemonic;
+	if (p.op1.kind != NO_OPERAND)
+	{
+	    out << ' ';
+	    write_operand(code, p.op1, out, label_base);
+	}
+	out << '\n';
+	break;
+    case ASM_FLOP:
+	out << "  " << mnemonic << ' ';
+	n1 = write_operand(code, p.op1, out, label_base);
+	out.pad(TAB-11 - int(n) - int(n1));
+	out.end_line(code.text(p.comment));
+	break;
+    default:
+	// The mnemonic, its operands and the comment in their columns:
+	out << "  " << mnemonic;
+	if (p.op1.kind != NO_OPERAND || !out.is_compact( ))
+	    out << ' ';
+	out.pad(5 - int(n));
+	n1 = write_operand(code, p.op1, out, label_base);
+	if (p.op2.kind != NO_OPERAND)
+	{
+	    out << ", ";
+	    n2 = write_operand(code, p.op2, out, label_base);
+	    out.pad(TAB-10 - int(n1) - int(n2));
+	}
+	else
+	    out.pad(TAB-8 - int(n1));
+	out.end_line(code.text(p.comment));
+	break;
+    }
+}
+//----------------------------------------------------------------------------
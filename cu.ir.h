@@ -0,0 +1,286 @@
+// File: cu.ir.h
+// Version: Oct 18, 2026
+// This file provides the instruction lists of the CU code generator.  The
+// code generator does not write its assembly code as text.  Instead, it
+// adds records to an asm_list, and once the code of a whole function is in
+// the list, print_asm lowers the list to GNU assembly through an
+// asm_emitter (see cu.emitter.h).  Any pass that wants to inspect, change,
+// reorder or delete instructions works on the list between the two steps.
+//
+// Each record (asm_instruction) has an opcode, up to two operands and a
+// comment.  An operand (asm_operand) has a kind, registers, an integer and
+// a symbol.  Symbols, comments and raw text are kept in the text pool of
+// the list, and records refer to them by their position in the pool, so
+// that a record is 40 bytes with no strings of its own.  The kinds of
+// operands, and how each one is written, are:
+//   NO_OPERAND             (nothing)
+//   REGISTER_OPERAND       %base
+//   IMMEDIATE_OPERAND      $value
+//   NUMBER_OPERAND         value                 (for .long)
+//   MEMORY_OPERAND         value(%base) or value(%base,%index,scale)
+//                          (the value is left out if it is zero)
+//   LABEL_OPERAND          jump.value
+//   SYMBOL_OPERAND         symbol
+//   ADDRESS_OPERAND        $symbol
+//   ADDRESS_PLUS_OPERAND   $symbol+(value)
+//   SYMBOL_MEMORY_OPERAND  (symbol)
+//   SYMBOL_PLUS_OPERAND    (symbol+value)
+//   TEXT_OPERAND           symbol (any other text, written as it is)
+// An operand with a symbol may also have a label number, which is written
+// right after the symbol (as in "$stringrecord.12").
+//
+// The label numbers (of LABEL_OPERANDs and after symbols) come from
+// unique_number in the code generator.  When a list is printed, a base
+// may be added to all of them, so that a function's code can be made with
+// numbers that start at 1 and still get the same labels as if it had been
+// made after all of the functions before it.
+//
+// Besides the instructions, there are three pseudo-opcodes:
+//   OP_TEXT   raw text (directives, data and banners), written as it is;
+//             the text is in the pool at op1.symbol, op1.value bytes long.
+//   OP_LABEL  a label, op1, which is a LABEL_OPERAND or a SYMBOL_OPERAND.
+//             It is written as "  label:" in the ASM_COLUMNS layout, as
+//             "label:" in the ASM_BARE layout, and as "  label: " (with the
+//             rest of the line in the next record) in the ASM_PLAIN layout.
+//   OP_LONG   a .long with a NUMBER_OPERAND.
+//
+// The layout of a record says how it is written:
+//   ASM_COLUMNS  "  mnemonic op1, op2" with the operands and the comment
+//                lined up in columns (this is the usual layout);
+//   ASM_PLAIN    "  mnemonic", with no operands and no comment;
+//   ASM_BARE     "mnemonic op1", at the start of the line with no comment;
+//   ASM_FLOP     "  mnemonic op1" with the comment in a column of its own
+//                (the floating point operations of cgx_flop).
+// In compact mode, the emitter leaves out all of the padding and comments.
+//
+// The floating point instructions are those of the x87 (fld, fadd, fstp
+// and so on), and the scalar SSE2 instructions of the SSE_FLOATS option of
+// cu.compilation.h (movss, addss, cvtsi2ss, ucomiss and so on), whose
+// registers are %xmm0 and %xmm1.
+//
+// CONSTRUCTORS for the asm_arg struct, which is how an operand is given to
+// an asm_list:
+//   asm_arg( )
+//     Postcondition: The argument is NO_OPERAND.
+//
+//   asm_arg(int value)
+//     Postcondition: The argument is the immediate $value.
+//
+//   asm_arg(const char* text)
+//   asm_arg(const std::string& text)
+//     Postcondition: The argument is the operand written as text in the
+//     syntax above, which the list works out when the argument is added.
+//     Text that does not fit any kind is kept as a TEXT_OPERAND.
+//
+// FUNCTIONS that make other asm_args:
+//   asm_arg asm_register_arg(int r)
+//   asm_arg asm_memory_arg(int base, int value)
+//   asm_arg asm_label_arg(int j)
+//   asm_arg asm_number_arg(int value)
+//   asm_arg asm_symbol_arg(int kind, const char* symbol, int value = 0, int label = 0)
+//     Postcondition: The return value is the argument of the given kind.
+//     The symbol is not copied until the argument is added to a list.  If
+//     label is not zero, it is the label number after the symbol.
+//
+// CONSTRUCTOR for the asm_list class:
+//   asm_list( )
+//     Postcondition: The list is empty, and it keeps comments.
+//
+// MODIFICATION MEMBER FUNCTIONS for the asm_list class:
+//   void keep_comments(bool keep)
+//     Postcondition: If keep is false, the comments of the records that
+//     are added from now on are dropped (as they are in compact mode).
+//
+//   void add(int opcode, const asm_arg& op1 = asm_arg( ),
+//            const asm_arg& op2 = asm_arg( ),
+//            const asm_text& comment = asm_text( ), int layout = ASM_COLUMNS)
+//     Postcondition: A record has been added to the end of the list.
+//
+//   asm_list& operator <<(const char* s)
+//   asm_list& operator <<(const std::string& s)
+//   asm_list& operator <<(char c)
+//   asm_list& operator <<(int i)
+//     Postcondition: The text (or the decimal digits of i) has been added
+//     to the end of the list as raw text.  Raw text that directly follows
+//     raw text goes into the same OP_TEXT record.
+//
+//   asm_instruction& operator [ ](size_t i)
+//     Precondition: i < size( ).
+//     Postcondition: The return value is the record at index i.
+//
+//   void clear( )
+//     Postcondition: The list and its pool are empty.
+//
+//   void erase(size_t first, size_t last)
+//     Precondition: first <= last <= size( ).
+//     Postcondition: The records from index first up to (but not
+//     including) index last have been removed, and the records after them
+//     have moved down.  The pool keeps their texts.
+//
+//   void swap(asm_list& other)
+//     Postcondition: The records, pools and settings of the two lists
+//     have been exchanged.
+//
+//   bool read(std::istream& in)
+//     Postcondition: If the next bytes of in are a list that was written by
+//     write, then this list is now a copy of that list (apart from its
+//     keep_comments setting) and the return value is true.  Otherwise the
+//     list is empty and the return value is false.
+//
+// CONSTANT MEMBER FUNCTIONS for the asm_list class:
+//   size_t size( ) const
+//     Postcondition: The return value is the number of records.
+//
+//   const asm_instruction& operator [ ](size_t i) const
+//     Precondition: i < size( ).
+//     Postcondition: The return value is the record at index i.
+//
+//   const char* text(int position) const
+//     Postcondition: The return value points to the text at the given
+//     position of the pool (a symbol or a comment ends with a '\0').
+//     Position 0 is always the empty string.
+//
+//   void write(std::ostream& out) const
+//     Postcondition: The records and the pool of the list have been written
+//     to out as raw bytes (so they can be read back only on a machine like
+//     this one; this is for the function cache of cu.cache.h).
+//
+// FUNCTIONS for writing a list:
+//   const char* asm_mnemonic(int opcode)
+//     Postcondition: The return value is the GNU mnemonic of the opcode.
+//
+//   void print_asm(const asm_list& code, asm_emitter& out, int label_base = 0)
+//     Postcondition: The records of code have been written to out as GNU
+//     assembly, in order, with label_base added to every label number.
+//
+//   void print_asm_record(const asm_list& code, size_t i, asm_emitter& out,
+//                         int label_base = 0)
+//     Precondition: i < code.size( ).
+//     Postcondition: The record at index i alone has been written to out,
+//     just as print_asm writes it.
+
+#ifndef CU_IR_H
+#define CU_IR_H
+#include <cstddef>       // Provides size_t, NULL
+#include <cstring>       // Provides strlen
+#include <iostream>      // Provides istream, ostream
+#include <string>        // Provides string class
+#include <vector>        // Provides vector class
+#include "cu.emitter.h"  // Provides asm_emitter, asm_text
+
+enum
+{
+    OP_TEXT, OP_LABEL, OP_LONG,
+    OP_ADDL, OP_CALL, OP_CDQ, OP_CMPL, OP_DECL, OP_IDIVL, OP_IMULL, OP_INCL,
+    OP_MOVL, OP_NEGL, OP_POPL, OP_PUSHL, OP_RET, OP_SHLL, OP_SHRL, OP_SUBL,
+    OP_XORL, OP_PUSHA, OP_POPA,
+    OP_JMP, OP_JE, OP_JNE, OP_JA, OP_JAE, OP_JB, OP_JBE, OP_JG, OP_JGE,
+    OP_JL, OP_JLE,
+    OP_FADD, OP_FIADD, OP_FCHS, OP_FCOMPP, OP_FDIV, OP_FIDIV, OP_FIDIVR,
+    OP_FILD, OP_FIMUL, OP_FNINIT, OP_FISTPL, OP_FISUB, OP_FISUBR, OP_FLD,
+    OP_FLDZ, OP_FMUL, OP_FNSTSW, OP_FSTP, OP_FSTPL, OP_FSUB, OP_SAHF,
+    OP_ADDSD, OP_ADDSS, OP_CVTSD2SS, OP_CVTSI2SD, OP_CVTSI2SS, OP_CVTSS2SD,
+    OP_CVTSS2SI, OP_DIVSD, OP_DIVSS, OP_MOVSD, OP_MOVSS, OP_MULSD, OP_MULSS,
+    OP_SUBSD, OP_SUBSS, OP_UCOMISS, OP_XORPS,
+    MANY_OPCODES
+};
+
+enum
+{
+    NO_REGISTER, EAX, EBX, ECX, EDX, ESI, EDI, EBP, ESP, AX, XMM0, XMM1,
+    MANY_REGISTERS
+};
+
+enum
+{
+    NO_OPERAND, REGISTER_OPERAND, IMMEDIATE_OPERAND, NUMBER_OPERAND,
+    MEMORY_OPERAND, LABEL_OPERAND, SYMBOL_OPERAND, ADDRESS_OPERAND,
+    ADDRESS_PLUS_OPERAND, SYMBOL_MEMORY_OPERAND, SYMBOL_PLUS_OPERAND,
+    TEXT_OPERAND
+};
+
+enum { ASM_COLUMNS, ASM_PLAIN, ASM_BARE, ASM_FLOP };
+
+struct asm_operand
+{
+    unsigned char kind;
+    unsigned char base;      // Register
+    unsigned char index;     // Index register of a MEMORY_OPERAND, or 0
+    unsigned char scale;     // Scale of the index register
+    int value;               // Number, offset or label number
+    int symbol;              // Position of the symbol in the pool, or 0
+    int label;               // Label number after the symbol, or 0
+};
+
+struct asm_instruction
+{
+    unsigned char opcode;
+    unsigned char layout;
+    int comment;             // Position of the comment in the pool, or 0
+    asm_operand op1;
+    asm_operand op2;
+};
+
+struct asm_arg
+{
+    asm_arg( ) : text(NULL), size(0) { set(NO_OPERAND, 0); }
+    asm_arg(int value) : text(NULL), size(0) { set(IMMEDIATE_OPERAND, value); }
+    asm_arg(const char* s) : text(s), size(std::strlen(s)) { set(NO_OPERAND, 0); }
+    asm_arg(const std::string& s) : text(s.data( )), size(s.size( )) { set(NO_OPERAND, 0); }
+    void set(int kind, int value)
+	{
+	    operand.kind = kind; operand.base = operand.index = operand.scale = 0;
+	    operand.value = value; operand.symbol = operand.label = 0;
+	}
+    asm_operand operand;     // The operand, except for its symbol
+    const char* text;        // Its symbol, or its text if kind is NO_OPERAND
+    size_t size;             // Length of the text
+};
+
+asm_arg asm_register_arg(int r);
+asm_arg asm_memory_arg(int base, int value);
+asm_arg asm_label_arg(int j);
+asm_arg asm_number_arg(int value);
+asm_arg asm_symbol_arg(int kind, const char* symbol, int value = 0, int label = 0);
+
+class asm_list
+{
+public:
+    asm_list( );
+    void keep_comments(bool keep) { comments = keep; }
+    void add(
+	int opcode,
+	const asm_arg& op1 = asm_arg( ),
+	const asm_arg& op2 = asm_arg( ),
+	const asm_text& comment = asm_text( ),
+	int layout = ASM_COLUMNS
+	);
+    asm_list& operator <<(const char* s)
+	{ add_text(s, std::strlen(s)); return *this; }
+    asm_list& operator <<(const std::string& s)
+	{ add_text(s.data( ), s.size( )); return *this; }
+    asm_list& operator <<(char c)
+	{ add_text(&c, 1); return *this; }
+    asm_list& operator <<(int i);
+    asm_instruction& operator [ ](size_t i) { return code[i]; }
+    const asm_instruction& operator [ ](size_t i) const { return code[i]; }
+    size_t size( ) const { return code.size( ); }
+    const char* text(int position) const { return &pool[position]; }
+    void clear( );
+    void erase(size_t first, size_t last);
+    void swap(asm_list& other);
+    bool read(std::istream& in);
+    void write(std::ostream& out) const;
+private:
+    std::vector<asm_instruction> code;
+    std::vector<char> pool;
+    bool comments;
+    int add_pool(const char* s, size_t n);
+    asm_operand operand_of(const asm_arg& a);
+    void add_text(const char* s, size_t n);
+};
+
+const char* asm_mnemonic(int opcode);
+void print_asm(const asm_list& code, asm_emitter& out, int label_base = 0);
+void print_asm_record(const asm_list& code, size_t i, asm_emitter& out, int label_base = 0);
+#endif
@@ -64,6 +64,12 @@
 # ptr-to-array or ptr-to-string (which we call ptr-to-array-or-string).
 .section .text                                                         
 
+# The functions are global: this file is assembled once on its own and
+# kept in the library libcu.a (see the makefile), which is linked with
+# each program that the CU compiler writes.
+.globl lib.copyrec, lib.freerec, lib.coercerec
+.globl lib.intpow, lib.readmore, lib.readstr
+
 	
 # ...........................................................        
 lib.copyrec:
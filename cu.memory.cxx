@@ -0,0 +1,318 @@
+// File: cu.memory.cxx
+// Version: Oct 18, 2026
+// This is the implementation file for the memory report of the CU compiler
+// (see cu.memory.h).
+
+#include <algorithm>     // Provides sort
+#include <cstddef>       // Provides size_t, NULL
+#include <cstdio>        // Provides FILE, fopen, fscanf, fclose
+#include <iomanip>       // Provides setw
+#include <iostream>      // Provides ostream
+#include <map>           // Provides map class
+#include <string>        // Provides string class
+#include <utility>       // Provides pair
+#include <vector>        // Provides vector class
+#ifndef _WIN32
+#include <sys/resource.h> // Provides getrusage
+#include <unistd.h>      // Provides sysconf
+#endif
+#include "tree.h"        // Provides the tree class
+#include "intern.h"      // Provides intern_shared, many_interned
+#include "cu.tab.h"      // Provides the token numbers
+#include "cu.enum.h"     // Provides lhs
+#include "cu.types.h"    // Provides many_types
+#include "cu.memory.h"   // Provides the phases
+using namespace std;
+using namespace colorado;
+
+//----------------------------------------------------------------------------
+// The names of the phases, indexed by phase number:
+static const char* const phase_names[MANY_PHASES] =
+    { "other", "lex", "parse", "load", "traverse", "codegen" };
+
+// The counts of one phase:
+struct phase_count
+{
+    long nodes;              // New trees
+    long node_bytes;         // Their bytes
+    long sets;               // Calls of set_attribute
+    long map_bytes;          // Bytes of the values that went into maps
+    long resident_growth;    // Growth of the resident set size
+};
+
+// The counts of one attribute key.  There are only a few keys, so they are
+// kept in a small table that is searched from the start.  Any keys that do
+// not fit are counted together in other_keys.
+const int MANY_KEYS = 24;
+struct key_count
+{
+    const string* key;       // Interned key (NULL for other_keys)
+    long sets[MANY_PHASES];
+    long map_bytes;
+};
+
+// All of the counts of one thread:
+struct memory_counts
+{
+    phase_count phases[MANY_PHASES];
+    key_count keys[MANY_KEYS];
+    key_count other_keys;
+    int many_keys;
+    int phase;               // The phase that the thread is in
+    long last_resident;      // Resident set size at the last change of phase
+};
+
+// The counts of each thread, and whether the report has been started:
+static __thread memory_counts counts;
+static bool started = false;
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// The current and the peak resident set size of the process in bytes, or
+// 0 where they are not known.
+static long resident_bytes( )
+{
+    long pages = 0;
+    long resident = 0;
+#ifndef _WIN32
+    FILE* file = fopen("/proc/self/statm", "r");
+
+    if (file == NULL)
+	return 0;
+    if (fscanf(file, "%ld %ld", &pages, &resident) != 2)
+	resident = 0;
+    fclose(file);
+    resident *= sysconf(_SC_PAGESIZE);
+#endif
+    return resident;
+}
+static long peak_resident_bytes( )
+{
+#ifndef _WIN32
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return usage.ru_maxrss * 1024L;
+#endif
+#endif
+    return 0;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// The tree_hooks of the report.
+static void count_node(size_t bytes)
+{
+    phase_count& p = counts.phases[counts.phase];
+
+    ++p.nodes;
+    p.node_bytes += bytes;
+}
+
+static void count_attribute(const tree* p, const string& key, size_t bytes)
+{
+    int phase = counts.phase;
+    key_count* k = NULL;
+    int i;
+
+    // While the parser runs, the lexer makes a tree for each token, and its
+    // first attribute is the Token.  At that point the tree itself is moved
+    // from the parse counts to the lex counts.
+    if (phase == PARSE_PHASE && p->is_attribute<int>("Token"))
+    {
+	phase = LEX_PHASE;
+	if (key == "Token")
+	{
+	    --counts.phases[PARSE_PHASE].nodes;
+	    counts.phases[PARSE_PHASE].node_bytes -= p->many_bytes( );
+	    ++counts.phases[LEX_PHASE].nodes;
+	    counts.phases[LEX_PHASE].node_bytes += p->many_bytes( );
+	}
+    }
+    ++counts.phases[phase].sets;
+    counts.phases[phase].map_bytes += bytes;
+
+    for (i = 0; i < counts.many_keys && k == NULL; ++i)
+    {
+	if (*(counts.keys[i].key) == key)
+	    k = &(counts.keys[i]);
+    }
+    if (k == NULL && counts.many_keys < MANY_KEYS)
+    {
+	k = &(counts.keys[counts.many_keys++]);
+	k->key = &(intern_shared(key));
+    }
+    if (k == NULL)
+	k = &(counts.other_keys);
+    ++(k->sets[phase]);
+    k->map_bytes += bytes;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+void start_memory_report( )
+{
+    static const tree_hooks hooks = { count_node, count_attribute, NULL };
+    int phase = counts.phase;
+
+    counts = memory_counts( );
+    counts.phase = phase;
+    counts.last_resident = resident_bytes( );
+    started = true;
+    tree::set_hooks(&hooks);
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+void set_memory_phase(int phase)
+{
+    long resident;
+
+    if (started)
+    {
+	resident = resident_bytes( );
+	counts.phases[counts.phase].resident_growth += resident - counts.last_resident;
+	counts.last_resident = resident;
+    }
+    counts.phase = phase;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// The kind of a node for the report: the label of a nonterminal, the name of
+// a token that has a lexeme of its own, or one kind for all of the keywords
+// and symbols.
+static string kind_of(const tree* p)
+{
+    if (p->is_attribute<lhs>("LHS"))
+	return p->label( );
+    if (!p->is_attribute<int>("Token"))
+	return "(other)";
+    switch (p->attribute<int>("Token"))
+    {
+    case IDENTIFIER: return "IDENTIFIER";
+    case TYPENAME: return "TYPENAME";
+    case INTEGERVALUE: return "INTEGERVALUE";
+    case FLOATVALUE: return "FLOATVALUE";
+    case STRINGVALUE: return "STRINGVALUE";
+    default: return "(keyword or symbol)";
+    }
+}
+
+// Kinds are listed with the most bytes first:
+typedef pair<string, pair<long, long> > kind_count;
+static bool more_bytes(const kind_count& a, const kind_count& b)
+{
+    return a.second.second > b.second.second;
+}
+
+// Rounds a number of bytes to kilobytes:
+static long kb(long bytes)
+{
+    return (bytes >= 0) ? (bytes + 512) / 1024 : -((-bytes + 512) / 1024);
+}
+
+// The order of the phases in the report:
+static const int phase_order[MANY_PHASES] =
+    { LEX_PHASE, PARSE_PHASE, LOAD_PHASE, TRAVERSE_PHASE, CODEGEN_PHASE, OTHER_PHASE };
+
+// Writes one line of the table of keys:
+static void write_key(ostream& out, const string& name, const key_count& k)
+{
+    int j;
+
+    out << "  " << left << setw(12) << name << right;
+    for (j = 0; j < MANY_PHASES; ++j)
+	out << setw(10) << k.sets[phase_order[j]];
+    out << setw(10) << kb(k.map_bytes) << endl;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+void write_memory_report(ostream& out, const tree* root)
+{
+    map<string, pair<long, long> > kinds;
+    vector<kind_count> sorted;
+    vector<const tree*> stack;
+    phase_count total = phase_count( );
+    const phase_count* p;
+    const tree* t;
+    size_t i;
+    int j;
+
+    out << "Memory report" << endl;
+    out << "  Peak resident set size: " << kb(peak_resident_bytes( )) << " KB" << endl;
+    out << "  Interned strings: " << many_interned( )
+	<< "   Types: " << many_types( ) << endl << endl;
+
+    // The counts of each phase:
+    out << "  " << left << setw(12) << "phase" << right
+	<< setw(10) << "nodes" << setw(10) << "node KB"
+	<< setw(10) << "sets" << setw(10) << "map KB"
+	<< setw(10) << "RSS KB" << endl;
+    for (j = 0; j < MANY_PHASES; ++j)
+    {
+	p = &(counts.phases[phase_order[j]]);
+	out << "  " << left << setw(12) << phase_names[phase_order[j]] << right
+	    << setw(10) << p->nodes << setw(10) << kb(p->node_bytes)
+	    << setw(10) << p->sets << setw(10) << kb(p->map_bytes);
+	if (phase_order[j] == LEX_PHASE)
+	    out << setw(10) << "-" << endl;   // Counted with parse
+	else
+	    out << setw(10) << kb(p->resident_growth) << endl;
+	total.nodes += p->nodes;
+	total.node_bytes += p->node_bytes;
+	total.sets += p->sets;
+	total.map_bytes += p->map_bytes;
+	total.resident_growth += p->resident_growth;
+    }
+    out << "  " << left << setw(12) << "total" << right
+	<< setw(10) << total.nodes << setw(10) << kb(total.node_bytes)
+	<< setw(10) << total.sets << setw(10) << kb(total.map_bytes)
+	<< setw(10) << kb(total.resident_growth) << endl << endl;
+
+    // The calls of set_attribute for each key in each phase:
+    out << "  " << left << setw(12) << "key" << right;
+    for (j = 0; j < MANY_PHASES; ++j)
+	out << setw(10) << phase_names[phase_order[j]];
+    out << setw(10) << "map KB" << endl;
+    for (j = 0; j < counts.many_keys; ++j)
+	write_key(out, *(counts.keys[j].key), counts.keys[j]);
+    if (counts.other_keys.map_bytes > 0 || counts.many_keys == MANY_KEYS)
+	write_key(out, "(others)", counts.other_keys);
+    out << endl;
+
+    // The nodes of the tree by kind, without recursion:
+    if (root != NULL)
+	stack.push_back(root);
+    while (!stack.empty( ))
+    {
+	t = stack.back( );
+	stack.pop_back( );
+	pair<long, long>& c = kinds[kind_of(t)];
+	++c.first;
+	c.second += t->many_bytes( );
+	for (i = 0; i < t->many_children( ); ++i)
+	    stack.push_back(t->child(i));
+    }
+    sorted.assign(kinds.begin( ), kinds.end( ));
+    sort(sorted.begin( ), sorted.end( ), more_bytes);
+    out << "  " << left << setw(22) << "node kind (in tree)" << right
+	<< setw(10) << "nodes" << setw(10) << "KB" << endl;
+    for (i = 0; i < sorted.size( ); ++i)
+    {
+	out << "  " << left << setw(22) << sorted[i].first << right
+	    << setw(10) << sorted[i].second.first
+	    << setw(10) << kb(sorted[i].second.second) << endl;
+    }
+}
+//----------------------------------------------------------------------------
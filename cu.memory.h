@@ -0,0 +1,61 @@
+// File: cu.memory.h
+// Version: Oct 18, 2026
+// This file provides the memory report of the CU compiler (cu --mem-report),
+// which shows where the memory of a compilation goes.  Once the report is
+// started, it watches every new tree and every set_attribute through the
+// tree_hooks of tree.h, and it counts them by the phase of the compilation:
+//   lex:      the one-node trees of the tokens and their attributes (these
+//             are made while the parser runs, and are told apart from the
+//             parser's own trees by their Token attribute);
+//   parse:    the trees of the nonterminals and their attributes;
+//   load:     the trees made by load_tree (see cu.serial.h);
+//   traverse: the attributes set by the traverser;
+//   codegen:  anything done by the code generator;
+//   other:    anything done outside of these phases.
+// At each change of phase, the resident set size of the process is also
+// sampled, so the report shows how much each phase made it grow (lex and
+// parse are counted together, since they run at the same time).  Until the
+// report is started, the hooks are not installed, and the trees pay only
+// for a test of one pointer.
+//
+// The counts are kept separately for each thread, and the report is of
+// the thread that calls write_memory_report.
+//
+// CONSTANTS: OTHER_PHASE, LEX_PHASE, PARSE_PHASE, LOAD_PHASE,
+// TRAVERSE_PHASE and CODEGEN_PHASE are the phases.  (LEX_PHASE is never
+// given to set_memory_phase; see above.)
+//
+// FUNCTIONS:
+//   void start_memory_report( )
+//     Postcondition: The counts are zero, and from now on every new tree
+//     and every set_attribute (in any thread) is counted.
+//
+//   void set_memory_phase(int phase)
+//     Postcondition: What the calling thread does from now on is counted
+//     in the given phase.  If the report was started, the growth of the
+//     resident set size since the last change of phase has been charged to
+//     the phase that just ended.
+//
+//   void write_memory_report(ostream& out, const colorado::tree* root)
+//     Precondition: start_memory_report( ) was called.
+//     Postcondition: The report has been written to out: the peak resident
+//     set size of the process, the counts of each phase, the counts of
+//     each attribute key in each phase, and the number of nodes and bytes
+//     of each kind of node in the tree at root (which may be NULL), along
+//     with the sizes of the string pool and the type table.
+
+#ifndef CU_MEMORY_H
+#define CU_MEMORY_H
+#include <iostream>      // Provides ostream
+#include "tree.h"        // Provides the colorado::tree class
+
+enum
+{
+    OTHER_PHASE, LEX_PHASE, PARSE_PHASE, LOAD_PHASE, TRAVERSE_PHASE,
+    CODEGEN_PHASE, MANY_PHASES
+};
+
+void start_memory_report( );
+void set_memory_phase(int phase);
+void write_memory_report(std::ostream& out, const colorado::tree* root);
+#endif
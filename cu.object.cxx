@@ -0,0 +1,1106 @@
+// File: cu.object.cxx
+// Version: Oct 18, 2026
+// This is the implementation file for the ELF32 object files of the CU
+// compiler (see cu.object.h).
+
+#include <algorithm>     // Provides sort
+#include <cctype>        // Provides isalnum, isdigit
+#include <cstddef>       // Provides size_t
+#include <cstdlib>       // Provides strtol
+#include <iostream>      // Provides ostream
+#include <map>           // Provides map
+#include <sstream>       // Provides ostringstream
+#include <string>        // Provides string class
+#include <vector>        // Provides vector class
+#include "cu.emitter.h"  // Provides asm_emitter, format_int
+#include "cu.ir.h"       // Provides asm_list, print_asm_record and the opcodes
+#include "cu.object.h"
+using namespace std;
+
+//----------------------------------------------------------------------------
+// The numbers of the i386 registers (in the order of cu.ir.h): the general
+// registers, -1 for %ax (which is not one), and then the xmm registers:
+static const int machine_register[MANY_REGISTERS] =
+    { -1, 0, 3, 1, 2, 6, 7, 5, 4, -1, 0, 1 };
+
+// The condition codes of the conditional jumps (the low four bits of
+// their opcodes), from OP_JE to OP_JLE:
+static const int condition[OP_JLE - OP_JE + 1] =
+    { 0x4, 0x5, 0x7, 0x3, 0x2, 0x6, 0xF, 0xD, 0xC, 0xE };
+
+// The constants of the ELF format that are used here:
+enum
+{
+    ELF_HEADER_SIZE = 52, SECTION_HEADER_SIZE = 40, SYMBOL_SIZE = 16,
+    RELOCATION_SIZE = 8,
+    SHT_PROGBITS = 1, SHT_SYMTAB = 2, SHT_STRTAB = 3, SHT_NOBITS = 8, SHT_REL = 9,
+    SHF_WRITE = 1, SHF_ALLOC = 2, SHF_EXECINSTR = 4, SHF_INFO_LINK = 0x40,
+    STB_LOCAL = 0, STB_GLOBAL = 1, STT_NOTYPE = 0, STT_SECTION = 3,
+    R_386_32 = 1, R_386_PC32 = 2
+};
+
+static bool is_byte(int value)
+{
+    return value >= -128 && value <= 127;
+}
+
+static bool is_memory(const asm_operand& op)
+{
+    return op.kind == MEMORY_OPERAND || op.kind == SYMBOL_MEMORY_OPERAND
+	|| op.kind == SYMBOL_PLUS_OPERAND;
+}
+
+static bool is_register(const asm_operand& op)
+// Whether the operand is a general register.
+{
+    return op.kind == REGISTER_OPERAND && op.base < XMM0 && machine_register[op.base] >= 0;
+}
+
+static bool is_xmm(const asm_operand& op)
+{
+    return op.kind == REGISTER_OPERAND && op.base >= XMM0;
+}
+
+// Whether a memory operand has registers that can be encoded:
+static bool is_encodable(const asm_operand& op)
+{
+    if (op.kind != MEMORY_OPERAND)
+	return true;
+    if (op.base >= XMM0 || machine_register[op.base] < 0)
+	return false;
+    return op.index == NO_REGISTER
+	|| (op.index < XMM0 && machine_register[op.index] >= 0 && op.index != ESP
+	    && (op.scale == 1 || op.scale == 2 || op.scale == 4 || op.scale == 8));
+}
+
+static bool is_immediate(const asm_operand& op)
+{
+    return op.kind == IMMEDIATE_OPERAND || op.kind == ADDRESS_OPERAND
+	|| op.kind == ADDRESS_PLUS_OPERAND;
+}
+
+static bool is_small(const asm_operand& op)
+{
+    return op.kind == IMMEDIATE_OPERAND && is_byte(op.value);
+}
+
+static string decimal(int value)
+{
+    char digits[12];
+
+    format_int(value, digits);
+    return digits;
+}
+
+static string trim(const string& s)
+{
+    size_t start = s.find_first_not_of(" \t\r");
+    size_t end = s.find_last_not_of(" \t\r");
+
+    return (start == string::npos) ? "" : s.substr(start, end - start + 1);
+}
+
+// Reads a number in the syntax of the assembler (decimal, or octal with a
+// leading 0, or hexadecimal with a leading 0x), and tells if it was one:
+static bool number_of(const string& s, int& value)
+{
+    string t = trim(s);
+    const char* start = t.c_str( );
+    char* end;
+
+    if (t.empty( ))
+	return false;
+    value = int(strtol(start, &end, 0));
+    return *end == '\0';
+}
+
+// Splits the text at the commas that are not inside parentheses or quotes:
+static vector<string> split(const string& s)
+{
+    vector<string> answer;
+    string item;
+    int depth = 0;
+    bool quoted = false;
+    size_t i;
+
+    for (i = 0; i < s.size( ); ++i)
+    {
+	if (s[i] == '"' && (i == 0 || s[i-1] != '\\'))
+	    quoted = !quoted;
+	else if (!quoted && s[i] == '(')
+	    ++depth;
+	else if (!quoted && s[i] == ')')
+	    --depth;
+	if (s[i] == ',' && depth == 0 && !quoted)
+	{
+	    answer.push_back(trim(item));
+	    item.clear( );
+	}
+	else
+	    item += s[i];
+    }
+    if (!trim(item).empty( ) || !answer.empty( ))
+	answer.push_back(trim(item));
+    return answer;
+}
+
+// Adds a 16-bit or a 32-bit number to the end of a file, low byte first:
+static void put16(vector<unsigned char>& file, int value)
+{
+    file.push_back((unsigned char) value);
+    file.push_back((unsigned char) (value >> 8));
+}
+
+static void put32(vector<unsigned char>& file, size_t value)
+{
+    put16(file, int(value & 0xFFFF));
+    put16(file, int((value >> 16) & 0xFFFF));
+}
+
+// The name of a string table is added to its end, and its position is
+// returned:
+static size_t add_name(vector<unsigned char>& table, const string& name)
+{
+    size_t position = table.size( );
+
+    table.insert(table.end( ), name.begin( ), name.end( ));
+    table.push_back('\0');
+    return position;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+elf_object::elf_object( )
+{
+    section = TEXT;
+    rept_count = -1;
+}
+
+size_t elf_object::size( ) const
+{
+    return bytes[TEXT].size( ) + bytes[DATA].size( ) + 6 * jumps.size( );
+}
+
+void elf_object::fail(const string& message)
+{
+    if (failure.empty( ))
+	failure = message;
+}
+
+int elf_object::symbol_of(const string& name)
+{
+    map<string, int>::iterator it = symbol_index.find(name);
+    symbol s;
+
+    if (it != symbol_index.end( ))
+	return it->second;
+    s.name = name;
+    s.defined = false;
+    s.global = false;
+    s.where.section = TEXT;
+    s.where.offset = s.where.jumps = 0;
+    s.index = 0;
+    symbols.push_back(s);
+    symbol_index[name] = symbols.size( ) - 1;
+    return symbols.size( ) - 1;
+}
+
+int elf_object::symbol_of(const asm_list& code, const asm_operand& op, int label_base)
+{
+    if (op.kind == LABEL_OPERAND)
+	return symbol_of("jump." + decimal(op.value + label_base));
+    if (op.label == 0)
+	return symbol_of(code.text(op.symbol));
+    return symbol_of(code.text(op.symbol) + decimal(op.label + label_base));
+}
+
+elf_object::place elf_object::here( ) const
+{
+    place answer;
+
+    answer.section = section;
+    answer.offset = bytes[section].size( );
+    answer.jumps = (section == TEXT) ? jumps.size( ) : 0;
+    return answer;
+}
+
+size_t elf_object::address(const place& p) const
+{
+    return p.offset + ((p.section == TEXT) ? jump_sizes[p.jumps] : 0);
+}
+
+void elf_object::define(int s)
+{
+    if (symbols[s].defined)
+	fail("The symbol " + symbols[s].name + " is defined twice.");
+    symbols[s].defined = true;
+    symbols[s].where = here( );
+}
+
+void elf_object::word(int w)
+{
+    byte(w);
+    byte(w >> 8);
+    byte(w >> 16);
+    byte(w >> 24);
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// The operands of the instructions.
+
+// Adds the ModR/M byte (with reg in its middle bits) for the register or
+// memory operand op, and the bytes that follow it:
+void elf_object::modrm(int reg, const asm_list& code, const asm_operand& op, int label_base)
+{
+    static const int scale_bits[9] = { -1, 0, 1, -1, 2, -1, -1, -1, 3 };
+    int base, mod;
+    fixup f;
+
+    if (is_register(op) || is_xmm(op))
+    {
+	byte(0xC0 | (reg << 3) | machine_register[op.base]);
+	return;
+    }
+    if (op.kind == SYMBOL_MEMORY_OPERAND || op.kind == SYMBOL_PLUS_OPERAND)
+    {   // An absolute address:
+	byte(0x05 | (reg << 3));
+	f.where = here( );
+	f.target = symbol_of(code, op, label_base);
+	f.relative = false;
+	fixups.push_back(f);
+	word((op.kind == SYMBOL_PLUS_OPERAND) ? op.value : 0);
+	return;
+    }
+    base = machine_register[op.base];
+    // No displacement, unless the base is %ebp (which then needs one):
+    mod = (op.value == 0 && base != 5) ? 0 : is_byte(op.value) ? 1 : 2;
+    if (op.index == NO_REGISTER && base != 4)
+	byte((mod << 6) | (reg << 3) | base);
+    else if (op.index == NO_REGISTER)
+    {   // %esp is a base only through a SIB byte with no index:
+	byte((mod << 6) | (reg << 3) | 4);
+	byte(0x24);
+    }
+    else
+    {
+	byte((mod << 6) | (reg << 3) | 4);
+	byte((scale_bits[op.scale] << 6) | (machine_register[op.index] << 3) | base);
+    }
+    if (mod == 1)
+	byte(op.value);
+    else if (mod == 2)
+	word(op.value);
+}
+
+// Adds the four bytes of an immediate operand:
+void elf_object::immediate(const asm_list& code, const asm_operand& op, int label_base)
+{
+    fixup f;
+
+    if (op.kind == IMMEDIATE_OPERAND)
+    {
+	word(op.value);
+	return;
+    }
+    f.where = here( );
+    f.target = symbol_of(code, op, label_base);
+    f.relative = false;
+    fixups.push_back(f);
+    word((op.kind == ADDRESS_PLUS_OPERAND) ? op.value : 0);
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// Encodes one record, and tells whether it could.
+bool elf_object::encode(const asm_list& code, const asm_instruction& p, int label_base)
+{
+    const asm_operand& a = p.op1;
+    const asm_operand& b = p.op2;
+    bool none = (a.kind == NO_OPERAND && b.kind == NO_OPERAND);
+    bool one_rm = ((is_register(a) || is_memory(a)) && b.kind == NO_OPERAND);
+    bool one_memory = (is_memory(a) && b.kind == NO_OPERAND);
+    bool b_rm = (is_register(b) || is_memory(b));
+    int n;
+    jump j;
+    fixup f;
+
+    if (!is_encodable(a) || !is_encodable(b))
+	return false;
+
+    switch (p.opcode)
+    {
+    case OP_TEXT:
+	text(code.text(a.symbol), a.value);
+	return true;
+    case OP_LABEL:
+	if (a.kind != LABEL_OPERAND && a.kind != SYMBOL_OPERAND)
+	    return false;
+	define(symbol_of(code, a, label_base));
+	return true;
+    case OP_LONG:
+	if (a.kind != NUMBER_OPERAND && a.kind != IMMEDIATE_OPERAND)
+	    return false;
+	word(a.value);
+	return true;
+
+    case OP_ADDL: case OP_SUBL: case OP_CMPL: case OP_XORL:
+	n = (p.opcode == OP_ADDL) ? 0 : (p.opcode == OP_SUBL) ? 5 : (p.opcode == OP_CMPL) ? 7 : 6;
+	if (is_small(a) && b_rm)
+	{
+	    byte(0x83);
+	    modrm(n, code, b, label_base);
+	    byte(a.value);
+	}
+	else if (is_immediate(a) && b.kind == REGISTER_OPERAND && b.base == EAX)
+	{   // The short form for %eax:
+	    byte(n*8 + 5);
+	    immediate(code, a, label_base);
+	}
+	else if (is_immediate(a) && b_rm)
+	{
+	    byte(0x81);
+	    modrm(n, code, b, label_base);
+	    immediate(code, a, label_base);
+	}
+	else if (is_register(a) && b_rm)
+	{
+	    byte(n*8 + 1);
+	    modrm(machine_register[a.base], code, b, label_base);
+	}
+	else if (is_memory(a) && is_register(b))
+	{
+	    byte(n*8 + 3);
+	    modrm(machine_register[b.base], code, a, label_base);
+	}
+	else
+	    return false;
+	return true;
+    case OP_MOVL:
+	if (is_register(a) && a.base == EAX
+	    && (b.kind == SYMBOL_MEMORY_OPERAND || b.kind == SYMBOL_PLUS_OPERAND))
+	{   // The short form for storing %eax at an absolute address:
+	    byte(0xA3);
+	    f.where = here( );
+	    f.target = symbol_of(code, b, label_base);
+	    f.relative = false;
+	    fixups.push_back(f);
+	    word((b.kind == SYMBOL_PLUS_OPERAND) ? b.value : 0);
+	}
+	else if (is_register(b) && b.base == EAX
+	    && (a.kind == SYMBOL_MEMORY_OPERAND || a.kind == SYMBOL_PLUS_OPERAND))
+	{   // ... and for loading it from one:
+	    byte(0xA1);
+	    f.where = here( );
+	    f.target = symbol_of(code, a, label_base);
+	    f.relative = false;
+	    fixups.push_back(f);
+	    word((a.kind == SYMBOL_PLUS_OPERAND) ? a.value : 0);
+	}
+	else if (is_register(a) && b_rm)
+	{
+	    byte(0x89);
+	    modrm(machine_register[a.base], code, b, label_base);
+	}
+	else if (is_memory(a) && is_register(b))
+	{
+	    byte(0x8B);
+	    modrm(machine_register[b.base], code, a, label_base);
+	}
+	else if (is_immediate(a) && is_register(b))
+	{
+	    byte(0xB8 + machine_register[b.base]);
+	    immediate(code, a, label_base);
+	}
+	else if (is_immediate(a) && is_memory(b))
+	{
+	    byte(0xC7);
+	    modrm(0, code, b, label_base);
+	    immediate(code, a, label_base);
+	}
+	else
+	    return false;
+	return true;
+    case OP_PUSHL:
+	if (is_register(a) && b.kind == NO_OPERAND)
+	    byte(0x50 + machine_register[a.base]);
+	else if (is_small(a) && b.kind == NO_OPERAND)
+	{
+	    byte(0x6A);
+	    byte(a.value);
+	}
+	else if (is_immediate(a) && b.kind == NO_OPERAND)
+	{
+	    byte(0x68);
+	    immediate(code, a, label_base);
+	}
+	else if (one_memory)
+	{
+	    byte(0xFF);
+	    modrm(6, code, a, label_base);
+	}
+	else
+	    return false;
+	return true;
+    case OP_POPL:
+	if (is_register(a) && b.kind == NO_OPERAND)
+	    byte(0x58 + machine_register[a.base]);
+	else if (one_memory)
+	{
+	    byte(0x8F);
+	    modrm(0, code, a, label_base);
+	}
+	else
+	    return false;
+	return true;
+    case OP_INCL: case OP_DECL:
+	n = (p.opcode == OP_INCL) ? 0 : 1;
+	if (is_register(a) && b.kind == NO_OPERAND)
+	    byte(0x40 + 8*n + machine_register[a.base]);
+	else if (one_memory)
+	{
+	    byte(0xFF);
+	    modrm(n, code, a, label_base);
+	}
+	else
+	    return false;
+	return true;
+    case OP_NEGL: case OP_IDIVL:
+	if (!one_rm)
+	    return false;
+	byte(0xF7);
+	modrm((p.opcode == OP_NEGL) ? 3 : 7, code, a, label_base);
+	return true;
+    case OP_IMULL:
+	if (one_rm)
+	{
+	    byte(0xF7);
+	    modrm(5, code, a, label_base);
+	}
+	else if ((is_register(a) || is_memory(a)) && is_register(b))
+	{
+	    byte(0x0F);
+	    byte(0xAF);
+	    modrm(machine_register[b.base], code, a, label_base);
+	}
+	else if (is_small(a) && is_register(b))
+	{
+	    byte(0x6B);
+	    modrm(machine_register[b.base], code, b, label_base);
+	    byte(a.value);
+	}
+	else if (a.kind == IMMEDIATE_OPERAND && is_register(b))
+	{
+	    byte(0x69);
+	    modrm(machine_register[b.base], code, b, label_base);
+	    word(a.value);
+	}
+	else
+	    return false;
+	return true;
+    case OP_SHLL: case OP_SHRL:
+	n = (p.opcode == OP_SHLL) ? 4 : 5;
+	if (one_rm)
+	{   // A shift by one:
+	    byte(0xD1);
+	    modrm(n, code, a, label_base);
+	}
+	else if (a.kind == IMMEDIATE_OPERAND && a.value == 1 && b_rm)
+	{
+	    byte(0xD1);
+	    modrm(n, code, b, label_base);
+	}
+	else if (is_small(a) && b_rm)
+	{
+	    byte(0xC1);
+	    modrm(n, code, b, label_base);
+	    byte(a.value);
+	}
+	else
+	    return false;
+	return true;
+
+    case OP_CDQ: case OP_RET: case OP_PUSHA: case OP_POPA: case OP_SAHF:
+	if (!none)
+	    return false;
+	byte((p.opcode == OP_CDQ) ? 0x99 : (p.opcode == OP_RET) ? 0xC3
+	     : (p.opcode == OP_PUSHA) ? 0x60 : (p.opcode == OP_POPA) ? 0x61 : 0x9E);
+	return true;
+
+    case OP_CALL:
+	if (a.kind != SYMBOL_OPERAND || b.kind != NO_OPERAND)
+	    return false;
+	byte(0xE8);
+	f.where = here( );
+	f.target = symbol_of(code, a, label_base);
+	f.relative = true;
+	fixups.push_back(f);
+	word(-4);
+	return true;
+    case OP_JMP: case OP_JE: case OP_JNE: case OP_JA: case OP_JAE: case OP_JB:
+    case OP_JBE: case OP_JG: case OP_JGE: case OP_JL: case OP_JLE:
+	if ((a.kind != LABEL_OPERAND && a.kind != SYMBOL_OPERAND)
+	    || b.kind != NO_OPERAND || section != TEXT)
+	    return false;
+	// The jump gets its bytes when its size is known, in write:
+	j.offset = bytes[TEXT].size( );
+	j.opcode = p.opcode;
+	j.target = symbol_of(code, a, label_base);
+	j.is_long = false;
+	jumps.push_back(j);
+	return true;
+
+    // The floating point operations.  The ones with no operand pop the
+    // stack (as the assembler takes them), the ones with a memory operand
+    // and no suffix work on 32-bit floats (the default of the assembler),
+    // and the integer ones work on 32-bit integers:
+    case OP_FADD: case OP_FMUL: case OP_FSUB: case OP_FDIV:
+	n = (p.opcode == OP_FADD) ? 0 : (p.opcode == OP_FMUL) ? 1 : (p.opcode == OP_FSUB) ? 4 : 6;
+	if (none)
+	{
+	    byte(0xDE);
+	    byte(0xC1 + 8*n);
+	}
+	else if (one_memory)
+	{
+	    byte(0xD8);
+	    modrm(n, code, a, label_base);
+	}
+	else
+	    return false;
+	return true;
+    case OP_FIADD: case OP_FIMUL: case OP_FISUB: case OP_FISUBR: case OP_FIDIV:
+    case OP_FIDIVR:
+	if (!one_memory)
+	    return false;
+	byte(0xDA);
+	modrm((p.opcode == OP_FIADD) ? 0 : (p.opcode == OP_FIMUL) ? 1
+	      : (p.opcode == OP_FISUB) ? 4 : (p.opcode == OP_FISUBR) ? 5
+	      : (p.opcode == OP_FIDIV) ? 6 : 7, code, a, label_base);
+	return true;
+    case OP_FILD: case OP_FISTPL: case OP_FLD: case OP_FSTP: case OP_FSTPL:
+	if (!one_memory)
+	    return false;
+	switch (p.opcode)
+	{
+	case OP_FILD:   byte(0xDB); n = 0; break;
+	case OP_FISTPL: byte(0xDB); n = 3; break;
+	case OP_FLD:    byte(0xD9); n = 0; break;
+	case OP_FSTP:   byte(0xD9); n = 3; break;
+	default:        byte(0xDD); n = 3; break;
+	}
+	modrm(n, code, a, label_base);
+	return true;
+    case OP_FCHS: case OP_FCOMPP: case OP_FNINIT: case OP_FLDZ:
+	if (!none)
+	    return false;
+	switch (p.opcode)
+	{
+	case OP_FCHS:   byte(0xD9); byte(0xE0); break;
+	case OP_FCOMPP: byte(0xDE); byte(0xD9); break;
+	case OP_FNINIT: byte(0xDB); byte(0xE3); break;
+	default:        byte(0xD9); byte(0xEE); break;
+	}
+	return true;
+    case OP_FNSTSW:
+	if (a.kind == REGISTER_OPERAND && a.base == AX && b.kind == NO_OPERAND)
+	{
+	    byte(0xDF);
+	    byte(0xE0);
+	}
+	else if (one_memory)
+	{
+	    byte(0xDD);
+	    modrm(7, code, a, label_base);
+	}
+	else
+	    return false;
+	return true;
+
+    // The scalar SSE2 operations.  Each one is a prefix (F3 for a float, F2
+    // for a double, none for ucomiss and xorps), 0F and one more byte, with the xmm
+    // register that it sets (or the general register of cvtss2si) in the
+    // ModR/M byte and the operand that it reads after it.  Only a movss or
+    // a movsd may store to memory, with a byte of its own:
+    case OP_ADDSD: case OP_ADDSS: case OP_CVTSD2SS: case OP_CVTSS2SD:
+    case OP_DIVSD: case OP_DIVSS: case OP_MOVSD: case OP_MOVSS:
+    case OP_MULSD: case OP_MULSS: case OP_SUBSD: case OP_SUBSS:
+    case OP_UCOMISS: case OP_XORPS:
+    case OP_CVTSI2SD: case OP_CVTSI2SS: case OP_CVTSS2SI:
+	if ((p.opcode == OP_MOVSS || p.opcode == OP_MOVSD) && is_xmm(a) && is_memory(b))
+	{
+	    byte((p.opcode == OP_MOVSS) ? 0xF3 : 0xF2);
+	    byte(0x0F);
+	    byte(0x11);
+	    modrm(machine_register[a.base], code, b, label_base);
+	    return true;
+	}
+	if (p.opcode == OP_CVTSI2SD || p.opcode == OP_CVTSI2SS)
+	    n = is_xmm(b) && (is_register(a) || is_memory(a));
+	else if (p.opcode == OP_CVTSS2SI)
+	    n = is_register(b) && (is_xmm(a) || is_memory(a));
+	else
+	    n = is_xmm(b) && (is_xmm(a) || is_memory(a));
+	if (!n)
+	    return false;
+	switch (p.opcode)
+	{
+	case OP_ADDSD: case OP_CVTSD2SS: case OP_CVTSI2SD: case OP_DIVSD:
+	case OP_MOVSD: case OP_MULSD: case OP_SUBSD:
+	    byte(0xF2);
+	    break;
+	case OP_UCOMISS: case OP_XORPS:
+	    break;
+	default:
+	    byte(0xF3);
+	    break;
+	}
+	byte(0x0F);
+	switch (p.opcode)
+	{
+	case OP_MOVSD: case OP_MOVSS:        byte(0x10); break;
+	case OP_CVTSI2SD: case OP_CVTSI2SS:  byte(0x2A); break;
+	case OP_CVTSS2SI:                    byte(0x2D); break;
+	case OP_UCOMISS:                     byte(0x2E); break;
+	case OP_ADDSD: case OP_ADDSS:        byte(0x58); break;
+	case OP_MULSD: case OP_MULSS:        byte(0x59); break;
+	case OP_CVTSD2SS: case OP_CVTSS2SD:  byte(0x5A); break;
+	case OP_XORPS:                       byte(0x57); break;
+	case OP_SUBSD: case OP_SUBSS:        byte(0x5C); break;
+	default:                             byte(0x5E); break;
+	}
+	modrm(machine_register[b.base], code, a, label_base);
+	return true;
+    }
+    return false;
+}
+
+void elf_object::add(const asm_list& code, int label_base)
+{
+    size_t i;
+
+    for (i = 0; i < code.size( ); ++i)
+    {
+	if (!encode(code, code[i], label_base))
+	{   // The message has the record as print_asm would write it:
+	    ostringstream record;
+	    asm_emitter out(record);
+	    out.set_compact(true);
+	    print_asm_record(code, i, out, label_base);
+	    out.flush( );
+	    fail("Cannot encode \"" + trim(record.str( ).substr(0, record.str( ).find('\n'))) + "\".");
+	}
+    }
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// The raw text of the lists, which is read one line at a time.
+
+void elf_object::text(const char* s, size_t n)
+{
+    size_t i, start = 0;
+
+    for (i = 0; i < n; ++i)
+    {
+	if (s[i] == '\n')
+	{   // (A .rept in the line reads its own lines through text.)
+	    string whole = partial + string(s + start, i - start);
+	    partial.clear( );
+	    line(whole);
+	    start = i + 1;
+	}
+    }
+    partial.append(s + start, n - start);
+}
+
+void elf_object::line(const string& s)
+{
+    string rest = s;
+    bool quoted = false;
+    size_t i;
+
+    // The comment (if any) is dropped:
+    for (i = 0; i < rest.size( ); ++i)
+    {
+	if (rest[i] == '"' && (i == 0 || rest[i-1] != '\\'))
+	    quoted = !quoted;
+	else if (rest[i] == '#' && !quoted)
+	{
+	    rest.erase(i);
+	    break;
+	}
+    }
+    rest = trim(rest);
+    if (rept_count >= 0)
+    {   // The lines of a .rept are kept until its .endr:
+	if (rest != ".endr")
+	    rept_text += rest + '\n';
+	else
+	{
+	    string body;
+	    int count = rept_count;
+	    rept_count = -1;
+	    body.swap(rept_text);
+	    for ( ; count > 0; --count)
+		text(body.data( ), body.size( ));
+	}
+	return;
+    }
+
+    // Any labels at the start of the line:
+    for (i = 0; i < rest.size( ) && rest[i] != ':'
+	     && (isalnum(rest[i]) || rest[i] == '.' || rest[i] == '_' || rest[i] == '$'); ++i)
+	;
+    while (i > 0 && i < rest.size( ) && rest[i] == ':' && !isdigit(rest[0]))
+    {
+	define(symbol_of(rest.substr(0, i)));
+	rest = trim(rest.substr(i + 1));
+	for (i = 0; i < rest.size( ) && rest[i] != ':'
+		 && (isalnum(rest[i]) || rest[i] == '.' || rest[i] == '_' || rest[i] == '$'); ++i)
+	    ;
+    }
+    if (rest.empty( ))
+	return;
+    i = rest.find_first_of(" \t");
+    if (i == string::npos)
+	i = rest.size( );
+    if (rest[0] == '.')
+	directive(rest.substr(0, i), trim(rest.substr(i)));
+    else
+	instruction(rest.substr(0, i), trim(rest.substr(i)));
+}
+
+void elf_object::directive(const string& name, const string& rest)
+{
+    vector<string> items = split(rest);
+    string s;
+    int value;
+    size_t i, k;
+
+    if (name == ".section" && !items.empty( ) && (items[0] == ".text" || items[0] == ".data"))
+	section = (items[0] == ".text") ? TEXT : DATA;
+    else if (name == ".text" || name == ".data")
+	section = (name == ".text") ? TEXT : DATA;
+    else if ((name == ".globl" || name == ".global") && items.size( ) == 1)
+	symbols[symbol_of(items[0])].global = true;
+    else if ((name == ".long" || name == ".byte") && !items.empty( ))
+    {
+	for (i = 0; i < items.size( ); ++i)
+	{
+	    if (!number_of(items[i], value))
+	    {
+		fail("Cannot encode \"" + name + " " + rest + "\".");
+		return;
+	    }
+	    if (name == ".long")
+		word(value);
+	    else
+		byte(value);
+	}
+    }
+    else if ((name == ".ascii" || name == ".asciz" || name == ".string")
+	     && rest.size( ) >= 2 && rest[0] == '"' && rest[rest.size( )-1] == '"')
+    {
+	s = rest.substr(1, rest.size( ) - 2);
+	for (i = 0; i < s.size( ); ++i)
+	{
+	    if (s[i] != '\\' || i + 1 == s.size( ))
+	    {
+		byte(s[i]);
+		continue;
+	    }
+	    ++i;
+	    switch (s[i])
+	    {
+	    case 'n': byte('\n'); break;
+	    case 't': byte('\t'); break;
+	    case 'r': byte('\r'); break;
+	    case 'b': byte('\b'); break;
+	    case 'f': byte('\f'); break;
+	    default:
+		if (s[i] >= '0' && s[i] <= '7')
+		{   // Up to three octal digits:
+		    for (value = 0, k = 0; k < 3 && i < s.size( ) && s[i] >= '0' && s[i] <= '7'; ++k, ++i)
+			value = value * 8 + (s[i] - '0');
+		    --i;
+		    byte(value);
+		}
+		else
+		    byte(s[i]);
+		break;
+	    }
+	}
+	if (name != ".ascii")
+	    byte(0);
+    }
+    else if (name == ".rept" && number_of(rest, value))
+    {
+	rept_count = (value > 0) ? value : 0;
+	rept_text.clear( );
+    }
+    else
+	fail("Cannot encode \"" + name + (rest.empty( ) ? "" : " ") + rest + "\".");
+}
+
+void elf_object::instruction(const string& mnemonic, const string& rest)
+{
+    vector<string> operands = split(rest);
+    asm_list code;
+    int opcode;
+
+    for (opcode = OP_LONG + 1; opcode < MANY_OPCODES; ++opcode)
+    {
+	if (mnemonic == asm_mnemonic(opcode))
+	    break;
+    }
+    if (opcode == MANY_OPCODES || operands.size( ) > 2)
+    {
+	fail("Cannot encode \"" + mnemonic + (rest.empty( ) ? "" : " ") + rest + "\".");
+	return;
+    }
+    code.add(
+	opcode,
+	(operands.size( ) > 0) ? asm_arg(operands[0]) : asm_arg( ),
+	(operands.size( ) > 1) ? asm_arg(operands[1]) : asm_arg( )
+	);
+    if (!encode(code, code[0], 0))
+	fail("Cannot encode \"" + mnemonic + (rest.empty( ) ? "" : " ") + rest + "\".");
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// Gives each jump its size.  Every jump to a local label in .text starts
+// short, and the ones that cannot reach their labels are made long, until
+// none change (as the assembler does it).  Since a jump only grows, one
+// that is too far now is too far for good.  Any other jump is long.
+void elf_object::relax( )
+{
+    size_t k;
+    long distance;
+    bool changed = true;
+
+    for (k = 0; k < jumps.size( ); ++k)
+    {
+	const symbol& target = symbols[jumps[k].target];
+	jumps[k].is_long = !target.defined || target.global || target.where.section != TEXT;
+    }
+    jump_sizes.resize(jumps.size( ) + 1);
+    while (changed)
+    {
+	changed = false;
+	jump_sizes[0] = 0;
+	for (k = 0; k < jumps.size( ); ++k)
+	{
+	    jump_sizes[k+1] = jump_sizes[k]
+		+ (!jumps[k].is_long ? 2 : (jumps[k].opcode == OP_JMP) ? 5 : 6);
+	}
+	for (k = 0; k < jumps.size( ); ++k)
+	{
+	    if (jumps[k].is_long)
+		continue;
+	    distance = long(address(symbols[jumps[k].target].where))
+		- long(jumps[k].offset + jump_sizes[k+1]);
+	    if (distance < -128 || distance > 127)
+		changed = jumps[k].is_long = true;
+	}
+    }
+}
+
+bool elf_object::write(ostream& out)
+{
+    // The sections of the file, in order:
+    enum { S_NULL, S_TEXT, S_REL_TEXT, S_DATA, S_REL_DATA, S_BSS, S_NOTE,
+	   S_SYMTAB, S_STRTAB, S_SHSTRTAB, MANY_HEADERS };
+    static const char* const names[MANY_HEADERS] =
+	{ "", ".text", ".rel.text", ".data", ".rel.data", ".bss",
+	  ".note.GNU-stack", ".symtab", ".strtab", ".shstrtab" };
+    vector<unsigned char> contents[MANY_HEADERS];
+    vector<unsigned char> file;
+    vector<pair<size_t, size_t> > relocations[MANY_SECTIONS];
+    size_t offsets[MANY_HEADERS];
+    size_t name_at[MANY_HEADERS];
+    size_t k, i, at, start, first_global;
+    unsigned char* place_bytes;
+    int value, target, code;
+
+    if (!partial.empty( ))
+    {
+	string whole;
+	whole.swap(partial);
+	line(whole);
+    }
+    if (rept_count >= 0)
+	fail("A .rept has no .endr.");
+    if (!failure.empty( ))
+	return false;
+    relax( );
+
+    // The symbol table: the null symbol, the two sections, the local
+    // symbols, and then the global ones (defined or not):
+    contents[S_STRTAB].push_back('\0');
+    contents[S_SYMTAB].resize(3 * SYMBOL_SIZE, 0);
+    contents[S_SYMTAB][SYMBOL_SIZE + 12] = contents[S_SYMTAB][2*SYMBOL_SIZE + 12] = STT_SECTION;
+    contents[S_SYMTAB][SYMBOL_SIZE + 14] = S_TEXT;
+    contents[S_SYMTAB][2*SYMBOL_SIZE + 14] = S_DATA;
+    first_global = 0;
+    for (i = 0; i < 2; ++i)
+    {
+	for (k = 0; k < symbols.size( ); ++k)
+	{
+	    symbol& s = symbols[k];
+	    if ((s.defined && !s.global) != (i == 0))
+		continue;
+	    if (i == 1 && first_global == 0)
+		first_global = contents[S_SYMTAB].size( ) / SYMBOL_SIZE;
+	    s.index = contents[S_SYMTAB].size( ) / SYMBOL_SIZE;
+	    put32(contents[S_SYMTAB], add_name(contents[S_STRTAB], s.name));
+	    put32(contents[S_SYMTAB], s.defined ? address(s.where) : 0);
+	    put32(contents[S_SYMTAB], 0);
+	    contents[S_SYMTAB].push_back(((s.global || !s.defined) ? STB_GLOBAL : STB_LOCAL) << 4
+					 | STT_NOTYPE);
+	    contents[S_SYMTAB].push_back(0);
+	    put16(contents[S_SYMTAB], !s.defined ? 0 : (s.where.section == TEXT) ? S_TEXT : S_DATA);
+	}
+    }
+    if (first_global == 0)
+	first_global = contents[S_SYMTAB].size( ) / SYMBOL_SIZE;
+
+    // The code, with the bytes of each jump put in its place:
+    start = 0;
+    for (k = 0; k < jumps.size( ); ++k)
+    {
+	const symbol& s = symbols[jumps[k].target];
+	contents[S_TEXT].insert(contents[S_TEXT].end( ),
+				bytes[TEXT].begin( ) + start, bytes[TEXT].begin( ) + jumps[k].offset);
+	start = jumps[k].offset;
+	code = (jumps[k].opcode == OP_JMP) ? -1 : condition[jumps[k].opcode - OP_JE];
+	at = contents[S_TEXT].size( ) + ((code < 0) ? 1 : 2);
+	if (!jumps[k].is_long)
+	{
+	    contents[S_TEXT].push_back((code < 0) ? 0xEB : 0x70 + code);
+	    contents[S_TEXT].push_back(address(s.where) - (contents[S_TEXT].size( ) + 1));
+	    continue;
+	}
+	if (code < 0)
+	    contents[S_TEXT].push_back(0xE9);
+	else
+	{
+	    contents[S_TEXT].push_back(0x0F);
+	    contents[S_TEXT].push_back(0x80 + code);
+	}
+	if (s.defined && !s.global && s.where.section == TEXT)
+	    value = int(address(s.where) - (at + 4));
+	else
+	{
+	    value = -4 + ((s.defined && !s.global) ? int(address(s.where)) : 0);
+	    relocations[TEXT].push_back(make_pair(at, size_t(
+		((s.defined && !s.global) ? ((s.where.section == TEXT) ? 1 : 2) : s.index) << 8
+		| R_386_PC32)));
+	}
+	put32(contents[S_TEXT], value);
+    }
+    contents[S_TEXT].insert(contents[S_TEXT].end( ), bytes[TEXT].begin( ) + start, bytes[TEXT].end( ));
+    contents[S_DATA] = bytes[DATA];
+
+    // The addresses and the relocations.  A symbol of this file that is not
+    // global is given by its section (symbol 1 or 2) and the offset in it:
+    for (k = 0; k < fixups.size( ); ++k)
+    {
+	const fixup& f = fixups[k];
+	const symbol& s = symbols[f.target];
+	bool local = s.defined && !s.global;
+	at = address(f.where);
+	place_bytes = &contents[(f.where.section == TEXT) ? S_TEXT : S_DATA][at];
+	value = place_bytes[0] | place_bytes[1] << 8 | place_bytes[2] << 16 | place_bytes[3] << 24;
+	if (f.relative && local && s.where.section == f.where.section)
+	    value += int(address(s.where)) - int(at);
+	else
+	{
+	    if (local)
+		value += int(address(s.where));
+	    target = local ? ((s.where.section == TEXT) ? 1 : 2) : s.index;
+	    relocations[f.where.section].push_back(
+		make_pair(at, size_t(target << 8 | (f.relative ? R_386_PC32 : R_386_32))));
+	}
+	place_bytes[0] = value;
+	place_bytes[1] = value >> 8;
+	place_bytes[2] = value >> 16;
+	place_bytes[3] = value >> 24;
+    }
+    for (i = 0; i < MANY_SECTIONS; ++i)
+    {
+	sort(relocations[i].begin( ), relocations[i].end( ));
+	for (k = 0; k < relocations[i].size( ); ++k)
+	{
+	    put32(contents[(i == TEXT) ? S_REL_TEXT : S_REL_DATA], relocations[i][k].first);
+	    put32(contents[(i == TEXT) ? S_REL_TEXT : S_REL_DATA], relocations[i][k].second);
+	}
+    }
+    for (i = 0; i < MANY_HEADERS; ++i)
+	name_at[i] = add_name(contents[S_SHSTRTAB], names[i]);
+
+    // The file: its header, the contents of the sections (each table on
+    // a 4-byte boundary), and then the section headers:
+    file.resize(ELF_HEADER_SIZE);
+    for (i = 1; i < MANY_HEADERS; ++i)
+    {
+	if (i == S_REL_TEXT || i == S_REL_DATA || i == S_SYMTAB)
+	    file.resize((file.size( ) + 3) & ~size_t(3));
+	offsets[i] = file.size( );
+	if (i != S_BSS)
+	    file.insert(file.end( ), contents[i].begin( ), contents[i].end( ));
+    }
+    file.resize((file.size( ) + 3) & ~size_t(3));
+    at = file.size( );
+    file.resize(at + SECTION_HEADER_SIZE, 0);
+    for (i = 1; i < MANY_HEADERS; ++i)
+    {
+	put32(file, name_at[i]);
+	put32(file, (i == S_REL_TEXT || i == S_REL_DATA) ? SHT_REL
+	      : (i == S_SYMTAB) ? SHT_SYMTAB
+	      : (i == S_STRTAB || i == S_SHSTRTAB) ? SHT_STRTAB
+	      : (i == S_BSS) ? SHT_NOBITS : SHT_PROGBITS);
+	put32(file, (i == S_TEXT) ? SHF_ALLOC | SHF_EXECINSTR
+	      : (i == S_DATA || i == S_BSS) ? SHF_ALLOC | SHF_WRITE
+	      : (i == S_REL_TEXT || i == S_REL_DATA) ? SHF_INFO_LINK : 0);
+	put32(file, 0);
+	put32(file, offsets[i]);
+	put32(file, contents[i].size( ));
+	put32(file, (i == S_REL_TEXT || i == S_REL_DATA) ? S_SYMTAB
+	      : (i == S_SYMTAB) ? S_STRTAB : 0);
+	put32(file, (i == S_REL_TEXT) ? size_t(S_TEXT) : (i == S_REL_DATA) ? size_t(S_DATA)
+	      : (i == S_SYMTAB) ? first_global : 0);
+	put32(file, (i == S_REL_TEXT || i == S_REL_DATA || i == S_SYMTAB) ? 4 : 1);
+	put32(file, (i == S_REL_TEXT || i == S_REL_DATA) ? RELOCATION_SIZE
+	      : (i == S_SYMTAB) ? SYMBOL_SIZE : 0);
+    }
+
+    // The ELF header, for a 32-bit little-endian i386 relocatable file:
+    static const unsigned char ident[16] =
+	{ 0x7F, 'E', 'L', 'F', 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    vector<unsigned char> header(ident, ident + 16);
+    put16(header, 1);                    // ET_REL
+    put16(header, 3);                    // EM_386
+    put32(header, 1);                    // EV_CURRENT
+    put32(header, 0);                    // No entry point
+    put32(header, 0);                    // No program headers
+    put32(header, at);                   // The section headers
+    put32(header, 0);                    // No flags
+    put16(header, ELF_HEADER_SIZE);
+    put16(header, 0);
+    put16(header, 0);
+    put16(header, SECTION_HEADER_SIZE);
+    put16(header, MANY_HEADERS);
+    put16(header, S_SHSTRTAB);
+    copy(header.begin( ), header.end( ), file.begin( ));
+
+    out.write((const char*) &file[0], file.size( ));
+    return bool(out);
+}
+//----------------------------------------------------------------------------
@@ -0,0 +1,145 @@
+// File: cu.object.h
+// Version: Oct 18, 2026
+// This file provides the elf_object class, which turns the instruction
+// lists of the CU code generator (see cu.ir.h) straight into an ELF32
+// relocatable object file for the i386 (cu -c), so that the program does
+// not have to go through the assembler.  The instructions are encoded with
+// the same choices that the GNU assembler makes for the text that
+// print_asm writes (the short forms for small immediates and for %eax, the
+// defaults for the floating point operations that have no suffix, and
+// jumps of two bytes when the label is near), so the bytes of the code
+// are the same as those of "as --32" on that text.
+//
+// Besides the instructions, the raw text of a list (OP_TEXT) is read for
+// the few directives that the code generator writes: .section .text and
+// .section .data (or .text and .data), .globl, .long and .byte with
+// numbers, .ascii and .asciz, .rept and .endr, and labels.  An instruction
+// in raw text is also encoded.  The functions of cu.lib.s are not part of
+// the object file: they are in the library libcu.a, which is linked with
+// it (see the makefile):
+//   cu -c -o program.o program.cu
+//   gcc -m32 program.o libcu.a -o program
+//
+// The labels of a program become its symbols: main and _main (and any
+// other symbol given to .globl) are global, and the rest are local.  A
+// symbol that is used but not defined (such as printf or lib.copyrec) is
+// an undefined global, which the linker finds.  An absolute address is an
+// R_386_32 relocation and a call of a symbol in another file is an
+// R_386_PC32 relocation; as with the assembler, a local symbol is given
+// as its section plus an offset.  A call or a jump to a label of the
+// program itself needs no relocation.
+//
+// CONSTRUCTOR for the elf_object class:
+//   elf_object( )
+//     Postcondition: The object is empty, with .text as its section.
+//
+// MODIFICATION MEMBER FUNCTIONS for the elf_object class:
+//   void add(const asm_list& code, int label_base = 0)
+//     Postcondition: The records of code have been encoded at the end of
+//     the object, in order, with label_base added to every label number
+//     (just as print_asm would write them).  A record that cannot be
+//     encoded (such as a popl with no operand, which the assembler also
+//     refuses) is left out, and its text is kept for error( ).
+//
+//   bool write(std::ostream& out)
+//     Postcondition: If nothing failed, then the jumps have been given
+//     their sizes, the object file has been written to out, and the return
+//     value is true.  Otherwise nothing was written, and the return value
+//     is false.
+//
+// CONSTANT MEMBER FUNCTIONS for the elf_object class:
+//   size_t size( ) const
+//     Postcondition: The return value is the number of bytes of code and
+//     data so far (with each jump counted at its longest).
+//
+//   const std::string& error( ) const
+//     Postcondition: The return value is a message about the first thing
+//     that could not be encoded or resolved, or "" if there is none.
+//
+// An elf_object cannot be copied or assigned.
+
+#ifndef CU_OBJECT_H
+#define CU_OBJECT_H
+#include <cstddef>       // Provides size_t
+#include <iostream>      // Provides ostream
+#include <map>           // Provides map
+#include <string>        // Provides string class
+#include <vector>        // Provides vector class
+#include "cu.ir.h"       // Provides the asm_list class
+
+class elf_object
+{
+public:
+    elf_object( );
+    void add(const asm_list& code, int label_base = 0);
+    bool write(std::ostream& out);
+    size_t size( ) const;
+    const std::string& error( ) const { return failure; }
+private:
+    enum { TEXT, DATA, MANY_SECTIONS };
+
+    // A place in a section: its offset among the bytes that are already
+    // encoded, and (in .text) how many jumps come before it, since the
+    // size of each jump is not known until the end.
+    struct place
+    {
+	int section;
+	size_t offset;
+	size_t jumps;
+    };
+    struct symbol
+    {
+	std::string name;
+	bool defined;
+	bool global;
+	place where;
+	int index;           // Its index in the symbol table of the file
+    };
+    // Four bytes that hold the address of a symbol (plus the addend that
+    // the bytes already hold), or its distance from the end of the bytes:
+    struct fixup
+    {
+	place where;
+	int target;          // The symbol
+	bool relative;
+    };
+    struct jump
+    {
+	size_t offset;       // Where it is among the bytes of .text
+	int opcode;
+	int target;          // The symbol
+	bool is_long;
+    };
+
+    std::vector<unsigned char> bytes[MANY_SECTIONS];
+    std::vector<symbol> symbols;
+    std::map<std::string, int> symbol_index;
+    std::vector<fixup> fixups;
+    std::vector<jump> jumps;
+    std::vector<size_t> jump_sizes;     // Total size of the first k jumps
+    int section;                        // The current section
+    int rept_count;                     // The count of an open .rept, or -1
+    std::string rept_text;              // The lines of an open .rept
+    std::string partial;                // A line of raw text with no '\n' yet
+    std::string failure;
+
+    int symbol_of(const std::string& name);
+    int symbol_of(const asm_list& code, const asm_operand& op, int label_base);
+    place here( ) const;
+    size_t address(const place& p) const;
+    void define(int s);
+    void byte(int b) { bytes[section].push_back((unsigned char) b); }
+    void word(int w);
+    void fail(const std::string& message);
+    void text(const char* s, size_t n);
+    void line(const std::string& s);
+    void directive(const std::string& name, const std::string& rest);
+    void instruction(const std::string& mnemonic, const std::string& rest);
+    bool encode(const asm_list& code, const asm_instruction& p, int label_base);
+    void modrm(int reg, const asm_list& code, const asm_operand& op, int label_base);
+    void immediate(const asm_list& code, const asm_operand& op, int label_base);
+    void relax( );
+    elf_object(const elf_object&);
+    void operator =(const elf_object&);
+};
+#endif
@@ -0,0 +1,445 @@
+// File: cu.peephole.cxx
+// Version: Oct 18, 2026
+// This is the implementation file for the peephole optimizer of the CU
+// code generator (see cu.peephole.h).
+
+#include <cstddef>       // Provides size_t, NULL
+#include <cstring>       // Provides strcmp
+#include "cu.ir.h"       // Provides the asm_list class
+#include "cu.peephole.h"
+using namespace std;
+
+// How many records a pattern looks ahead, at most:
+const size_t WINDOW = 32;
+
+// How many records the optimizer goes back after a change, since a change
+// can complete a pattern that starts just before it:
+const size_t BACK = 2;
+
+//----------------------------------------------------------------------------
+// Facts about operands and records.  The registers are compared by their
+// whole names, so %ax is %eax.
+static int whole(int r)
+{
+    return (r == AX) ? EAX : r;
+}
+
+static bool uses(const asm_operand& op, int r)
+// Whether the operand is the register r, or an address that is computed
+// from it.
+{
+    if (op.kind != REGISTER_OPERAND && op.kind != MEMORY_OPERAND)
+	return false;
+    return whole(op.base) == r || (op.index != NO_REGISTER && whole(op.index) == r);
+}
+
+static bool is_memory(const asm_operand& op)
+{
+    return op.kind == MEMORY_OPERAND || op.kind == SYMBOL_MEMORY_OPERAND
+	|| op.kind == SYMBOL_PLUS_OPERAND;
+}
+
+static bool is_global(const asm_operand& op)
+{
+    return op.kind == SYMBOL_MEMORY_OPERAND || op.kind == SYMBOL_PLUS_OPERAND;
+}
+
+static bool is_source(const asm_operand& op)
+// Whether the operand may be the source of a movl (and does not depend on
+// %esp).
+{
+    switch (op.kind)
+    {
+    case REGISTER_OPERAND:
+    case IMMEDIATE_OPERAND:
+    case MEMORY_OPERAND:
+    case ADDRESS_OPERAND:
+    case ADDRESS_PLUS_OPERAND:
+    case SYMBOL_MEMORY_OPERAND:
+    case SYMBOL_PLUS_OPERAND:
+	return !uses(op, ESP);
+    default:
+	return false;
+    }
+}
+
+static bool is_destination(const asm_operand& op)
+// Whether the operand may be the destination of a movl (and does not
+// depend on %esp).
+{
+    return (op.kind == REGISTER_OPERAND || is_memory(op)) && !uses(op, ESP);
+}
+
+static bool is_immediate(const asm_operand& op, int value)
+{
+    return op.kind == IMMEDIATE_OPERAND && op.symbol == 0 && op.value == value;
+}
+
+static bool same(const asm_list& code, const asm_operand& a, const asm_operand& b)
+{
+    return a.kind == b.kind && a.base == b.base && a.index == b.index
+	&& a.scale == b.scale && a.value == b.value && a.label == b.label
+	&& strcmp(code.text(a.symbol), code.text(b.symbol)) == 0;
+}
+
+static bool is_instruction(const asm_instruction& x)
+{
+    return x.opcode > OP_LONG;
+}
+
+static bool is_jump(const asm_instruction& x)
+{
+    return x.opcode >= OP_JMP && x.opcode <= OP_JLE;
+}
+
+static bool is_blank(const asm_list& code, const asm_instruction& x)
+// Whether the record is raw text with nothing but white space.
+{
+    const char* s = code.text(x.op1.symbol);
+    int i;
+
+    if (x.opcode != OP_TEXT)
+	return false;
+    for (i = 0; i < x.op1.value; ++i)
+    {
+	if (s[i] != ' ' && s[i] != '\t' && s[i] != '\n')
+	    return false;
+    }
+    return true;
+}
+
+static bool touches_stack(const asm_instruction& x)
+// Whether the instruction moves %esp, or reads or writes through it.
+{
+    switch (x.opcode)
+    {
+    case OP_CALL:
+    case OP_POPL:
+    case OP_PUSHL:
+    case OP_RET:
+    case OP_PUSHA:
+    case OP_POPA:
+	return true;
+    default:
+	return uses(x.op1, ESP) || uses(x.op2, ESP)
+	    || x.op1.kind == TEXT_OPERAND || x.op2.kind == TEXT_OPERAND;
+    }
+}
+
+static bool flags_dead(const asm_list& code, size_t i)
+// Whether the flags are set again, from the record at index i on, before
+// any instruction reads them.  A label does not change this, since the
+// code after it runs next; a jump might go somewhere that reads them.
+{
+    for ( ; i < code.size( ); ++i)
+    {
+	if (is_blank(code, code[i]))
+	    continue;
+	switch (code[i].opcode)
+	{
+	case OP_ADDL:
+	case OP_CALL:        // The flags are not kept across a call
+	case OP_CMPL:
+	case OP_NEGL:
+	case OP_SUBL:
+	case OP_UCOMISS:
+	case OP_XORL:
+	    return true;
+	case OP_ADDSD: case OP_ADDSS: case OP_CVTSD2SS: case OP_CVTSI2SD:
+	case OP_CVTSI2SS: case OP_CVTSS2SD: case OP_CVTSS2SI: case OP_DIVSD:
+	case OP_DIVSS: case OP_MOVSD: case OP_MOVSS: case OP_MULSD:
+	case OP_MULSS: case OP_SUBSD: case OP_SUBSS: case OP_XORPS:
+	case OP_CDQ:
+	case OP_FADD: case OP_FCHS: case OP_FCOMPP: case OP_FDIV:
+	case OP_FIADD: case OP_FIDIV: case OP_FIDIVR: case OP_FILD:
+	case OP_FIMUL: case OP_FISTPL: case OP_FISUB: case OP_FISUBR:
+	case OP_FLD: case OP_FLDZ: case OP_FMUL: case OP_FNINIT:
+	case OP_FNSTSW: case OP_FSTP: case OP_FSTPL: case OP_FSUB:
+	case OP_LABEL:
+	case OP_MOVL:
+	case OP_POPL:
+	case OP_PUSHL:
+	    break;
+	default:             // Reads the flags, sets only some of them, or
+	    return false;    // is a jump or raw text
+	}
+    }
+    return false;
+}
+
+static bool writes(const asm_operand& dest, int r)
+// Whether writing to dest may change register r or a global variable.
+// The frame (at %ebp or %esp) never holds a global variable.
+{
+    if (dest.kind == REGISTER_OPERAND)
+	return whole(dest.base) == r;
+    if (dest.kind == MEMORY_OPERAND)
+	return dest.index != NO_REGISTER || (dest.base != EBP && dest.base != ESP);
+    return true;
+}
+
+static bool clobbers(const asm_instruction& x, int r)
+// Whether the instruction may change register r or a global variable (or
+// go somewhere else).
+{
+    switch (x.opcode)
+    {
+    case OP_ADDL:
+    case OP_CVTSS2SI:
+    case OP_MOVL:
+    case OP_MOVSD:
+    case OP_MOVSS:
+    case OP_SHLL:
+    case OP_SHRL:
+    case OP_SUBL:
+    case OP_XORL:
+	return writes(x.op2, r);
+    case OP_IMULL:
+	if (x.op2.kind != NO_OPERAND)
+	    return writes(x.op2, r);
+	return r == EAX || r == EDX;
+    case OP_DECL:
+    case OP_FISTPL:
+    case OP_FSTP:
+    case OP_FSTPL:
+    case OP_INCL:
+    case OP_NEGL:
+    case OP_POPL:
+	return writes(x.op1, r);
+    case OP_CDQ:
+	return r == EDX;
+    case OP_IDIVL:
+	return r == EAX || r == EDX;
+    case OP_FNSTSW:
+	return r == EAX;
+    case OP_CMPL:
+    case OP_PUSHL:
+    case OP_FADD: case OP_FCHS: case OP_FCOMPP: case OP_FDIV:
+    case OP_FIADD: case OP_FIDIV: case OP_FIDIVR: case OP_FILD:
+    case OP_FIMUL: case OP_FISUB: case OP_FISUBR: case OP_FLD:
+    case OP_FLDZ: case OP_FMUL: case OP_FNINIT: case OP_FSUB:
+    case OP_SAHF:
+    case OP_ADDSD: case OP_ADDSS: case OP_CVTSD2SS: case OP_CVTSI2SD:
+    case OP_CVTSI2SS: case OP_CVTSS2SD: case OP_DIVSD: case OP_DIVSS:
+    case OP_MULSD: case OP_MULSS: case OP_SUBSD: case OP_SUBSS:
+    case OP_UCOMISS: case OP_XORPS: // No general register, no memory
+	return false;
+    default:
+	return true;
+    }
+}
+
+static asm_instruction move(const asm_instruction& x, const asm_operand& from, const asm_operand& to)
+// A movl from one operand to another, with the comment of x.
+{
+    asm_instruction answer = x;
+
+    answer.opcode = OP_MOVL;
+    answer.layout = ASM_COLUMNS;
+    answer.op1 = from;
+    answer.op2 = to;
+    return answer;
+}
+
+static asm_operand immediate(int value)
+{
+    asm_operand answer = { IMMEDIATE_OPERAND, 0, 0, 0, value, 0, 0 };
+    return answer;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// The patterns.  Each one looks at the records from index i on, and if
+// they match, it changes them and returns true.
+static bool push_pop(asm_list& code, size_t i)
+{
+    asm_operand from, to;
+
+    if (i + 1 >= code.size( ) || code[i].opcode != OP_PUSHL || code[i+1].opcode != OP_POPL)
+	return false;
+    from = code[i].op1;
+    to = code[i+1].op1;
+    if (!is_source(from) || !is_destination(to))
+	return false;
+    if (same(code, from, to))
+    {
+	code.erase(i, i + 2);
+	return true;
+    }
+    if (is_memory(from) && is_memory(to))
+	return false;
+    code[i+1] = move(code[i+1], from, to);
+    code.erase(i, i + 1);
+    return true;
+}
+
+static bool push_move_pop(asm_list& code, size_t i)
+{
+    asm_operand from, to;
+
+    if (i + 2 >= code.size( ) || code[i].opcode != OP_PUSHL
+	|| code[i+1].opcode != OP_MOVL || code[i+2].opcode != OP_POPL)
+	return false;
+    from = code[i].op1;
+    to = code[i+2].op1;
+    if (!is_source(from) || to.kind != REGISTER_OPERAND || uses(to, ESP)
+	|| !is_source(code[i+1].op1) || code[i+1].op2.kind != REGISTER_OPERAND
+	|| uses(code[i+1].op2, ESP)
+	|| uses(code[i+1].op1, whole(to.base))
+	|| whole(code[i+1].op2.base) == whole(to.base))
+	return false;
+    code[i] = move(code[i+2], from, to);
+    code.erase(i + 2, i + 3);
+    return true;
+}
+
+static bool push_false(asm_list& code, size_t i)
+{
+    size_t j, k;
+    asm_operand to;
+
+    if (code[i].opcode != OP_PUSHL || !is_immediate(code[i].op1, 0))
+	return false;
+    // The code of the comparison must not use the stack:
+    for (j = i + 1; j < code.size( ) && j <= i + WINDOW; ++j)
+    {
+	if (is_jump(code[j]) || !is_instruction(code[j]) || touches_stack(code[j]))
+	    break;
+    }
+    if (j + 3 >= code.size( ) || !is_jump(code[j]) || code[j].opcode == OP_JMP
+	|| code[j].op1.kind != LABEL_OPERAND
+	|| code[j+1].opcode != OP_XORL || !is_immediate(code[j+1].op1, 1)
+	|| code[j+1].op2.kind != MEMORY_OPERAND || code[j+1].op2.base != ESP
+	|| code[j+1].op2.index != NO_REGISTER || code[j+1].op2.value != 0
+	|| code[j+2].opcode != OP_LABEL || !same(code, code[j+2].op1, code[j].op1)
+	|| code[j+3].opcode != OP_POPL || !is_destination(code[j+3].op1))
+	return false;
+    for (k = 0; k < code.size( ); ++k)
+    {   // The label must be for this jump alone:
+	if (k != j && is_jump(code[k]) && same(code, code[k].op1, code[j].op1))
+	    return false;
+    }
+    to = code[j+3].op1;
+    for (k = i; k + 1 < j; ++k)
+	code[k] = code[k+1];
+    code[j-1] = move(code[j+3], immediate(0), to);
+    code[j+1] = move(code[j+3], immediate(1), to);
+    code.erase(j + 3, j + 4);
+    return true;
+}
+
+static bool add_zero(asm_list& code, size_t i)
+{
+    if ((code[i].opcode != OP_ADDL && code[i].opcode != OP_SUBL)
+	|| !is_immediate(code[i].op1, 0) || !flags_dead(code, i + 1))
+	return false;
+    code.erase(i, i + 1);
+    return true;
+}
+
+static bool self_move(asm_list& code, size_t i)
+{
+    if (code[i].opcode != OP_MOVL || code[i].op1.kind != REGISTER_OPERAND
+	|| code[i].op2.kind != REGISTER_OPERAND || code[i].op1.base != code[i].op2.base)
+	return false;
+    code.erase(i, i + 1);
+    return true;
+}
+
+static bool jump_next(asm_list& code, size_t i)
+{
+    size_t j;
+
+    if (!is_jump(code[i]))
+	return false;
+    for (j = i + 1; j < code.size( ) && is_blank(code, code[j]); ++j)
+	;
+    if (j == code.size( ) || code[j].opcode != OP_LABEL || !same(code, code[i].op1, code[j].op1))
+	return false;
+    code.erase(i, i + 1);
+    return true;
+}
+
+static bool repeated_load(asm_list& code, size_t i)
+{
+    size_t j;
+    int r;
+
+    if (code[i].opcode != OP_MOVL || !is_global(code[i].op1)
+	|| code[i].op2.kind != REGISTER_OPERAND || code[i].op2.base == ESP)
+	return false;
+    r = whole(code[i].op2.base);
+    for (j = i + 1; j < code.size( ) && j <= i + WINDOW; ++j)
+    {
+	if (code[j].opcode == OP_MOVL && same(code, code[j].op1, code[i].op1)
+	    && code[j].op2.kind == REGISTER_OPERAND && code[j].op2.base != ESP)
+	{
+	    if (whole(code[j].op2.base) == r)
+		code.erase(j, j + 1);
+	    else
+		code[j].op1 = code[i].op2;
+	    return true;
+	}
+	if (clobbers(code[j], r))
+	    return false;
+    }
+    return false;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// The table of the patterns, in the order of the constants of cu.peephole.h:
+struct peephole_pattern
+{
+    const char* name;
+    bool (*apply)(asm_list& code, size_t i);
+};
+
+static const peephole_pattern patterns[MANY_PEEPHOLE_PATTERNS] =
+{
+    { "push-pop", push_pop },
+    { "push-move-pop", push_move_pop },
+    { "push-false", push_false },
+    { "add-zero", add_zero },
+    { "self-move", self_move },
+    { "jump-next", jump_next },
+    { "repeated-load", repeated_load }
+};
+
+const char* peephole_name(int pattern)
+{
+    return patterns[pattern].name;
+}
+
+void peephole(asm_list& code, long hits[ ])
+{
+    bool changed = true;
+    size_t i;
+    int k;
+
+    while (changed)
+    {
+	changed = false;
+	i = 0;
+	while (i < code.size( ))
+	{
+	    for (k = 0; k < MANY_PEEPHOLE_PATTERNS; ++k)
+	    {
+		if (patterns[k].apply(code, i))
+		    break;
+	    }
+	    if (k == MANY_PEEPHOLE_PATTERNS)
+		++i;
+	    else
+	    {
+		changed = true;
+		if (hits != NULL)
+		    ++hits[k];
+		i = (i > BACK) ? i - BACK : 0;
+	    }
+	}
+    }
+}
+//----------------------------------------------------------------------------
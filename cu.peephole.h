@@ -0,0 +1,62 @@
+// File: cu.peephole.h
+// Version: Oct 18, 2026
+// This file provides the peephole optimizer of the CU code generator,
+// which runs over the instruction list of each function (see cu.ir.h)
+// just before the list is printed (cu -O1, which is the default; cu -O0
+// prints the lists as they were generated).  The optimizer looks at a few
+// records at a time and puts shorter or cheaper code in their place, with
+// the same effect on the registers, the memory and the flags that the
+// rest of the code reads.  Its patterns are in a table, in the order in
+// which they are tried at each record:
+//   push-pop           pushl X / popl Y becomes movl X, Y (or nothing,
+//                      if X is Y), unless both are in memory;
+//   push-move-pop      pushl X / movl Z, R1 / popl R2 becomes
+//                      movl X, R2 / movl Z, R1 (the stack code of a binary
+//                      operator, once its right operand is a movl);
+//   push-false         the pushl $0 of a comparison, whose 0 is flipped to
+//                      1 when the jump is not taken and then popped, becomes
+//                      a movl $0 and a movl $1 straight to where it is
+//                      popped;
+//   add-zero           addl $0 or subl $0, when the flags that it sets are
+//                      not read before they are set again;
+//   self-move          movl R, R;
+//   jump-next          a jump to the label that comes right after it;
+//   repeated-load      a second load of the same global variable, when
+//                      the register of the first load still holds it,
+//                      becomes a move from that register.
+// None of the patterns moves code across a label, a call or raw text, or
+// changes an instruction whose operand depends on %esp.  To add a
+// pattern, give it a constant before MANY_PEEPHOLE_PATTERNS and a row of
+// the table in cu.peephole.cxx.
+//
+// CONSTANTS: PEEP_PUSH_POP, PEEP_PUSH_MOVE_POP, PEEP_PUSH_FALSE,
+// PEEP_ADD_ZERO, PEEP_SELF_MOVE, PEEP_JUMP_NEXT and PEEP_REPEATED_LOAD are
+// the patterns, and there are MANY_PEEPHOLE_PATTERNS of them.
+//
+// FUNCTIONS for the peephole optimizer:
+//   const char* peephole_name(int pattern)
+//     Precondition: 0 <= pattern < MANY_PEEPHOLE_PATTERNS.
+//     Postcondition: The return value is the name of the pattern (as
+//     above), for the time report.
+//
+//   void peephole(asm_list& code, long hits[ ] = NULL)
+//     Postcondition: The patterns have been applied to the records of code
+//     until none of them applies anywhere.  If hits is not NULL, then it
+//     has MANY_PEEPHOLE_PATTERNS counters, and each time that a pattern
+//     was applied, its counter has been increased by one.
+
+#ifndef CU_PEEPHOLE_H
+#define CU_PEEPHOLE_H
+#include <cstddef>       // Provides NULL
+#include "cu.ir.h"       // Provides the asm_list class
+
+enum
+{
+    PEEP_PUSH_POP, PEEP_PUSH_MOVE_POP, PEEP_PUSH_FALSE, PEEP_ADD_ZERO,
+    PEEP_SELF_MOVE, PEEP_JUMP_NEXT, PEEP_REPEATED_LOAD,
+    MANY_PEEPHOLE_PATTERNS
+};
+
+const char* peephole_name(int pattern);
+void peephole(asm_list& code, long hits[ ] = NULL);
+#endif
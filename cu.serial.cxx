@@ -0,0 +1,644 @@
+// File: cu.serial.cxx
+// Version: Oct 18, 2026
+// This is the implementation file for the binary tree files (see
+// cu.serial.h).
+
+#include <cstddef>       // Provides size_t, NULL
+#include <cstring>       // Provides memcmp, memcpy
+#include <fstream>       // Provides ofstream
+#include <map>           // Provides map class
+#include <string>        // Provides string class
+#include <vector>        // Provides vector class
+#include "intern.h"      // Provides intern
+#include "mapped.h"      // Provides the mapped_file class
+#include "tree.h"        // Provides the tree class
+#include "cu.tab.h"      // Provides the token numbers
+#include "cu.enum.h"     // Provides lhs, rhs
+#include "cu.types.h"    // Provides the cu_type struct
+#include "cu.serial.h"   // Provides save_tree, load_tree
+using namespace std;
+using namespace colorado;
+
+//----------------------------------------------------------------------------
+// The attributes that a file can hold, in the order of the bits of a node's
+// mask.
+enum value_kind { INT_VALUE, BOOL_VALUE, LHS_VALUE, RHS_VALUE, TREE_VALUE, TYPE_VALUE };
+struct field_info
+{
+    const char* key;
+    value_kind kind;
+};
+static const field_info fields[ ] =
+{
+    { "Addressable", BOOL_VALUE }, { "Bytes", INT_VALUE },
+    { "Constant", INT_VALUE }, { "Definition", TREE_VALUE }, { "Depth", INT_VALUE },
+    { "Errors", INT_VALUE }, { "Kind", LHS_VALUE }, { "LHS", LHS_VALUE },
+    { "Line", INT_VALUE }, { "Offset", INT_VALUE }, { "RHS", RHS_VALUE },
+    { "Reference", BOOL_VALUE }, { "Token", INT_VALUE },
+    { "Type", TYPE_VALUE }
+};
+const int MANY_FIELDS = sizeof(fields) / sizeof(fields[0]);
+
+// The parts of a file (see cu.serial.h):
+const char MAGIC[8] = { 'C', 'U', 't', 'r', 'e', 'e', '\r', '\n' };
+const int VERSION = 2;
+struct file_header
+{
+    char magic[8];
+    int version;
+    int many_strings;
+    int string_bytes;     // Rounded up to a multiple of four
+    int many_types;
+    int many_nodes;
+    int node_bytes;       // Rounded up to a multiple of four
+    unsigned int checksum;  // Of everything after the header
+};
+struct type_record
+{
+    int format;           // TYPENAME, ARRAY or POINTER
+    int name;             // String index for a TYPENAME, otherwise -1
+    int element;          // Type index for ARRAY or POINTER, otherwise -1
+};
+
+// One node of the node list, as it is written and read:
+struct node_fields
+{
+    unsigned int label;          // String index
+    unsigned int many_children;
+    unsigned int present;        // Bit f is set if fields[f] is attached
+    int values[MANY_FIELDS];     // Only the present values are written
+};
+
+// checksum(data, n) is a simple hash of n bytes (a multiple of four), which
+// catches a file that was damaged after it was written.
+static unsigned int checksum(const char* data, size_t n)
+{
+    unsigned int answer = 0;
+    unsigned int word;
+    size_t i;
+
+    for (i = 0; i < n; i += 4)
+    {
+	memcpy(&word, data + i, 4);
+	answer = (answer ^ word) * 16777619u;
+    }
+    return answer;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// The node list is a string of bytes.  Each number in it is written in
+// seven-bit groups, low group first, with the high bit of each byte set if
+// another byte follows; so most numbers take only one or two bytes.  The
+// values of fields are signed (a NULL Definition or Type is -1), and so they
+// are first mapped 0, -1, 1, -2, 2... to 0, 1, 2, 3, 4...  An int field is
+// written as the difference from its value in the previous node that had
+// it, since neighbouring nodes mostly have the same or nearby Line, Depth
+// and Offset.
+static void put_number(string& out, unsigned int n)
+{
+    while (n >= 0x80)
+    {
+	out += char((n & 0x7F) | 0x80);
+	n >>= 7;
+    }
+    out += char(n);
+}
+
+static void put_node(string& out, const node_fields& node, int previous[ ])
+{
+    unsigned int value;
+    int f;
+
+    put_number(out, node.label);
+    put_number(out, node.many_children);
+    put_number(out, node.present);
+    for (f = 0; f < MANY_FIELDS; ++f)
+    {
+	if ((node.present & (1u << f)) == 0)
+	    continue;
+	value = node.values[f];
+	if (fields[f].kind == INT_VALUE)
+	{
+	    value -= previous[f];
+	    previous[f] = node.values[f];
+	}
+	put_number(out, (int(value) < 0) ? ~(value << 1) : (value << 1));
+    }
+}
+
+// A node_reader reads the node list.  read_number and read_node return
+// false if the list ends too soon or a number is too long.
+class node_reader
+{
+public:
+    node_reader(const char* start, size_t n);
+    bool read_number(unsigned int& n);
+    bool read_node(node_fields& node);
+    bool at_end( ) const;
+private:
+    const unsigned char* next;
+    const unsigned char* end;
+    int previous[MANY_FIELDS];   // The last value of each int field
+};
+
+node_reader::node_reader(const char* start, size_t n)
+    : next((const unsigned char*) start), end((const unsigned char*) start + n)
+{
+    int f;
+
+    for (f = 0; f < MANY_FIELDS; ++f)
+	previous[f] = 0;
+}
+
+bool node_reader::read_number(unsigned int& n)
+{
+    int shift;
+
+    n = 0;
+    for (shift = 0; shift < 35; shift += 7)
+    {
+	if (next == end)
+	    return false;
+	n |= (unsigned int)(*next & 0x7F) << shift;
+	if ((*next++ & 0x80) == 0)
+	    return true;
+    }
+    return false;
+}
+
+bool node_reader::read_node(node_fields& node)
+{
+    unsigned int n;
+    int f;
+
+    if (!read_number(node.label) || !read_number(node.many_children)
+	|| !read_number(node.present) || (node.present >> MANY_FIELDS) != 0)
+	return false;
+    for (f = 0; f < MANY_FIELDS; ++f)
+    {
+	if ((node.present & (1u << f)) == 0)
+	    continue;
+	if (!read_number(n))
+	    return false;
+	n = (n & 1) ? ~(n >> 1) : (n >> 1);
+	if (fields[f].kind == INT_VALUE)
+	{
+	    n += previous[f];
+	    previous[f] = int(n);
+	}
+	node.values[f] = int(n);
+    }
+    return true;
+}
+
+bool node_reader::at_end( ) const
+{   // Only the zero bytes that round the list up to a multiple of four:
+    const unsigned char* p;
+
+    for (p = next; p != end; ++p)
+	if (*p != 0)
+	    return false;
+    return true;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// A tree_writer collects the tables of one file.  Strings and types are
+// numbered in order of their first use, and nodes in preorder.
+class tree_writer
+{
+public:
+    bool collect(const tree* root);
+    bool write(const string& filename) const;
+private:
+    int add_string(const string* s);
+    int add_type(const cu_type* t);
+
+    map<const string*, int> string_index;
+    vector<const string*> strings;
+    map<const cu_type*, int> type_index;
+    vector<type_record> types;
+    map<const tree*, int> node_index;
+    string nodes;
+    int previous[MANY_FIELDS];   // The last value of each int field
+};
+
+int tree_writer::add_string(const string* s)
+{
+    map<const string*, int>::iterator it = string_index.find(s);
+
+    if (it != string_index.end( ))
+	return it->second;
+    string_index[s] = strings.size( );
+    strings.push_back(s);
+    return strings.size( ) - 1;
+}
+
+int tree_writer::add_type(const cu_type* t)
+{
+    map<const cu_type*, int>::iterator it;
+    type_record record;
+
+    if (t == NULL)
+	return -1;
+    it = type_index.find(t);
+    if (it != type_index.end( ))
+	return it->second;
+
+    // The name or element type is recorded before the type itself:
+    record.format = t->format;
+    record.name = (t->name == NULL) ? -1 : add_string(t->name);
+    record.element = add_type(t->element);
+    type_index[t] = types.size( );
+    types.push_back(record);
+    return types.size( ) - 1;
+}
+
+bool tree_writer::collect(const tree* root)
+{
+    vector<const tree*> order;   // The nodes in preorder
+    vector<const tree*> pending; // Stack of nodes still to be numbered
+    map<const tree*, int>::iterator it;
+    const tree* p;
+    const tree* definition;
+    node_fields node;
+    size_t i, j;
+    int f, many_found;
+
+    // Number the nodes in preorder (without recursion), so that Definition
+    // attributes can refer to nodes that come later:
+    pending.push_back(root);
+    while (!pending.empty( ))
+    {
+	p = pending.back( );
+	pending.pop_back( );
+	node_index[p] = order.size( );
+	order.push_back(p);
+	for (j = p->many_children( ); j > 0; --j)
+	    pending.push_back(p->child(j-1));
+    }
+
+    for (f = 0; f < MANY_FIELDS; ++f)
+	previous[f] = 0;
+
+    for (i = 0; i < order.size( ); ++i)
+    {
+	p = order[i];
+	node.label = add_string(&(p->label( )));
+	node.many_children = p->many_children( );
+	node.present = 0;
+	many_found = 0;
+	for (f = 0; f < MANY_FIELDS; ++f)
+	{
+	    const string key = fields[f].key;
+	    bool found = false;
+	    int value = 0;
+
+	    switch (fields[f].kind)
+	    {
+	    case INT_VALUE:
+		if ((found = p->is_attribute<int>(key)))
+		    value = p->attribute<int>(key);
+		break;
+	    case BOOL_VALUE:
+		if ((found = p->is_attribute<bool>(key)))
+		    value = p->attribute<bool>(key);
+		break;
+	    case LHS_VALUE:
+		if ((found = p->is_attribute<lhs>(key)))
+		    value = p->attribute<lhs>(key);
+		break;
+	    case RHS_VALUE:
+		if ((found = p->is_attribute<rhs>(key)))
+		    value = p->attribute<rhs>(key);
+		break;
+	    case TREE_VALUE:
+		if ((found = p->is_attribute<const tree*>(key)))
+		{
+		    definition = p->attribute<const tree*>(key);
+		    value = -1;
+		    if (definition != NULL)
+		    {   // A definition must be a node of the same tree:
+			it = node_index.find(definition);
+			if (it == node_index.end( ))
+			    return false;
+			value = it->second;
+		    }
+		}
+		break;
+	    case TYPE_VALUE:
+		if ((found = p->is_attribute<const cu_type*>(key)))
+		    value = add_type(p->attribute<const cu_type*>(key));
+		break;
+	    }
+	    node.values[f] = value;
+	    if (found)
+	    {
+		node.present |= (1u << f);
+		++many_found;
+	    }
+	}
+
+	// Any other attribute cannot be written:
+	if (size_t(many_found) != p->many_attributes( ))
+	    return false;
+	put_node(nodes, node, previous);
+    }
+    return true;
+}
+
+bool tree_writer::write(const string& filename) const
+{
+    ofstream out(filename.c_str( ), ios::out | ios::binary | ios::trunc);
+    file_header header;
+    vector<int> offsets;
+    string bytes;
+    string body;          // Everything after the header
+    size_t i;
+
+    for (i = 0; i < strings.size( ); ++i)
+    {
+	offsets.push_back(bytes.size( ));
+	bytes += *strings[i];
+    }
+    offsets.push_back(bytes.size( ));
+    bytes.resize((bytes.size( ) + 3) / 4 * 4, '\0');
+
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.many_strings = strings.size( );
+    header.string_bytes = bytes.size( );
+    header.many_types = types.size( );
+    header.many_nodes = node_index.size( );
+    header.node_bytes = (nodes.size( ) + 3) / 4 * 4;
+
+    body.append((const char*) &(offsets[0]), offsets.size( ) * sizeof(int));
+    body.append(bytes);
+    if (!types.empty( ))
+	body.append((const char*) &(types[0]), types.size( ) * sizeof(type_record));
+    body.append(nodes);
+    body.resize(body.size( ) + header.node_bytes - nodes.size( ), '\0');
+    header.checksum = checksum(body.data( ), body.size( ));
+
+    out.write((const char*) &header, sizeof(header));
+    out.write(body.data( ), body.size( ));
+    out.close( );
+    return !out.fail( );
+}
+
+bool save_tree(const tree* root, const string& filename)
+{
+    tree_writer writer;
+
+    return writer.collect(root) && writer.write(filename);
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// The parts of a file that is in memory.  is_valid(file, parts) finds the
+// parts and checks that every size, index and value in them is in range,
+// and that the node list is exactly one tree in preorder.  So load_tree can
+// build the tree without any further checks.
+struct file_parts
+{
+    const file_header* header;
+    const int* offsets;
+    const char* bytes;
+    const type_record* types;
+    const char* nodes;
+};
+
+// take(remaining, many, size) removes many items of the given size from the
+// remaining bytes, and returns false if there are not enough bytes.
+static bool take(size_t& remaining, int many, size_t size)
+{
+    if (many < 0 || size_t(many) > remaining / size)
+	return false;
+    remaining -= many * size;
+    return true;
+}
+
+// is_valid_node(node, header) checks the indexes and values of one node.
+static bool is_valid_node(const node_fields& node, const file_header* header)
+{
+    int f, value;
+
+    if (node.label >= (unsigned int) header->many_strings
+	|| node.many_children >= (unsigned int) header->many_nodes)
+	return false;
+    for (f = 0; f < MANY_FIELDS; ++f)
+    {
+	if ((node.present & (1u << f)) == 0)
+	    continue;
+	value = node.values[f];
+	switch (fields[f].kind)
+	{
+	case TREE_VALUE:
+	    if (value < -1 || value >= header->many_nodes)
+		return false;
+	    break;
+	case TYPE_VALUE:
+	    if (value < -1 || value >= header->many_types)
+		return false;
+	    break;
+	case LHS_VALUE:
+	    if (value < ILLEGAL_NONTERMINAL || value > vardefn__)
+		return false;
+	    break;
+	case RHS_VALUE:
+	    if (value < ILLEGAL_RHS
+		|| value > __typeexpr_IDENTIFIER_IS_INITIALLY_expr_SEMICOLON)
+		return false;
+	    break;
+	default:
+	    break;
+	}
+    }
+    return true;
+}
+
+static bool is_valid(const mapped_file& file, file_parts& parts)
+{
+    const file_header* header = (const file_header*) file.data( );
+    size_t remaining;
+    vector<unsigned int> unread;  // Children still to come, for each open node
+    node_fields node;
+    int i;
+
+    if (file.size( ) < sizeof(file_header)
+	|| memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0
+	|| header->version != VERSION
+	|| header->string_bytes % 4 != 0 || header->node_bytes % 4 != 0
+	|| header->many_nodes < 1)
+	return false;
+    remaining = file.size( ) - sizeof(file_header);
+    if (!take(remaining, header->many_strings, sizeof(int))
+	|| !take(remaining, 1, sizeof(int))
+	|| !take(remaining, header->string_bytes, 1)
+	|| !take(remaining, header->many_types, sizeof(type_record))
+	|| !take(remaining, header->node_bytes, 1)
+	|| remaining != 0)
+	return false;
+    if (header->checksum != checksum((const char*) (header + 1),
+				     file.size( ) - sizeof(file_header)))
+	return false;
+
+    parts.header = header;
+    parts.offsets = (const int*) (header + 1);
+    parts.bytes = (const char*) (parts.offsets + header->many_strings + 1);
+    parts.types = (const type_record*) (parts.bytes + header->string_bytes);
+    parts.nodes = (const char*) (parts.types + header->many_types);
+
+    if (parts.offsets[0] != 0)
+	return false;
+    for (i = 0; i < header->many_strings; ++i)
+	if (parts.offsets[i+1] < parts.offsets[i]
+	    || parts.offsets[i+1] > header->string_bytes)
+	    return false;
+
+    for (i = 0; i < header->many_types; ++i)
+    {
+	if (parts.types[i].format == TYPENAME)
+	{
+	    if (parts.types[i].name < 0 || parts.types[i].name >= header->many_strings)
+		return false;
+	}
+	else if (parts.types[i].format == ARRAY || parts.types[i].format == POINTER)
+	{
+	    if (parts.types[i].element < 0 || parts.types[i].element >= i)
+		return false;
+	}
+	else
+	    return false;
+    }
+
+    // Every node after the first must be the child of an open node:
+    node_reader reader(parts.nodes, header->node_bytes);
+    for (i = 0; i < header->many_nodes; ++i)
+    {
+	if (i > 0)
+	{
+	    if (unread.empty( ))
+		return false;
+	    --unread.back( );
+	}
+	if (!reader.read_node(node) || !is_valid_node(node, header))
+	    return false;
+	unread.push_back(node.many_children);
+	while (!unread.empty( ) && unread.back( ) == 0)
+	    unread.pop_back( );
+    }
+    return unread.empty( ) && reader.at_end( );
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// A fix_up is a tree attribute of a node that refers to a later node.  It is
+// set when all of the nodes have been built.
+struct fix_up
+{
+    tree* node;
+    const char* key;
+    int target;
+};
+
+tree* load_tree(const string& filename)
+{
+    mapped_file file(filename);
+    file_parts parts;
+    vector<const string*> strings;
+    vector<const cu_type*> canonical;
+    vector<tree*> trees;
+    vector<tree*> parents;        // The open nodes, innermost last
+    vector<unsigned int> unread;  // Children still to come, for each open node
+    vector<fix_up> fix_ups;
+    fix_up later;
+    node_fields node;
+    tree* p;
+    int i, f, value;
+
+    if (!file.is_open( ) || !is_valid(file, parts))
+	return NULL;
+
+    // Each distinct string is interned once, and each type is looked up
+    // once, no matter how many nodes use it:
+    strings.resize(parts.header->many_strings);
+    for (i = 0; i < parts.header->many_strings; ++i)
+	strings[i] = &(intern(parts.bytes + parts.offsets[i],
+			      parts.offsets[i+1] - parts.offsets[i]));
+    canonical.resize(parts.header->many_types);
+    for (i = 0; i < parts.header->many_types; ++i)
+    {
+	if (parts.types[i].format == TYPENAME)
+	    canonical[i] = type_primitive(*strings[parts.types[i].name]);
+	else
+	    canonical[i] = type_plus(canonical[parts.types[i].element],
+				     parts.types[i].format);
+    }
+
+    // The nodes are built in one pass over the node list:
+    node_reader reader(parts.nodes, parts.header->node_bytes);
+    trees.resize(parts.header->many_nodes);
+    for (i = 0; i < parts.header->many_nodes; ++i)
+    {
+	reader.read_node(node);
+	p = trees[i] = new tree;
+	p->set_interned_label(*strings[node.label]);
+	if (i > 0)
+	{
+	    parents.back( )->append_child(p);
+	    --unread.back( );
+	}
+	for (f = 0; f < MANY_FIELDS; ++f)
+	{
+	    if ((node.present & (1u << f)) == 0)
+		continue;
+	    value = node.values[f];
+	    switch (fields[f].kind)
+	    {
+	    case INT_VALUE:
+		p->set_attribute<int>(fields[f].key, value);
+		break;
+	    case BOOL_VALUE:
+		p->set_attribute<bool>(fields[f].key, value != 0);
+		break;
+	    case LHS_VALUE:
+		p->set_attribute<lhs>(fields[f].key, lhs(value));
+		break;
+	    case RHS_VALUE:
+		p->set_attribute<rhs>(fields[f].key, rhs(value));
+		break;
+	    case TREE_VALUE:
+		if (value < i)
+		    p->set_attribute<const tree*>(fields[f].key, value < 0 ? NULL : trees[value]);
+		else
+		{
+		    later.node = p;
+		    later.key = fields[f].key;
+		    later.target = value;
+		    fix_ups.push_back(later);
+		}
+		break;
+	    case TYPE_VALUE:
+		p->set_attribute<const cu_type*>(fields[f].key, value < 0 ? NULL : canonical[value]);
+		break;
+	    }
+	}
+	parents.push_back(p);
+	unread.push_back(node.many_children);
+	while (!unread.empty( ) && unread.back( ) == 0)
+	{
+	    parents.pop_back( );
+	    unread.pop_back( );
+	}
+    }
+    for (i = 0; i < int(fix_ups.size( )); ++i)
+	fix_ups[i].node->set_attribute<const tree*>(fix_ups[i].key, trees[fix_ups[i].target]);
+    return trees[0];
+}
+//----------------------------------------------------------------------------
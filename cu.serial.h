@@ -0,0 +1,50 @@
+// File: cu.serial.h
+// Version: Oct 18, 2026
+// This file provides a compact binary file format for a parse tree that
+// has been decorated by the traverser.  A program that has been parsed and
+// traversed once can be saved, and later the decorated tree can be loaded
+// again and given straight to the code generator without running the
+// lexer, the parser or the traverser.
+//
+// The file holds:
+//   1. A header with a magic number, a version, the sizes of the parts and
+//      a checksum of the rest of the file.
+//   2. A table of the distinct strings (labels) in the tree.
+//   3. A table of the distinct types (see cu.types.h) used by the tree.
+//      Each type refers to its name or its element type by index.
+//   4. The nodes in preorder.  Each node has the index of its label, its
+//      number of children, a bit mask of the attribute slots that are in
+//      use, and the value of each of those slots.  LHS, RHS, Kind and Token
+//      are stored as their enum or token numbers, Definition as a node index
+//      and Type as a type index.  The numbers of the nodes are written in
+//      seven-bit groups, so that most of them take one or two bytes.
+// All other numbers are 4-byte ints in the byte order of the machine that
+// wrote the file; the file is meant as a cache on that machine, not as an
+// exchange format.  Only the attributes that the lexer, parser and traverser
+// (with its constant folder) set are supported.
+//
+// FUNCTIONS:
+//   bool save_tree(const colorado::tree* root, const string& filename)
+//     Precondition: root is a whole tree that was decorated by traverse( ).
+//     Postcondition: If every attribute of the tree is one that this file
+//     format supports, then the tree has been written to the named file and
+//     the return value is true.  Otherwise (or if the file cannot be
+//     written) the return value is false.
+//
+//   colorado::tree* load_tree(const string& filename)
+//     Postcondition: If the named file holds a tree that was written by
+//     save_tree, then the return value is a new copy of that tree with all
+//     of its attributes.  Definition attributes point to the nodes of the
+//     new tree, and Type attributes point to the canonical types.  The new
+//     tree is built in the calling thread's current tree_arena (if any).
+//     If the file is missing or is not a valid tree file, then the return
+//     value is NULL.  The file is read through mmap where it is available.
+
+#ifndef CU_SERIAL_H
+#define CU_SERIAL_H
+#include <string>        // Provides string class
+#include "tree.h"        // Provides the colorado::tree class
+
+bool save_tree(const colorado::tree* root, const std::string& filename);
+colorado::tree* load_tree(const std::string& filename);
+#endif
@@ -0,0 +1,306 @@
+// File: cu.server.cxx
+// Version: Oct 18, 2026
+// This is the implementation file for the server mode of the CU compiler
+// (see cu.server.h).
+
+#include <cstddef>       // Provides size_t, NULL
+#include <cstring>       // Provides memcpy, strerror
+#include <iomanip>       // Provides setw, setprecision
+#include <iostream>      // Provides ostream
+#include <sstream>       // Provides istringstream, ostringstream
+#include <string>        // Provides string class
+#include <vector>        // Provides vector class
+#ifndef _WIN32
+#include <cerrno>        // Provides errno, EINTR
+#include <csignal>       // Provides signal, SIGPIPE
+#include <cstdlib>       // Provides atoi
+#include <poll.h>        // Provides poll, pollfd
+#include <pthread.h>     // Provides pthread_create, pthread_mutex_t
+#include <sys/socket.h>  // Provides socket, bind, listen, accept, setsockopt
+#include <sys/stat.h>    // Provides lstat, S_ISSOCK
+#include <sys/time.h>    // Provides gettimeofday
+#include <sys/un.h>      // Provides sockaddr_un
+#include <unistd.h>      // Provides read, write, close, unlink
+#endif
+#include "intern.h"      // Provides the intern_arena class
+#include "tree.h"        // Provides the tree_arena class
+#include "cu.compilation.h" // Provides the compilation struct and phases
+#include "cu.server.h"
+using namespace std;
+using namespace colorado;
+
+#ifdef _WIN32
+//----------------------------------------------------------------------------
+bool run_server(const string& path, int jobs, ostream& log)
+{
+    log << "There is no server mode on Windows." << endl;
+    return false;
+}
+//----------------------------------------------------------------------------
+#else
+//----------------------------------------------------------------------------
+// A client has this many seconds to send its whole request, and the reply
+// is dropped if the client does not take each part of it that fast, so
+// that a client cannot hold a worker thread forever:
+static const int CLIENT_SECONDS = 30;
+
+// What the worker threads of a server share:
+struct server_team
+{
+    int listener;            // The listening socket
+    ostream* log;
+    pthread_mutex_t log_lock; // Held while a line is written to the log
+    long many_requests;      // Requests answered so far
+};
+
+// Wall-clock time in seconds:
+static double now( )
+{
+    timeval t;
+
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec / 1e6;
+}
+
+// Reads from fd until the other side shuts down, and puts what was read
+// at the end of text.  The return value is false if reading failed, or if
+// the other side had not shut down by the deadline (a time from now( )).
+static bool read_all(int fd, vector<char>& text, double deadline)
+{
+    char chunk[64*1024];
+    pollfd ready;
+    double left;
+    ssize_t n;
+
+    for (;;)
+    {
+	left = deadline - now( );
+	if (left <= 0)
+	    return false;
+	ready.fd = fd;
+	ready.events = POLLIN;
+	n = poll(&ready, 1, int(1000*left) + 1);
+	if (n < 0 && errno == EINTR)
+	    continue;
+	if (n <= 0)
+	    return false;
+	n = read(fd, chunk, sizeof(chunk));
+	if (n == 0)
+	    return true;
+	if (n < 0 && errno != EINTR)
+	    return false;
+	if (n > 0)
+	    text.insert(text.end( ), chunk, chunk + n);
+    }
+}
+
+// Writes the n bytes at s to fd.  The return value is false if writing
+// failed (for example, because the client went away).
+static bool write_all(int fd, const char* s, size_t n)
+{
+    ssize_t written;
+
+    while (n > 0)
+    {
+	written = write(fd, s, n);
+	if (written < 0 && errno == EINTR)
+	    continue;
+	if (written <= 0)
+	    return false;
+	s += written;
+	n -= written;
+    }
+    return true;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// Answers the request on the connection fd, building the trees in arena.
+// The return value is the status of the reply (0 if the program compiled).
+// The calling thread's intern_arena must stay until the compilation (c) is
+// gone, since its symbol table holds interned names.
+static int answer(int fd, tree_arena& arena)
+{
+    vector<char> text;
+    ostringstream out;
+    ostringstream err;
+    ostringstream header;
+    compilation c(out, err);
+    istringstream options;
+    string word, assembly, errors;
+    size_t newline;
+    bool ok = false;
+
+    if (!read_all(fd, text, now( ) + CLIENT_SECONDS))
+	return 1;
+    for (newline = 0; newline < text.size( ) && text[newline] != '\n'; ++newline)
+	;
+    options.str(string(text.begin( ), text.begin( ) + newline));
+    while (options >> word)
+    {
+	if (word == "--compact")
+	    c.out.set_compact(true);
+	else if (word == "--threads" && options >> c.threads && c.threads > 0)
+	    ;
+	else if (word == "--registers")
+	    c.options |= REGISTER_EXPRESSIONS;
+	else if (word == "--sse")
+	    c.options |= SSE_FLOATS;
+	else if (word == "-O0")
+	    c.options &= ~OPTIMIZATIONS;
+	else if (word == "-O1")
+	    c.options |= OPTIMIZATIONS;
+	else
+	    err << "Unknown option in the request: " << word << endl;
+    }
+
+    if (newline == text.size( ))
+	err << "The request has no line of options." << endl;
+    else if (err.str( ).empty( ))
+    {   // The two bytes of padding end the text for the lexer:
+	text.push_back('\0');
+	text.push_back('\0');
+	tree_arena::set_current(&arena);
+	scan_in_place(c, &text[newline+1], text.size( ) - newline - 3);
+	if (!parse(c))
+	    err << "Parsing failed." << endl;
+	else
+	{
+	    traverse(c);
+	    if (c.root->attribute<int>("Errors") != 0)
+		err << "Errors in the traversal." << endl;
+	    else
+	    {
+		codegen(c, c.root);
+		ok = true;
+	    }
+	}
+	end_scan(c);
+	tree_arena::set_current(NULL);
+	arena.reset( );
+    }
+
+    if (ok)
+	assembly = out.str( );
+    errors = err.str( );
+    header << (ok ? 0 : 1) << ' ' << assembly.size( ) << ' ' << errors.size( ) << '\n';
+    if (write_all(fd, header.str( ).data( ), header.str( ).size( ))
+	&& write_all(fd, assembly.data( ), assembly.size( )))
+	write_all(fd, errors.data( ), errors.size( ));
+    return ok ? 0 : 1;
+}
+
+static void* serve(void* team_pointer)
+{
+    server_team* team = static_cast<server_team*>(team_pointer);
+    tree_arena arena;
+    intern_arena strings;   // The names of one request at a time
+    timeval timeout;
+    double start;
+    int fd, status;
+    long number;
+
+    for (;;)
+    {
+	fd = accept(team->listener, NULL, NULL);
+	if (fd < 0)
+	{
+	    if (errno == EINTR)
+		continue;
+	    pthread_mutex_lock(&team->log_lock);
+	    *team->log << "accept failed: " << strerror(errno) << endl;
+	    pthread_mutex_unlock(&team->log_lock);
+	    return NULL;
+	}
+	start = now( );
+	timeout.tv_sec = CLIENT_SECONDS;
+	timeout.tv_usec = 0;
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	// The strings of the request that are not in the shared pool go away
+	// with it, so the pool does not grow with each new program:
+	intern_arena::set_current(&strings);
+	status = answer(fd, arena);
+	intern_arena::set_current(NULL);
+	strings.release( );
+	close(fd);
+
+	pthread_mutex_lock(&team->log_lock);
+	number = ++team->many_requests;
+	*team->log << "request " << number << ": "
+		   << (status == 0 ? "compiled" : "failed") << " in "
+		   << fixed << setprecision(3) << 1000*(now( ) - start) << " ms"
+		   << endl;
+	pthread_mutex_unlock(&team->log_lock);
+    }
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+bool run_server(const string& path, int jobs, ostream& log)
+{
+    server_team team;
+    sockaddr_un address;
+    vector<pthread_t> threads;
+    struct stat old;     // Whatever is at path already
+    int i;
+
+    if (path.size( ) >= sizeof(address.sun_path))
+    {
+	log << "The socket name is too long: " << path << endl;
+	return false;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str( ), path.size( ) + 1);
+
+    // Only a socket (left by an earlier server) is replaced, never a file:
+    if (lstat(path.c_str( ), &old) == 0)
+    {
+	if (!S_ISSOCK(old.st_mode))
+	{
+	    log << "Cannot listen on " << path << ": it is not a socket" << endl;
+	    return false;
+	}
+	unlink(path.c_str( ));
+    }
+
+    team.listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (team.listener < 0)
+    {
+	log << "Cannot make a socket: " << strerror(errno) << endl;
+	return false;
+    }
+    if (bind(team.listener, (sockaddr*) &address, sizeof(address)) != 0
+	|| listen(team.listener, SOMAXCONN) != 0)
+    {
+	log << "Cannot listen on " << path << ": " << strerror(errno) << endl;
+	close(team.listener);
+	return false;
+    }
+    // A client that goes away must not kill the server:
+    signal(SIGPIPE, SIG_IGN);
+
+    team.log = &log;
+    team.many_requests = 0;
+    pthread_mutex_init(&team.log_lock, NULL);
+    if (jobs < 1)
+	jobs = 1;
+    log << "Listening on " << path << " with " << jobs
+	<< (jobs == 1 ? " thread." : " threads.") << endl;
+
+    // The calling thread is one of the workers:
+    threads.resize(jobs - 1);
+    for (i = 0; i < jobs - 1; ++i)
+	pthread_create(&threads[i], NULL, serve, &team);
+    serve(&team);
+    for (i = 0; i < jobs - 1; ++i)
+	pthread_join(threads[i], NULL);
+    close(team.listener);
+    pthread_mutex_destroy(&team.log_lock);
+    return false;
+}
+//----------------------------------------------------------------------------
+#endif
@@ -0,0 +1,46 @@
+// File: cu.server.h
+// Version: Oct 18, 2026
+// This file provides the server mode of the CU compiler (cu --server), in
+// which one process stays up and compiles the programs that its clients
+// (such as cu-client) send to it over a Unix domain socket.  A request
+// pays only for its own compilation: the process, the interned strings
+// and the canonical types (see intern.h and cu.types.h) are already there,
+// and each worker thread of the server keeps its tree_arena between
+// requests (see tree_arena::reset in tree.h), so that its trees come from
+// memory that is already allocated.  The strings that a request interns
+// and that were not in the shared pool are kept in an intern_arena of the
+// worker, which is released after each request, so that the memory of a
+// long-running server does not grow with each new program.
+//
+// THE PROTOCOL: A client connects to the socket and sends one request:
+//   a line of options, which may be empty (the options are --compact,
+//   --threads N, --registers, --sse, -O0 and -O1, as for cu), ended by
+//   '\n'; then the text of the program, ended by shutting down the
+//   client's side of the connection (shutdown with SHUT_WR).  A request
+//   that is not all there within 30 seconds of the connection is dropped:
+//   the server closes the connection with no reply.  So is a reply that
+//   the client does not read for 30 seconds.
+// The server then sends one reply and closes the connection:
+//   a line "status assembly_bytes error_bytes" ended by '\n', where status
+//   is 0 if the program compiled with no errors, and 1 otherwise;
+//   then the assembly code (assembly_bytes bytes, none if status is 1);
+//   then the error messages (error_bytes bytes).
+//
+// FUNCTION:
+//   bool run_server(const string& path, int jobs, ostream& log)
+//     Postcondition: If a socket could be made at path (replacing any
+//     socket that was there), then the server has answered requests on it
+//     with jobs worker threads until the process is killed, and a line
+//     was written to log for each request.  If the socket could not be
+//     made (or something other than a socket is at path, which is left
+//     alone, or a connection could not be accepted), the reason was
+//     written to log and the return value is false.  (On Windows, there is no
+//     server, and the return value is always false.)
+
+#ifndef CU_SERVER_H
+#define CU_SERVER_H
+#include <iostream>      // Provides ostream
+#include <string>        // Provides string class
+
+bool run_server(const std::string& path, int jobs, std::ostream& log);
+#endif
@@ -68,5 +68,3 @@
 #define	UNARYHIGH	322
 #define	HIGHEST	323
 
-
-extern YYSTYPE yylval;
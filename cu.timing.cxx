@@ -0,0 +1,197 @@
+// File: cu.timing.cxx
+// Version: Oct 18, 2026
+// This is the implementation file for the time report of the CU compiler
+// (see cu.timing.h).
+
+#include <cstddef>       // Provides size_t, NULL
+#include <ctime>         // Provides clock, clock_gettime
+#include <iomanip>       // Provides setw, setprecision
+#include <iostream>      // Provides ostream
+#include <string>        // Provides string class
+#include <vector>        // Provides vector class
+#include "tree.h"        // Provides the tree class and tree_hooks
+#include "cu.timing.h"
+using namespace std;
+using namespace colorado;
+
+//----------------------------------------------------------------------------
+// The clocks, in seconds.  Each thread of the code generator uses CPU time
+// of its own, so the CPU clock is that of the whole process.
+static double wall_clock( )
+{
+#ifdef _WIN32
+    return double(clock( )) / CLOCKS_PER_SEC;
+#else
+    timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+#endif
+}
+
+static double cpu_clock( )
+{
+#ifdef _WIN32
+    return double(clock( )) / CLOCKS_PER_SEC;
+#else
+    timespec t;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+#endif
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// The tree_hooks of the report, which count for the one time_report that
+// exists, and then call the hooks that were there before it.
+static time_report* active = NULL;
+static const tree_hooks* chained = NULL;
+
+static void count_node(size_t bytes)
+{
+    __sync_fetch_and_add(&active->nodes, 1);
+    if (chained != NULL)
+	chained->node_allocated(bytes);
+}
+
+static void count_set(const tree* p, const string& key, size_t bytes)
+{
+    __sync_fetch_and_add(&active->attribute_sets, 1);
+    if (chained != NULL)
+	chained->attribute_set(p, key, bytes);
+}
+
+static void count_lookup(const tree* p, const string& key)
+{
+    __sync_fetch_and_add(&active->attribute_lookups, 1);
+    if (chained != NULL && chained->attribute_read != NULL)
+	chained->attribute_read(p, key);
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+void named_counts::add(int i, const char* name, long n)
+{
+    if (size_t(i) >= counts.size( ))
+    {
+	names.resize(i+1, NULL);
+	counts.resize(i+1, 0);
+    }
+    names[i] = name;
+    counts[i] += n;
+}
+
+time_report::time_report( )
+    : tokens(0), nodes(0), attribute_sets(0), attribute_lookups(0), seeks(0),
+      constants_folded(0), instructions(0), labels(0),
+      phase_wall(0), phase_cpu(0), part_wall(0)
+{
+    static const tree_hooks hooks = { count_node, count_set, count_lookup };
+    int i;
+
+    for (i = 0; i < MANY_TIMES; ++i)
+	wall[i] = cpu[i] = 0;
+    active = this;
+    previous = chained = tree::set_hooks(&hooks);
+}
+
+time_report::~time_report( )
+{
+    tree::set_hooks(previous);
+    active = NULL;
+    chained = NULL;
+}
+
+void time_report::start_phase(int)
+{
+    phase_wall = wall_clock( );
+    phase_cpu = cpu_clock( );
+}
+
+void time_report::stop_phase(int phase)
+{
+    wall[phase] += wall_clock( ) - phase_wall;
+    cpu[phase] += cpu_clock( ) - phase_cpu;
+}
+
+void time_report::start_part(int)
+{
+    part_wall = wall_clock( );
+}
+
+void time_report::stop_part(int part)
+{
+    wall[part] += wall_clock( ) - part_wall;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// Writes one line of the report: the name and the wall-clock and CPU time
+// in milliseconds, with a '~' before a CPU time that is estimated.
+static void write_line(ostream& out, const char* name, double wall, double cpu, bool estimated)
+{
+    out << "  " << setw(12) << left << name << right << fixed << setprecision(2)
+	<< setw(12) << wall * 1000 << setw(4) << (estimated ? "~" : "")
+	<< setw(10) << cpu * 1000 << endl;
+}
+
+static void write_count(ostream& out, const char* name, long count)
+{
+    out << "  " << setw(22) << left << name << right << setw(12) << count << endl;
+}
+
+// Writes the counters of an optimizer that ran, after the title:
+static void write_counts(ostream& out, const char* title, const named_counts& counts)
+{
+    size_t i;
+
+    if (counts.size( ) == 0)
+	return;
+    out << title << endl;
+    for (i = 0; i < counts.size( ); ++i)
+    {
+	if (counts.name(i) != NULL)
+	    write_count(out, counts.name(i), counts.count(i));
+    }
+}
+
+void time_report::write(ostream& out) const
+{
+    // The parts are taken out of the phases that hold them:
+    double parse_wall = wall[TIME_PARSE] - wall[TIME_LEX];
+    double decorate_wall = wall[TIME_DECORATE] - wall[TIME_VALIDATE];
+    double lex_share = (wall[TIME_PARSE] > 0) ? wall[TIME_LEX] / wall[TIME_PARSE] : 0;
+    double validate_share =
+	(wall[TIME_DECORATE] > 0) ? wall[TIME_VALIDATE] / wall[TIME_DECORATE] : 0;
+    double total_wall = wall[TIME_PARSE] + wall[TIME_DECORATE] + wall[TIME_CODEGEN];
+    double total_cpu = cpu[TIME_PARSE] + cpu[TIME_DECORATE] + cpu[TIME_CODEGEN];
+    ios::fmtflags flags = out.flags( );
+    streamsize precision = out.precision( );
+
+    out << "Time report:" << endl;
+    out << "  " << setw(12) << left << "phase" << right
+	<< setw(12) << "wall ms" << setw(14) << "CPU ms" << endl;
+    write_line(out, "lex", wall[TIME_LEX], cpu[TIME_PARSE] * lex_share, true);
+    write_line(out, "parse", parse_wall, cpu[TIME_PARSE] * (1 - lex_share), true);
+    write_line(out, "decorate", decorate_wall, cpu[TIME_DECORATE] * (1 - validate_share), true);
+    write_line(out, "validate", wall[TIME_VALIDATE], cpu[TIME_DECORATE] * validate_share, true);
+    write_line(out, "codegen", wall[TIME_CODEGEN], cpu[TIME_CODEGEN], false);
+    write_line(out, "total", total_wall, total_cpu, false);
+    out << "Counters:" << endl;
+    write_count(out, "tokens", tokens);
+    write_count(out, "nodes created", nodes);
+    write_count(out, "attribute sets", attribute_sets);
+    write_count(out, "attribute lookups", attribute_lookups);
+    write_count(out, "symbol-table seeks", seeks);
+    write_count(out, "constants folded", constants_folded);
+    write_count(out, "instructions emitted", instructions);
+    write_count(out, "labels allocated", labels);
+    write_counts(out, "Peephole patterns applied:", peephole);
+    out.flags(flags);
+    out.precision(precision);
+}
+//----------------------------------------------------------------------------
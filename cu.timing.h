@@ -0,0 +1,167 @@
+// File: cu.timing.h
+// Version: Oct 18, 2026
+// This file provides the time report of the CU compiler (cu --time-report),
+// which shows where the time of a compilation goes, in the manner of the
+// -ftime-report of gcc.  It has the wall-clock and CPU time of each phase:
+//   lex:      the calls of the lexer (which runs inside of the parser);
+//   parse:    the rest of yyparse;
+//   decorate: the traverser, apart from validation (and with the constant
+//             folder of cu.fold.cxx);
+//   validate: the type checks of the traverser (validate in
+//             cu.traverser.cxx, which runs inside of decoration);
+//   codegen:  the code generator, with all of its threads;
+// and these counts:
+//   tokens, nodes created, attribute sets and attribute lookups (of all
+//   trees, through the tree_hooks of tree.h), symbol-table seeks,
+//   constant expressions folded (by the constant folder), instructions
+//   emitted (not counting labels, data and raw text) and labels allocated
+//   (by unique_number in the code generator);
+// and how many times each pattern of the peephole optimizer was applied
+// (see cu.peephole.h).
+//
+// The whole phases (parse with the lexer in it, traverse, and codegen) are
+// timed with both clocks when they start and end.  The lexer and the
+// validation run one token or one node at a time, so each of their calls
+// is timed by the wall clock alone (reading the CPU clock that often would
+// cost more than the lexer does).  Their CPU times are the shares of the
+// CPU time of the whole phase, in proportion to their wall-clock times,
+// and the report marks them with a '~'.
+//
+// A phase reaches the report through c.report of its compilation (see
+// cu.compilation.h), which is NULL unless the report is wanted.  So when
+// there is no report, each place that counts or times costs only a test
+// of one pointer, and the trees pay only for a test of the hooks pointer.
+// Compiling the phases with -DCU_NO_COUNTERS takes the tests of the
+// counters out of them (see the COUNT macro below); the tokens, seeks,
+// constants, instructions and labels of the report are then zero, and the
+// peephole patterns are left out of it, as they are when the peephole
+// optimizer does not run.
+//
+// CONSTANTS: TIME_LEX, TIME_PARSE, TIME_DECORATE, TIME_VALIDATE and
+// TIME_CODEGEN are the phases.  TIME_PARSE, TIME_DECORATE and TIME_CODEGEN
+// are given to start_phase and stop_phase (TIME_DECORATE is then the whole
+// traverser), and TIME_LEX and TIME_VALIDATE to start_part and stop_part.
+//
+// CONSTRUCTOR for the time_report class:
+//   time_report( )
+//     Postcondition: The times and counts are zero, and from now on every
+//     new tree, set_attribute and lookup of an attribute (in any thread) is
+//     counted.  Any tree_hooks that were set before (such as those of the
+//     memory report) are still called.  Only one time_report may exist at a
+//     time.  A time_report cannot be copied or assigned.
+//
+// DESTRUCTOR: The tree_hooks that were set before the report are set again.
+//
+// MEMBER FUNCTIONS for the time_report class:
+//   void start_phase(int phase)
+//   void stop_phase(int phase)
+//     Postcondition: The wall-clock and CPU time between a start_phase and
+//     the next stop_phase has been added to the phase.
+//
+//   void start_part(int part)
+//   void stop_part(int part)
+//     Precondition: The phase that holds the part has been started.
+//     Postcondition: The wall-clock time between a start_part and the next
+//     stop_part has been added to the part.
+//
+//   void write(ostream& out) const
+//     Postcondition: The report has been written to out.
+//
+// PUBLIC MEMBER VARIABLES of the time_report class (the counters that the
+// phases add to; nodes, attribute_sets and attribute_lookups are added to
+// by the hooks, in whichever threads make and read the trees):
+//   long tokens, nodes, attribute_sets, attribute_lookups, seeks,
+//   constants_folded, instructions, labels
+//   named_counts peephole (one counter for each pattern)
+//
+// THE named_counts CLASS holds the counters of the patterns of an optimizer,
+// each with its name.  It grows as they are counted, so the
+// report does not need to know how many there are, and a program that has
+// the report but no optimizer (such as test-lexer) does not link one:
+//   void add(int i, const char* name, long n)
+//     Precondition: i >= 0, and name is a string that is never freed.
+//     Postcondition: n has been added to counter number i, whose name is
+//     name.
+//   size_t size( ) const
+//     Postcondition: The return value is one more than the largest number
+//     of a counter that was added to, or 0 if none was.
+//   const char* name(size_t i) const
+//   long count(size_t i) const
+//     Precondition: i < size( ).
+//     Postcondition: The return value is the name (NULL if the counter was
+//     never added to) or the count of counter number i.
+//
+// MACROS:
+//   COUNT(c, counter, n)
+//     Adds n to the counter of the time report of the compilation c, if it
+//     has one.
+//
+//   COUNT_NAMED(c, counts, i, name, n)
+//     Adds n to counter number i (named name) of the named_counts counts
+//     of the time report of the compilation c, if it has one.
+
+#ifndef CU_TIMING_H
+#define CU_TIMING_H
+#include <cstddef>       // Provides size_t
+#include <iostream>      // Provides ostream
+#include <vector>        // Provides vector class
+#include "tree.h"        // Provides the colorado::tree_hooks struct
+
+enum
+{
+    TIME_LEX, TIME_PARSE, TIME_DECORATE, TIME_VALIDATE, TIME_CODEGEN,
+    MANY_TIMES
+};
+
+class named_counts
+{
+public:
+    void add(int i, const char* name, long n);
+    size_t size( ) const { return counts.size( ); }
+    const char* name(size_t i) const { return names[i]; }
+    long count(size_t i) const { return counts[i]; }
+private:
+    std::vector<const char*> names;
+    std::vector<long> counts;
+};
+
+class time_report
+{
+public:
+    time_report( );
+    ~time_report( );
+    void start_phase(int phase);
+    void stop_phase(int phase);
+    void start_part(int part);
+    void stop_part(int part);
+    void write(std::ostream& out) const;
+
+    long tokens;
+    long nodes;
+    long attribute_sets;
+    long attribute_lookups;
+    long seeks;
+    long constants_folded;
+    long instructions;
+    long labels;
+    named_counts peephole;
+private:
+    double wall[MANY_TIMES];       // Seconds of each phase or part
+    double cpu[MANY_TIMES];        // Seconds of CPU time of each phase
+    double phase_wall, phase_cpu;  // When the current phase started
+    double part_wall;              // When the current part started
+    const colorado::tree_hooks* previous; // The hooks before the report
+    time_report(const time_report&);
+    void operator =(const time_report&);
+};
+
+#ifdef CU_NO_COUNTERS
+#define COUNT(c, counter, n) do { } while (0)
+#define COUNT_NAMED(c, counts, i, name, n) do { } while (0)
+#else
+#define COUNT(c, counter, n) \
+    do { if ((c).report != NULL) (c).report->counter += (n); } while (0)
+#define COUNT_NAMED(c, counts, i, name, n) \
+    do { if ((c).report != NULL) (c).report->counts.add(i, name, n); } while (0)
+#endif
+#endif
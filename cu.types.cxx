@@ -0,0 +1,182 @@
+// File: cu.types.cxx
+// Version: Oct 18, 2026
+// This is the implementation file for the canonical CU types (see
+// cu.types.h).
+
+#include <cstddef>       // Provides size_t, NULL
+#include <iostream>      // Provides ostream
+#include <map>           // Provides map class
+#include <string>        // Provides string class
+#include <vector>        // Provides vector class
+#include <pthread.h>     // Provides pthread_mutex_t
+#include "intern.h"      // Provides intern_shared
+#include "cu.tab.h"      // Provides the token numbers
+#include "cu.types.h"    // Provides the cu_type declarations
+using namespace std;
+using namespace colorado;
+
+//----------------------------------------------------------------------------
+// The table of all types.  all[i] is the type with id i, and primitives
+// maps each interned type name to its TYPENAME type.  The table is created
+// by its first use and never destroyed, like the pool of interned strings,
+// so its names are interned in the shared pool (never in an intern_arena).
+struct type_table
+{
+    vector<cu_type*> all;
+    map<const string*, cu_type*> primitives;
+};
+static type_table& table( )
+{
+    static type_table* answer = new type_table;
+    return *answer;
+}
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// new_type(format, name, element) adds a new type to the table and returns
+// it.  The caller must hold table_lock, and the element type (if any) must
+// already be complete.
+static cu_type* new_type(int format, const string* name, const cu_type* element)
+{
+    type_table& t = table( );
+    cu_type* answer = new cu_type;
+
+    answer->id = t.all.size( );
+    answer->format = format;
+    answer->name = name;
+    answer->element = element;
+    answer->coercible_from = NULL;
+    answer->is_array = (format == ARRAY);
+    answer->is_string = (format == TYPENAME && *name == "|string|");
+    answer->is_using_implicit_memory = answer->is_array || answer->is_string;
+    answer->is_simple_array =
+	answer->is_array && !element->is_using_implicit_memory;
+    answer->is_complex_array =
+	answer->is_array && element->is_using_implicit_memory;
+    answer->array_of = NULL;
+    answer->pointer_to = NULL;
+    t.all.push_back(answer);
+    return answer;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// locked_primitive(name) and locked_plus(t, qualifier) do the work of
+// type_primitive and type_plus.  The caller must hold table_lock.
+static const cu_type* locked_primitive(const string& name);
+static const cu_type* locked_plus(const cu_type* t, int qualifier);
+
+static const cu_type* locked_primitive(const string& name)
+{
+    const string* key = &intern_shared(name);
+    map<const string*, cu_type*>::iterator it = table( ).primitives.find(key);
+    cu_type* answer;
+
+    if (it != table( ).primitives.end( ))
+	return it->second;
+    answer = new_type(TYPENAME, key, NULL);
+    table( ).primitives[key] = answer;
+    if (name == "|float|")
+	answer->coercible_from = locked_primitive("|int|");
+    return answer;
+}
+
+static const cu_type* locked_plus(const cu_type* t, int qualifier)
+{
+    const cu_type*& slot = (qualifier == ARRAY) ? t->array_of : t->pointer_to;
+    cu_type* answer;
+
+    if (slot != NULL)
+	return slot;
+    answer = new_type(qualifier, NULL, t);
+    // Only an array keeps the coercion of its elements:
+    if (qualifier == ARRAY && t->coercible_from != NULL)
+	answer->coercible_from = locked_plus(t->coercible_from, ARRAY);
+    slot = answer;
+    return answer;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+const cu_type* type_primitive(const string& name)
+{
+    const cu_type* answer;
+
+    pthread_mutex_lock(&table_lock);
+    answer = locked_primitive(name);
+    pthread_mutex_unlock(&table_lock);
+    return answer;
+}
+
+const cu_type* type_plus(const cu_type* t, int qualifier)
+{
+    const cu_type* answer;
+
+    pthread_mutex_lock(&table_lock);
+    answer = locked_plus(t, qualifier);
+    pthread_mutex_unlock(&table_lock);
+    return answer;
+}
+
+const cu_type* type_minus(const cu_type* t, int qualifier)
+{
+    if (t == NULL || t->format != qualifier)
+	return NULL;
+    return t->element;
+}
+
+int format_of_type(const cu_type* t)
+{
+    if (t == NULL) return NULLPTR;
+    return t->format;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// Each type has one object, so compatibility is a comparison of pointers.
+bool is_compat(const cu_type* var_type, const cu_type* expr_type, bool allow_coercion)
+{
+    // The type of nullptr is NULL, and it can work for any ptr variable:
+    if (expr_type == NULL)
+	return format_of_type(var_type) == POINTER;
+    if (var_type == expr_type)
+	return true;
+    return allow_coercion && var_type != NULL && var_type->coercible_from == expr_type;
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+size_t many_types( )
+{
+    size_t answer;
+
+    pthread_mutex_lock(&table_lock);
+    answer = table( ).all.size( );
+    pthread_mutex_unlock(&table_lock);
+    return answer;
+}
+
+ostream& operator <<(ostream& out, const cu_type* t)
+{
+    for ( ; t != NULL && t->format != TYPENAME; t = t->element)
+	out << (t->format == ARRAY ? "array of " : "pointer to ");
+    if (t == NULL)
+	return out << "nullptr";
+    return out << *(t->name);
+}
+//----------------------------------------------------------------------------
+
+
+//----------------------------------------------------------------------------
+// The four primitive types:
+const cu_type* const BOOL_TYPE = type_primitive("|bool|");
+const cu_type* const FLOAT_TYPE = type_primitive("|float|");
+const cu_type* const INTEGER_TYPE = type_primitive("|int|");
+const cu_type* const STRING_TYPE = type_primitive("|string|");
+//----------------------------------------------------------------------------
@@ -0,0 +1,105 @@
+// File: cu.types.h
+// Version: Oct 18, 2026
+// This file provides the canonical data types of the CU language.  Each
+// distinct type (a primitive type such as |int|, or an array of or pointer
+// to another type) is represented by exactly one cu_type object, which is
+// created the first time the type is needed and is never destroyed.  So
+// two types are the same if and only if they are the same object, and
+// compatibility tests need no walk over parse trees.
+//
+// The traverser attaches a "Type" attribute (a const cu_type*) to each
+// typeexpr node and to each expr node of the parse tree.  The type of the
+// nullptr expression is NULL.
+//
+// STRUCT cu_type:
+//   int id: A small number for this type.  The types are numbered 0, 1,
+//     2, ... in the order that they were created.
+//   int format: TYPENAME, ARRAY or POINTER.
+//   const string* name: For a TYPENAME, the interned type name (such as
+//     "|int|").  Otherwise NULL.
+//   const cu_type* element: For an ARRAY or POINTER, the type of the
+//     elements or the type that is pointed to.  Otherwise NULL.
+//   const cu_type* coercible_from: If an expression of some other type can
+//     be coerced to this type, then this is that other type (|int| for
+//     |float|, array of |int| for array of |float|, and so on).  Otherwise
+//     NULL.
+//   bool is_array, is_string: True for an array or a |string|.
+//   bool is_using_implicit_memory: True for an array or a |string|.
+//   bool is_simple_array: True for an array whose elements are neither
+//     strings nor arrays.
+//   bool is_complex_array: True for an array whose elements are strings
+//     or arrays.
+//
+// CONSTANTS: BOOL_TYPE, FLOAT_TYPE, INTEGER_TYPE and STRING_TYPE are the
+// four primitive types.
+//
+// FUNCTIONS:
+//   const cu_type* type_primitive(const string& name)
+//     Postcondition: The return value is the TYPENAME type with the given
+//     name.
+//
+//   const cu_type* type_plus(const cu_type* t, int qualifier)
+//     Precondition: t is not NULL, and qualifier is ARRAY or POINTER.
+//     Postcondition: The return value is the array of t or pointer to t.
+//
+//   const cu_type* type_minus(const cu_type* t, int qualifier)
+//     Postcondition: If t is an array of (or pointer to) some type, and
+//     qualifier is ARRAY (or POINTER), then the return value is that type.
+//     Otherwise the return value is NULL.
+//
+//   int format_of_type(const cu_type* t)
+//     Postcondition: The return value is t->format, or NULLPTR if t is NULL.
+//
+//   bool is_compat
+//   (const cu_type* var_type, const cu_type* expr_type, bool allow_coercion)
+//     Postcondition: The return value is true if an expression of type
+//     expr_type can be used to initialize a variable of type var_type. If
+//     allow_coercion is true, then a coercion from int to float (or from
+//     array of int to array of float, and so on) is permitted.
+//
+//   size_t many_types( )
+//     Postcondition: The return value is the number of types created so far.
+//
+//   ostream& operator <<(ostream& out, const cu_type* t)
+//     Postcondition: The type has been written to out in the notation of
+//     the language (such as "array of |int|").
+//
+// Threads: The types are shared by all threads, and these functions may be
+// called by several threads at once.
+
+#ifndef CU_TYPES_H
+#define CU_TYPES_H
+#include <cstddef>       // Provides size_t
+#include <iostream>      // Provides ostream
+#include <string>        // Provides string class
+
+struct cu_type
+{
+    int id;
+    int format;
+    const std::string* name;
+    const cu_type* element;
+    const cu_type* coercible_from;
+    bool is_array;
+    bool is_string;
+    bool is_using_implicit_memory;
+    bool is_simple_array;
+    bool is_complex_array;
+    // Used only by type_plus, to find the array of or pointer to this type:
+    mutable const cu_type* array_of;
+    mutable const cu_type* pointer_to;
+};
+
+extern const cu_type* const BOOL_TYPE;
+extern const cu_type* const FLOAT_TYPE;
+extern const cu_type* const INTEGER_TYPE;
+extern const cu_type* const STRING_TYPE;
+
+const cu_type* type_primitive(const std::string& name);
+const cu_type* type_plus(const cu_type* t, int qualifier);
+const cu_type* type_minus(const cu_type* t, int qualifier);
+int format_of_type(const cu_type* t);
+size_t many_types( );
+std::ostream& operator <<(std::ostream& out, const cu_type* t);
+bool is_compat(const cu_type* var_type, const cu_type* expr_type, bool allow_coercion = true);
+#endif
@@ -18,17 +18,26 @@
 %{
 #include "tree.h"                  // Provides tree class
 #include "cu.enum.h"               // Provides nonterminals and rhsclasses
+#include "cu.compilation.h"        // Provides the compilation struct
+#include "cu.timing.h"             // Provides the time_report class, COUNT
 using namespace colorado;          // For tree, nonterminals and rhs classes
 #define YYSTYPE tree*              // Type of semantic values
-tree* parse_tree_root_ptr;         // Will point to root of parse tree
 
-// Functions provided by the Lexical Analyzer (cs3155.lex):
-int yylex( );                      // Provided by the lexer
-void yyerror(const char* message); // Provided by the lexer
-extern int yylineno;               // Provided by the lexer
+// Functions provided by the Lexical Analyzer (cu.lex).  The parser is pure,
+// so yylex stores each token's tree in *lvalp instead of a global yylval,
+// and the scanner and the compilation are passed to every call.  The
+// parser calls the lexer through the yylex below, which also takes the
+// compilation, so that it can time and count the tokens for a time report:
+int yylex(YYSTYPE* lvalp, void* scanner);
+static int yylex(YYSTYPE* lvalp, void* scanner, compilation* c);
+void yyerror(void* scanner, compilation* c, const char* message);
+int yyget_lineno(void* scanner);
 
 // Function to set Nonterminal and RHS attributes of a node:
 void set_node(tree* ptr, lhs nonterminal, rhs rule);
+
+// Function to add one more item to a defnlist, exprseq, parmseq or stmtlist:
+tree* append_item(tree* list, tree* item, rhs rule);
 %}
 /*---------------------------------------------------------------------------*/
 
@@ -43,6 +52,13 @@ void set_node(tree* ptr, lhs nonterminal, rhs rule);
 %token HAT AT PERCENT STAR SLASH LT LE EQEQ EQ LCURLY GT GE NE
 %token RCURLY SEMICOLON COMMA
 %token INTEGERVALUE FLOATVALUE STRINGVALUE IDENTIFIER TYPENAME
+
+/* The parser keeps no global state: yyparse(scanner, c) parses one        */
+/* program with the given scanner, and puts the root of its tree in c.      */
+%code requires { struct compilation; }
+%define api.pure
+%parse-param {void* scanner} {compilation* c}
+%lex-param {void* scanner} {compilation* c}
 /*--------------------------------------------------------------------------*/
 
 
@@ -74,7 +90,7 @@ program       : defnlist
 	      {
                   $$ = new tree("<program>", 1, $1);
                   set_node($$, program__, __defnlist);
-                  parse_tree_root_ptr = $$;
+                  c->root = $$;
 	      }
               ;
 
@@ -100,12 +116,12 @@ defn          : vardefn
 defnlist      : /* EMPTY */
               {
                   $$ = new tree("<defnlist>");
+                  $$->set_attribute<int>("Line", yyget_lineno(scanner));
                   set_node($$, defnlist__, __EMPTY);
               }
               | defnlist defn
               {
-                  $$ = new tree("<defnlist>", 2, $1, $2);
-                  set_node($$, defnlist__, __defnlist_defn);
+                  $$ = append_item($1, $2, __defnlist_defn);
               }
               ;
 
@@ -299,6 +315,7 @@ expr          : INTEGERVALUE
 exprseq       : /* EMPTY */
               {
                   $$ = new tree("<exprseq>");
+                  $$->set_attribute<int>("Line", yyget_lineno(scanner));
                   set_node($$, exprseq__, __EMPTY);
               }
               | expr
@@ -308,8 +325,8 @@ exprseq       : /* EMPTY */
               }
               | exprseq COMMA expr
               {
-                  $$ = new tree("<exprseq>", 3, $1, $2, $3);
-                  set_node($$, exprseq__, __exprseq_COMMA_expr);
+                  delete $2;
+                  $$ = append_item($1, $3, __exprseq_COMMA_expr);
               }
               ;
 
@@ -340,6 +357,7 @@ parmdefn      : typeexpr IDENTIFIER
 parmseq       : /* EMPTY */
               {
                   $$ = new tree("<parmseq>");
+                  $$->set_attribute<int>("Line", yyget_lineno(scanner));
                   set_node($$, parmseq__, __EMPTY);
               }
               | parmdefn
@@ -349,8 +367,8 @@ parmseq       : /* EMPTY */
               }
               | parmseq COMMA parmdefn
               {
-                  $$ = new tree("<parmseq>", 3, $1, $2, $3);
-                  set_node($$, parmseq__, __parmseq_COMMA_parmdefn);
+                  delete $2;
+                  $$ = append_item($1, $3, __parmseq_COMMA_parmdefn);
               }
 	      ;
 
@@ -429,12 +447,12 @@ stmt          : SEMICOLON
 stmtlist      : /* EMPTY */
               {
                   $$ = new tree("<stmtlist>");
+                  $$->set_attribute<int>("Line", yyget_lineno(scanner));
                   set_node($$, stmtlist__, __EMPTY);
               }
               | stmtlist stmt
               {
-                  $$ = new tree("<stmtlist>", 2, $1, $2);
-                  set_node($$, stmtlist__, __stmtlist_stmt);
+                  $$ = append_item($1, $2, __stmtlist_stmt);
               }
               ;
 
@@ -479,9 +497,44 @@ void set_node(tree* p, lhs nonterminal, rhs rule)
     p->set_attribute<rhs>("RHS", rule);
     p->set_attribute<int>("Errors", 0);
 
+    // An empty list already has the line that the lexer had reached:
     if (p->many_children( ) > 0)
         p->set_attribute<int>("Line", p->child(0)->attribute<int>("Line"));
-    else
-        p->set_attribute<int>("Line", yylineno);
+}
+
+bool parse(compilation& c)
+{
+    c.root = NULL;
+    return yyparse(c.scanner, &c) == 0;
+}
+
+static int yylex(YYSTYPE* lvalp, void* scanner, compilation* c)
+{
+    int token;
+
+    if (c->report == NULL)
+	return yylex(lvalp, scanner);
+    c->report->start_part(TIME_LEX);
+    token = yylex(lvalp, scanner);
+    c->report->stop_part(TIME_LEX);
+    if (token != 0)
+	COUNT(*c, tokens, 1);
+    return token;
+}
+
+// The four kinds of lists are not built as chains of binary nodes.  Each
+// list is a single node whose children are the items of the list (without
+// the commas), so that long lists need neither deep trees nor deep
+// recursion.  The RHS of a list is __EMPTY until its first item is added.
+// At that point it becomes the rule that added the item, so an exprseq or
+// parmseq that starts with a comma has the RHS __exprseq_COMMA_expr or
+// __parmseq_COMMA_parmdefn, and every other non-empty list has the RHS
+// __defnlist_defn, __expr, __parmdefn or __stmtlist_stmt.
+tree* append_item(tree* list, tree* item, rhs rule)
+{
+    if (list->attribute<rhs>("RHS") == __EMPTY)
+        list->set_attribute<rhs>("RHS", rule);
+    list->append_child(item);
+    return list;
 }
 /*--------------------------------------------------------------------------*/
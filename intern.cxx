@@ -0,0 +1,237 @@
+// File: intern.cxx
+// Version: Oct 18, 2026
+// This is the implementation file for the string interner.
+
+#include <cstddef>       // Provides size_t
+#include <cstring>       // Provides memcmp, strlen
+#include <string>        // Provides string class
+#include <vector>        // Provides vector class
+#include <pthread.h>     // Provides pthread_mutex_t
+#include "intern.h"      // Provides the intern declarations
+using namespace std;
+
+namespace colorado
+{
+    //---------------------------------------------------------------------
+    // A pool is a hash table with separate chaining.  The entries of the
+    // shared pool are never removed, so a reference to an entry's text
+    // stays valid forever.  Those of an intern_arena are removed only by
+    // its release( ).
+    struct intern_entry
+    {
+	string text;
+	size_t hash;
+	intern_entry* next;
+    };
+
+    // pool( ) is created by its first use, so that trees that are global
+    // variables in other files can intern their labels during start-up.
+    // It is never destroyed, so those labels also stay valid at exit.
+    struct intern_pool
+    {
+	vector<intern_entry*> buckets;
+	size_t many;
+	intern_pool( ) : buckets(1024, (intern_entry*) NULL), many(0) { }
+    };
+    static intern_pool& pool( )
+    {
+	static intern_pool* answer = new intern_pool;
+	return *answer;
+    }
+    static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+    // The current intern_arena of each thread:
+    static __thread intern_arena* current_strings = NULL;
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    // hash_of(s, n) is the FNV-1a hash of the n characters at s.
+    static size_t hash_of(const char* s, size_t n)
+    {
+	size_t answer = 2166136261u;
+	size_t i;
+
+	for (i = 0; i < n; ++i)
+	{
+	    answer ^= (unsigned char) s[i];
+	    answer *= 16777619u;
+	}
+	return answer;
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    // grow(p) doubles the number of buckets in the pool p.
+    static void grow(intern_pool& p)
+    {
+	vector<intern_entry*> old_buckets(2*p.buckets.size( ), (intern_entry*) NULL);
+	intern_entry* e;
+	intern_entry* next;
+	size_t i, b;
+
+	old_buckets.swap(p.buckets);
+	for (i = 0; i < old_buckets.size( ); ++i)
+	{
+	    for (e = old_buckets[i]; e != NULL; e = next)
+	    {
+		next = e->next;
+		b = e->hash & (p.buckets.size( ) - 1);
+		e->next = p.buckets[b];
+		p.buckets[b] = e;
+	    }
+	}
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    // find(p, s, n, hash) is the entry of the pool p for the n characters
+    // at s (whose hash is given), or NULL if there is none.
+    static intern_entry* find(const intern_pool& p, const char* s, size_t n, size_t hash)
+    {
+	intern_entry* e;
+
+	for (e = p.buckets[hash & (p.buckets.size( ) - 1)]; e != NULL; e = e->next)
+	{
+	    if (e->hash == hash && e->text.size( ) == n && memcmp(e->text.data( ), s, n) == 0)
+		return e;
+	}
+	return NULL;
+    }
+
+    // add(p, s, n, hash) adds an entry for the n characters at s to the
+    // pool p, and returns it.
+    static intern_entry* add(intern_pool& p, const char* s, size_t n, size_t hash)
+    {
+	intern_entry* e = new intern_entry;
+	size_t b = hash & (p.buckets.size( ) - 1);
+
+	e->text.assign(s, n);
+	e->hash = hash;
+	e->next = p.buckets[b];
+	p.buckets[b] = e;
+	if (++p.many > p.buckets.size( ))
+	    grow(p);
+	return e;
+    }
+
+    // shared(s, n, hash) is the entry of the shared pool for the n
+    // characters at s, which is added if it is not there yet.
+    static intern_entry* shared(const char* s, size_t n, size_t hash)
+    {
+	intern_pool& p = pool( );
+	intern_entry* e;
+
+	pthread_mutex_lock(&pool_lock);
+	e = find(p, s, n, hash);
+	if (e == NULL)
+	    e = add(p, s, n, hash);
+	pthread_mutex_unlock(&pool_lock);
+	return e;
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    const string& intern(const char* s, size_t n)
+    {
+	size_t hash = hash_of(s, n);
+	intern_arena* arena = current_strings;
+	intern_entry* e;
+
+	if (arena == NULL)
+	    return shared(s, n, hash)->text;
+
+	// The arena needs no lock, since only this thread uses it:
+	e = find(*arena->strings, s, n, hash);
+	if (e != NULL)
+	    return e->text;
+	pthread_mutex_lock(&pool_lock);
+	e = find(pool( ), s, n, hash);
+	pthread_mutex_unlock(&pool_lock);
+	if (e == NULL)
+	    e = add(*arena->strings, s, n, hash);
+	return e->text;
+    }
+
+    const string& intern_shared(const string& s)
+    {
+	return shared(s.data( ), s.size( ), hash_of(s.data( ), s.size( )))->text;
+    }
+
+    const string& intern(const string& s)
+    {
+	return intern(s.data( ), s.size( ));
+    }
+
+    const string& intern(const char* s)
+    {
+	return intern(s, strlen(s));
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    size_t many_interned( )
+    {
+	size_t answer;
+
+	pthread_mutex_lock(&pool_lock);
+	answer = pool( ).many;
+	pthread_mutex_unlock(&pool_lock);
+	return answer;
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    intern_arena::intern_arena( )
+	: strings(new intern_pool)
+    {
+    }
+
+    intern_arena::~intern_arena( )
+    {
+	release( );
+	delete strings;
+    }
+
+    size_t intern_arena::size( ) const
+    {
+	return strings->many;
+    }
+
+    void intern_arena::release( )
+    {
+	intern_entry* e;
+	intern_entry* next;
+	size_t i;
+
+	// The buckets are kept, for the next job of the same size:
+	for (i = 0; i < strings->buckets.size( ); ++i)
+	{
+	    for (e = strings->buckets[i]; e != NULL; e = next)
+	    {
+		next = e->next;
+		delete e;
+	    }
+	    strings->buckets[i] = NULL;
+	}
+	strings->many = 0;
+    }
+
+    intern_arena* intern_arena::current( )
+    {
+	return current_strings;
+    }
+
+    intern_arena* intern_arena::set_current(intern_arena* arena)
+    {
+	intern_arena* answer = current_strings;
+	current_strings = arena;
+	return answer;
+    }
+    //---------------------------------------------------------------------
+}
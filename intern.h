@@ -0,0 +1,89 @@
+// File: intern.h
+// Version: Oct 18, 2026
+// This file provides a string interner: a pool that keeps exactly one
+// copy of each distinct string value.  Labels of trees, lexemes of tokens
+// and names in the symbol table are all interned, so that two of them are
+// equal if and only if they are the same object (and they can be compared
+// by address instead of by contents).
+//
+// FUNCTIONS in the colorado namespace:
+//   const string& intern(const string& s)
+//   const string& intern(const char* s)
+//   const string& intern(const char* s, size_t n)
+//     Postcondition: The return value is a reference to the pooled copy of
+//     the string (or of the n characters starting at s).  Every call with
+//     the same value returns a reference to the same object, which stays
+//     valid (and unchanged) until the program ends.  But if the calling
+//     thread has a current intern_arena (see below) and the string is not
+//     in the shared pool, then the copy is kept in that arena instead, and
+//     it is valid only until the arena is released.
+//
+//   const string& intern_shared(const string& s)
+//     Postcondition: The same as intern(s), except that the copy is always
+//     kept in the shared pool.  This is for a string that is kept by
+//     something that outlives any arena (such as the table of types).
+//
+//   size_t many_interned( )
+//     Postcondition: The return value is the number of distinct strings in
+//     the shared pool.
+//
+// THE intern_arena CLASS holds the strings that one thread interns for one
+// job, such as a request to cu --server, so that the strings of many jobs
+// do not pile up in the shared pool.  A string is only added to an arena
+// when it is not in the shared pool, and once it is in the arena, the
+// thread gets the arena's copy of it until the arena is released.
+//
+//   intern_arena( )
+//     Postcondition: The arena is empty.
+//
+//   ~intern_arena( )
+//     The destructor calls release( ).
+//
+//   size_t size( ) const
+//     Postcondition: The return value is the number of strings in the arena.
+//
+//   void release( )
+//     Postcondition: The strings of the arena are gone, and so any
+//     reference that intern gave out for them is no longer valid.
+//
+//   static intern_arena* current( )
+//   static intern_arena* set_current(intern_arena* arena)
+//     Each thread has its own current arena, which is NULL at the start.
+//     The set_current function changes the calling thread's current arena
+//     (NULL means the shared pool) and returns the previous one.
+//
+// Threads: The shared pool may be used by several threads at once.  Each
+// intern_arena is meant to be used by one thread at a time.
+
+#ifndef COLORADO_INTERN
+#define COLORADO_INTERN
+#include <cstddef>       // Provides size_t
+#include <string>        // Provides string class
+
+namespace colorado
+{
+    struct intern_pool;      // See intern.cxx
+
+    class intern_arena
+    {
+    public:
+	intern_arena( );
+	~intern_arena( );
+	size_t size( ) const;
+	void release( );
+	static intern_arena* current( );
+	static intern_arena* set_current(intern_arena* arena);
+    private:
+	intern_pool* strings;
+	friend const std::string& intern(const char* s, size_t n);
+	intern_arena(const intern_arena&);
+	void operator =(const intern_arena&);
+    };
+
+    const std::string& intern(const std::string& s);
+    const std::string& intern(const char* s);
+    const std::string& intern(const char* s, size_t n);
+    const std::string& intern_shared(const std::string& s);
+    size_t many_interned( );
+}
+#endif
@@ -0,0 +1,79 @@
+// File: mapped.cxx
+// Version: Oct 18, 2026
+// This is the implementation file for the colorado::mapped_file class (see
+// mapped.h).
+
+#include <cstddef>       // Provides size_t, NULL
+#include <fstream>       // Provides ifstream
+#include <iterator>      // Provides istreambuf_iterator
+#include <string>        // Provides string class
+#include <vector>        // Provides vector class
+#ifndef _WIN32
+#include <fcntl.h>       // Provides open
+#include <sys/mman.h>    // Provides mmap, munmap
+#include <sys/stat.h>    // Provides fstat
+#include <unistd.h>      // Provides close
+#endif
+#include "mapped.h"      // Provides the mapped_file class
+using namespace std;
+
+namespace colorado
+{
+    //---------------------------------------------------------------------
+    mapped_file::mapped_file(const string& filename, size_t padding)
+	: start(NULL), bytes(0), mapped_bytes(0)
+    {
+#ifndef _WIN32
+	int fd = open(filename.c_str( ), O_RDONLY);
+	struct stat info;
+	void* region;
+
+	if (fd < 0)
+	    return;
+	if (fstat(fd, &info) == 0 && info.st_size > 0)
+	{
+	    // First reserve room for the file and its padding with an
+	    // anonymous mapping, which is all zero.  Then the file is mapped
+	    // over the front of it.  The rest of the file's last page is
+	    // also zero, so the padding is zero wherever it falls.
+	    mapped_bytes = info.st_size + padding;
+	    region = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE,
+			  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	    if (region != MAP_FAILED
+		&& mmap(region, info.st_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED)
+	    {
+		start = static_cast<char*>(region);
+		bytes = info.st_size;
+		close(fd);
+		return;
+	    }
+	    if (region != MAP_FAILED)
+		munmap(region, mapped_bytes);
+	    mapped_bytes = 0;
+	}
+	close(fd);
+#endif
+	// Read the file into the buffer instead:
+	ifstream in(filename.c_str( ), ios::in | ios::binary);
+
+	if (!in)
+	    return;
+	buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>( ));
+	bytes = buffer.size( );
+	buffer.resize(bytes + padding + 1, '\0');
+	start = &(buffer[0]);
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    mapped_file::~mapped_file( )
+    {
+#ifndef _WIN32
+	if (mapped_bytes > 0)
+	    munmap(start, mapped_bytes);
+#endif
+    }
+    //---------------------------------------------------------------------
+}
@@ -0,0 +1,53 @@
+// File: mapped.h
+// Version: Oct 18, 2026
+// This file provides a class for reading a whole file through mmap, so
+// that its contents can be used in place instead of being copied into a
+// buffer.  The mapping is private: a program may write into the contents
+// (as the lexer does when it ends each token with a '\0'), but the writes
+// only go to the program's own copy of the changed pages and never to the
+// file.  Where mmap is not available (or the file is empty), the contents
+// are read into an ordinary buffer instead.
+//
+// CONSTRUCTOR for the colorado::mapped_file class:
+//   mapped_file(const string& filename, size_t padding = 0)
+//     Postcondition: If the named file can be read, then is_open( ) is true,
+//     data( ) points to its size( ) bytes, and they are followed by padding
+//     more bytes that are all zero.  Otherwise is_open( ) is false.
+//
+// MEMBER FUNCTIONS for the colorado::mapped_file class:
+//   bool is_open( ) const
+//   char* data( )
+//   const char* data( ) const
+//   size_t size( ) const
+//     Postcondition: The return values are as described above.  The data
+//     stay valid until the mapped_file is destroyed.
+//
+// A mapped_file cannot be copied or assigned.
+
+#ifndef COLORADO_MAPPED
+#define COLORADO_MAPPED
+#include <cstddef>       // Provides size_t
+#include <string>        // Provides string class
+#include <vector>        // Provides vector class
+
+namespace colorado
+{
+    class mapped_file
+    {
+    public:
+	mapped_file(const std::string& filename, size_t padding = 0);
+	~mapped_file( );
+	bool is_open( ) const { return start != NULL; }
+	char* data( ) { return start; }
+	const char* data( ) const { return start; }
+	size_t size( ) const { return bytes; }
+    private:
+	char* start;            // NULL if the file could not be read
+	size_t bytes;           // Size of the file
+	size_t mapped_bytes;    // Size of the whole mapping, or 0 if none
+	std::vector<char> buffer;
+	mapped_file(const mapped_file&);
+	void operator =(const mapped_file&);
+    };
+}
+#endif
@@ -3,14 +3,29 @@
 // Version: Jan 12, 2006
 // This file provides a general symbol table class that can be
 // used to keep track of the symbols in a compiler or other translator.
+// The names are interned (see intern.h), so that a search compares
+// each name by its address rather than by its characters.
+//
+// The symbols are kept in a hash table whose key is the address of the
+// interned name.  Each bucket is a stack of symbols with the newest symbol
+// on top, so the symbols with one name form a stack in which the innermost
+// definition is found first.  seek, insert and seek(depth) take constant
+// expected time, and exit_scope takes time proportional to the number of
+// symbols that go out of scope.
+// A seek by a string interns it first, which takes the lock of the pool.
+// A caller whose name is interned already (such as the label of a tree)
+// can give seek the address of the interned copy instead, which skips the
+// pool, so that the threads of several compilations do not wait on it.
 
 #ifndef COLORADO_SYMTAB
 #define COLORADO_SYMTAB
+#include <cstddef>       // Provides size_t
 #include <cstdlib>       // Provides NULL
 #include <map>           // Provides vector template class
 #include <stack>         // Provides stack template class
 #include <string>        // Provides string class
 #include <vector>        // Provides vector template class
+#include "intern.h"      // Provides intern
 
 namespace colorado
 {
@@ -20,11 +35,12 @@ namespace colorado
     public:
 	struct symbol_info
 	{
-	    std::string name;
+	    const std::string* name;   // Interned copy of the name
 	    int depth;
 	    int kind;
 	    int offset;
 	    value_type value;
+	    int next;                  // Index of next symbol in the bucket
 	};
 
 	struct kind_info
@@ -40,9 +56,10 @@ namespace colorado
 	void clear( );
 	void enter_scope( );
 	void exit_scope( );
-	bool insert(std::string name, int kind, value_type value);
+	bool insert(const std::string& name, int kind, value_type value);
 	void register_kind(int kind, int start_offset, int delta, bool reset_for_new_scope);
-	symbol_info* seek(std::string name);
+	symbol_info* seek(const std::string& name);
+	symbol_info* seek(const std::string* interned);
 	symbol_info* seek(int depth);
 
 	int current_depth( ) const { return cd; }
@@ -60,10 +77,15 @@ namespace colorado
     private:
 	int cd;
 	symbol_info* sought;
-	std::vector<symbol_info> symbols;
+	std::vector<symbol_info> symbols;   // In order of depth, then insertion
+	std::vector<int> buckets;          // Index of top symbol, or -1
+	std::vector<int> scope_start;      // Index of first symbol of each depth
 	std::map<int, kind_info> kinds;
 	std::stack< kind_info> saved;
 	std::vector<int> kinds_to_save;
+
+	int bucket_of(const std::string* interned) const;
+	void rehash(size_t many_buckets);
     };
 }
 #include "symtab.template"
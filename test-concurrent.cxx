@@ -0,0 +1,201 @@
+//****************************************************************************
+// FILE: test-concurrent.cxx
+// Stress test of compiling many CU programs at the same time
+// Version date: Oct 18, 2026
+// This program first compiles each of the named CU programs once, by
+// itself, and keeps the assembly code and the error messages of each one.
+// Then it starts several threads, and each thread compiles all of the
+// programs again several times (each thread in a different order, and
+// half of the threads scanning the programs in place through mmap while
+// the others read them as streams).  Each compilation has its own
+// compilation struct and its own tree_arena.  Half of the threads (and the
+// first compilations) also intern the names of each program in an
+// intern_arena that is released after it, as cu --server does, while the
+// others add them to the shared pool.  The output of each compilation must
+// be the same as when the program was compiled by itself.  The number of
+// compilations whose output differed is printed at the end, and the exit
+// status is nonzero if there were any.
+// The necessary commands are the same as for cu (see cu.cxx), with
+// test-concurrent.o in place of cu.o:
+// 1. g++ -Wall -c test-concurrent.cxx
+// 2. g++ test-concurrent.o cu.tab.o cu.lex.o cu.timing.o cu.traverser.o cu.fold.o cu.types.o cu.codegen.o cu.cache.o cu.emitter.o cu.ir.o cu.peephole.o cu.object.o tree.o intern.o mapped.o -o test-concurrent -lpthread
+// You can then run the test on some programs, with the number of threads
+// and the number of times that each thread compiles each program:
+// test-concurrent --threads 8 --rounds 20 *.cu
+//*****************************************************************************
+#include <cstdio>           // Provides FILE, fopen, fclose
+#include <cstdlib>          // Provides atoi
+#include <iostream>         // Provides cout
+#include <sstream>          // Provides ostringstream
+#include <string>           // Provides string class
+#include <vector>           // Provides vector class
+#include <pthread.h>        // Provides pthread_create, pthread_join
+#include "intern.h"         // Provides the colorado::intern_arena class
+#include "tree.h"           // Provides the colorado::tree class
+#include "mapped.h"         // Provides the colorado::mapped_file class
+#include "cu.compilation.h" // Provides the compilation struct and phases
+using namespace std;        // cout and endl are in std::
+using namespace colorado;   // tree class
+
+// Everything that one compilation wrote:
+struct result
+{
+    string assembly;
+    string errors;
+};
+
+// The work of one thread:
+struct worker
+{
+    const vector<string>* programs;
+    const vector<result>* expected;
+    int number;         // 0, 1, 2, ... for the threads
+    int rounds;
+    int compilations;   // How many compilations the thread did
+    int failures;       // How many of them had the wrong output
+};
+
+// Compiles the named program as cu does, and returns its output.  If
+// mapped is true, the program is scanned in place, and otherwise it is
+// read as a stream.  The names of the program are interned in the calling
+// thread's current intern_arena, which must not be released until this
+// function has returned.
+result compile(const string& filename, bool mapped)
+{
+    ostringstream out;
+    ostringstream err;
+    compilation c(out, err);
+    tree_arena arena;
+    mapped_file* source = NULL;
+    FILE* file = NULL;
+    result answer;
+
+    tree_arena::set_current(&arena);
+    if (mapped)
+    {
+	source = new mapped_file(filename, 2);
+	if (source->is_open( ))
+	    scan_in_place(c, source->data( ), source->size( ));
+    }
+    else
+    {
+	file = fopen(filename.c_str( ), "r");
+	if (file != NULL)
+	    scan_stream(c, file);
+    }
+    if (c.scanner == NULL)
+	err << "Cannot read " << filename << "." << endl;
+    else if (!parse(c))
+	err << "Parsing failed." << endl;
+    else
+    {
+	traverse(c);
+	if (c.root->attribute<int>("Errors") != 0)
+	    err << "Errors in the traversal." << endl;
+	else
+	    codegen(c, c.root);
+    }
+    end_scan(c);
+    delete source;
+    if (file != NULL)
+	fclose(file);
+    tree_arena::set_current(NULL);
+    arena.release( );
+
+    answer.assembly = out.str( );
+    answer.errors = err.str( );
+    return answer;
+}
+
+void* work(void* p)
+{
+    worker* w = static_cast<worker*>(p);
+    size_t many = w->programs->size( );
+    size_t i, k;
+    intern_arena strings;
+    result r;
+    int round;
+
+    if ((w->number / 2) % 2 == 1)
+	intern_arena::set_current(&strings);
+    for (round = 0; round < w->rounds; ++round)
+    {
+	for (k = 0; k < many; ++k)
+	{   // Each thread starts at a different program:
+	    i = (k + w->number) % many;
+	    r = compile((*w->programs)[i], (w->number % 2) == 0);
+	    strings.release( );
+	    ++(w->compilations);
+	    if (r.assembly != (*w->expected)[i].assembly
+		|| r.errors != (*w->expected)[i].errors)
+		++(w->failures);
+	}
+    }
+    intern_arena::set_current(NULL);
+    return NULL;
+}
+
+int main(int argc, char* argv[ ])
+{
+    vector<string> programs;
+    vector<result> expected;
+    vector<worker> workers;
+    vector<pthread_t> threads;
+    intern_arena strings;
+    int many_threads = 8;
+    int rounds = 20;
+    int compilations = 0;
+    int failures = 0;
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+	if (string(argv[i]) == "--threads" && i+1 < argc)
+	    many_threads = atoi(argv[++i]);
+	else if (string(argv[i]) == "--rounds" && i+1 < argc)
+	    rounds = atoi(argv[++i]);
+	else
+	    programs.push_back(argv[i]);
+    }
+    if (programs.empty( ) || many_threads < 1 || rounds < 1)
+    {
+	cerr << "Usage: " << argv[0]
+	     << " [--threads N] [--rounds N] program.cu..." << endl;
+	return 1;
+    }
+
+    // The expected output of each program, compiled by itself (with its
+    // names kept out of the shared pool, so that the threads that have an
+    // intern_arena of their own still add them to it):
+    intern_arena::set_current(&strings);
+    for (i = 0; i < int(programs.size( )); ++i)
+    {
+	expected.push_back(compile(programs[i], false));
+	strings.release( );
+    }
+    intern_arena::set_current(NULL);
+
+    workers.resize(many_threads);
+    threads.resize(many_threads);
+    for (i = 0; i < many_threads; ++i)
+    {
+	workers[i].programs = &programs;
+	workers[i].expected = &expected;
+	workers[i].number = i;
+	workers[i].rounds = rounds;
+	workers[i].compilations = 0;
+	workers[i].failures = 0;
+	pthread_create(&threads[i], NULL, work, &workers[i]);
+    }
+    for (i = 0; i < many_threads; ++i)
+    {
+	pthread_join(threads[i], NULL);
+	compilations += workers[i].compilations;
+	failures += workers[i].failures;
+    }
+
+    cout << many_threads << " threads compiled " << programs.size( )
+	 << " programs " << compilations << " times: "
+	 << failures << " with the wrong output." << endl;
+    return (failures == 0) ? 0 : 1;
+}
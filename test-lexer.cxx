@@ -9,24 +9,33 @@
 // 2. g++ -Wall -c cs3155.lex.c
 // 3. g++ -Wall -c test-lexer.cxx
 // 4. g++ -Wall -c tree.cxx
-// 4. g++ test-lexer.o cs3155.lex.o tree.o -o test-lexer
+// 4. g++ -Wall -c intern.cxx
+// 4. g++ test-lexer.o cs3155.lex.o tree.o intern.o -o test-lexer -lpthread
 // After compilation, you can create a file called tokens.txt that
 // contains one or more instances of each kind of token that you
 // want to recognize.  You can then run this test-lexer on that
 // file with the command:
 // test-lexer <tokens.txt
 //*****************************************************************************
+#include <cstdio>          // Provides stdin
 #include <iostream>        // Provides cin and cout
+#include "tree.h"          // Provides the colorado::tree class
+#include "cu.compilation.h" // Provides the compilation struct
+#define YYSTYPE colorado::tree* // Data type attached to tokens
 #include "cu.tab.h"        // Defines the token numbers
 using namespace std;       // cout and endl are in std::
-int yylex( );              // Provided by flex
-extern char* yytext;       // Provided flex
+int yylex(YYSTYPE* lvalp, void* scanner); // Provided by flex
+char* yyget_text(void* scanner);          // Provided by flex
 const int END_OF_FILE = 0; // Token number for the end of file
 
 int main( )
 {
+    compilation c;
+    YYSTYPE value;
     int next_token;
-    while ((next_token = yylex( )) != END_OF_FILE)
+
+    scan_stream(c, stdin);
+    while ((next_token = yylex(&value, c.scanner)) != END_OF_FILE)
     {
 	switch (next_token)
 	{
@@ -87,19 +96,19 @@ int main( )
 	case COMMA: cout << "TOKEN: COMMA"; break;
 	    
 	case IDENTIFIER:
-	    cout << "IDENTIFIER: " << '\"' << yytext << '\"';
+	    cout << "IDENTIFIER: " << '\"' << yyget_text(c.scanner) << '\"';
 	    break;
 	case TYPENAME:
-	    cout << "TYPENAME: " << '\"' << yytext << '\"';
+	    cout << "TYPENAME: " << '\"' << yyget_text(c.scanner) << '\"';
 	    break;
 	case INTEGERVALUE:
-	    cout << "INTEGERVALUE: " << '\"' << yytext << '\"'; 
+	    cout << "INTEGERVALUE: " << '\"' << yyget_text(c.scanner) << '\"'; 
 	    break;
 	case STRINGVALUE:
-	    cout << "STRINGVALUE: " << '\"' << yytext << '\"'; 
+	    cout << "STRINGVALUE: " << '\"' << yyget_text(c.scanner) << '\"'; 
 	    break;
 	case FLOATVALUE:
-	    cout << "FLOATVALUE: " << '\"' << yytext << '\"'; 
+	    cout << "FLOATVALUE: " << '\"' << yyget_text(c.scanner) << '\"'; 
 	    break;
 	
 	default:
@@ -114,5 +123,6 @@ int main( )
 	cout << endl;
     }
     cout << "END OF FILE." << endl;
+    end_scan(c);
     return 0;
 }
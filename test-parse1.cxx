@@ -18,15 +18,19 @@
 // file with the command:
 // test-parse1 < sample.3155
 //*****************************************************************************
+#include <cstdio>           // Provides stdin
 #include <iostream>         // Provides cin and cout
+#include "cu.compilation.h" // Provides the compilation struct and phases
 using namespace std;        // cout and endl are in std::
-int yyparse( );             // Provided by the parser
 
 int main( )
 {
+    compilation c;
+
     cout << "Starting parsing..." << endl;
 
-    if (yyparse( ) != 0)
+    scan_stream(c, stdin);
+    if (!parse(c))
 	cout << "Parsing failed." << endl;
     else
     {
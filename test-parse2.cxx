@@ -11,41 +11,49 @@
 // 3. bison -b cu -d -v cu.y
 // 4. g++ -Wall -c cu.y.c
 // 5. g++ -Wall -c cu.traverser.cxx
-// 6. g++ -Wall -c test-parse2.cxx
-// 7. g++ -Wall -c tree.cxx
-// 8. g++ test-parse2.o cu.y.o cu.lex.o cu.traverser.o tree.o -o test-parse2
+// 6. g++ -Wall -c cu.types.cxx
+// 7. g++ -Wall -c test-parse2.cxx
+// 8. g++ -Wall -c tree.cxx
+// 9. g++ -Wall -c intern.cxx
+// 10. g++ -Wall -c cu.emitter.cxx
+// 11. g++ -Wall -c cu.ir.cxx
+// 12. g++ -Wall -c cu.timing.cxx
+// 13. g++ -Wall -c cu.fold.cxx
+// 14. g++ test-parse2.o cu.y.o cu.lex.o cu.timing.o cu.traverser.o cu.fold.o cu.types.o cu.emitter.o cu.ir.o tree.o intern.o -o test-parse2 -lpthread
 // After compilation, you can create a file called sample.3155 that
 // contains a program written in the CSCI 3155 programming language.
 // You can then run this test-parse1 on that
 // file with the command:
 // test-parse2 < sample.cu
 //*****************************************************************************
+#include <cstdio>           // Provides stdin
 #include <iostream>         // Provides cin and cout
 #include "cu.tab.h"         // Provides definitions of the token numbers
 #include "tree.h"           // Provides the colorado::tree class
+#include "cu.compilation.h" // Provides the compilation struct and phases
 using namespace std;        // cout and endl are in std::
 using namespace colorado;   // tree class
-int yyparse( );             // Provided by the parser
-void traverse( );           // Provided by cu.traverser.cxx
-extern tree* parse_tree_root_ptr; // From the parser
 #ifndef FULLTREE
 #define FULLTREE false      // Print tree's attributes?
 #endif
 
 int main( )
 {
+    compilation c;
+
     cout << "Starting parsing..." << endl;
 
-    if (yyparse( ) != 0)
+    scan_stream(c, stdin);
+    if (!parse(c))
 	cout << "Parsing failed." << endl;
     else
     {
 	cout << "Parsing OK." << endl;
-	traverse( );
-	if (parse_tree_root_ptr->attribute<int>("Errors") != 0)
+	traverse(c);
+	if (c.root->attribute<int>("Errors") != 0)
 	    cout << "Errors in the traversal." << endl;
 	else
-	    parse_tree_root_ptr->write(cout, FULLTREE);
+	    c.root->write(cout, FULLTREE);
     }
 
     return 0;
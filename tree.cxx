@@ -2,7 +2,7 @@
 // Written by Michael Main (Sep 4, 2005)
 // This is the implementation file for an attribute tree class.
 
-#include <cstdlib>       // Provides NULL
+#include <cstdlib>       // Provides NULL, malloc, free
 #include <iomanip>       // Provides setw
 #include <iostream>      // Provides ostream
 #include <string>        // Provides string class
@@ -11,33 +11,87 @@
 #include <vector>        // Provides vector class
 #include <assert.h>      // Provides assert macro
 #include <stdarg.h>      // Provides va_list, va_start, va_arg, va_end
+#include "intern.h"      // Provides intern, intern_shared
 #include "tree.h"        // Provides tree class definition
 using namespace std;
 
 namespace colorado
 {
     //----------------------------------------------------------------------
-    bool tree::new_called = false;
+    // Every tree is preceded by a node_header, which is filled in by the
+    // new operator.  The arena is NULL for a tree on the heap.
+    union node_header
+    {
+	struct
+	{
+	    tree_arena* arena;
+	} info;
+	double alignment;   // Keeps the tree itself aligned for a double
+    };
+    static node_header* header_of(const void* p)
+    {
+	return static_cast<node_header*>(const_cast<void*>(p)) - 1;
+    }
+
+    // The current arena of each thread, and the most recent tree that the
+    // new operator has allocated in this thread (but that has not yet been
+    // constructed).  Each thread has its own copy of these variables.
+    static __thread tree_arena* current_arena = NULL;
+    static __thread const void* new_tree = NULL;
+
+    // The size of every piece of memory handed out by an arena is rounded
+    // up to a multiple of this alignment.
+    static const size_t ARENA_ALIGNMENT = 2*sizeof(void*) > sizeof(double) ?
+	2*sizeof(void*) : sizeof(double);
+
+    // empty_label( ) is the interned empty string, which is the label of a
+    // tree that is created without one.  It is looked up in the pool only
+    // once, since the lexer creates every token's tree that way (and in
+    // the shared pool, since the first tree may be made in an intern_arena).
+    static const std::string& empty_label( )
+    {
+	static const std::string& answer = intern_shared("");
+	return answer;
+    }
+    //----------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------
+    // The hooks of all trees, which are NULL unless set_hooks is called:
+    const tree_hooks* tree::hooks = NULL;
+    //----------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------
+    // The keys of the fixed slots, indexed by slot_number:
+    static const char* const slot_keys[ ] =
+    {
+	"Addressable", "Bytes", "Definition", "Depth", "Errors", "Kind",
+	"LHS", "Line", "Offset", "RHS", "Reference", "Token", "Type"
+    };
     //----------------------------------------------------------------------
 
     //----------------------------------------------------------------------
     tree::tree(const std::string& label, size_t n, ...)
+	: children(arena_of_new_tree( )),
+	  attributes(std::less<std::string>( ), arena_of_new_tree( ))
     {
 	va_list arguments;    // List of the pointers to children
 	size_t i;             // Loop control variable 
 
 	// Trees can be created only through a call to new; otherwise the
 	// the destructor fails.  Therefore, trees are never local
-	// or global variables; they occur only on the heap.
-	// When new is called, it sets new_called to true.
-	// We check that it is true here, then reset it to false
-	// for the next constructor call.
-	// Note that this approach is not thread-safe.
-	assert(new_called);
-	new_called = false;
+	// or global variables; they occur only on the heap or in an arena.
+	// When new is called, it records the address of the new tree in
+	// the thread's new_tree variable.  We check that it is this tree,
+	// then reset it to NULL for the next constructor call.
+	assert(new_tree == this);
+	new_tree = NULL;
 	
-	root_label = label;  // Set the label for the root
+	// Set the label for the root:
+	root_label = label.empty( ) ? &(empty_label( )) : &(intern(label));
 	uplink = NULL;       // The root has no parent
+	clear_slots( );      // No attributes yet
 	
 	// Add the pointers to the children
 	va_start(arguments, n); // Start after n
@@ -52,18 +106,17 @@ namespace colorado
     
     //---------------------------------------------------------------------
     tree::tree(const tree& source)
+	: children(arena_of_new_tree( )),
+	  attributes(std::less<std::string>( ), arena_of_new_tree( ))
     {
 	// Trees can be created only through a call to new; otherwise the
-	// the destructor fails.  Therefore, trees are never local
-	// or global variables; they occur only on the heap.
-	// When new is called, it sets new_called to true.
-	// We check that it is true here, then reset it to false
-	// for the next constructor call.
-	// Note that this approach is not thread-safe.
-	assert(new_called);
-	new_called = false;
+	// the destructor fails.  See the other constructor.
+	assert(new_tree == this);
+	new_tree = NULL;
 
 	uplink = NULL; // Since this is a new tree.
+	root_label = &(empty_label( ));
+	clear_slots( );
 	*this = source;
     }
     //---------------------------------------------------------------------
@@ -73,7 +126,7 @@ namespace colorado
     tree& tree::operator =(const tree& source)
     {
 	size_t i;
-	map<string, attribute_struct>::const_iterator it;
+	attribute_map::const_iterator it;
 	attribute_struct a;
 
 	// Check whether this is a self-assignment
@@ -87,10 +140,19 @@ namespace colorado
 	{
 	    append_child(new tree(*(source.children[i])));
 	}
+	for (i = 0; i < MANY_SLOTS; ++i)
+	{
+	    if (source.slots[i].ops != NULL)
+	    {
+		source.slots[i].ops->copier(&(slots[i].data), &(source.slots[i].data));
+		slots[i].ops = source.slots[i].ops;
+	    }
+	}
 	for (it = source.attributes.begin( ); it != source.attributes.end( ); ++it)
 	{
 	    a = it->second;
-	    a.data_ptr = a.copier(a.data_ptr);
+	    a.data_ptr = allocate_payload(a.ops->data_size);
+	    a.ops->copier(a.data_ptr, it->second.data_ptr);
 	    attributes[it->first] = a;
 	}            
 	return *this;
@@ -101,12 +163,25 @@ namespace colorado
     //---------------------------------------------------------------------
     void* tree::operator new(size_t bytes)
     {
-	new_called = true;
-	return malloc(bytes);
+	node_header* h;
+
+	if (current_arena == NULL)
+	    h = static_cast<node_header*>(malloc(sizeof(node_header) + bytes));
+	else
+	    h = static_cast<node_header*>(current_arena->allocate(sizeof(node_header) + bytes));
+	h->info.arena = current_arena;
+	new_tree = h + 1;
+	if (hooks != NULL)
+	    hooks->node_allocated(sizeof(node_header) + bytes);
+	return h + 1;
     }
     void tree::operator delete(void* p)
     {
-	free(p);
+	node_header* h = header_of(p);
+
+	// A tree in an arena stays there until the arena is released.
+	if (h->info.arena == NULL)
+	    free(h);
     }
     //---------------------------------------------------------------------
         
@@ -125,10 +200,15 @@ namespace colorado
     //---------------------------------------------------------------------
     const std::type_info& tree::attribute_type(const std::string& key) const
     {
+	if (hooks != NULL && hooks->attribute_read != NULL)
+	    hooks->attribute_read(this, key);
+	const slot_struct* s = find_slot(key);
+	if (s != NULL)
+	    return *(s->ops->data_type);
 	if (attributes.count(key) > 0)
 	{
 	    // Cannot use attributes[key] on a const map; use find instead.
-	    return *(attributes.find(key)->second.data_type);
+	    return *(attributes.find(key)->second.ops->data_type);
 	}
 	else
 	    return typeid(void);
@@ -152,11 +232,10 @@ namespace colorado
     void tree::clear( )
     {
 	size_t i;
-	map<string, attribute_struct>::iterator it;
-	attribute_struct a;
+	attribute_map::iterator it;
 	    
 	// Reset the label to the default value
-	root_label = "";
+	root_label = &(empty_label( ));
 
 	// Clear all the children
 	for (i = 0; i < children.size( ); ++i)
@@ -166,11 +245,10 @@ namespace colorado
 	children.resize(0);
 	
 	// Clear all the attributes
+	for (i = 0; i < MANY_SLOTS; ++i)
+	    release_slot(slot_number(i));
 	for (it = attributes.begin( ); it != attributes.end( ); ++it)
-	{
-	    a = it->second;
-	    a.destroyer(a.data_ptr);
-	}
+	    release_payload(it->second);
 	attributes.clear( );
     }
     //---------------------------------------------------------------------
@@ -221,14 +299,27 @@ namespace colorado
     //---------------------------------------------------------------------
     bool tree::erase_attribute(const string& key)
     {
-	map<string, attribute_struct>::iterator it;
-	attribute_struct a;
+	slot_number n = slot_of(key);
+
+	if (n != NO_SLOT && slots[n].ops != NULL)
+	{
+	    release_slot(n);
+	    return true;
+	}
+	return erase_map_attribute(key);
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    bool tree::erase_map_attribute(const string& key)
+    {
+	attribute_map::iterator it;
 	
 	it = attributes.find(key);
 	if (it == attributes.end( ))
 	    return false;
-	a = it->second;	    
-	a.destroyer(a.data_ptr);
+	release_payload(it->second);
 	attributes.erase(it);
 	return true;
     }
@@ -261,7 +352,274 @@ namespace colorado
     //---------------------------------------------------------------------
     bool tree::is_any_attribute(const string& key) const
     {
-	return (attributes.find(key) != attributes.end( ));
+	if (hooks != NULL && hooks->attribute_read != NULL)
+	    hooks->attribute_read(this, key);
+	return find_slot(key) != NULL || (attributes.find(key) != attributes.end( ));
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    size_t tree::many_attributes( ) const
+    {
+	size_t answer = attributes.size( );
+	size_t i;
+
+	for (i = 0; i < MANY_SLOTS; ++i)
+	    if (slots[i].ops != NULL)
+		++answer;
+	return answer;
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    size_t tree::many_bytes( ) const
+    {
+	size_t answer = sizeof(node_header) + sizeof(tree);
+	attribute_map::const_iterator it;
+
+	answer += children.capacity( ) * sizeof(tree*);
+	// Each entry of the map is a node of a red-black tree (with a color
+	// and three links) that points to a copy of the value:
+	for (it = attributes.begin( ); it != attributes.end( ); ++it)
+	    answer += 4*sizeof(void*) + sizeof(*it) + it->second.ops->data_size;
+	return answer;
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    tree::slot_number tree::slot_of(const string& key)
+    {
+	// Most keys are rejected by their first letter alone.  The others
+	// need a single comparison (or two for the keys starting with L or R).
+	slot_number n;
+	
+	switch (key.size( ) > 0 ? key[0] : 0)
+	{
+	case 'A': n = ADDRESSABLE_SLOT; break;
+	case 'B': n = BYTES_SLOT; break;
+	case 'D':
+	    n = (key.size( ) > 2 && key[2] == 'f') ? DEFINITION_SLOT : DEPTH_SLOT;
+	    break;
+	case 'E': n = ERRORS_SLOT; break;
+	case 'K': n = KIND_SLOT; break;
+	case 'L':
+	    n = (key.size( ) > 1 && key[1] == 'H') ? LHS_SLOT : LINE_SLOT;
+	    break;
+	case 'O': n = OFFSET_SLOT; break;
+	case 'R':
+	    n = (key.size( ) > 1 && key[1] == 'H') ? RHS_SLOT : REFERENCE_SLOT;
+	    break;
+	case 'T':
+	    n = (key.size( ) > 1 && key[1] == 'o') ? TOKEN_SLOT : TYPE_SLOT;
+	    break;
+	default:
+	    return NO_SLOT;
+	}
+	return (key == slot_keys[n]) ? n : NO_SLOT;
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    void tree::clear_slots( )
+    {
+	size_t i;
+
+	for (i = 0; i < MANY_SLOTS; ++i)
+	    slots[i].ops = NULL;
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    tree_arena* tree::arena( ) const
+    {
+	return header_of(this)->info.arena;
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    tree_arena* tree::arena_of_new_tree( )
+    {
+	// Used by the constructors before their bodies check new_tree.
+	return (new_tree == NULL) ? NULL : header_of(new_tree)->info.arena;
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    void* tree::allocate_payload(size_t bytes)
+    {
+	tree_arena* home = arena( );
+	return (home == NULL) ? ::operator new(bytes) : home->allocate(bytes);
+    }
+    void tree::release_payload(const attribute_struct& a)
+    {
+	a.ops->destroyer(a.data_ptr);
+	if (arena( ) == NULL)
+	    ::operator delete(a.data_ptr);
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    tree_arena::tree_arena(size_t block_bytes)
+    {
+	this->block_bytes = block_bytes;
+	blocks = spares = NULL;
+	next_free = end_free = NULL;
+	used_bytes = 0;
+	block_count = 0;
+	cleanups = NULL;
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    void* tree_arena::allocate(size_t bytes)
+    {
+	// Each block starts with its link, padded to the alignment.
+	const size_t link_bytes =
+	    (sizeof(block) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+	block* b;
+	char* answer;
+	size_t size;
+
+	bytes = (bytes + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+	used_bytes += bytes;
+	if (bytes <= size_t(end_free - next_free))
+	{   // The usual case: carve the memory from the head block.
+	    answer = next_free;
+	    next_free += bytes;
+	    return answer;
+	}
+
+	size = (bytes > block_bytes/4) ? bytes : block_bytes;
+	if (size == block_bytes && spares != NULL)
+	{   // An ordinary block that was kept by reset( ):
+	    b = spares;
+	    spares = spares->next;
+	}
+	else
+	{
+	    b = static_cast<block*>(malloc(link_bytes + size));
+	    if (b == NULL)
+		throw std::bad_alloc( );
+	    b->bytes = size;
+	}
+	++block_count;
+	answer = reinterpret_cast<char*>(b) + link_bytes;
+	if (bytes > block_bytes/4 && blocks != NULL)
+	{   // A big request gets a block of its own, behind the head block.
+	    b->next = blocks->next;
+	    blocks->next = b;
+	    return answer;
+	}
+	b->next = blocks;
+	blocks = b;
+	next_free = answer + bytes;
+	end_free = answer + size;
+	return answer;
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    tree_arena::cleanup* tree_arena::add_cleanup(void (*action)(void*), void* data)
+    {
+	cleanup* c = static_cast<cleanup*>(allocate(sizeof(cleanup)));
+	c->action = action;
+	c->data = data;
+	c->next = cleanups;
+	cleanups = c;
+	return c;
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    void tree_arena::release( )
+    {
+	block* b;
+	cleanup* c;
+
+	for (c = cleanups; c != NULL; c = c->next)
+	{
+	    if (c->action != NULL)
+		c->action(c->data);
+	}
+	while (blocks != NULL)
+	{
+	    b = blocks;
+	    blocks = blocks->next;
+	    free(b);
+	}
+	while (spares != NULL)
+	{
+	    b = spares;
+	    spares = spares->next;
+	    free(b);
+	}
+	next_free = end_free = NULL;
+	used_bytes = 0;
+	block_count = 0;
+	cleanups = NULL;
+    }
+
+    void tree_arena::reset( )
+    {
+	block* b;
+	cleanup* c;
+
+	for (c = cleanups; c != NULL; c = c->next)
+	{
+	    if (c->action != NULL)
+		c->action(c->data);
+	}
+	while (blocks != NULL)
+	{
+	    b = blocks;
+	    blocks = blocks->next;
+	    if (b->bytes == block_bytes)
+	    {
+		b->next = spares;
+		spares = b;
+	    }
+	    else
+		free(b);
+	}
+	next_free = end_free = NULL;
+	used_bytes = 0;
+	block_count = 0;
+	cleanups = NULL;
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    tree_arena* tree_arena::current( )
+    {
+	return current_arena;
+    }
+    tree_arena* tree_arena::set_current(tree_arena* arena)
+    {
+	tree_arena* answer = current_arena;
+	current_arena = arena;
+	return answer;
+    }
+    //---------------------------------------------------------------------
+
+
+    //---------------------------------------------------------------------
+    const tree_hooks* tree::set_hooks(const tree_hooks* hooks)
+    {
+	const tree_hooks* answer = tree::hooks;
+	tree::hooks = hooks;
+	return answer;
     }
     //---------------------------------------------------------------------
 
@@ -270,18 +628,35 @@ namespace colorado
     void tree::write(ostream& out, bool print_attributes, int indentation) const
     {
 	size_t i;
-	map<string, attribute_struct>::const_iterator it;
-	attribute_struct a;
+	attribute_map::const_iterator it;
 
-	// Print the label and attributes of the root:
-	out << setw(indentation) << "" << "==>" << root_label << endl;
+	// Print the label and attributes of the root.  The slots and the
+	// map are each in order by key, so they are merged as they print.
+	out << setw(indentation) << "" << "==>" << *root_label << endl;
 	if (print_attributes)
 	{
-	    for (it = attributes.begin( ); it != attributes.end( ); ++it)
+	    i = 0;
+	    it = attributes.begin( );
+	    while (i < MANY_SLOTS || it != attributes.end( ))
 	    {
-		out << setw(indentation) << "   " << "|" << it->first << "| ";
-		a = it->second;
-		a.printer(out, a.data_ptr);
+		if (i < MANY_SLOTS && slots[i].ops == NULL)
+		{
+		    ++i;
+		    continue;
+		}
+		out << setw(indentation) << "   " << "|";
+		if (it == attributes.end( ) || (i < MANY_SLOTS && it->first > slot_keys[i]))
+		{
+		    out << slot_keys[i] << "| ";
+		    slots[i].ops->printer(out, &(slots[i].data));
+		    ++i;
+		}
+		else
+		{
+		    out << it->first << "| ";
+		    it->second.ops->printer(out, it->second.data_ptr);
+		    ++it;
+		}
 		out << endl;
 	    }
 	}
@@ -3,16 +3,23 @@
 // This is the header file for an attribute tree class.
 //
 // A tree object is a non-empty tree.
-// Threads: The tree is not safe to use in multi-threaded applications.
+// Threads: A single tree must not be used by several threads at once, but
+// different threads may build and use different trees at the same time.
 // Dynamic restriction: Trees can be created only through a call to new.
 // Therefore, trees cannot be local variables, global variables, or
 // value parameters.  In general, use a pointer to a tree object rather
 // than declaring a tree variable directly.
+// Arenas: If a tree_arena is the current arena of the calling thread, then
+// new trees (with their children lists and attribute values) are carved out
+// of that arena instead of being allocated one at a time on the heap.  See
+// the tree_arena class below.
 
 // The root of each tree has these items:
 // 1. A string label.
 //    This label can be set by the constructor or by the set_label( ) member
 //    function.  It can be retrieved with the label( ) member function.
+//    Labels are interned (see intern.h), so the labels of two trees are
+//    equal if and only if &(p->label( )) == &(q->label( )).
 // 2. A collection of named attributes.
 //    Activating the member function set_attribute<T>(key, v) sets an attribute.
 //    The key argument is the name of the attribute; the v argument (of type
@@ -20,6 +27,13 @@
 //    later be retrieved via the member function attribute<T>(key).
 //    Warning: If an attribute is set using a set_attribute<T> with a type T,
 //    then it must be retrieved using the same type <T> with attribute<T>.
+//    Storage: The attributes that the CU compiler uses on almost every node
+//    ("Addressable", "Bytes", "Definition", "Depth", "Errors", "Kind", "LHS",
+//    "Line", "Offset", "RHS", "Reference", "Token" and "Type") are kept in
+//    fixed slots inside the node whenever their value fits in eight bytes.
+//    Any other attribute is kept in a map from its key to a copy of the
+//    value on the heap (or in the tree's arena).  The difference is
+//    invisible through the member functions.
 // 3. Zero or more children.
 //    Each child is implemented as a pointer to a non-empty subtree.
 //    These children may be set by the constructor, the append_child member
@@ -131,9 +145,19 @@
 //     the return value is false.
 //
 //   const string& label( ) const
-//   string& label( ) { return root_label; }
 //     Postcondition: The return value is a reference to the label of the
-//     root of this tree.
+//     root of this tree.  This is the interned copy of the label, which is
+//     shared with every other use of the same string.
+//
+//   size_t many_attributes( ) const
+//     Postcondition: The return value is the number of attributes attached
+//     to the root of this tree (whether they are in slots or in the map).
+//
+//   size_t many_bytes( ) const
+//     Postcondition: The return value is the number of bytes of memory that
+//     the root of this tree takes: the node itself, its list of children and
+//     the attributes in the map (approximately, for the map), but not its
+//     subtrees or its label.
 //
 //   size_t many_children( ) const
 //     Postcondition: The return value is the number of children possessed by
@@ -153,42 +177,215 @@
 //     key, then that attribute has been removed (and its memory released).
 //     The attribute can later be retrieved with attribute<T>(key).
 //
-//   void set_label(const string label)
+//   void set_label(const string& label)
 //     Postcondition: The label of the root of this tree has been changed
 //     to the specified value.
 //
+//   void set_interned_label(const string& label)
+//     Precondition: label is a string that was returned by intern (see
+//     intern.h), such as the label( ) of another tree.
+//     Postcondition: The label of the root of this tree has been changed to
+//     label.  Unlike set_label, this does not look up the label in the pool
+//     again, so it is the cheaper way to label a new tree with a lexeme.
+//
 //   void write(ostream& out, bool print_attributes = true, int indentation = 0)
 //     Postcondition: A representation of this tree (including all labels and
 //     attributes) has been printed to the specified ostream.  All output lines
 //     in this representation are indented by the specified amount.  If
 //     print_attributes is true, then each nodes attributes will be printed
 //     below its label.
+//
+//   static const tree_hooks* set_hooks(const tree_hooks* hooks)
+//     Postcondition: hooks (which may be NULL) is now the tree_hooks of all
+//     trees in all threads, and the return value is the previous one.  See
+//     the tree_hooks struct below.
+//
+// THE tree_hooks STRUCT:
+//   A program that wants to watch the memory used by trees (such as the
+//   memory report of cu) can give set_hooks a tree_hooks with these
+//   functions:
+//     node_allocated(bytes) is called by the new operator for each new tree
+//       that takes bytes bytes (including the header in front of it);
+//     attribute_set(p, key, bytes) is called by set_attribute after the
+//       attribute with the given key has been set on the tree *p.  bytes is
+//       0 for a value that is kept in a fixed slot, or the size of the copy
+//       of the value that the map holds;
+//     attribute_read(p, key), which may be NULL, is called by attribute,
+//       attribute_type, is_attribute and is_any_attribute for each lookup of
+//       the key on the tree *p.
+//   The functions may be called by several threads at once.  With no hooks
+//   (the default), each of these places costs only a test of one pointer.
+//
+// THE tree_arena CLASS:
+//   A tree_arena hands out memory from large blocks.  Nothing is returned
+//   to the arena one piece at a time; instead, release( ) returns all of
+//   the blocks at once, without running any destructors.  A compilation
+//   that builds all of its trees in one arena can therefore drop them all
+//   at the end in time proportional to the number of blocks.  Each arena
+//   is meant to be used by one thread at a time.
+//
+//   tree_arena(size_t block_bytes = 65536)
+//     Postcondition: The arena is empty.  It will get its memory from the
+//     heap in blocks of block_bytes bytes (or bigger for big requests).
+//
+//   ~tree_arena( )
+//     The destructor calls release( ).
+//
+//   void* allocate(size_t bytes)
+//     Postcondition: The return value points to bytes bytes of memory
+//     (suitably aligned for any attribute value) that remain in use until
+//     the next release( ).
+//
+//   cleanup* add_cleanup(void (*action)(void*), void* data)
+//     Postcondition: action(data) will be called by the next release( ),
+//     before any block is returned to the heap.  The action may be cancelled
+//     earlier by setting the action member of the returned cleanup to NULL.
+//
+//   size_t bytes_allocated( ) const
+//   size_t many_blocks( ) const
+//     Postcondition: The return value is the number of bytes handed out
+//     (or the number of blocks obtained) since the last release( ).
+//
+//   void release( )
+//     Postcondition: The pending cleanups have been run and all blocks have
+//     been returned to the heap.  Any tree in the arena is gone, and the
+//     destructors of its attribute values have not been called (so values
+//     that own other memory should not be attached to trees in an arena).
+//
+//   void reset( )
+//     Postcondition: The same as release( ), except that the blocks of the
+//     ordinary size are kept as spares, and allocate uses them before it
+//     gets any new blocks from the heap.  So an arena that is reset after
+//     each of many similar jobs (as in cu --server) stops calling malloc
+//     once it has grown to the size of the biggest job.
+//
+//   static tree_arena* current( )
+//   static tree_arena* set_current(tree_arena* arena)
+//     Each thread has its own current arena, which is NULL at the start.
+//     The set_current function changes the calling thread's current arena
+//     (NULL means the heap) and returns the previous one.  A tree is always
+//     allocated in the current arena of the thread that calls new.
 
 #ifndef COLORADO_TREE
 #define COLORADO_TREE
+#include <cstddef>       // Provides size_t, ptrdiff_t
 #include <iostream>      // Provides ostream
+#include <new>           // Provides placement new
 #include <string>        // Provides string class
 #include <map>           // Provides map class
 #include <typeinfo>      // Provides type_info and typeid
 #include <vector>        // Provides vector class
 #include <assert.h>      // Provides assert macro
+#include "intern.h"      // Provides intern
 
 namespace colorado
 {
-    // destroy<T>(p) interprets *p as a T data value that was allocated
-    // on the heap.  This function deletes this T object (calling its
-    // destructor and returning its memory to the heap).
-    template<typename T> void destroy(void* p)
+    class tree_arena
+    {
+    public:
+	// A cleanup is one pending call of add_cleanup.
+	struct cleanup
+	{
+	    void (*action)(void*);
+	    void* data;
+	    cleanup* next;
+	};
+
+	tree_arena(size_t block_bytes = 65536);
+	~tree_arena( ) { release( ); }
+	void* allocate(size_t bytes);
+	cleanup* add_cleanup(void (*action)(void*), void* data);
+	size_t bytes_allocated( ) const { return used_bytes; }
+	size_t many_blocks( ) const { return block_count; }
+	void release( );
+	void reset( );
+	static tree_arena* current( );
+	static tree_arena* set_current(tree_arena* arena);
+    private:
+	// Every block starts with a pointer to the next block in the list,
+	// and its size (not counting this header).
+	struct block
+	{
+	    block* next;
+	    size_t bytes;
+	};
+	size_t block_bytes;   // Size of an ordinary block
+	block* blocks;        // Head of the list of blocks in use
+	block* spares;        // Ordinary blocks kept by reset( )
+	char* next_free;      // Next unused byte of the head block
+	char* end_free;       // One past the last byte of the head block
+	size_t used_bytes;    // Bytes handed out by allocate
+	size_t block_count;   // Number of blocks in the list
+	cleanup* cleanups;    // Pending cleanups, most recent first
+
+	// An arena cannot be copied:
+	tree_arena(const tree_arena&);
+	void operator =(const tree_arena&);
+    };
+
+    // An arena_allocator<T> is a standard allocator that gets its memory
+    // from an arena (or from the heap if the arena is NULL).  Memory that
+    // came from an arena is never given back by deallocate.
+    template <typename T> class arena_allocator
+    {
+    public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+	template <typename U> struct rebind { typedef arena_allocator<U> other; };
+
+	arena_allocator(tree_arena* arena = NULL) : home(arena) { }
+	template <typename U> arena_allocator(const arena_allocator<U>& source)
+	    : home(source.home) { }
+	pointer address(reference x) const { return &x; }
+	const_pointer address(const_reference x) const { return &x; }
+	pointer allocate(size_type n, const void* = 0)
+	{
+	    if (home == NULL)
+		return static_cast<pointer>(::operator new(n * sizeof(T)));
+	    return static_cast<pointer>(home->allocate(n * sizeof(T)));
+	}
+	void deallocate(pointer p, size_type)
+	{
+	    if (home == NULL)
+		::operator delete(p);
+	}
+	size_type max_size( ) const { return size_type(-1) / sizeof(T); }
+	void construct(pointer p, const T& value) { new (p) T(value); }
+	void destroy(pointer p) { p->~T( ); }
+
+	tree_arena* home;     // Where the memory comes from (NULL for the heap)
+    };
+    template <typename T, typename U>
+    bool operator ==(const arena_allocator<T>& a, const arena_allocator<U>& b)
+    {
+	return a.home == b.home;
+    }
+    template <typename T, typename U>
+    bool operator !=(const arena_allocator<T>& a, const arena_allocator<U>& b)
     {
-	delete static_cast<T*>(p);
+	return a.home != b.home;
     }
 
-    // copy<T>(p) interprets *p as a T data value.  This function makes
-    // a copy of this value, using T's copy constructor. The return value
-    // is a pointer to the newly created T object.
-    template<typename T> void* copy(const void* p)
+    // destroy_in_place<T>(p) interprets *p as a T data value that was
+    // constructed with placement new inside a tree's attribute slot (or in
+    // memory that belongs to the tree).  This function calls the T
+    // destructor but does not release any memory.
+    template<typename T> void destroy_in_place(void* p)
     {
-	return static_cast<void*> (new T(*(static_cast<const T*>(p))));
+	static_cast<T*>(p)->~T( );
+    }
+
+    // copy_in_place<T>(target, p) interprets *p as a T data value.  This
+    // function uses T's copy constructor to construct a copy of this value
+    // in the raw memory at target (which must be big enough for a T).
+    template<typename T> void copy_in_place(void* target, const void* p)
+    {
+	new (target) T(*(static_cast<const T*>(p)));
     }
 
     // If data of type T can be printed with the usual << operator, then
@@ -219,39 +416,151 @@ namespace colorado
 	    out << "(value of type " << typeid(T).name() << " cannot be printed)";
     }
 
+    class tree;
+    struct tree_hooks
+    {
+	void (*node_allocated)(size_t bytes);
+	void (*attribute_set)(const tree* p, const std::string& key, size_t bytes);
+	void (*attribute_read)(const tree* p, const std::string& key);
+    };
+
     class tree
     {
     protected:
-	// An attribute_struct contains information about an attribute that's
-	// attached to the root of a tree.  The data_ptr points to the actual
-	// value of the attribute. The type_info for this information is in
-	// *data_type.  The other three members are pointers to functions.
-	// If the type of the attribute value is T, then:
-	//   destroyer(p) points to destroy<T>
-	//   copier(p) points to  copy<T>
-	//   print(p) points to print<T>
-        struct attribute_struct
+	// An attribute_ops contains information about the type of an
+	// attribute value.  The type_info for this type is in *data_type, and
+	// data_size is the size of one value.  The other three members are
+	// pointers to functions.  If the type of the attribute value is T, then:
+	//   destroyer(p) points to destroy_in_place<T>
+	//   copier(target, p) points to copy_in_place<T>
+	//   printer(out, p) points to print<T>
+	// There is a single attribute_ops for each type T, and it is shared by
+	// every attribute that holds a T.
+	struct attribute_ops
 	{
-	    void* data_ptr;
 	    const std::type_info* data_type;
+	    size_t data_size;
 	    void (*destroyer)(void*);
-	    void* (*copier)(const void*);
+	    void (*copier)(void*, const void*);
 	    void (*printer)(std::ostream&, const void*); 
 	};
+
+	// An attribute_struct contains information about an attribute in the
+	// map.  The data_ptr points to the actual value of the attribute,
+	// which was placed in memory from allocate_payload.
+        struct attribute_struct
+	{
+	    void* data_ptr;
+	    const attribute_ops* ops;
+	};
+
+	// The fixed slots, in alphabetical order of their keys so that
+	// write( ) can list them along with the map in sorted order.
+	enum slot_number
+	{
+	    NO_SLOT = -1,
+	    ADDRESSABLE_SLOT, BYTES_SLOT, DEFINITION_SLOT, DEPTH_SLOT,
+	    ERRORS_SLOT, KIND_SLOT, LHS_SLOT, LINE_SLOT, OFFSET_SLOT,
+	    RHS_SLOT, REFERENCE_SLOT, TOKEN_SLOT, TYPE_SLOT,
+	    MANY_SLOTS
+	};
+
+	// A slot_struct holds one attribute in place.  The ops pointer is NULL
+	// if the slot is not in use.  Otherwise, data contains a T value that
+	// was constructed with placement new, and ops points to ops_for<T>( ).
+	struct slot_struct
+	{
+	    const attribute_ops* ops;
+	    union
+	    {
+		void* pointer_value;
+		long long_value;
+		double double_value;
+		char bytes[8];
+	    } data;
+	};
+
+	// ops_for<T>( ) is the shared attribute_ops for values of type T.
+	template <typename T> static const attribute_ops* ops_for( )
+	{
+	    static const attribute_ops answer =
+		{ &(typeid(T)), sizeof(T), destroy_in_place<T>, copy_in_place<T>, print<T> };
+	    return &answer;
+	}
+
+	// is_slot_type<T>( ) is true if a T value fits into a slot.
+	template <typename T> static bool is_slot_type( )
+	{
+	    return sizeof(T) <= sizeof(((slot_struct*) 0)->data);
+	}
+
+	// slot_of(key) is the slot for the key, or NO_SLOT if the key is
+	// not one of the keys with a fixed slot.
+	static slot_number slot_of(const std::string& key);
+
+	// find_slot(key) is the slot that currently holds the attribute
+	// with the given key, or NULL if that attribute is not in a slot.
+	const slot_struct* find_slot(const std::string& key) const
+	{
+	    slot_number n = slot_of(key);
+	    if (n == NO_SLOT || slots[n].ops == NULL)
+		return NULL;
+	    return &(slots[n]);
+	}
+	slot_struct* find_slot(const std::string& key)
+	{
+	    slot_number n = slot_of(key);
+	    if (n == NO_SLOT || slots[n].ops == NULL)
+		return NULL;
+	    return &(slots[n]);
+	}
+
+	// has_attribute<T>(key) is is_attribute<T>(key), without the hook.
+	template <typename T> bool has_attribute(const std::string& key) const
+	{
+	    const slot_struct* s = find_slot(key);
+	    if (s != NULL)
+		return typeid(T) == *(s->ops->data_type);
+	    if (attributes.count(key) > 0)
+	    {
+		// Cannot use attributes[key] on a const map; use find instead.
+		return typeid(T) == *(attributes.find(key)->second.ops->data_type);
+	    }
+	    else
+		return false;
+	}
+
+	// release_slot(n) destroys any value in slot n and marks it unused.
+	void release_slot(slot_number n)
+	{
+	    if (slots[n].ops != NULL)
+	    {
+		slots[n].ops->destroyer(&(slots[n].data));
+		slots[n].ops = NULL;
+	    }
+	}
 	
+	// The children and the attribute map get their memory from the same
+	// arena as the tree itself (or from the heap).
+	typedef std::vector<tree*, arena_allocator<tree*> > child_vector;
+	typedef std::map<
+	    std::string, attribute_struct, std::less<std::string>,
+	    arena_allocator<std::pair<const std::string, attribute_struct> >
+	    > attribute_map;
+
 	// Information about the root of this tree:
-        std::string root_label;        // Label of the root
+        const std::string* root_label; // Interned label of the root
         tree* uplink;                  // Pointer to parent
-        std::vector<tree*> children;   // Ptrs to children
+        child_vector children;         // Ptrs to children
     
 	// Information about the attributes attached to the root.
-	// attributes[xxx] is the attribute that was attached with key xxx.
-	std::map<std::string, attribute_struct> attributes;
+	// slots[n] holds the attribute for the n-th well-known key, and
+	// attributes[xxx] is any other attribute that was attached with key xxx.
+	slot_struct slots[MANY_SLOTS];
+	attribute_map attributes;
 
-	// The following varible is set to true by the new operator
-	// whenever a new tree is being allocated.  The constructor
-	// sets it back to false.
-	static bool new_called;
+	// The hooks of all trees (see set_hooks), or NULL:
+	static const tree_hooks* hooks;
     public:
         tree(const std::string& label = std::string( ), size_t n = 0, ...);
         tree(const tree& source);
@@ -264,12 +573,22 @@ namespace colorado
 	template <typename T> const T& attribute(const std::string& key) const
 	{
 	    assert(is_attribute_details<T>(key));
+	    if (hooks != NULL && hooks->attribute_read != NULL)
+		hooks->attribute_read(this, key);
+	    const slot_struct* s = find_slot(key);
+	    if (s != NULL)
+		return *(static_cast<const T*>(static_cast<const void*>(&(s->data))));
 	    // Cannot use attributes[key] on a const map; use find instead.
 	    return *(static_cast<T*>(attributes.find(key)->second.data_ptr)); 
 	}
 	template <typename T> T& attribute(const std::string& key)
 	{
 	    assert(is_attribute_details<T>(key));
+	    if (hooks != NULL && hooks->attribute_read != NULL)
+		hooks->attribute_read(this, key);
+	    slot_struct* s = find_slot(key);
+	    if (s != NULL)
+		return *(static_cast<T*>(static_cast<void*>(&(s->data))));
 	    return *(static_cast<T*>(attributes[key].data_ptr)); 
 	}
 	const std::type_info& attribute_type(const std::string& key) const;  
@@ -284,17 +603,13 @@ namespace colorado
         void insert_child(size_t n, tree* p);
         template <typename T> bool is_attribute(const std::string& key) const
 	{
-	    if (attributes.count(key) > 0)
-	    {
-		// Cannot use attributes[key] on a const map; use find instead.
-		return typeid(T) == *(attributes.find(key)->second.data_type);
-	    }
-	    else
-		return false;
+	    if (hooks != NULL && hooks->attribute_read != NULL)
+		hooks->attribute_read(this, key);
+	    return has_attribute<T>(key);
 	}
         template <typename T> bool is_attribute_details(const std::string& key) const
 	{
-	    if (!is_attribute<T>(key))
+	    if (!has_attribute<T>(key))
 	    {
 		write(std::cerr);
 		std::cerr << "Trying to find "  << key << " attribute "
@@ -305,30 +620,52 @@ namespace colorado
 		return true;
 	}
         bool is_any_attribute(const std::string& key) const;
-        const std::string& label( ) const { return root_label; }
-        std::string& label( ) { return root_label; }
+        const std::string& label( ) const { return *root_label; }
+        size_t many_attributes( ) const;
+        size_t many_bytes( ) const;
         size_t many_children( ) const { return children.size( ); }
         tree* parent( ) { return uplink; }
         const tree* parent( ) const { return uplink; }
         template <typename T> void set_attribute(const std::string& key, T data)
 	{
-	    T* p = new T(data); // A new T object that is a copy of data
+	    slot_number n = slot_of(key);
+	    if (n != NO_SLOT && is_slot_type<T>( ))
+	    {   // A well-known key whose value is kept in place.
+		if (!attributes.empty( ))
+		    erase_map_attribute(key);
+		release_slot(n);
+		new (&(slots[n].data)) T(data);
+		slots[n].ops = ops_for<T>( );
+		if (hooks != NULL)
+		    hooks->attribute_set(this, key, 0);
+		return;
+	    }
+	    if (n != NO_SLOT)
+		release_slot(n);
+
+	    // A new T object that is a copy of data:
+	    void* p = new (allocate_payload(sizeof(T))) T(data);
             attribute_struct a;
 
             if (attributes.count(key) > 0)
-	    {
-		a = attributes[key];	    
-		a.destroyer(a.data_ptr);
-	    }
+		release_payload(attributes[key]);
 	    a.data_ptr = p;
-	    a.data_type = &(typeid(T));
-	    a.destroyer = destroy<T>;
-	    a.copier = copy<T>;
-	    a.printer = print<T>;
+	    a.ops = ops_for<T>( );
 	    attributes[key] = a;
+	    if (hooks != NULL)
+		hooks->attribute_set(this, key, sizeof(T));
 	}
-	void set_label(const std::string label) { root_label = label; }
+	void set_label(const std::string& label) { root_label = &(intern(label)); }
+	void set_interned_label(const std::string& label) { root_label = &label; }
 	void write(std::ostream& out, bool print_attributes = true, int indentation = 0) const;
+	static const tree_hooks* set_hooks(const tree_hooks* hooks);
+    private:
+	bool erase_map_attribute(const std::string& key);
+	void clear_slots( );
+	tree_arena* arena( ) const;
+	void* allocate_payload(size_t bytes);
+	void release_payload(const attribute_struct& a);
+	static tree_arena* arena_of_new_tree( );
     };
 
 }